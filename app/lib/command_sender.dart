@@ -0,0 +1,62 @@
+import 'dart:async';
+
+/// Sends one request, e.g. LedState.post.
+typedef CommandSend = Future<void> Function(String path, Map<String, dynamic> body);
+
+/// Sends commands with at most one request in flight per path, latest value wins.
+///
+/// A slider fires a change for every pixel it moves, far faster than the controller answers. Firing a request
+/// per change piles them up and lets them arrive out of order, so the LED lags behind the slider and can settle
+/// on an old value. Here the first change goes out right away; changes made while it is in flight replace each
+/// other, and only the newest is sent once the request completes. The round trip sets the pace, so a fast
+/// network sees every step and a slow one skips intermediate values, and the last value sent is always the
+/// last value set.
+class CommandSender {
+  CommandSender(this._send);
+
+  final CommandSend _send;
+  final Map<String, _Channel> _channels = {};
+
+  /// Requests currently waiting for an answer, across all paths.
+  int get inFlight => _channels.values.where((channel) => channel.busy).length;
+
+  /// Queues body for path, replacing any body still waiting there. Completes once body, or a newer body for
+  /// the same path that replaced it, has been sent, with that request's error if it failed.
+  Future<void> send(String path, Map<String, dynamic> body) {
+    final channel = _channels.putIfAbsent(path, _Channel.new);
+    final done = Completer<void>();
+    channel.pending = body;
+    channel.waiters.add(done);
+    if (!channel.busy) {
+      _drain(path, channel);
+    }
+    return done.future;
+  }
+
+  Future<void> _drain(String path, _Channel channel) async {
+    channel.busy = true;
+    while (channel.pending != null) {
+      final body = channel.pending!;
+      final waiters = List.of(channel.waiters);
+      channel.pending = null;
+      channel.waiters.clear();
+      try {
+        await _send(path, body);
+        for (var waiter in waiters) {
+          waiter.complete();
+        }
+      } catch (error, stackTrace) {
+        for (var waiter in waiters) {
+          waiter.completeError(error, stackTrace);
+        }
+      }
+    }
+    channel.busy = false;
+  }
+}
+
+class _Channel {
+  bool busy = false;
+  Map<String, dynamic>? pending;
+  final List<Completer<void>> waiters = [];
+}
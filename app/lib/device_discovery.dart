@@ -0,0 +1,201 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:io';
+
+import 'package:http/http.dart' as http;
+import 'package:multicast_dns/multicast_dns.dart';
+import 'package:shared_preferences/shared_preferences.dart';
+
+/// DNS-SD service type the firmware advertises (see firmware/main/discovery.c).
+const String ledServiceType = '_ledctl._tcp';
+
+/// A controller found on the network, or remembered from an earlier run.
+class LedDevice {
+  const LedDevice({
+    required this.id,
+    required this.name,
+    required this.host,
+    required this.port,
+    this.version = '',
+    this.pixels = 0,
+    this.capabilities = const {},
+  });
+
+  /// Last 3 MAC bytes, stays the same when DHCP hands out a new address.
+  final String id;
+  final String name;
+  final String host;
+  final int port;
+  final String version;
+  final int pixels;
+  final Set<String> capabilities;
+
+  String get authority => port == 80 ? host : '$host:$port';
+
+  Uri uri(String path) => Uri.http(authority, path);
+
+  Uri wsUri(String path) => Uri(scheme: 'ws', host: host, port: port, path: path);
+
+  bool hasCapability(String capability) => capabilities.contains(capability);
+
+  Map<String, dynamic> toJson() => {
+    'id': id,
+    'name': name,
+    'host': host,
+    'port': port,
+    'version': version,
+    'pixels': pixels,
+    'caps': capabilities.toList(),
+  };
+
+  factory LedDevice.fromJson(Map<String, dynamic> json) => LedDevice(
+    id: json['id'] as String,
+    name: json['name'] as String,
+    host: json['host'] as String,
+    port: json['port'] as int,
+    version: json['version'] as String? ?? '',
+    pixels: json['pixels'] as int? ?? 0,
+    capabilities: {for (var cap in json['caps'] as List? ?? const []) cap as String},
+  );
+
+  /// Builds a device from the TXT record entries (id, version, pixels, caps).
+  factory LedDevice.fromTxt(String name, String host, int port, Map<String, String> txt) => LedDevice(
+    id: txt['id'] ?? name,
+    name: name,
+    host: host,
+    port: port,
+    version: txt['version'] ?? '',
+    pixels: int.tryParse(txt['pixels'] ?? '') ?? 0,
+    capabilities: (txt['caps'] ?? '').split(',').where((cap) => cap.isNotEmpty).toSet(),
+  );
+}
+
+/// The part of an mDNS client discovery uses, so tests can answer queries without a network.
+abstract class ServiceBrowser {
+  Future<void> start();
+  Stream<T> lookup<T extends ResourceRecord>(ResourceRecordQuery query, {Duration timeout});
+  void stop();
+}
+
+class MdnsServiceBrowser implements ServiceBrowser {
+  final MDnsClient _client = MDnsClient();
+
+  @override
+  Future<void> start() => _client.start();
+
+  @override
+  Stream<T> lookup<T extends ResourceRecord>(ResourceRecordQuery query, {Duration timeout = const Duration(seconds: 3)}) =>
+    _client.lookup<T>(query, timeout: timeout);
+
+  @override
+  void stop() => _client.stop();
+}
+
+extension _FirstOrNull<T> on Stream<T> {
+  // Lookups end at their timeout, possibly without an answer
+  Future<T?> firstOrNull() async {
+    await for (var value in this) {
+      return value;
+    }
+    return null;
+  }
+}
+
+/// Splits TXT strings ("key=value", one per line as multicast_dns joins them) into a map.
+Map<String, String> parseTxt(String text) {
+  final entries = <String, String>{};
+  for (var line in const LineSplitter().convert(text)) {
+    final separator = line.indexOf('=');
+    if (separator > 0) {
+      entries[line.substring(0, separator)] = line.substring(separator + 1);
+    }
+  }
+  return entries;
+}
+
+/// Browses for _ledctl._tcp and resolves each instance: SRV for host and port, TXT for details, A for the address.
+class DeviceDiscovery {
+  DeviceDiscovery({ServiceBrowser Function()? browserFactory, this.timeout = const Duration(seconds: 3)})
+    : _browserFactory = browserFactory ?? MdnsServiceBrowser.new;
+
+  final ServiceBrowser Function() _browserFactory;
+  final Duration timeout;
+
+  Future<List<LedDevice>> discover() async {
+    final browser = _browserFactory();
+    await browser.start();
+    final devices = <String, LedDevice>{};
+    try {
+      final instances = await browser
+        .lookup<PtrResourceRecord>(ResourceRecordQuery.serverPointer('$ledServiceType.local'), timeout: timeout)
+        .map((ptr) => ptr.domainName)
+        .toSet();
+      for (var instance in instances) {
+        final device = await _resolve(browser, instance);
+        if (device != null) {
+          devices[device.id] = device;
+        }
+      }
+    } finally {
+      browser.stop();
+    }
+    return devices.values.toList();
+  }
+
+  Future<LedDevice?> _resolve(ServiceBrowser browser, String instance) async {
+    final srv = await browser
+      .lookup<SrvResourceRecord>(ResourceRecordQuery.service(instance), timeout: timeout)
+      .firstOrNull();
+    if (srv == null) return null;
+    final txt = await browser
+      .lookup<TxtResourceRecord>(ResourceRecordQuery.text(instance), timeout: timeout)
+      .firstOrNull();
+    final address = await browser
+      .lookup<IPAddressResourceRecord>(ResourceRecordQuery.addressIPv4(srv.target), timeout: timeout)
+      .firstOrNull();
+    // Without an A record the .local name still works where the OS resolves mDNS
+    final host = address?.address.address ?? srv.target;
+    final name = instance.endsWith('.$ledServiceType.local')
+      ? instance.substring(0, instance.length - '.$ledServiceType.local'.length)
+      : instance;
+    return LedDevice.fromTxt(name, host, srv.port, parseTxt(txt?.text ?? ''));
+  }
+}
+
+/// Remembers discovered devices and the selected one across app restarts, so the app can
+/// send requests right away and only browses again when a device stops answering.
+class DeviceCache {
+  static const _devicesKey = 'led_devices';
+  static const _selectedKey = 'led_selected_device';
+
+  Future<List<LedDevice>> loadDevices() async {
+    final prefs = await SharedPreferences.getInstance();
+    final stored = prefs.getString(_devicesKey);
+    if (stored == null) return [];
+    try {
+      return [for (var json in jsonDecode(stored) as List) LedDevice.fromJson(json as Map<String, dynamic>)];
+    } on FormatException {
+      return [];
+    } on TypeError {
+      return [];
+    }
+  }
+
+  Future<void> saveDevices(List<LedDevice> devices) async {
+    final prefs = await SharedPreferences.getInstance();
+    await prefs.setString(_devicesKey, jsonEncode([for (var device in devices) device.toJson()]));
+  }
+
+  Future<String?> loadSelectedId() async {
+    final prefs = await SharedPreferences.getInstance();
+    return prefs.getString(_selectedKey);
+  }
+
+  Future<void> saveSelectedId(String id) async {
+    final prefs = await SharedPreferences.getInstance();
+    await prefs.setString(_selectedKey, id);
+  }
+}
+
+/// True for errors that mean the device is not at its cached address anymore.
+bool isUnreachable(Object error) => error is http.ClientException || error is SocketException || error is TimeoutException;
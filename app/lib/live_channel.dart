@@ -0,0 +1,225 @@
+import 'dart:async';
+import 'dart:io';
+import 'dart:typed_data';
+
+/// Operation codes of the live channel's binary messages (see firmware/main/live_protocol.h).
+abstract final class LiveOp {
+  static const state = 1;
+  static const mode = 2;
+  static const duration = 3;
+  static const color = 4;
+  static const pixels = 5;
+  static const preview = 6;
+}
+
+/// First byte of the preview frames the controller sends back, never an operation.
+const int liveFrameMessage = 0x80;
+
+/// LED modes by their firmware value (led_mode_t). Morse Code needs a string and stays on HTTP.
+enum LiveMode { light, blinky, morse, audio }
+
+/// Builds one live channel message: operations applied in order on the device as a single change,
+/// like a /batch. Multi-byte fields are little-endian.
+class LiveMessage {
+  final BytesBuilder _bytes = BytesBuilder();
+
+  LiveMessage state(bool on) => _add([LiveOp.state, on ? 1 : 0]);
+
+  LiveMessage mode(LiveMode mode) => _add([LiveOp.mode, mode.index]);
+
+  LiveMessage duration(int milliseconds) =>
+    _add([LiveOp.duration, ..._uint32(milliseconds)]);
+
+  LiveMessage color(int red, int green, int blue, [int white = 0]) =>
+    _add([LiveOp.color, red, green, blue, white]);
+
+  LiveMessage pixels(int start, int count, int red, int green, int blue, [int white = 0]) =>
+    _add([LiveOp.pixels, ..._uint16(start), ..._uint16(count), red, green, blue, white]);
+
+  /// Asks for preview frames at up to fps per second on this connection, 0 stops them. Not an LED change.
+  LiveMessage preview(int fps) => _add([LiveOp.preview, fps]);
+
+  Uint8List toBytes() => _bytes.toBytes();
+
+  LiveMessage _add(List<int> bytes) {
+    _bytes.add(bytes);
+    return this;
+  }
+
+  static List<int> _uint16(int value) => [value & 0xff, value >> 8 & 0xff];
+
+  static List<int> _uint32(int value) => [..._uint16(value), ..._uint16(value >> 16)];
+}
+
+/// One decoded operation. value is the state (0 or 1), mode, duration or preview rate; start, count and rgbw belong to
+/// color (whole LED, start 0 and count 0) and pixels.
+class LiveOperation {
+  const LiveOperation(this.type, {this.value = 0, this.start = 0, this.count = 0, this.rgbw = const []});
+
+  final int type;
+  final int value;
+  final int start;
+  final int count;
+  final List<int> rgbw;
+}
+
+/// Splits a message into its operations, the same way the firmware's live_decode does.
+///
+/// Throws a [FormatException] for an unknown operation, a truncated one or a state other than 0 or 1.
+List<LiveOperation> decodeLiveMessage(Uint8List message) {
+  final data = ByteData.sublistView(message);
+  final operations = <LiveOperation>[];
+  var pos = 0;
+  while (pos < message.length) {
+    final type = message[pos];
+    final size = switch (type) {
+      LiveOp.state || LiveOp.mode || LiveOp.preview => 1,
+      LiveOp.duration || LiveOp.color => 4,
+      LiveOp.pixels => 8,
+      _ => throw FormatException('Unknown operation $type', message, pos),
+    };
+    if (message.length - pos - 1 < size) {
+      throw FormatException('Truncated operation $type', message, pos);
+    }
+    final p = pos + 1;
+    operations.add(switch (type) {
+      LiveOp.state when message[p] > 1 => throw FormatException('Invalid state', message, p),
+      LiveOp.state || LiveOp.mode || LiveOp.preview => LiveOperation(type, value: message[p]),
+      LiveOp.duration => LiveOperation(type, value: data.getUint32(p, Endian.little)),
+      LiveOp.color => LiveOperation(type, rgbw: message.sublist(p, p + 4)),
+      _ => LiveOperation(type,
+        start: data.getUint16(p, Endian.little),
+        count: data.getUint16(p + 2, Endian.little),
+        rgbw: message.sublist(p + 4, p + 8)),
+    });
+    pos = p + size;
+  }
+  return operations;
+}
+
+/// Opens a WebSocket, WebSocket.connect outside of tests.
+typedef WebSocketConnector = Future<WebSocket> Function(Uri uri);
+
+/// Keeps one WebSocket open to a controller's /live endpoint and reconnects on its own.
+///
+/// A dropped connection is retried after [initialBackoff], doubling up to [maxBackoff] while the
+/// controller stays away, and straight back to [initialBackoff] once a connection succeeds. Pings every
+/// [pingInterval] notice a controller that vanished without closing the connection. Messages are only
+/// sent while connected; [send] reports false otherwise so the caller can fall back to HTTP, which also
+/// finds a controller that moved to a new address.
+class LiveChannel {
+  LiveChannel({
+    WebSocketConnector? connector,
+    this.initialBackoff = const Duration(milliseconds: 250),
+    this.maxBackoff = const Duration(seconds: 8),
+    this.pingInterval = const Duration(seconds: 5),
+    this.connectTimeout = const Duration(seconds: 3),
+  }) : _connector = connector ?? ((uri) => WebSocket.connect(uri.toString()));
+
+  final WebSocketConnector _connector;
+  final Duration initialBackoff;
+  final Duration maxBackoff;
+  final Duration pingInterval;
+  final Duration connectTimeout;
+
+  final StreamController<bool> _changes = StreamController<bool>.broadcast();
+  final StreamController<Uint8List> _messages = StreamController<Uint8List>.broadcast();
+  Uri? _uri;
+  WebSocket? _socket;
+  // Bumped whenever the target changes, so a loop for an old target stops at its next step
+  int _generation = 0;
+  Timer? _retry;
+  Completer<void>? _wake;
+
+  /// Connection attempts made so far, successful or not.
+  int attempts = 0;
+
+  bool get connected => _socket != null;
+
+  Uri? get uri => _uri;
+
+  /// Emits true on every connect and false on every disconnect.
+  Stream<bool> get connectionChanges => _changes.stream;
+
+  /// Binary messages from the controller, such as preview frames.
+  Stream<Uint8List> get messages => _messages.stream;
+
+  /// Connects to uri, keeping the connection up until [disconnect] or another [connect].
+  void connect(Uri uri) {
+    if (uri == _uri) return;
+    disconnect();
+    _uri = uri;
+    _run(_generation);
+  }
+
+  /// Closes the connection and stops reconnecting.
+  void disconnect() {
+    _generation++;
+    _uri = null;
+    _retry?.cancel();
+    _wake?.complete();
+    _wake = null;
+    _socket?.close();
+    _setSocket(null);
+  }
+
+  /// Sends a binary message, typically from [LiveMessage.toBytes].
+  ///
+  /// Returns false without sending when there is no connection.
+  bool send(Uint8List message) {
+    final socket = _socket;
+    if (socket == null) return false;
+    socket.add(message);
+    return true;
+  }
+
+  Future<void> close() async {
+    disconnect();
+    await _changes.close();
+    await _messages.close();
+  }
+
+  void _setSocket(WebSocket? socket) {
+    final was = _socket != null;
+    _socket = socket;
+    if (was != (socket != null) && !_changes.isClosed) {
+      _changes.add(socket != null);
+    }
+  }
+
+  Future<void> _run(int generation) async {
+    var backoff = initialBackoff;
+    while (generation == _generation) {
+      attempts++;
+      try {
+        final socket = await _connector(_uri!).timeout(connectTimeout);
+        if (generation != _generation) {
+          await socket.close();
+          return;
+        }
+        socket.pingInterval = pingInterval;
+        backoff = initialBackoff;
+        _setSocket(socket);
+        // Runs until the connection is gone
+        await socket.forEach((data) {
+          if (data is List<int> && !_messages.isClosed) _messages.add(Uint8List.fromList(data));
+        }).catchError((_) {});
+        if (generation != _generation) return;
+        _setSocket(null);
+      } catch (_) {
+        if (generation != _generation) return;
+      }
+      await _sleep(backoff);
+      backoff = backoff * 2 > maxBackoff ? maxBackoff : backoff * 2;
+    }
+  }
+
+  // Cut short by disconnect, so an old loop never outlives its target by a whole backoff
+  Future<void> _sleep(Duration duration) {
+    final wake = _wake = Completer<void>();
+    _retry = Timer(duration, () {
+      if (!wake.isCompleted) wake.complete();
+    });
+    return wake.future;
+  }
+}
@@ -0,0 +1,85 @@
+import 'dart:typed_data';
+
+import 'package:flutter/material.dart';
+
+import 'live_channel.dart';
+
+/// Bytes before the ranges of a preview frame: the message type and the pixel count.
+const int liveFrameHeader = 3;
+
+/// The controller's last frame as received over the live channel, downsampled by the controller to at
+/// most 256 pixels. Starts black, like the copy the controller diffs against when a preview starts.
+class LivePreviewFrame {
+  Uint8List _pixels = Uint8List(0);
+
+  /// Preview pixels, 0 until the first frame.
+  int get length => _pixels.length ~/ 3;
+
+  Color pixel(int i) => Color.fromARGB(255, _pixels[3 * i], _pixels[3 * i + 1], _pixels[3 * i + 2]);
+
+  List<int> rgb(int i) => _pixels.sublist(3 * i, 3 * i + 3);
+
+  /// Back to black, for a new subscription.
+  void reset() => _pixels = Uint8List(0);
+
+  /// Applies one frame message. Returns false, leaving the frame as it was, for anything that is not a
+  /// well-formed preview frame.
+  bool apply(Uint8List message) {
+    if (message.length < liveFrameHeader || message[0] != liveFrameMessage) return false;
+    final count = message[1] | message[2] << 8;
+    final pixels = count * 3 == _pixels.length ? Uint8List.fromList(_pixels) : Uint8List(count * 3);
+    var pos = liveFrameHeader;
+    while (pos < message.length) {
+      if (message.length - pos < 4) return false;
+      final start = message[pos] | message[pos + 1] << 8;
+      final run = message[pos + 2] | message[pos + 3] << 8;
+      pos += 4;
+      if (run == 0 || start + run > count || message.length - pos < 3 * run) return false;
+      pixels.setRange(3 * start, 3 * (start + run), message, pos);
+      pos += 3 * run;
+    }
+    _pixels = pixels;
+    return true;
+  }
+}
+
+/// Draws a preview frame as a strip, or as a matrix row by row when columns is given.
+class LivePreview extends StatelessWidget {
+  const LivePreview({super.key, required this.frame, this.columns});
+
+  final LivePreviewFrame frame;
+  final int? columns;
+
+  @override
+  Widget build(BuildContext context) {
+    final columns = this.columns ?? frame.length;
+    final rows = columns == 0 ? 0 : (frame.length + columns - 1) ~/ columns;
+    return AspectRatio(
+      aspectRatio: rows == 0 ? 1.0 : (columns / rows).clamp(1.0, 16.0).toDouble(),
+      child: CustomPaint(painter: _PreviewPainter(frame, columns, rows)),
+    );
+  }
+}
+
+class _PreviewPainter extends CustomPainter {
+  _PreviewPainter(this.frame, this.columns, this.rows);
+
+  final LivePreviewFrame frame;
+  final int columns;
+  final int rows;
+
+  @override
+  void paint(Canvas canvas, Size size) {
+    if (frame.length == 0) return;
+    final cell = Size(size.width / columns, size.height / rows);
+    final paint = Paint();
+    for (var i = 0; i < frame.length; i++) {
+      paint.color = frame.pixel(i);
+      canvas.drawRect(Offset(i % columns * cell.width, i ~/ columns * cell.height) & cell, paint);
+    }
+  }
+
+  // The same frame object changes between builds, every rebuild is a new frame
+  @override
+  bool shouldRepaint(_PreviewPainter oldDelegate) => true;
+}
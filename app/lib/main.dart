@@ -1,7 +1,14 @@
+import 'dart:async';
+import 'dart:typed_data';
+
 import 'package:flutter/material.dart';
 import 'package:provider/provider.dart';
 import 'package:http/http.dart' as http;
 import 'dart:convert';
+import 'command_sender.dart';
+import 'device_discovery.dart';
+import 'live_channel.dart';
+import 'live_preview.dart';
 
 enum ColorEnum {red, green, blue}
 enum CommsEnum {ble, wifi}
@@ -35,7 +42,7 @@ class MyApp extends StatelessWidget {
   @override
   Widget build(BuildContext context) {
     return ChangeNotifierProvider(
-      create: (context) => LedState(),
+      create: (context) => LedState()..loadDevices(),
       child: MaterialApp(
         title: 'ESP32 RGB LED Remote Control',
         theme: ThemeData(
@@ -48,6 +55,34 @@ class MyApp extends StatelessWidget {
 }
 
 class LedState extends ChangeNotifier {
+  LedState({DeviceDiscovery? discovery, DeviceCache? cache, LiveChannel? live})
+    : _discovery = discovery ?? DeviceDiscovery(),
+      _cache = cache ?? DeviceCache(),
+      _live = live ?? LiveChannel() {
+    _liveChanges = _live.connectionChanges.listen(_liveConnectionChanged);
+    _liveMessages = _live.messages.listen((message) {
+      if (_preview.apply(message)) notifyListeners();
+    });
+  }
+
+  /// Preview frames per second asked of the controller, which sends only the pixels that changed.
+  static const int previewFps = 10;
+
+  final DeviceDiscovery _discovery;
+  final DeviceCache _cache;
+  // Controllers with the live capability take sliders and switches over one open WebSocket,
+  // HTTP is the fallback while it is down
+  final LiveChannel _live;
+  late final StreamSubscription<bool> _liveChanges;
+  late final StreamSubscription<Uint8List> _liveMessages;
+  final LivePreviewFrame _preview = LivePreviewFrame();
+  int? _previewColumns;
+  // Sliders and switches change faster than the controller answers, only their latest value matters
+  late final CommandSender _commands = CommandSender(post);
+  List<LedDevice> _devices = [];
+  LedDevice? _device;
+  bool _discovering = false;
+
   bool _lightOn = false;
   int _duration = 250;
   String _text = "";
@@ -57,19 +92,140 @@ class LedState extends ChangeNotifier {
   int get duration => _duration;
   String get text => _text;
   List<int> get colorList => List.unmodifiable(_colorList);
+  List<LedDevice> get devices => List.unmodifiable(_devices);
+  LedDevice? get device => _device;
+  bool get discovering => _discovering;
+  bool get liveConnected => _live.connected;
+  LivePreviewFrame get preview => _preview;
+  int? get previewColumns => _previewColumns;
+
+  // Cached devices answer right away, browsing only happens when there is nothing cached
+  Future<void> loadDevices() async {
+    _devices = await _cache.loadDevices();
+    final selectedId = await _cache.loadSelectedId();
+    _device = _devices.where((device) => device.id == selectedId).firstOrNull ?? _devices.firstOrNull;
+    _connectLive();
+    notifyListeners();
+    if (_devices.isEmpty) {
+      await discoverDevices();
+    }
+  }
+
+  Future<void> discoverDevices() async {
+    if (_discovering) return;
+    _discovering = true;
+    notifyListeners();
+    try {
+      final found = await _discovery.discover();
+      // Devices that didn't answer this time stay cached, they may just be switched off
+      final byId = {for (var device in _devices) device.id: device};
+      for (var device in found) {
+        byId[device.id] = device;
+      }
+      _devices = byId.values.toList();
+      _device = byId[_device?.id] ?? _device ?? found.firstOrNull;
+      _connectLive();
+      await _cache.saveDevices(_devices);
+    } catch (error) {
+      debugPrint('Discovery failed: $error');
+    } finally {
+      _discovering = false;
+      notifyListeners();
+    }
+  }
+
+  void selectDevice(LedDevice device) {
+    _device = device;
+    _connectLive();
+    notifyListeners();
+    _cache.saveSelectedId(device.id);
+  }
+
+  // Follows the selected device, including to a new address found by discovery
+  void _connectLive() {
+    final device = _device;
+    if (device != null && device.hasCapability('live')) {
+      _live.connect(device.wsUri('/live'));
+    } else {
+      _live.disconnect();
+    }
+  }
+
+  // Every connection is a new preview subscription, which the controller diffs against black
+  void _liveConnectionChanged(bool connected) {
+    _preview.reset();
+    if (connected) {
+      _live.send(LiveMessage().preview(previewFps).toBytes());
+      _loadPreviewColumns();
+    }
+    notifyListeners();
+  }
+
+  // A matrix covering the whole LED, not downsampled, is drawn row by row instead of as a strip
+  Future<void> _loadPreviewColumns() async {
+    final device = _device;
+    _previewColumns = null;
+    if (device == null || !device.hasCapability('matrix') || device.pixels > 256) return;
+    try {
+      final response = await http.get(device.uri('/zones')).timeout(const Duration(seconds: 2));
+      final zones = (jsonDecode(response.body) as Map<String, dynamic>)['zones'] as List;
+      for (var zone in zones.cast<Map<String, dynamic>>()) {
+        if (zone['start'] == 0 && zone['length'] == device.pixels && (zone['height'] as int) > 1) {
+          _previewColumns = zone['width'] as int;
+          notifyListeners();
+        }
+      }
+    } catch (error) {
+      debugPrint('GET /zones failed: $error');
+    }
+  }
+
+  @override
+  void dispose() {
+    _liveChanges.cancel();
+    _liveMessages.cancel();
+    _live.close();
+    super.dispose();
+  }
+
+  // A device that stopped answering has usually got a new address from DHCP, so browse
+  // again and retry once at its new address
+  Future<void> post(String path, Map<String, dynamic> body) async {
+    final device = _device;
+    if (device == null) return;
+    try {
+      await _send(device, path, body);
+      return;
+    } catch (error) {
+      if (!isUnreachable(error)) {
+        debugPrint('POST $path failed: $error');
+        return;
+      }
+    }
+    await discoverDevices();
+    final moved = _device;
+    if (moved == null || moved.id != device.id || moved.authority == device.authority) return;
+    try {
+      await _send(moved, path, body);
+    } catch (error) {
+      debugPrint('POST $path failed: $error');
+    }
+  }
+
+  Future<http.Response> _send(LedDevice device, String path, Map<String, dynamic> body) => http.post(
+    device.uri(path),
+    headers: {'Content-Type': 'application/json'},
+    body: jsonEncode(body)
+  ).timeout(const Duration(seconds: 2));
 
   void setLightOn(bool value) {
     _lightOn = value;
     notifyListeners();
 
-    var url = Uri.http('192.168.50.199', '/light');
-    var response = http.post(
-      url,
-      headers: {'Content-Type': 'application/json'},
-      body: jsonEncode({
-        "state": value
-      })
-    );
+    if (_live.send(LiveMessage().state(value).mode(LiveMode.light).toBytes())) return;
+    _commands.send('/light', {
+      "state": value
+    });
   }
 
   void setDuration(int value) {
@@ -86,16 +242,17 @@ class LedState extends ChangeNotifier {
     _colorList[color.index] = value;
     notifyListeners();
 
-    var url = Uri.http('192.168.50.199', '/color');
-    var response = http.post(
-      url,
-      headers: {'Content-Type': 'application/json'},
-      body: jsonEncode({
-        "red": _colorList[ColorEnum.red.index],
-        "green": _colorList[ColorEnum.green.index],
-        "blue": _colorList[ColorEnum.blue.index]
-      })
+    final message = LiveMessage().color(
+      _colorList[ColorEnum.red.index],
+      _colorList[ColorEnum.green.index],
+      _colorList[ColorEnum.blue.index]
     );
+    if (_live.send(message.toBytes())) return;
+    _commands.send('/color', {
+      "red": _colorList[ColorEnum.red.index],
+      "green": _colorList[ColorEnum.green.index],
+      "blue": _colorList[ColorEnum.blue.index]
+    });
   }
 }
 
@@ -118,7 +275,7 @@ class _MyHomePageState extends State<MyHomePage> {
         selectedPage = RemotePage();
         break;
       case 1:
-        selectedPage = Placeholder();
+        selectedPage = DevicesPage();
         break;
       default:
         throw UnimplementedError('no widget for selectedPageIndex: $selectedPageIndex');
@@ -160,8 +317,8 @@ class _MyHomePageState extends State<MyHomePage> {
               label: 'Remote',
             ),
             BottomNavigationBarItem(
-              icon: Icon(Icons.info_outline),
-              label: 'Info',
+              icon: Icon(Icons.devices),
+              label: 'Devices',
             ),
           ],
           currentIndex: selectedPageIndex,
@@ -189,6 +346,19 @@ class RemotePage extends StatelessWidget {
       child: Column(
         mainAxisAlignment: MainAxisAlignment.center,
         children: [
+          // PREVIEW
+          if (ledState.liveConnected && ledState.preview.length > 0)
+            FeatureSection(
+              theme: theme,
+              ledState: ledState,
+              title: 'Preview',
+              children: [
+                Expanded(
+                  flex: 5,
+                  child: LivePreview(frame: ledState.preview, columns: ledState.previewColumns),
+                ),
+              ],
+            ),
           // LIGHT
           FeatureSection(
             theme: theme,
@@ -237,14 +407,9 @@ class RemotePage extends StatelessWidget {
               Expanded(flex: 1, child: Center(child: Text('ms'))),
               ElevatedButton(
                 onPressed: () {
-                  var url = Uri.http('192.168.50.199', '/blinky');
-                  var response = http.post(
-                    url,
-                    headers: {'Content-Type': 'application/json'},
-                    body: jsonEncode({
-                      "duration": ledState.duration
-                    })
-                  );
+                  ledState.post('/blinky', {
+                    "duration": ledState.duration
+                  });
                 },
                 child: Icon(Icons.send),
               ),
@@ -272,14 +437,9 @@ class RemotePage extends StatelessWidget {
               Expanded(flex: 1, child: SizedBox()),
               ElevatedButton(
                 onPressed: () {
-                  var url = Uri.http('192.168.50.199', '/morse');
-                  var response = http.post(
-                    url,
-                    headers: {'Content-Type': 'application/json'},
-                    body: jsonEncode({
-                      "morse": englishToMorseCode(ledState.text)
-                    })
-                  );
+                  ledState.post('/morse', {
+                    "morse": englishToMorseCode(ledState.text)
+                  });
                 },
                 child: Icon(Icons.send),
               ),
@@ -326,6 +486,41 @@ class RemotePage extends StatelessWidget {
   }
 }
 
+class DevicesPage extends StatelessWidget {
+  const DevicesPage({super.key});
+
+  @override
+  Widget build(BuildContext context) {
+    var ledState = context.watch<LedState>();
+
+    return RefreshIndicator(
+      onRefresh: ledState.discoverDevices,
+      child: ListView(
+        children: [
+          if (ledState.discovering)
+            LinearProgressIndicator(),
+          if (ledState.devices.isEmpty && !ledState.discovering)
+            ListTile(
+              leading: Icon(Icons.search_off),
+              title: Text('No controllers found'),
+              subtitle: Text('Pull down to search the network again'),
+            ),
+          for (var device in ledState.devices)
+            ListTile(
+              leading: Icon(device.id == ledState.device?.id ? Icons.radio_button_checked : Icons.radio_button_unchecked),
+              title: Text(device.name),
+              subtitle: Text('${device.authority} · ${device.pixels} pixels · ${device.version}'),
+              trailing: device.id == ledState.device?.id && ledState.liveConnected ? Icon(Icons.bolt) : null,
+              onTap: () {
+                ledState.selectDevice(device);
+              },
+            ),
+        ],
+      ),
+    );
+  }
+}
+
 class FeatureSection extends StatelessWidget {
   const FeatureSection({
     super.key,
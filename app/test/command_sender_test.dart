@@ -0,0 +1,156 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:io';
+
+import 'package:app/command_sender.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:http/http.dart' as http;
+
+/// Stands in for a controller on a slow network: answers every POST after a fixed latency and records
+/// the bodies in arrival order and how many requests overlapped.
+class MockController {
+  MockController(this.latency);
+
+  final Duration latency;
+  final List<Map<String, dynamic>> bodies = [];
+  late HttpServer _server;
+  int _active = 0;
+  int maxActive = 0;
+
+  Uri uri(String path) => Uri.http('${_server.address.address}:${_server.port}', path);
+
+  Future<void> start() async {
+    _server = await HttpServer.bind(InternetAddress.loopbackIPv4, 0);
+    _server.listen((request) async {
+      _active++;
+      if (_active > maxActive) maxActive = _active;
+      final body = await utf8.decoder.bind(request).join();
+      await Future.delayed(latency);
+      // Applied when the controller answers, so a request that overtook an older one gets overwritten by it
+      bodies.add(jsonDecode(body) as Map<String, dynamic>);
+      _active--;
+      request.response.statusCode = HttpStatus.ok;
+      await request.response.close();
+    });
+  }
+
+  Future<void> stop() => _server.close(force: true);
+}
+
+Map<String, dynamic> color(int red) => {'red': red, 'green': 0, 'blue': 0};
+
+void main() {
+  group('CommandSender against a mock controller', () {
+    const changes = 200;
+    late MockController controller;
+
+    setUp(() async {
+      controller = MockController(const Duration(milliseconds: 20));
+      await controller.start();
+    });
+
+    tearDown(() => controller.stop());
+
+    Future<void> post(String path, Map<String, dynamic> body) =>
+      http.post(controller.uri(path), headers: {'Content-Type': 'application/json'}, body: jsonEncode(body));
+
+    // A slider dragged across its range, one change per millisecond
+    Future<Duration> drag(Future<void> Function(int red) change) async {
+      final stopwatch = Stopwatch()..start();
+      final sent = <Future<void>>[];
+      for (var red = 1; red <= changes; red++) {
+        sent.add(change(red));
+        await Future.delayed(const Duration(milliseconds: 1));
+      }
+      await Future.wait(sent);
+      return stopwatch.elapsed;
+    }
+
+    test('keeps one request in flight and ends on the last value', () async {
+      final sender = CommandSender(post);
+
+      final elapsed = await drag((red) => sender.send('/color', color(red)));
+
+      // ignore: avoid_print
+      print('coalesced: ${controller.bodies.length} requests for $changes changes, '
+        'at most ${controller.maxActive} in flight, settled after ${elapsed.inMilliseconds} ms');
+      expect(controller.maxActive, 1);
+      expect(controller.bodies.length, lessThan(changes ~/ 4));
+      expect(controller.bodies.last, color(changes));
+      final reds = [for (var body in controller.bodies) body['red'] as int];
+      expect(reds, orderedEquals([...reds]..sort()));
+      expect(sender.inFlight, 0);
+    });
+
+    test('firing a request per change piles them up', () async {
+      final elapsed = await drag((red) => post('/color', color(red)));
+
+      // ignore: avoid_print
+      print('uncoalesced: ${controller.bodies.length} requests for $changes changes, '
+        'at most ${controller.maxActive} in flight, settled after ${elapsed.inMilliseconds} ms');
+      expect(controller.bodies, hasLength(changes));
+      expect(controller.maxActive, greaterThan(1));
+    });
+  });
+
+  group('CommandSender', () {
+    test('sends the first change right away and only the newest of the rest', () async {
+      final sent = <int>[];
+      final gate = <Completer<void>>[];
+      final sender = CommandSender((path, body) {
+        sent.add(body['red'] as int);
+        gate.add(Completer<void>());
+        return gate.last.future;
+      });
+
+      final first = sender.send('/color', color(1));
+      final replaced = sender.send('/color', color(2));
+      final newest = sender.send('/color', color(3));
+      expect(sent, [1]);
+      expect(sender.inFlight, 1);
+
+      gate[0].complete();
+      await first;
+      await Future<void>.delayed(Duration.zero);
+      expect(sent, [1, 3]);
+
+      gate[1].complete();
+      await Future.wait([replaced, newest]);
+      expect(sender.inFlight, 0);
+    });
+
+    test('keeps paths apart', () async {
+      final gate = Completer<void>();
+      final paths = <String>[];
+      final sender = CommandSender((path, body) {
+        paths.add(path);
+        return gate.future;
+      });
+
+      final light = sender.send('/light', {'state': true});
+      final colorSent = sender.send('/color', color(1));
+      expect(paths, ['/light', '/color']);
+      expect(sender.inFlight, 2);
+
+      gate.complete();
+      await Future.wait([light, colorSent]);
+    });
+
+    test('fails the waiters of a failed request and still sends the newer value', () async {
+      final sent = <int>[];
+      final failure = Completer<void>();
+      final sender = CommandSender((path, body) {
+        sent.add(body['red'] as int);
+        return sent.length == 1 ? failure.future : Future.value();
+      });
+
+      final failed = sender.send('/color', color(1));
+      final next = sender.send('/color', color(2));
+      failure.completeError(const SocketException('unreachable'));
+
+      await expectLater(failed, throwsA(isA<SocketException>()));
+      await next;
+      expect(sent, [1, 2]);
+    });
+  });
+}
@@ -0,0 +1,172 @@
+import 'dart:io';
+
+import 'package:app/device_discovery.dart';
+import 'package:app/main.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:multicast_dns/multicast_dns.dart';
+import 'package:shared_preferences/shared_preferences.dart';
+
+const _instance = 'ledctl-a1b2c3.$ledServiceType.local';
+const _target = 'ledctl-a1b2c3.local';
+
+/// Stands in for the controllers' mDNS responders, answering each query from a fixed set of records.
+class FakeResponder implements ServiceBrowser {
+  FakeResponder(this.records);
+
+  final List<ResourceRecord> records;
+  final List<String> queried = [];
+  bool started = false;
+
+  @override
+  Future<void> start() async {
+    started = true;
+  }
+
+  @override
+  Stream<T> lookup<T extends ResourceRecord>(ResourceRecordQuery query, {Duration timeout = Duration.zero}) {
+    queried.add(query.fullyQualifiedName);
+    return Stream.fromIterable(records.whereType<T>().where((record) => record.name == query.fullyQualifiedName));
+  }
+
+  @override
+  void stop() {
+    started = false;
+  }
+}
+
+List<ResourceRecord> controllerRecords({String instance = _instance, String target = _target, String address = '192.168.1.40', String id = 'a1b2c3'}) => [
+  PtrResourceRecord('$ledServiceType.local', 0, domainName: instance),
+  SrvResourceRecord(instance, 0, target: target, port: 80, priority: 0, weight: 0),
+  TxtResourceRecord(instance, 0, text: 'id=$id\nversion=1.4.0\npixels=150\ncaps=rgbw,zones,schedule'),
+  IPAddressResourceRecord(target, 0, address: InternetAddress(address)),
+];
+
+class FakeCache implements DeviceCache {
+  List<LedDevice> devices = [];
+  String? selectedId;
+
+  @override
+  Future<List<LedDevice>> loadDevices() async => devices;
+
+  @override
+  Future<void> saveDevices(List<LedDevice> devices) async {
+    this.devices = devices;
+  }
+
+  @override
+  Future<String?> loadSelectedId() async => selectedId;
+
+  @override
+  Future<void> saveSelectedId(String id) async {
+    selectedId = id;
+  }
+}
+
+void main() {
+  group('DeviceDiscovery', () {
+    test('resolves an advertised controller from its SRV, TXT and A records', () async {
+      final responder = FakeResponder(controllerRecords());
+      final devices = await DeviceDiscovery(browserFactory: () => responder).discover();
+
+      expect(devices, hasLength(1));
+      final device = devices.single;
+      expect(device.id, 'a1b2c3');
+      expect(device.name, 'ledctl-a1b2c3');
+      expect(device.host, '192.168.1.40');
+      expect(device.uri('/light'), Uri.parse('http://192.168.1.40/light'));
+      expect(device.version, '1.4.0');
+      expect(device.pixels, 150);
+      expect(device.capabilities, {'rgbw', 'zones', 'schedule'});
+      expect(responder.started, isFalse);
+    });
+
+    test('uses the .local name when no address is answered', () async {
+      final records = controllerRecords()..removeWhere((record) => record is IPAddressResourceRecord);
+      final devices = await DeviceDiscovery(browserFactory: () => FakeResponder(records)).discover();
+
+      expect(devices.single.host, _target);
+    });
+
+    test('skips instances without a service record and finds several controllers', () async {
+      final records = [
+        ...controllerRecords(),
+        ...controllerRecords(instance: 'ledctl-d4e5f6.$ledServiceType.local', target: 'ledctl-d4e5f6.local', address: '192.168.1.41', id: 'd4e5f6'),
+        PtrResourceRecord('$ledServiceType.local', 0, domainName: 'stale.$ledServiceType.local'),
+      ];
+      final devices = await DeviceDiscovery(browserFactory: () => FakeResponder(records)).discover();
+
+      expect(devices.map((device) => device.id), unorderedEquals(['a1b2c3', 'd4e5f6']));
+    });
+
+    test('finds nothing on a quiet network', () async {
+      final devices = await DeviceDiscovery(browserFactory: () => FakeResponder([])).discover();
+
+      expect(devices, isEmpty);
+    });
+  });
+
+  test('parseTxt keeps values containing =', () {
+    expect(parseTxt('id=a1\ncaps=a=b\nflag\n'), {'id': 'a1', 'caps': 'a=b'});
+  });
+
+  test('DeviceCache round-trips devices and the selection', () async {
+    SharedPreferences.setMockInitialValues({});
+    final cache = DeviceCache();
+    final device = LedDevice.fromTxt('ledctl-a1b2c3', '192.168.1.40', 8080, parseTxt('id=a1b2c3\npixels=60\ncaps=audio'));
+
+    await cache.saveDevices([device]);
+    await cache.saveSelectedId(device.id);
+    final loaded = await cache.loadDevices();
+
+    expect(loaded.single.toJson(), device.toJson());
+    expect(loaded.single.authority, '192.168.1.40:8080');
+    expect(await cache.loadSelectedId(), 'a1b2c3');
+  });
+
+  group('LedState', () {
+    test('browses when nothing is cached and selects the first controller', () async {
+      final cache = FakeCache();
+      final state = LedState(
+        discovery: DeviceDiscovery(browserFactory: () => FakeResponder(controllerRecords())),
+        cache: cache,
+      );
+
+      await state.loadDevices();
+
+      expect(state.device?.id, 'a1b2c3');
+      expect(cache.devices, hasLength(1));
+    });
+
+    test('uses the cache without browsing', () async {
+      final responder = FakeResponder(controllerRecords());
+      final cache = FakeCache()
+        ..devices = [LedDevice(id: 'a1b2c3', name: 'ledctl-a1b2c3', host: '192.168.1.40', port: 80)]
+        ..selectedId = 'a1b2c3';
+      final state = LedState(discovery: DeviceDiscovery(browserFactory: () => responder), cache: cache);
+
+      await state.loadDevices();
+
+      expect(state.device?.host, '192.168.1.40');
+      expect(responder.queried, isEmpty);
+    });
+
+    test('follows the selected controller to a new address and keeps absent ones', () async {
+      final cache = FakeCache()
+        ..devices = [
+          LedDevice(id: 'a1b2c3', name: 'ledctl-a1b2c3', host: '192.168.1.12', port: 80),
+          LedDevice(id: '000000', name: 'ledctl-000000', host: '192.168.1.13', port: 80),
+        ]
+        ..selectedId = 'a1b2c3';
+      final state = LedState(
+        discovery: DeviceDiscovery(browserFactory: () => FakeResponder(controllerRecords())),
+        cache: cache,
+      );
+
+      await state.loadDevices();
+      await state.discoverDevices();
+
+      expect(state.device?.host, '192.168.1.40');
+      expect(state.devices.map((device) => device.id), unorderedEquals(['a1b2c3', '000000']));
+    });
+  });
+}
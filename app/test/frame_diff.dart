@@ -0,0 +1,32 @@
+import 'dart:typed_data';
+
+/// Encodes the pixels of frame (3 bytes each) that differ from sent as ranges and brings sent up to date,
+/// the same way the firmware's frame_diff_encode does. Returns no bytes when nothing changed.
+///
+/// Each range is start and count (little-endian, 2 bytes each) followed by count red, green, blue
+/// triples. One unchanged pixel between changes is sent inside the range, being cheaper than a new header.
+Uint8List encodeFrameDiff(Uint8List sent, Uint8List frame) {
+  final count = frame.length ~/ 3;
+  final out = BytesBuilder(copy: false);
+  bool changed(int i) =>
+    sent[3 * i] != frame[3 * i] || sent[3 * i + 1] != frame[3 * i + 1] || sent[3 * i + 2] != frame[3 * i + 2];
+
+  var i = 0;
+  while (i < count) {
+    if (!changed(i)) {
+      i++;
+      continue;
+    }
+    final start = i;
+    var end = i + 1;
+    for (var j = end; j < count && j <= end + 1; j++) {
+      if (changed(j)) end = j + 1;
+    }
+    final run = end - start;
+    out.add([start & 0xff, start >> 8, run & 0xff, run >> 8]);
+    out.add(frame.sublist(3 * start, 3 * end));
+    sent.setRange(3 * start, 3 * end, frame, 3 * start);
+    i = end;
+  }
+  return out.toBytes();
+}
@@ -0,0 +1,124 @@
+import 'dart:async';
+import 'dart:typed_data';
+
+import 'package:app/live_channel.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'live_stand_in.dart';
+
+Future<void> until(bool Function() condition, {Duration timeout = const Duration(seconds: 5)}) async {
+  final deadline = DateTime.now().add(timeout);
+  while (!condition()) {
+    if (DateTime.now().isAfter(deadline)) throw TimeoutException('Condition not met', timeout);
+    await Future.delayed(const Duration(milliseconds: 1));
+  }
+}
+
+void main() {
+  group('LiveMessage', () {
+    test('encodes the same bytes the firmware decodes', () {
+      final bytes = LiveMessage()
+        .state(true)
+        .mode(LiveMode.blinky)
+        .duration(500)
+        .color(10, 20, 30, 40)
+        .pixels(3, 2, 1, 2, 3, 4)
+        .toBytes();
+
+      // Checked against live_decode on the host
+      expect(bytes, [1, 1, 2, 1, 3, 0xF4, 0x01, 0, 0, 4, 10, 20, 30, 40, 5, 3, 0, 2, 0, 1, 2, 3, 4]);
+    });
+
+    test('decodes back to the same operations', () {
+      final operations = decodeLiveMessage(LiveMessage().duration(70000).pixels(300, 2, 5, 6, 7).toBytes());
+
+      expect(operations.map((op) => op.type), [LiveOp.duration, LiveOp.pixels]);
+      expect(operations[0].value, 70000);
+      expect([operations[1].start, operations[1].count], [300, 2]);
+      expect(operations[1].rgbw, [5, 6, 7, 0]);
+    });
+
+    test('rejects unknown, truncated and invalid operations', () {
+      for (var message in [[9], [4, 1, 2, 3], [1, 2], [5, 0, 0, 1]]) {
+        expect(() => decodeLiveMessage(Uint8List.fromList(message)), throwsFormatException, reason: '$message');
+      }
+    });
+  });
+
+  group('LiveChannel against a stand-in controller', () {
+    late LiveStandIn controller;
+    late LiveChannel channel;
+
+    setUp(() async {
+      controller = LiveStandIn();
+      await controller.start();
+      channel = LiveChannel(initialBackoff: const Duration(milliseconds: 20));
+    });
+
+    tearDown(() async {
+      await channel.close();
+      await controller.stop();
+    });
+
+    test('refuses to send while disconnected', () {
+      expect(channel.send(LiveMessage().state(true).toBytes()), isFalse);
+    });
+
+    test('streams color changes over one connection', () async {
+      const changes = 20000;
+      channel.connect(controller.uri);
+      await until(() => channel.connected);
+
+      final stopwatch = Stopwatch()..start();
+      for (var i = 1; i <= changes; i++) {
+        expect(channel.send(LiveMessage().color(i & 0xff, i >> 8 & 0xff, 0).toBytes()), isTrue);
+      }
+      await until(() => controller.messages == changes, timeout: const Duration(seconds: 30));
+      stopwatch.stop();
+
+      // ignore: avoid_print
+      print('live: $changes messages in ${stopwatch.elapsedMilliseconds} ms, '
+        '${(changes * 1000 / stopwatch.elapsedMilliseconds).round()} messages/s');
+      expect(controller.connections, 1);
+      expect(controller.dropped, 0);
+      expect(controller.pixels.first, [changes & 0xff, changes >> 8 & 0xff, 0, 0]);
+    });
+
+    test('drops an invalid message and keeps the connection', () async {
+      channel.connect(controller.uri);
+      await until(() => channel.connected);
+
+      channel.send(LiveMessage().pixels(25, 10, 1, 1, 1).toBytes());
+      channel.send(LiveMessage().state(true).mode(LiveMode.light).toBytes());
+      await until(() => controller.messages == 2);
+
+      expect(controller.dropped, 1);
+      expect(controller.state, isTrue);
+      expect(channel.connected, isTrue);
+    });
+
+    test('reconnects once the controller comes back', () async {
+      channel.connect(controller.uri);
+      await until(() => channel.connected);
+      final port = controller.port;
+
+      await controller.stop();
+      await until(() => !channel.connected);
+      await Future.delayed(const Duration(milliseconds: 200));
+      final attempts = channel.attempts;
+      final stopwatch = Stopwatch()..start();
+      await controller.start(port: port);
+      await until(() => channel.connected);
+      stopwatch.stop();
+
+      // ignore: avoid_print
+      print('live: reconnected ${stopwatch.elapsedMilliseconds} ms after the controller came back, '
+        '${channel.attempts - 1} attempts in total');
+      expect(controller.connections, 2);
+      // Backing off while away, 200 ms at 20 ms doubling is at most 4 retries
+      expect(attempts, lessThanOrEqualTo(6));
+      expect(stopwatch.elapsed, lessThan(const Duration(seconds: 1)));
+      expect(channel.send(LiveMessage().state(false).toBytes()), isTrue);
+    });
+  });
+}
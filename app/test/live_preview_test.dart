@@ -0,0 +1,148 @@
+import 'dart:async';
+import 'dart:math';
+import 'dart:typed_data';
+
+import 'package:app/live_channel.dart';
+import 'package:app/live_preview.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'frame_diff.dart';
+import 'live_stand_in.dart';
+
+Future<void> until(bool Function() condition, {Duration timeout = const Duration(seconds: 5)}) async {
+  final deadline = DateTime.now().add(timeout);
+  while (!condition()) {
+    if (DateTime.now().isAfter(deadline)) throw TimeoutException('Condition not met', timeout);
+    await Future.delayed(const Duration(milliseconds: 1));
+  }
+}
+
+Uint8List frameMessage(int count, List<int> ranges) =>
+  Uint8List.fromList([liveFrameMessage, count & 0xff, count >> 8, ...ranges]);
+
+void main() {
+  group('Frame diff', () {
+    test('encodes the same ranges as the firmware', () {
+      final sent = Uint8List(30);
+      final frame = Uint8List(30);
+      frame[6] = 9;
+      frame[13] = 8;
+      frame[26] = 7;
+
+      // Checked against frame_diff_encode on the host: pixels 2 and 4 share a range across the unchanged 3
+      expect(encodeFrameDiff(sent, frame), [2, 0, 3, 0, 9, 0, 0, 0, 0, 0, 0, 8, 0, 8, 0, 1, 0, 0, 0, 7]);
+      expect(sent, frame);
+      expect(encodeFrameDiff(sent, frame), isEmpty);
+    });
+
+    test('keeps a receiver in step through random frames', () {
+      final random = Random(1);
+      final sent = Uint8List(256 * 3);
+      final preview = LivePreviewFrame();
+      for (var i = 0; i < 1000; i++) {
+        final frame = Uint8List.fromList(sent);
+        for (var changes = random.nextInt(20); changes > 0; changes--) {
+          frame[random.nextInt(frame.length)] = random.nextInt(256);
+        }
+        expect(preview.apply(frameMessage(256, encodeFrameDiff(sent, frame))), isTrue);
+        expect([for (var p = 0; p < 256; p++) ...preview.rgb(p)], frame);
+      }
+    });
+
+    test('rejects malformed frames and keeps the last good one', () {
+      final preview = LivePreviewFrame();
+      expect(preview.apply(frameMessage(4, [1, 0, 1, 0, 5, 6, 7])), isTrue);
+      for (var ranges in [[0, 0, 0, 0], [3, 0, 2, 0, 1, 2, 3, 4, 5, 6], [0, 0, 1, 0, 1, 2], [0, 0]]) {
+        expect(preview.apply(frameMessage(4, ranges)), isFalse, reason: '$ranges');
+      }
+      expect(preview.apply(Uint8List.fromList([LiveOp.color, 0, 0])), isFalse);
+      expect(preview.length, 4);
+      expect(preview.rgb(1), [5, 6, 7]);
+    });
+  });
+
+  group('Preview against a stand-in controller', () {
+    late LiveStandIn controller;
+    late LiveChannel channel;
+    late LivePreviewFrame preview;
+    late List<int> sizes;
+
+    setUp(() async {
+      controller = LiveStandIn(length: 300);
+      await controller.start();
+      channel = LiveChannel(initialBackoff: const Duration(milliseconds: 20));
+      preview = LivePreviewFrame();
+      sizes = [];
+      channel.messages.listen((message) {
+        sizes.add(message.length);
+        preview.apply(message);
+      });
+      channel.connect(controller.uri);
+      await until(() => channel.connected);
+      channel.send(LiveMessage().preview(20).toBytes());
+      await until(() => preview.length > 0);
+    });
+
+    tearDown(() async {
+      await channel.close();
+      await controller.stop();
+    });
+
+    bool matches() => [for (var p = 0; p < preview.length; p++) ...preview.rgb(p)].toString() ==
+      controller.previewFrame().toString();
+
+    // Until the controller has taken every message sent so far and the preview shows it
+    Future<void> settle(int messages) => until(() => controller.messages == messages && matches());
+
+    test('announces a downsampled black strip', () {
+      expect(preview.length, 256);
+      expect(sizes, [liveFrameHeader]);
+    });
+
+    test('follows the LED with only the changed ranges', () async {
+      channel.send(LiveMessage().state(true).color(10, 20, 30, 5).toBytes());
+      await settle(2);
+      expect(preview.rgb(0), [15, 25, 35]);
+      final full = sizes.last;
+
+      sizes.clear();
+      const changes = 50;
+      for (var i = 0; i < changes; i++) {
+        channel.send(LiveMessage().pixels(i * 6, 2, i, 255 - i, 0).toBytes());
+        await Future.delayed(const Duration(milliseconds: 10));
+      }
+      await settle(2 + changes);
+
+      final bytes = sizes.fold(0, (sum, size) => sum + size);
+      // ignore: avoid_print
+      print('preview: full frame $full bytes, then $changes pixel changes in ${sizes.length} frames, '
+        '$bytes bytes (${(bytes / sizes.length).round()} per frame)');
+      expect(full, liveFrameHeader + 4 + 256 * 3);
+      expect(bytes, lessThan(full * sizes.length ~/ 4));
+    });
+
+    test('sends nothing while the LED stays the same', () async {
+      await Future.delayed(const Duration(milliseconds: 300));
+      expect(sizes, hasLength(1));
+    });
+
+    test('starts over from black after a reconnect', () async {
+      channel.send(LiveMessage().state(true).color(1, 2, 3).toBytes());
+      await settle(2);
+      final port = controller.port;
+
+      await controller.stop();
+      await until(() => !channel.connected);
+      preview.reset();
+      await controller.start(port: port);
+      await until(() => channel.connected);
+      channel.send(LiveMessage().preview(20).toBytes());
+      // The first frame of the new subscription carries everything that isn't black
+      await until(() => preview.length > 0);
+      expect(matches(), isTrue);
+      expect(sizes.last, liveFrameHeader + 4 + 256 * 3);
+      channel.send(LiveMessage().state(true).color(4, 5, 6).toBytes());
+      await settle(4);
+    });
+  });
+}
@@ -0,0 +1,135 @@
+import 'dart:async';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:app/live_channel.dart';
+
+import 'frame_diff.dart';
+
+/// Stands in for a controller's /live endpoint: decodes every binary message like the firmware and applies
+/// it to a simulated LED, dropping malformed messages or out of range pixels without closing the connection.
+/// Clients that ask for a preview get its changed ranges at their rate, each diffed against what that client
+/// holds, as the firmware does.
+class LiveStandIn {
+  LiveStandIn({this.length = 30}) : pixels = List.generate(length, (_) => [0, 0, 0, 0]);
+
+  final int length;
+  final List<List<int>> pixels;
+  bool state = false;
+  int mode = 0;
+  int duration = 0;
+  int messages = 0;
+  int dropped = 0;
+  int connections = 0;
+  int frames = 0;
+  int frameBytes = 0;
+  final List<WebSocket> _sockets = [];
+  final Map<WebSocket, Timer> _previews = {};
+  HttpServer? _server;
+
+  int get port => _server!.port;
+
+  Uri get uri => Uri(scheme: 'ws', host: InternetAddress.loopbackIPv4.address, port: port, path: '/live');
+
+  /// Starts listening, on the given port to come back where a dropped client expects it.
+  Future<void> start({int port = 0}) async {
+    final server = _server = await HttpServer.bind(InternetAddress.loopbackIPv4, port);
+    server.listen((request) async {
+      if (request.uri.path != '/live' || !WebSocketTransformer.isUpgradeRequest(request)) {
+        request.response.statusCode = HttpStatus.notFound;
+        await request.response.close();
+        return;
+      }
+      final socket = await WebSocketTransformer.upgrade(request);
+      connections++;
+      _sockets.add(socket);
+      socket.listen((data) {
+        if (data is List<int>) apply(Uint8List.fromList(data), socket);
+      }, onDone: () {
+        _sockets.remove(socket);
+        _previews.remove(socket)?.cancel();
+      });
+    });
+  }
+
+  /// Stops listening and drops every client, like a controller that lost power.
+  Future<void> stop() async {
+    await _server?.close(force: true);
+    _server = null;
+    for (var timer in _previews.values) {
+      timer.cancel();
+    }
+    _previews.clear();
+    for (var socket in List.of(_sockets)) {
+      await socket.close();
+    }
+    _sockets.clear();
+  }
+
+  /// The frame as shown, white added back into red, green and blue, downsampled to 256 pixels.
+  Uint8List previewFrame() {
+    final count = length < 256 ? length : 256;
+    final frame = Uint8List(count * 3);
+    if (!state) return frame;
+    for (var p = 0; p < count; p++) {
+      final pixel = pixels[p * length ~/ count];
+      for (var channel = 0; channel < 3; channel++) {
+        final value = pixel[channel] + pixel[3];
+        frame[3 * p + channel] = value > 255 ? 255 : value;
+      }
+    }
+    return frame;
+  }
+
+  void _preview(WebSocket socket, int fps) {
+    _previews.remove(socket)?.cancel();
+    if (fps == 0) return;
+    final sent = Uint8List(previewFrame().length);
+    var announced = false;
+    _previews[socket] = Timer.periodic(Duration(milliseconds: 1000 ~/ (fps < 20 ? fps : 20)), (_) {
+      final ranges = encodeFrameDiff(sent, previewFrame());
+      if (ranges.isEmpty && announced) return;
+      final count = sent.length ~/ 3;
+      final message = Uint8List.fromList([liveFrameMessage, count & 0xff, count >> 8, ...ranges]);
+      socket.add(message);
+      announced = true;
+      frames++;
+      frameBytes += message.length;
+    });
+  }
+
+  void apply(Uint8List message, [WebSocket? socket]) {
+    messages++;
+    final List<LiveOperation> operations;
+    try {
+      operations = decodeLiveMessage(message);
+    } on FormatException {
+      dropped++;
+      return;
+    }
+    if (operations.any((op) => op.type == LiveOp.pixels && (op.count == 0 || op.start + op.count > length))) {
+      dropped++;
+      return;
+    }
+    for (var op in operations) {
+      switch (op.type) {
+        case LiveOp.preview:
+          if (socket != null) _preview(socket, op.value);
+        case LiveOp.state:
+          state = op.value == 1;
+        case LiveOp.mode:
+          mode = op.value;
+        case LiveOp.duration:
+          duration = op.value;
+        case LiveOp.color:
+          for (var pixel in pixels) {
+            pixel.setAll(0, op.rgbw);
+          }
+        case LiveOp.pixels:
+          for (var i = op.start; i < op.start + op.count; i++) {
+            pixels[i].setAll(0, op.rgbw);
+          }
+      }
+    }
+  }
+}
@@ -0,0 +1,128 @@
+#include "audio_analysis.h"
+
+#define NOISE_FLOOR 4               // Amplitude per bin below which a band reads as silent, above FFT rounding noise
+#define PEAK_DECAY_SHIFT 7          // Peaks lose 1/128 per block, half in about 2 s at 22050 Hz
+#define BASS_LAST_BIN 3             // Beats are detected on bins 1 to 3, up to 130 Hz at 22050 Hz
+#define BEAT_HOLDOFF_BLOCKS 8       // At most one beat per 190 ms at 22050 Hz
+#define BEAT_DEVIATION_NUM 5        // A beat is over the average by 2.5 mean absolute deviations
+#define BEAT_DEVIATION_DEN 2
+#define BEAT_MIN_RATIO_NUM 2        // and at least twice the average
+#define BEAT_MIN_RATIO_DEN 1
+
+_Static_assert((1 << AUDIO_BANDS) == AUDIO_BLOCK_SIZE / 2, "bands must be the octaves of the spectrum");
+
+static uint32_t isqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1u << 30;
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// Mean power per bin over bins first to last inclusive
+static uint32_t mean_power(const fft_complex_t* spectrum, uint16_t first, uint16_t last)
+{
+    uint64_t sum = 0;
+    for (uint16_t bin = first; bin <= last; bin++) {
+        sum += fft_power(spectrum[bin]);
+    }
+    return (uint32_t)(sum / (last - first + 1));
+}
+
+// Scales an amplitude against its decaying peak, the peak jumps to the amplitude when it is louder
+static uint8_t auto_gain(uint32_t amplitude, uint32_t* peak)
+{
+    *peak -= *peak >> PEAK_DECAY_SHIFT;
+    if (*peak < NOISE_FLOOR) {
+        *peak = NOISE_FLOOR;
+    }
+    if (amplitude > *peak) {
+        *peak = amplitude;
+    }
+    if (amplitude <= NOISE_FLOOR) return 0;
+    return (uint8_t)((amplitude - NOISE_FLOOR) * 255 / (*peak - NOISE_FLOOR));
+}
+
+static bool detect_beat(audio_analysis_t* analysis, uint32_t bass)
+{
+    bool beat = false;
+    if (analysis->history_count == AUDIO_BEAT_HISTORY) {
+        uint32_t mean = (uint32_t)(analysis->bass_sum / AUDIO_BEAT_HISTORY);
+        uint64_t deviation_sum = 0;
+        for (uint8_t i = 0; i < AUDIO_BEAT_HISTORY; i++) {
+            uint32_t energy = analysis->bass_history[i];
+            deviation_sum += energy > mean ? energy - mean : mean - energy;
+        }
+        uint64_t deviation = deviation_sum / AUDIO_BEAT_HISTORY;
+        beat = analysis->holdoff == 0 &&
+               bass > NOISE_FLOOR * NOISE_FLOOR &&
+               (uint64_t)bass * BEAT_DEVIATION_DEN > (uint64_t)mean * BEAT_DEVIATION_DEN + deviation * BEAT_DEVIATION_NUM &&
+               (uint64_t)bass * BEAT_MIN_RATIO_DEN > (uint64_t)mean * BEAT_MIN_RATIO_NUM;
+        analysis->bass_sum -= analysis->bass_history[analysis->history_index];
+    } else {
+        analysis->history_count++;
+    }
+    analysis->bass_history[analysis->history_index] = bass;
+    analysis->bass_sum += bass;
+    analysis->history_index = (analysis->history_index + 1) % AUDIO_BEAT_HISTORY;
+
+    if (beat) {
+        analysis->holdoff = BEAT_HOLDOFF_BLOCKS;
+    } else if (analysis->holdoff) {
+        analysis->holdoff--;
+    }
+    return beat;
+}
+
+void audio_analysis_init(audio_analysis_t* analysis)
+{
+    memset(analysis, 0, sizeof(*analysis));
+    fft_init(&analysis->fft, AUDIO_BLOCK_SIZE);
+    for (uint16_t n = 0; n < AUDIO_BLOCK_SIZE; n++) {
+        float hann = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * n / AUDIO_BLOCK_SIZE);
+        analysis->window[n] = (int16_t)fminf(roundf(hann * 32768.0f), 32767.0f);
+    }
+    for (uint8_t band = 0; band < AUDIO_BANDS; band++) {
+        analysis->band_peaks[band] = NOISE_FLOOR;
+    }
+    analysis->level_peak = NOISE_FLOOR;
+}
+
+void audio_analysis_process(audio_analysis_t* analysis, const int16_t* samples, audio_features_t* features)
+{
+    // Microphones sit on a DC offset, which the window would otherwise leak into the lowest bins
+    int32_t sum = 0;
+    for (uint16_t n = 0; n < AUDIO_BLOCK_SIZE; n++) {
+        sum += samples[n];
+    }
+    int32_t offset = sum / AUDIO_BLOCK_SIZE;
+    for (uint16_t n = 0; n < AUDIO_BLOCK_SIZE; n++) {
+        int32_t centered = samples[n] - offset;
+        if (centered > INT16_MAX) centered = INT16_MAX;
+        if (centered < INT16_MIN) centered = INT16_MIN;
+        analysis->windowed[n] = (int16_t)((centered * analysis->window[n] + (1 << 14)) >> 15);
+    }
+    fft_real(&analysis->fft, analysis->windowed, analysis->spectrum);
+
+    uint64_t total = 0;
+    for (uint8_t band = 0; band < AUDIO_BANDS; band++) {
+        uint16_t first = 1 << band;
+        uint16_t last = (first << 1) - 1;
+        uint32_t power = mean_power(analysis->spectrum, first, last);
+        total += (uint64_t)power * (last - first + 1);
+        features->bands[band] = auto_gain(isqrt(power), &analysis->band_peaks[band]);
+    }
+    features->level = auto_gain(isqrt((uint32_t)(total / (AUDIO_BLOCK_SIZE / 2 - 1))), &analysis->level_peak);
+    features->beat = detect_beat(analysis, mean_power(analysis->spectrum, 1, BASS_LAST_BIN));
+}
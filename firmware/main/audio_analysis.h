@@ -0,0 +1,64 @@
+#ifndef AUDIO_ANALYSIS_H
+#define AUDIO_ANALYSIS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "fft.h"
+
+// Only depends on the C library so it can be built and tested on a host
+
+#define AUDIO_BLOCK_SIZE 512        // Samples per analysis, 23 ms at 22050 Hz
+#define AUDIO_BANDS 8               // Octaves of FFT bins, band b covers bins 2^b to 2^(b+1) - 1
+#define AUDIO_BEAT_HISTORY 43       // Blocks of bass energy a beat is compared against, 1 s at 22050 Hz
+
+/**
+ * @brief   What one block of audio sounded like, the parameters audio-reactive effects are driven by
+ */
+typedef struct {
+    uint8_t bands[AUDIO_BANDS];     //!< Loudness of each band relative to its recent peak, lowest band first
+    uint8_t level;                  //!< Loudness of the whole block relative to its recent peak
+    bool beat;                      //!< Bass energy jumped well above its average over the last second
+} audio_features_t;
+
+/**
+ * @brief   Analysis state carried from one block to the next
+ *
+ * @note Treat every member as private. Holds the FFT tables and scratch buffers, about 6 KB,
+ *       so keep it in static storage rather than on a task stack
+ */
+typedef struct {
+    fft_t fft;
+    int16_t window[AUDIO_BLOCK_SIZE];                   // Hann, Q15
+    int16_t windowed[AUDIO_BLOCK_SIZE];
+    fft_complex_t spectrum[AUDIO_BLOCK_SIZE / 2 + 1];
+    uint32_t band_peaks[AUDIO_BANDS];                   // Decaying peak amplitudes, the automatic gain
+    uint32_t level_peak;
+    uint32_t bass_history[AUDIO_BEAT_HISTORY];          // Ring of bass power per bin
+    uint64_t bass_sum;
+    uint8_t history_index;
+    uint8_t history_count;
+    uint8_t holdoff;                                    // Blocks left before another beat may be reported
+} audio_analysis_t;
+
+/**
+ * @brief   Prepares the FFT tables and window and forgets all history
+ *
+ * @param analysis: State to set up
+ */
+void audio_analysis_init(audio_analysis_t* analysis);
+
+/**
+ * @brief   Analyses one block of samples: Hann window, real FFT, band energies and beat detection
+ *
+ * @note Integer-only after audio_analysis_init. Band levels adapt to the input, each band is scaled
+ *       against a peak that follows loud blocks at once and decays over a few seconds, so the result
+ *       doesn't depend on microphone gain. Blocks below a noise floor read as silence
+ *
+ * @param analysis: State from audio_analysis_init
+ * @param samples: AUDIO_BLOCK_SIZE signed 16-bit mono samples, read only
+ * @param features: Filled with the block's features
+ */
+void audio_analysis_process(audio_analysis_t* analysis, const int16_t* samples, audio_features_t* features);
+
+#endif // AUDIO_ANALYSIS_H
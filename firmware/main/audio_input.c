@@ -0,0 +1,80 @@
+#include "audio_input.h"
+
+#if CONFIG_LED_AUDIO
+
+#define AUDIO_TASK_STACK_SIZE 3072
+#define AUDIO_TASK_PRIORITY 6           // Above httpd so blocks are analysed as they arrive
+#define AUDIO_TASK_CORE 0               // Network side, the render task owns the other core
+#define AUDIO_DMA_BUFFERS 4             // Blocks the DMA ring holds while the task is busy
+
+static const char* AUDIO_TAG = "audio input";
+
+static i2s_chan_handle_t rx_channel;
+static audio_features_cb_t features_callback;
+
+// Static rather than on the task stack, the analysis state alone is about 6 KB
+static audio_analysis_t analysis;
+static int32_t raw_samples[AUDIO_BLOCK_SIZE];
+static int16_t samples[AUDIO_BLOCK_SIZE];
+
+static void audio_task(void* arg)
+{
+    audio_features_t features;
+    size_t bytes_read;
+
+    for (;;) {
+        // One DMA buffer is exactly one block, so this waits for the next buffer to complete
+        esp_err_t err = i2s_channel_read(rx_channel, raw_samples, sizeof(raw_samples), &bytes_read, portMAX_DELAY);
+        if (err != ESP_OK || bytes_read != sizeof(raw_samples)) {
+            ESP_LOGW(AUDIO_TAG, "Short read from microphone: %s", esp_err_to_name(err));
+            continue;
+        }
+
+        metric_span_t span = metrics_begin();
+        // Samples arrive left-aligned in 32-bit slots, the shift sets the input gain
+        for (uint16_t n = 0; n < AUDIO_BLOCK_SIZE; n++) {
+            int32_t sample = raw_samples[n] >> CONFIG_LED_AUDIO_SAMPLE_SHIFT;
+            if (sample > INT16_MAX) sample = INT16_MAX;
+            if (sample < INT16_MIN) sample = INT16_MIN;
+            samples[n] = (int16_t)sample;
+        }
+        audio_analysis_process(&analysis, samples, &features);
+        metrics_end(METRIC_AUDIO_BLOCK, span);
+        features_callback(&features);
+    }
+}
+
+void audio_input_init(audio_features_cb_t on_features)
+{
+    features_callback = on_features;
+    audio_analysis_init(&analysis);
+
+    i2s_chan_config_t channel_config = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_AUTO, I2S_ROLE_MASTER);
+    channel_config.dma_desc_num = AUDIO_DMA_BUFFERS;
+    channel_config.dma_frame_num = AUDIO_BLOCK_SIZE;
+    ESP_ERROR_CHECK(i2s_new_channel(&channel_config, NULL, &rx_channel));
+
+    // Mono MEMS microphones like the INMP441 send 24 bits in a 32-bit left slot when L/R is tied low
+    i2s_std_config_t std_config = {
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(CONFIG_LED_AUDIO_SAMPLE_RATE),
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_32BIT, I2S_SLOT_MODE_MONO),
+        .gpio_cfg = {
+            .mclk = I2S_GPIO_UNUSED,
+            .bclk = CONFIG_LED_AUDIO_BCLK_GPIO,
+            .ws = CONFIG_LED_AUDIO_WS_GPIO,
+            .dout = I2S_GPIO_UNUSED,
+            .din = CONFIG_LED_AUDIO_DIN_GPIO
+        }
+    };
+    std_config.slot_cfg.slot_mask = I2S_STD_SLOT_LEFT;
+    ESP_ERROR_CHECK(i2s_channel_init_std_mode(rx_channel, &std_config));
+    ESP_ERROR_CHECK(i2s_channel_enable(rx_channel));
+
+    if (xTaskCreatePinnedToCore(audio_task, "audio input", AUDIO_TASK_STACK_SIZE, NULL, AUDIO_TASK_PRIORITY, NULL, AUDIO_TASK_CORE) != pdPASS) {
+        ESP_LOGE(AUDIO_TAG, "Failed to create audio task");
+        return;
+    }
+    ESP_LOGI(AUDIO_TAG, "Recording at %d Hz, %d samples per block", CONFIG_LED_AUDIO_SAMPLE_RATE, AUDIO_BLOCK_SIZE);
+}
+
+#endif // CONFIG_LED_AUDIO
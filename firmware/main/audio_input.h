@@ -0,0 +1,33 @@
+#ifndef AUDIO_INPUT_H
+#define AUDIO_INPUT_H
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/i2s_std.h"
+#include "metrics.h"
+#include "audio_analysis.h"
+
+/**
+ * @brief   Called with the features of every block of microphone samples
+ *
+ * @note Always runs in the audio task, so a callback that hands the features to another task can use a
+ *       single-producer queue. Must not block, the microphone keeps recording while it runs
+ *
+ * @param features: Features of the block, only valid during the call
+ */
+typedef void (*audio_features_cb_t)(const audio_features_t* features);
+
+/**
+ * @brief   Starts recording the I2S microphone set by menuconfig and the task that analyses it
+ *
+ * @note The I2S peripheral fills a ring of DMA buffers in the background, one block of AUDIO_BLOCK_SIZE
+ *       samples each, and the task analyses them as they complete. It runs on the network core so the
+ *       FFT never delays a frame on the render core. Only built with CONFIG_LED_AUDIO
+ *
+ * @param on_features: Callback run for every analysed block
+ */
+void audio_input_init(audio_features_cb_t on_features);
+
+#endif // AUDIO_INPUT_H
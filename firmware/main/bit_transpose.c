@@ -0,0 +1,73 @@
+#include "bit_transpose.h"
+
+void bit_transpose_8x8(const uint8_t in[8], uint8_t out[8])
+{
+    // Hacker's Delight transpose8, with the lanes loaded in reverse so lane l lands on bit l
+    uint32_t x = ((uint32_t)in[7] << 24) | ((uint32_t)in[6] << 16) | ((uint32_t)in[5] << 8) | in[4];
+    uint32_t y = ((uint32_t)in[3] << 24) | ((uint32_t)in[2] << 16) | ((uint32_t)in[1] << 8) | in[0];
+    uint32_t t;
+
+    t = (x ^ (x >> 7)) & 0x00AA00AA;
+    x = x ^ t ^ (t << 7);
+    t = (y ^ (y >> 7)) & 0x00AA00AA;
+    y = y ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC;
+    x = x ^ t ^ (t << 14);
+    t = (y ^ (y >> 14)) & 0x0000CCCC;
+    y = y ^ t ^ (t << 14);
+    t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+    y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+    x = t;
+
+    out[0] = x >> 24;
+    out[1] = x >> 16;
+    out[2] = x >> 8;
+    out[3] = x;
+    out[4] = y >> 24;
+    out[5] = y >> 16;
+    out[6] = y >> 8;
+    out[7] = y;
+}
+
+size_t bit_transpose_encode_8(const uint8_t* lanes, size_t lane_stride, size_t bytes, uint8_t* out)
+{
+    uint8_t column[8];
+    uint8_t planes[8];
+
+    for (size_t i = 0; i < bytes; i++) {
+        for (int lane = 0; lane < 8; lane++) {
+            column[lane] = lanes[lane * lane_stride + i];
+        }
+        bit_transpose_8x8(column, planes);
+        for (int bit = 0; bit < 8; bit++) {
+            *out++ = 0xFF;
+            *out++ = planes[bit];
+            *out++ = 0x00;
+        }
+    }
+    return bytes * 8 * BIT_TRANSPOSE_WORDS_PER_BIT;
+}
+
+size_t bit_transpose_encode_16(const uint8_t* lanes, size_t lane_stride, size_t bytes, uint16_t* out)
+{
+    uint8_t column[8];
+    uint8_t low_planes[8];
+    uint8_t high_planes[8];
+
+    for (size_t i = 0; i < bytes; i++) {
+        for (int lane = 0; lane < 8; lane++) {
+            column[lane] = lanes[lane * lane_stride + i];
+        }
+        bit_transpose_8x8(column, low_planes);
+        for (int lane = 0; lane < 8; lane++) {
+            column[lane] = lanes[(lane + 8) * lane_stride + i];
+        }
+        bit_transpose_8x8(column, high_planes);
+        for (int bit = 0; bit < 8; bit++) {
+            *out++ = 0xFFFF;
+            *out++ = ((uint16_t)high_planes[bit] << 8) | low_planes[bit];
+            *out++ = 0x0000;
+        }
+    }
+    return bytes * 8 * BIT_TRANSPOSE_WORDS_PER_BIT;
+}
@@ -0,0 +1,46 @@
+#ifndef BIT_TRANSPOSE_H
+#define BIT_TRANSPOSE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Only depends on the C library so it can be built and benchmarked on a host
+
+#define BIT_TRANSPOSE_WORDS_PER_BIT 3   // WS2812 bit as high, data, low slots
+
+/**
+ * @brief   Transposes an 8x8 bit matrix: bit l of out[j] is bit (7 - j) of in[l]
+ *
+ * @note out[0] therefore holds every lane's most significant bit, one lane per bit position
+ *
+ * @param in: One byte per lane
+ * @param out: One byte per bit plane, most significant plane first
+ */
+void bit_transpose_8x8(const uint8_t in[8], uint8_t out[8]);
+
+/**
+ * @brief   Encodes 8 lanes of WS2812 data into 8-bit parallel words, three per data bit
+ *          (all lanes high, the data bit, all lanes low), most significant bit first
+ *
+ * @param lanes: Lane-major data, byte i of lane l at lanes[l * lane_stride + i]
+ * @param lane_stride: Distance between lanes in bytes
+ * @param bytes: Bytes to encode from each lane
+ * @param out: Receives bytes * 8 * BIT_TRANSPOSE_WORDS_PER_BIT words
+ *
+ * @return Number of words written
+ */
+size_t bit_transpose_encode_8(const uint8_t* lanes, size_t lane_stride, size_t bytes, uint8_t* out);
+
+/**
+ * @brief   Same as bit_transpose_encode_8 for 16 lanes, lane l driving bit l of each 16-bit word
+ *
+ * @param lanes: Lane-major data, byte i of lane l at lanes[l * lane_stride + i]
+ * @param lane_stride: Distance between lanes in bytes
+ * @param bytes: Bytes to encode from each lane
+ * @param out: Receives bytes * 8 * BIT_TRANSPOSE_WORDS_PER_BIT words
+ *
+ * @return Number of words written
+ */
+size_t bit_transpose_encode_16(const uint8_t* lanes, size_t lane_stride, size_t bytes, uint16_t* out);
+
+#endif // BIT_TRANSPOSE_H
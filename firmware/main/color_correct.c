@@ -0,0 +1,73 @@
+#include "color_correct.h"
+
+static uint8_t clamp_channel(float value)
+{
+    if (value < 0) return 0;
+    if (value > 255) return 255;
+    return (uint8_t)(value + 0.5f);
+}
+
+// Tanner Helland's fit of the blackbody curve, only run when the tables are built
+static void kelvin_to_rgb(uint32_t kelvin, uint8_t rgb[3])
+{
+    float temp = kelvin / 100.0f;
+
+    if (temp <= 66) {
+        rgb[COLOR_RED] = 255;
+        rgb[COLOR_GREEN] = clamp_channel(99.4708025861f * logf(temp) - 161.1195681661f);
+    } else {
+        rgb[COLOR_RED] = clamp_channel(329.698727446f * powf(temp - 60, -0.1332047592f));
+        rgb[COLOR_GREEN] = clamp_channel(288.1221695283f * powf(temp - 60, -0.0755148492f));
+    }
+    if (temp >= 66) {
+        rgb[COLOR_BLUE] = 255;
+    } else if (temp <= 19) {
+        rgb[COLOR_BLUE] = 0;
+    } else {
+        rgb[COLOR_BLUE] = clamp_channel(138.5177312231f * logf(temp - 10) - 305.0447927307f);
+    }
+}
+
+void color_correct_init(color_correct_t* correct, uint32_t white_kelvin, const uint8_t balance[COLOR_CHANNELS])
+{
+    kelvin_to_rgb(white_kelvin, correct->white_point);
+
+    for (int channel = 0; channel < COLOR_CHANNELS - 1; channel++) {
+        uint32_t point = correct->white_point[channel];
+        for (uint32_t v = 0; v < 256; v++) {
+            // A channel the white LED doesn't emit puts no limit on the white
+            uint32_t extract = point ? v * 255 / point : 255;
+            correct->extract[channel][v] = extract > 255 ? 255 : extract;
+            correct->from_white[channel][v] = (v * point + 127) / 255;
+        }
+    }
+    for (int channel = 0; channel < COLOR_CHANNELS; channel++) {
+        for (uint32_t v = 0; v < 256; v++) {
+            correct->balance[channel][v] = (v * balance[channel] + 127) / 255;
+        }
+    }
+}
+
+void color_correct_rgbw(const color_correct_t* correct, const uint8_t in[COLOR_CHANNELS], uint8_t out[COLOR_CHANNELS])
+{
+    // The white all three channels have in common
+    uint8_t white = correct->extract[COLOR_RED][in[COLOR_RED]];
+    if (correct->extract[COLOR_GREEN][in[COLOR_GREEN]] < white) white = correct->extract[COLOR_GREEN][in[COLOR_GREEN]];
+    if (correct->extract[COLOR_BLUE][in[COLOR_BLUE]] < white) white = correct->extract[COLOR_BLUE][in[COLOR_BLUE]];
+
+    for (int channel = 0; channel < COLOR_CHANNELS - 1; channel++) {
+        int remaining = in[channel] - correct->from_white[channel][white];
+        out[channel] = correct->balance[channel][remaining < 0 ? 0 : remaining];
+    }
+    uint32_t total_white = white + in[COLOR_WHITE];
+    out[COLOR_WHITE] = correct->balance[COLOR_WHITE][total_white > 255 ? 255 : total_white];
+}
+
+void color_correct_rgb(const color_correct_t* correct, const uint8_t in[COLOR_CHANNELS], uint8_t out[COLOR_CHANNELS])
+{
+    for (int channel = 0; channel < COLOR_CHANNELS - 1; channel++) {
+        uint32_t value = in[channel] + correct->from_white[channel][in[COLOR_WHITE]];
+        out[channel] = correct->balance[channel][value > 255 ? 255 : value];
+    }
+    out[COLOR_WHITE] = 0;
+}
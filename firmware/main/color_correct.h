@@ -0,0 +1,59 @@
+#ifndef COLOR_CORRECT_H
+#define COLOR_CORRECT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+// Only depends on the C library so it can be built and tested on a host
+
+enum {
+    COLOR_RED,
+    COLOR_GREEN,
+    COLOR_BLUE,
+    COLOR_WHITE,
+    COLOR_CHANNELS
+};
+
+/**
+ * @brief   Lookup tables for turning stored RGBW colors into strip output, built once by color_correct_init
+ *
+ * @note Treat every member as private. Per pixel conversion is table lookups, compares and adds only
+ */
+typedef struct {
+    uint8_t white_point[COLOR_CHANNELS - 1];        // RGB the white LED emits at full drive
+    uint8_t extract[COLOR_CHANNELS - 1][256];       // Most white that channel value v could come from
+    uint8_t from_white[COLOR_CHANNELS - 1][256];    // Channel value white level w accounts for
+    uint8_t balance[COLOR_CHANNELS][256];           // Per channel output scaling
+} color_correct_t;
+
+/**
+ * @brief   Builds the tables for a white LED of the given color temperature and per channel balance
+ *
+ * @param correct: Tables to fill
+ * @param white_kelvin: Color temperature of the white LED, 1000 - 40000 K
+ * @param balance: Output scale per channel (red, green, blue, white), 255 leaves a channel unchanged
+ */
+void color_correct_init(color_correct_t* correct, uint32_t white_kelvin, const uint8_t balance[COLOR_CHANNELS]);
+
+/**
+ * @brief   Converts a stored color for an RGBW strip: moves the white part of red, green and blue
+ *          onto the white channel, adds the explicit white, then applies the balance
+ *
+ * @param correct: Tables from color_correct_init
+ * @param in: Stored red, green, blue and explicit white
+ * @param out: Red, green, blue and white to send
+ */
+void color_correct_rgbw(const color_correct_t* correct, const uint8_t in[COLOR_CHANNELS], uint8_t out[COLOR_CHANNELS]);
+
+/**
+ * @brief   Converts a stored color for an RGB strip: mixes the explicit white in at the white point,
+ *          then applies the balance. out[COLOR_WHITE] is set to 0
+ *
+ * @param correct: Tables from color_correct_init
+ * @param in: Stored red, green, blue and explicit white
+ * @param out: Red, green and blue to send
+ */
+void color_correct_rgb(const color_correct_t* correct, const uint8_t in[COLOR_CHANNELS], uint8_t out[COLOR_CHANNELS]);
+
+#endif // COLOR_CORRECT_H
@@ -0,0 +1,93 @@
+#include "discovery.h"
+
+#define DISCOVERY_SERVICE_TYPE "_ledctl"
+#define DISCOVERY_SERVICE_PROTO "_tcp"
+#define DISCOVERY_PORT 80
+#define DISCOVERY_ID_SIZE 7             // 3 MAC bytes in hex
+#define DISCOVERY_NAME_SIZE 48
+#define DISCOVERY_CAPS_SIZE 96
+
+static const char* DISCOVERY_TAG = "discovery";
+
+static void append_cap(char* caps, const char* cap)
+{
+    if (caps[0]) {
+        strlcat(caps, ",", DISCOVERY_CAPS_SIZE);
+    }
+    strlcat(caps, cap, DISCOVERY_CAPS_SIZE);
+}
+
+// Same names as the endpoints, so a client can tell what to offer before making a request
+static void build_caps(const led_t* led, char* caps)
+{
+    caps[0] = '\0';
+#if CONFIG_LED_RGBW
+    append_cap(caps, "rgbw");
+#endif
+    const zone_t* zones;
+    uint8_t zone_count = get_led_zones(led, &zones);
+    if (zone_count) {
+        append_cap(caps, "zones");
+    }
+    for (uint8_t i = 0; i < zone_count; i++) {
+        if (zones[i].layout == ZONE_LAYOUT_MATRIX || zones[i].layout == ZONE_LAYOUT_SERPENTINE) {
+            append_cap(caps, "matrix");
+            append_cap(caps, "text");
+            break;
+        }
+    }
+#if CONFIG_LED_AUDIO
+    append_cap(caps, "audio");
+#endif
+    append_cap(caps, "schedule");
+#if CONFIG_LED_GROUP
+    append_cap(caps, "group");
+#endif
+    append_cap(caps, "events");
+#if CONFIG_LED_LIVE
+    append_cap(caps, "live");
+#endif
+#if CONFIG_LED_METRICS
+    append_cap(caps, "metrics");
+#endif
+#if CONFIG_LED_TRACE
+    append_cap(caps, "trace");
+#endif
+}
+
+void discovery_init(const led_t* led)
+{
+    esp_err_t err = mdns_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(DISCOVERY_TAG, "Failed to start mDNS: %s", esp_err_to_name(err));
+        return;
+    }
+
+    // Several controllers on one network each need their own name
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    char id[DISCOVERY_ID_SIZE];
+    snprintf(id, sizeof(id), "%02x%02x%02x", mac[3], mac[4], mac[5]);
+    char hostname[DISCOVERY_NAME_SIZE];
+    snprintf(hostname, sizeof(hostname), "%s-%s", CONFIG_LED_HOSTNAME, id);
+    mdns_hostname_set(hostname);
+    mdns_instance_name_set(hostname);
+
+    char pixels[6];
+    snprintf(pixels, sizeof(pixels), "%u", get_led_length(led));
+    char caps[DISCOVERY_CAPS_SIZE];
+    build_caps(led, caps);
+    // mdns copies the items
+    mdns_txt_item_t txt[] = {
+        {"id", id},
+        {"version", esp_app_get_description()->version},
+        {"pixels", pixels},
+        {"caps", caps}
+    };
+    err = mdns_service_add(NULL, DISCOVERY_SERVICE_TYPE, DISCOVERY_SERVICE_PROTO, DISCOVERY_PORT, txt, sizeof(txt) / sizeof(txt[0]));
+    if (err != ESP_OK) {
+        ESP_LOGE(DISCOVERY_TAG, "Failed to add mDNS service: %s", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(DISCOVERY_TAG, "Advertising %s.local, caps %s", hostname, caps);
+}
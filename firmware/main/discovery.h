@@ -0,0 +1,26 @@
+#ifndef DISCOVERY_H
+#define DISCOVERY_H
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_app_desc.h"
+#include "mdns.h"
+#include "led_manager.h"
+
+/**
+ * @brief   Advertises the controller on the local network with mDNS/DNS-SD, so clients find it by
+ *          service instead of a hardcoded IP address
+ *
+ * @note Answers for <CONFIG_LED_HOSTNAME>-<last 3 MAC bytes>.local and publishes a _ledctl._tcp
+ *       service on port 80. Its TXT record carries id (the MAC suffix, stable across DHCP leases),
+ *       version (firmware), pixels (pixel count) and caps (comma-separated optional endpoints the
+ *       build serves). Needs the network up
+ *
+ * @param led: LED whose pixel count and zones are advertised
+ */
+void discovery_init(const led_t* led);
+
+#endif // DISCOVERY_H
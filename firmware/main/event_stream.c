@@ -0,0 +1,231 @@
+#include "event_stream.h"
+
+#define EVENT_MAX_CLIENTS 4
+#define EVENT_FRAME_MS 33               // At most one event per client per frame (~30 fps)
+#define EVENT_KEEPALIVE_MS 15000        // Comment line sent to idle clients so dead ones get noticed
+#define EVENT_STALL_TIMEOUT_MS 10000    // Clients that stay unwritable this long are dropped
+#define EVENT_BUF_SIZE 160
+#define EVENT_TASK_STACK_SIZE 3072
+#define EVENT_TASK_PRIORITY 4
+#define EVENT_TASK_CORE 0               // Network side, next to httpd and Wi-Fi
+#define MICRO_PER_MILLI 1000
+
+static const char* EVENT_TAG = "event stream";
+
+static const char* CHANGE_NAMES[] = {"mode", "state", "duration", "morse", "color", "pixels"};
+#define CHANGE_ALL ((1u << (sizeof(CHANGE_NAMES) / sizeof(CHANGE_NAMES[0]))) - 1)
+
+typedef struct {
+    httpd_req_t* req;           // Async copy of the subscribe request, NULL while the slot is free
+    int fd;
+    uint32_t changed;           // Pending led_change_t bits, merged across every version since the last event
+    uint16_t first_pixel;
+    uint16_t last_pixel;
+    uint32_t version;           // Only the latest version is ever sent
+    int64_t last_sent_us;
+    int64_t stalled_since_us;   // 0 while the socket is writable
+} event_client_t;
+
+static led_t* led;
+static TaskHandle_t event_task;
+static event_client_t clients[EVENT_MAX_CLIENTS];
+// Guards the pending fields, written by whichever task calls the LED setters
+static portMUX_TYPE clients_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void merge_change(event_client_t* client, uint32_t version, uint32_t changed, uint16_t first_pixel, uint16_t last_pixel)
+{
+    if (changed & LED_CHANGE_PIXELS) {
+        if (client->changed & LED_CHANGE_PIXELS) {
+            if (first_pixel < client->first_pixel) client->first_pixel = first_pixel;
+            if (last_pixel > client->last_pixel) client->last_pixel = last_pixel;
+        } else {
+            client->first_pixel = first_pixel;
+            client->last_pixel = last_pixel;
+        }
+    }
+    client->changed |= changed;
+    client->version = version;
+}
+
+static void on_led_change(uint32_t version, uint32_t changed, uint16_t first_pixel, uint16_t last_pixel)
+{
+    portENTER_CRITICAL(&clients_lock);
+    for (int i = 0; i < EVENT_MAX_CLIENTS; i++) {
+        if (clients[i].req) {
+            merge_change(&clients[i], version, changed, first_pixel, last_pixel);
+        }
+    }
+    portEXIT_CRITICAL(&clients_lock);
+
+    if (event_task) {
+        xTaskNotifyGive(event_task);
+    }
+}
+
+static bool socket_writable(int fd)
+{
+    fd_set write_fds;
+    FD_ZERO(&write_fds);
+    FD_SET(fd, &write_fds);
+    struct timeval no_wait = {0};
+    return select(fd + 1, NULL, &write_fds, NULL, &no_wait) > 0;
+}
+
+static void drop_client(event_client_t* client)
+{
+    httpd_req_t* req = client->req;
+    httpd_handle_t server = req->handle;
+    int fd = client->fd;
+
+    portENTER_CRITICAL(&clients_lock);
+    client->req = NULL;
+    portEXIT_CRITICAL(&clients_lock);
+
+    httpd_req_async_handler_complete(req);
+    httpd_sess_trigger_close(server, fd);
+    ESP_LOGI(EVENT_TAG, "Client on socket %d unsubscribed", fd);
+}
+
+static size_t format_event(char* buf, uint32_t version, uint32_t changed, uint16_t first_pixel, uint16_t last_pixel)
+{
+    size_t len = snprintf(
+        buf,
+        EVENT_BUF_SIZE,
+        "id: %" PRIu32 "\nevent: change\ndata: {\"version\":%" PRIu32 ",\"changed\":[",
+        version,
+        version
+    );
+    bool first = true;
+    for (int bit = 0; changed >> bit; bit++) {
+        if (changed & (1u << bit)) {
+            len += snprintf(buf + len, EVENT_BUF_SIZE - len, "%s\"%s\"", first ? "" : ",", CHANGE_NAMES[bit]);
+            first = false;
+        }
+    }
+    if (changed & LED_CHANGE_PIXELS) {
+        len += snprintf(buf + len, EVENT_BUF_SIZE - len, "],\"pixels\":[%u,%u]}\n\n", first_pixel, last_pixel);
+    } else {
+        len += snprintf(buf + len, EVENT_BUF_SIZE - len, "]}\n\n");
+    }
+    return len;
+}
+
+// Returns true if the client still has something to send after this frame
+static bool service_client(event_client_t* client, int64_t now)
+{
+    if (!client->req) return false;
+
+    bool keepalive_due = now - client->last_sent_us >= EVENT_KEEPALIVE_MS * MICRO_PER_MILLI;
+    if (!client->changed && !keepalive_due) return false;
+
+    // A slow client keeps accumulating into the same pending delta, nothing is queued behind it
+    if (!socket_writable(client->fd)) {
+        if (client->stalled_since_us == 0) {
+            client->stalled_since_us = now;
+        } else if (now - client->stalled_since_us >= EVENT_STALL_TIMEOUT_MS * MICRO_PER_MILLI) {
+            ESP_LOGW(EVENT_TAG, "Client on socket %d stalled", client->fd);
+            drop_client(client);
+            return false;
+        }
+        return true;
+    }
+    client->stalled_since_us = 0;
+
+    portENTER_CRITICAL(&clients_lock);
+    uint32_t changed = client->changed;
+    uint32_t version = client->version;
+    uint16_t first_pixel = client->first_pixel;
+    uint16_t last_pixel = client->last_pixel;
+    client->changed = 0;
+    portEXIT_CRITICAL(&clients_lock);
+
+    char buf[EVENT_BUF_SIZE];
+    size_t len;
+    if (changed) {
+        len = format_event(buf, version, changed, first_pixel, last_pixel);
+    } else {
+        len = snprintf(buf, EVENT_BUF_SIZE, ": keepalive\n\n");
+    }
+    if (httpd_resp_send_chunk(client->req, buf, len) != ESP_OK) {
+        drop_client(client);
+        return false;
+    }
+    client->last_sent_us = now;
+    return false;
+}
+
+static void event_stream_task(void* arg)
+{
+    bool pending = false;
+
+    for (;;) {
+        // Retry stalled clients next frame, otherwise sleep until a change or the keepalive
+        ulTaskNotifyTake(pdTRUE, pending ? 0 : pdMS_TO_TICKS(EVENT_KEEPALIVE_MS));
+
+        int64_t now = esp_timer_get_time();
+        pending = false;
+        for (int i = 0; i < EVENT_MAX_CLIENTS; i++) {
+            pending |= service_client(&clients[i], now);
+        }
+
+        // Changes arriving during this delay are coalesced into next frame's event
+        vTaskDelay(pdMS_TO_TICKS(EVENT_FRAME_MS));
+    }
+}
+
+esp_err_t event_stream_handler(httpd_req_t* req)
+{
+    // Before event_stream_init, or if its task failed to start, nothing would service or free a slot
+    if (!event_task) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_sendstr(req, "Event stream not running");
+        return ESP_FAIL;
+    }
+
+    // Only this handler fills slots and only the event task frees them, so a free slot stays free
+    event_client_t* client = NULL;
+    for (int i = 0; i < EVENT_MAX_CLIENTS && !client; i++) {
+        if (!clients[i].req) {
+            client = &clients[i];
+        }
+    }
+    if (!client) {
+        ESP_LOGW(EVENT_TAG, "No free subscriber slot");
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_sendstr(req, "Too many event stream clients");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "text/event-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_req_t* async_req;
+    if (httpd_req_async_handler_begin(req, &async_req) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start event stream");
+        return ESP_FAIL;
+    }
+
+    // First event announces the current version with everything marked changed
+    uint16_t length = get_led_length(led);
+    portENTER_CRITICAL(&clients_lock);
+    client->fd = httpd_req_to_sockfd(async_req);
+    client->changed = 0;
+    client->stalled_since_us = 0;
+    client->last_sent_us = esp_timer_get_time();
+    merge_change(client, get_led_version(led), CHANGE_ALL, 0, length - 1);
+    client->req = async_req;
+    portEXIT_CRITICAL(&clients_lock);
+
+    ESP_LOGI(EVENT_TAG, "Client on socket %d subscribed", client->fd);
+    xTaskNotifyGive(event_task);
+    return ESP_OK;
+}
+
+void event_stream_init(led_t* event_led)
+{
+    led = event_led;
+    if (xTaskCreatePinnedToCore(event_stream_task, "event stream", EVENT_TASK_STACK_SIZE, NULL, EVENT_TASK_PRIORITY, &event_task, EVENT_TASK_CORE) != pdPASS) {
+        ESP_LOGE(EVENT_TAG, "Failed to create event stream task");
+        return;
+    }
+    set_led_change_callback(led, on_led_change);
+}
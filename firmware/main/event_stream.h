@@ -0,0 +1,34 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "led_manager.h"
+
+/**
+ * @brief   Starts the task that pushes LED change events to subscribed clients and hooks it into led's change callback
+ * 
+ * @param led: LED whose changes are published
+ */
+void event_stream_init(led_t* led);
+
+/**
+ * @brief   URI handler that subscribes the client to a Server-Sent Events stream of LED changes
+ * 
+ * @note Each event is a compact delta ("event: change", data {"version", "changed", "pixels"}) rather than the full state.
+ *       Changes are coalesced so a client gets at most one event per frame, and a client whose socket is not writable
+ *       simply misses the intermediate versions instead of having them queued
+ * 
+ * @param req: Request, kept open as an async request for as long as the client stays subscribed
+ * 
+ * @return
+ *      - ESP_OK: Client subscribed
+ *      - ESP_FAIL: No free subscriber slot or the request could not be made async
+ */
+esp_err_t event_stream_handler(httpd_req_t* req);
+
+#endif // EVENT_STREAM_H
@@ -0,0 +1,111 @@
+#include "fft.h"
+
+static int16_t to_q15(float value)
+{
+    float scaled = roundf(value * 32768.0f);
+    if (scaled > INT16_MAX) return INT16_MAX;
+    if (scaled < INT16_MIN) return INT16_MIN;
+    return (int16_t)scaled;
+}
+
+static int16_t saturate(int32_t value)
+{
+    if (value > INT16_MAX) return INT16_MAX;
+    if (value < INT16_MIN) return INT16_MIN;
+    return (int16_t)value;
+}
+
+// Q15 product, rounded
+static inline int32_t q15_mul(int32_t a, int32_t b)
+{
+    return (a * b + (1 << 14)) >> 15;
+}
+
+esp_err_t fft_init(fft_t* fft, uint16_t points)
+{
+    if (points < 16 || points > FFT_MAX_POINTS || (points & (points - 1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint16_t half = points / 2;
+    fft->points = points;
+    fft->stages = 0;
+    while ((1u << fft->stages) < half) {
+        fft->stages++;
+    }
+    for (uint16_t k = 0; k < half; k++) {
+        float angle = -2.0f * (float)M_PI * k / points;
+        fft->twiddles[k].re = to_q15(cosf(angle));
+        fft->twiddles[k].im = to_q15(sinf(angle));
+
+        uint16_t reversed = 0;
+        for (uint8_t bit = 0; bit < fft->stages; bit++) {
+            reversed |= ((k >> bit) & 1) << (fft->stages - 1 - bit);
+        }
+        fft->bit_reverse[k] = reversed;
+    }
+    return ESP_OK;
+}
+
+// In-place complex FFT of points / 2 values already in bit-reversed order, halved every stage
+static void fft_complex(const fft_t* fft, fft_complex_t* data)
+{
+    uint16_t count = fft->points / 2;
+    for (uint16_t size = 2; size <= count; size <<= 1) {
+        uint16_t span = size / 2;
+        // W_size^j is W_points^(j * points / size)
+        uint16_t step = fft->points / size;
+        for (uint16_t j = 0; j < span; j++) {
+            int32_t wr = fft->twiddles[j * step].re;
+            int32_t wi = fft->twiddles[j * step].im;
+            for (uint16_t top = j; top < count; top += size) {
+                fft_complex_t* a = &data[top];
+                fft_complex_t* b = &data[top + span];
+                int32_t tr = q15_mul(b->re, wr) - q15_mul(b->im, wi);
+                int32_t ti = q15_mul(b->re, wi) + q15_mul(b->im, wr);
+                b->re = (int16_t)((a->re - tr) >> 1);
+                b->im = (int16_t)((a->im - ti) >> 1);
+                a->re = (int16_t)((a->re + tr) >> 1);
+                a->im = (int16_t)((a->im + ti) >> 1);
+            }
+        }
+    }
+}
+
+// One bin of the real spectrum from the half-length complex one: with z = Z[k] and c = conj(Z[half - k]),
+// X[k] = (z + c) / 2 + W^k (z - c) / 2i. Returned halved again so the whole transform is scaled by 1 / points
+static fft_complex_t split_bin(fft_complex_t z, fft_complex_t mirror, fft_complex_t w)
+{
+    int32_t even_re = z.re + mirror.re;
+    int32_t even_im = z.im - mirror.im;
+    // (z - c) / i
+    int32_t odd_re = z.im + mirror.im;
+    int32_t odd_im = mirror.re - z.re;
+    fft_complex_t bin = {
+        .re = saturate((even_re + q15_mul(odd_re, w.re) - q15_mul(odd_im, w.im) + 2) >> 2),
+        .im = saturate((even_im + q15_mul(odd_re, w.im) + q15_mul(odd_im, w.re) + 2) >> 2)
+    };
+    return bin;
+}
+
+void fft_real(const fft_t* fft, const int16_t* samples, fft_complex_t* spectrum)
+{
+    uint16_t half = fft->points / 2;
+    // Even samples as the real part and odd ones as the imaginary part, already in bit-reversed order
+    for (uint16_t n = 0; n < half; n++) {
+        fft_complex_t* slot = &spectrum[fft->bit_reverse[n]];
+        slot->re = samples[2 * n];
+        slot->im = samples[2 * n + 1];
+    }
+    fft_complex(fft, spectrum);
+
+    // Bins k and half - k read each other's value, so they are split together in place
+    fft_complex_t dc = spectrum[0];
+    spectrum[0] = (fft_complex_t){ .re = (int16_t)((dc.re + dc.im) >> 1), .im = 0 };
+    spectrum[half] = (fft_complex_t){ .re = (int16_t)((dc.re - dc.im) >> 1), .im = 0 };
+    for (uint16_t k = 1; k <= half / 2; k++) {
+        fft_complex_t low = spectrum[k];
+        fft_complex_t high = spectrum[half - k];
+        spectrum[k] = split_bin(low, high, fft->twiddles[k]);
+        spectrum[half - k] = split_bin(high, low, fft->twiddles[half - k]);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <stdint.h>
+#include <math.h>
+#include "esp_err.h"
+
+// Only depends on the C library so it can be built and tested on a host
+
+#define FFT_MAX_POINTS 1024
+
+/**
+ * @brief   Q15 complex value, 32767 is just under 1.0
+ */
+typedef struct {
+    int16_t re;
+    int16_t im;
+} fft_complex_t;
+
+/**
+ * @brief   Tables for a fixed-point real FFT of one size
+ *
+ * @note Treat every member as private. The real input is transformed as a complex FFT of half
+ *       its length, so the tables only cover points / 2
+ */
+typedef struct {
+    uint16_t points;                                    // Real input length
+    uint8_t stages;                                     // log2(points / 2)
+    fft_complex_t twiddles[FFT_MAX_POINTS / 2];         // e^(-2 pi i k / points)
+    uint16_t bit_reverse[FFT_MAX_POINTS / 2];
+} fft_t;
+
+/**
+ * @brief   Builds the twiddle and bit reversal tables
+ *
+ * @param fft: Tables to fill
+ * @param points: Real input length, a power of two from 16 to FFT_MAX_POINTS
+ *
+ * @return
+ *      - ESP_OK: Tables ready
+ *      - ESP_ERR_INVALID_ARG: If points is not a supported power of two
+ */
+esp_err_t fft_init(fft_t* fft, uint16_t points);
+
+/**
+ * @brief   Transforms real Q15 samples into the first half of their spectrum
+ *
+ * @note Every stage halves its result so nothing can overflow, which makes the output the
+ *       spectrum divided by points: a full-scale sine at a bin's frequency comes out near 16384
+ *       in that bin. Integer-only, radix-2 with 32-bit intermediates
+ *
+ * @param fft: Tables from fft_init
+ * @param samples: points samples, read only
+ * @param spectrum: Filled with bins 0 to points / 2 inclusive, points / 2 + 1 values
+ */
+void fft_real(const fft_t* fft, const int16_t* samples, fft_complex_t* spectrum);
+
+/**
+ * @brief   Gets the power of one bin
+ *
+ * @param bin: Spectrum bin
+ *
+ * @return re^2 + im^2, which always fits in 32 bits
+ */
+static inline uint32_t fft_power(fft_complex_t bin)
+{
+    return (uint32_t)((int32_t)bin.re * bin.re) + (uint32_t)((int32_t)bin.im * bin.im);
+}
+
+#endif // FFT_H
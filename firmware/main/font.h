@@ -0,0 +1,25 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <stdint.h>
+
+// Only depends on the C library so it can be built and tested on a host
+
+#define FONT_WIDTH 5
+#define FONT_HEIGHT 7
+#define FONT_FIRST ' '
+#define FONT_LAST '~'
+
+/**
+ * @brief   Gets the 5x7 glyph for a printable ASCII character
+ *
+ * @note Glyphs are FONT_WIDTH columns, left to right, with bit n of each set for a lit pixel in row n
+ *       (bit 0 is the top row). The table is const, so it stays in flash
+ *
+ * @param c: Character, anything outside FONT_FIRST to FONT_LAST gives the glyph for '?'
+ *
+ * @return FONT_WIDTH column bytes
+ */
+const uint8_t* font_glyph(char c);
+
+#endif // FONT_H
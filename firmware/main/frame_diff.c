@@ -0,0 +1,63 @@
+#include "frame_diff.h"
+
+#define MERGE_GAP 1         // Unchanged pixels worth sending to save a range header (3 bytes each against 4)
+
+static void put_u16(uint8_t* p, uint16_t value)
+{
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+static uint16_t get_u16(const uint8_t* p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static bool changed(const uint8_t (*sent)[3], const uint8_t (*frame)[3], uint16_t i)
+{
+    return memcmp(sent[i], frame[i], 3) != 0;
+}
+
+size_t frame_diff_encode(uint8_t (*sent)[3], const uint8_t (*frame)[3], uint16_t count, uint8_t* out)
+{
+    size_t len = 0;
+    uint16_t i = 0;
+
+    while (i < count) {
+        if (!changed(sent, frame, i)) {
+            i++;
+            continue;
+        }
+        // Extend the range over every change no more than MERGE_GAP pixels after the last one
+        uint16_t start = i;
+        uint16_t end = i + 1;       // One past the last change
+        for (uint16_t j = end; j < count && j <= end + MERGE_GAP; j++) {
+            if (changed(sent, frame, j)) end = j + 1;
+        }
+        uint16_t run = end - start;
+        put_u16(out + len, start);
+        put_u16(out + len + 2, run);
+        len += FRAME_DIFF_RANGE_HEADER;
+        memcpy(out + len, frame[start], 3 * run);
+        memcpy(sent[start], frame[start], 3 * run);
+        len += 3 * run;
+        i = end;
+    }
+    return len;
+}
+
+bool frame_diff_apply(uint8_t (*frame)[3], uint16_t count, const uint8_t* buf, size_t len)
+{
+    size_t pos = 0;
+
+    while (pos < len) {
+        if (len - pos < FRAME_DIFF_RANGE_HEADER) return false;
+        uint16_t start = get_u16(buf + pos);
+        uint16_t run = get_u16(buf + pos + 2);
+        pos += FRAME_DIFF_RANGE_HEADER;
+        if (run == 0 || start >= count || run > count - start || len - pos < 3 * (size_t)run) return false;
+        memcpy(frame[start], buf + pos, 3 * run);
+        pos += 3 * run;
+    }
+    return true;
+}
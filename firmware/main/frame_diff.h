@@ -0,0 +1,43 @@
+#ifndef FRAME_DIFF_H
+#define FRAME_DIFF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// Only depends on the C library so it can be built and tested on a host
+
+#define FRAME_DIFF_RANGE_HEADER 4                           // start (2 bytes), count (2 bytes)
+#define FRAME_DIFF_MAX_SIZE(count) (FRAME_DIFF_RANGE_HEADER + 3 * (count))  // Every pixel changed, one range
+
+/**
+ * @brief   Encodes the pixels of frame that differ from sent as ranges, and brings sent up to date
+ *
+ * @note Each range is start and count (little-endian, 2 bytes each) followed by count red, green, blue
+ *       triples. A run of one unchanged pixel between changes is sent inside the range rather than
+ *       opening a new one, its 3 bytes being cheaper than another range header. Nothing is written
+ *       when the frames are equal. Linear in count with a 3-byte compare per pixel
+ *
+ * @param sent: Frame the receiver holds, updated to frame
+ * @param frame: Frame to send
+ * @param count: Pixels in both frames
+ * @param out: Encoded ranges, at least FRAME_DIFF_MAX_SIZE(count) bytes
+ *
+ * @return Bytes written to out, 0 if nothing changed
+ */
+size_t frame_diff_encode(uint8_t (*sent)[3], const uint8_t (*frame)[3], uint16_t count, uint8_t* out);
+
+/**
+ * @brief   Applies encoded ranges to the receiver's frame
+ *
+ * @param frame: Frame to update
+ * @param count: Pixels in frame
+ * @param buf: Ranges from frame_diff_encode
+ * @param len: Length of buf
+ *
+ * @return true if every range was well-formed and inside the frame. frame may be partly updated otherwise
+ */
+bool frame_diff_apply(uint8_t (*frame)[3], uint16_t count, const uint8_t* buf, size_t len);
+
+#endif // FRAME_DIFF_H
@@ -0,0 +1,380 @@
+#include "group.h"
+
+#if CONFIG_LED_GROUP
+
+#define GROUP_TASK_STACK_SIZE 3072
+#define GROUP_TASK_PRIORITY 5
+#define GROUP_TASK_CORE 0               // Network side, next to httpd and Wi-Fi
+#define GROUP_APPLY_TASK_STACK_SIZE 3072
+#define GROUP_APPLY_TASK_PRIORITY 6     // Above the group task, a due command isn't held behind packets
+#define GROUP_SYNC_INTERVAL_US 500000
+#define GROUP_LEADER_TIMEOUT_US 5000000     // No reply this long, ask the whole group again
+#define GROUP_SYNC_TIMEOUT_US 30000000      // No reply this long, drift makes the offset untrustworthy
+#define GROUP_COMMAND_REPEATS 3
+#define MICRO_PER_MILLI 1000
+
+_Static_assert(GROUP_MODE_LIGHT == LED_MODE_LIGHT && GROUP_MODE_BLINKY == LED_MODE_BLINKY && GROUP_MODE_AUDIO == LED_MODE_AUDIO,
+               "group modes are led_mode_t values");
+
+static const char* GROUP_TAG = "group";
+
+static led_t* led;
+static int group_socket = -1;
+static struct sockaddr_in group_addr;
+static struct sockaddr_in leader_addr;  // Learned from the first reply, sync requests go straight to it
+static bool leader_known;
+static esp_timer_handle_t apply_timer;
+static TaskHandle_t apply_task;
+// Held by whoever touches the clock or the pending commands: the group task, the apply task and the senders
+static SemaphoreHandle_t group_lock;
+static group_clock_t group_clock;
+static group_pending_t pending;
+static group_dedup_t dedup;
+static uint32_t sender_id;
+static uint32_t sequence;
+static int64_t last_request_t1;
+static int64_t last_reply_us;
+
+static bool is_leader()
+{
+#if CONFIG_LED_GROUP_LEADER
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Only called with group_lock held
+static bool synced(int64_t now)
+{
+    return is_leader() || (group_clock_synced(&group_clock) && now - last_reply_us < GROUP_SYNC_TIMEOUT_US);
+}
+
+// Effects run on the group clock as soon as there is one, a stale estimate still beats the local clock
+static int64_t group_time_now()
+{
+    xSemaphoreTake(group_lock, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    int64_t time = !is_leader() && group_clock_synced(&group_clock) ? group_clock_to_group(&group_clock, now) : now;
+    xSemaphoreGive(group_lock);
+    return time;
+}
+
+static int64_t group_time_to_local(int64_t time)
+{
+    xSemaphoreTake(group_lock, portMAX_DELAY);
+    int64_t local = !is_leader() && group_clock_synced(&group_clock) ? group_clock_to_local(&group_clock, time) : time;
+    xSemaphoreGive(group_lock);
+    return local;
+}
+
+static const led_time_base_t group_time_base = {
+    .now = group_time_now,
+    .to_local = group_time_to_local
+};
+
+// Same order as a /batch operation, so a command behaves like posting it
+static void apply_action(const group_action_t* action)
+{
+    led_batch_begin(led);
+    if (action->has_color) {
+        set_led_rgbw(led, action->rgbw[0], action->rgbw[1], action->rgbw[2], action->rgbw[3]);
+    }
+    if (action->has_state) {
+        set_led_state(led, action->state);
+    }
+    if (action->has_duration) {
+        set_led_blink_duration(led, action->blink_duration);
+    }
+    if (action->has_mode) {
+        set_led_mode(led, (led_mode_t)action->mode);
+    } else if (action->has_state) {
+        set_led_mode(led, LED_MODE_LIGHT);
+    }
+    led_batch_commit(led);
+}
+
+// Only called with group_lock held
+static void arm_apply_timer()
+{
+    int64_t at;
+    esp_timer_stop(apply_timer);
+    if (group_pending_next(&pending, &at)) {
+        int64_t wait = at - esp_timer_get_time();
+        esp_timer_start_once(apply_timer, wait > 0 ? wait : 0);
+    }
+}
+
+// Runs in the esp_timer task shared by every timer, applying can block on the lock and a full command queue
+static void apply_timer_callback(void* arg)
+{
+    xTaskNotifyGive(apply_task);
+}
+
+static void group_apply_task(void* arg)
+{
+    group_action_t due[GROUP_MAX_PENDING];
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint8_t due_count = 0;
+        xSemaphoreTake(group_lock, portMAX_DELAY);
+        int64_t now = esp_timer_get_time();
+        while (due_count < GROUP_MAX_PENDING && group_pending_pop_due(&pending, now, &due[due_count])) {
+            due_count++;
+        }
+        arm_apply_timer();
+        xSemaphoreGive(group_lock);
+
+        for (uint8_t i = 0; i < due_count; i++) {
+            apply_action(&due[i]);
+        }
+    }
+}
+
+// Only called with group_lock held
+static esp_err_t queue_command(int64_t execute_at, const group_action_t* action)
+{
+    int64_t now = esp_timer_get_time();
+    // Without a group clock the best this member can do is run it now
+    int64_t at = is_leader() ? execute_at : synced(now) ? group_clock_to_local(&group_clock, execute_at) : now;
+    if (!group_pending_add(&pending, at, action)) {
+        return ESP_ERR_NO_MEM;
+    }
+    arm_apply_timer();
+    return ESP_OK;
+}
+
+static void send_packet(const group_packet_t* packet, const struct sockaddr_in* to)
+{
+    uint8_t buf[GROUP_PACKET_MAX_SIZE];
+    size_t len = group_packet_encode(packet, buf);
+    if (sendto(group_socket, buf, len, 0, (const struct sockaddr*)to, sizeof(*to)) < 0) {
+        ESP_LOGW(GROUP_TAG, "Failed to send packet: errno %d", errno);
+    }
+}
+
+static void send_sync_request()
+{
+    group_packet_t packet = {
+        .type = GROUP_PACKET_SYNC_REQUEST,
+        .group = CONFIG_LED_GROUP_ID,
+        .sender = sender_id
+    };
+    xSemaphoreTake(group_lock, portMAX_DELAY);
+    packet.sequence = ++sequence;
+    if (leader_known && esp_timer_get_time() - last_reply_us > GROUP_LEADER_TIMEOUT_US) {
+        ESP_LOGW(GROUP_TAG, "Clock leader stopped replying");
+        leader_known = false;
+    }
+    const struct sockaddr_in* to = leader_known ? &leader_addr : &group_addr;
+    // Taken as late as possible, any time between here and the wire adds to the delay
+    packet.sync_request.t1 = last_request_t1 = esp_timer_get_time();
+    xSemaphoreGive(group_lock);
+    send_packet(&packet, to);
+}
+
+static void handle_packet(const group_packet_t* packet, const struct sockaddr_in* from, int64_t received)
+{
+    switch (packet->type) {
+        case GROUP_PACKET_SYNC_REQUEST: {
+            if (!is_leader()) return;
+            group_packet_t reply = {
+                .type = GROUP_PACKET_SYNC_REPLY,
+                .group = CONFIG_LED_GROUP_ID,
+                .sender = sender_id,
+                .sequence = packet->sequence,
+                .sync_reply = {
+                    .requester = packet->sender,
+                    .t1 = packet->sync_request.t1,
+                    .t2 = received
+                }
+            };
+            reply.sync_reply.t3 = esp_timer_get_time();
+            send_packet(&reply, from);
+            break;
+        }
+        case GROUP_PACKET_SYNC_REPLY:
+            // Replies to an older request would pair the wrong t1 with this t4
+            xSemaphoreTake(group_lock, portMAX_DELAY);
+            if (packet->sync_reply.requester == sender_id && packet->sync_reply.t1 == last_request_t1) {
+                if (!group_clock_synced(&group_clock)) {
+                    ESP_LOGI(GROUP_TAG, "Synced to clock leader");
+                }
+                group_clock_add_sample(&group_clock, packet->sync_reply.t1, packet->sync_reply.t2, packet->sync_reply.t3, received);
+                last_reply_us = received;
+                leader_addr = *from;
+                leader_known = true;
+            }
+            xSemaphoreGive(group_lock);
+            break;
+        case GROUP_PACKET_COMMAND:
+#if !CONFIG_LED_AUDIO
+            // Without a microphone audio mode would only stay dark
+            if (packet->command.action.has_mode && packet->command.action.mode == GROUP_MODE_AUDIO) {
+                ESP_LOGW(GROUP_TAG, "Dropping audio mode command, no audio input");
+                break;
+            }
+#endif
+            xSemaphoreTake(group_lock, portMAX_DELAY);
+            if (!group_dedup_seen(&dedup, packet->sender, packet->sequence)) {
+                if (queue_command(packet->command.execute_at, &packet->command.action) != ESP_OK) {
+                    ESP_LOGW(GROUP_TAG, "Dropping command, %d already pending", GROUP_MAX_PENDING);
+                }
+            }
+            xSemaphoreGive(group_lock);
+            break;
+    }
+}
+
+static void group_task(void* arg)
+{
+    uint8_t buf[GROUP_PACKET_MAX_SIZE];
+    int64_t next_sync = 0;
+
+    for (;;) {
+        int64_t now = esp_timer_get_time();
+        if (!is_leader() && now >= next_sync) {
+            send_sync_request();
+            next_sync = now + GROUP_SYNC_INTERVAL_US;
+        }
+
+        // Wait for a packet until the next sync request is due
+        int64_t wait = is_leader() ? GROUP_SYNC_INTERVAL_US : next_sync - now;
+        struct timeval timeout = { .tv_sec = wait / 1000000, .tv_usec = wait % 1000000 };
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        FD_SET(group_socket, &read_fds);
+        if (select(group_socket + 1, &read_fds, NULL, NULL, &timeout) <= 0) {
+            continue;
+        }
+
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        int len = recvfrom(group_socket, buf, sizeof(buf), 0, (struct sockaddr*)&from, &from_len);
+        int64_t received = esp_timer_get_time();
+        group_packet_t packet;
+        if (len <= 0 || !group_packet_decode(buf, len, &packet) ||
+            packet.group != CONFIG_LED_GROUP_ID || packet.sender == sender_id) {
+            continue;
+        }
+        handle_packet(&packet, &from, received);
+    }
+}
+
+static esp_err_t open_socket()
+{
+    group_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (group_socket < 0) return ESP_FAIL;
+
+    struct sockaddr_in bind_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_LED_GROUP_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY)
+    };
+    group_addr.sin_family = AF_INET;
+    group_addr.sin_port = htons(CONFIG_LED_GROUP_PORT);
+    group_addr.sin_addr.s_addr = inet_addr(CONFIG_LED_GROUP_ADDRESS);
+    struct ip_mreq membership = {
+        .imr_multiaddr.s_addr = group_addr.sin_addr.s_addr,
+        .imr_interface.s_addr = htonl(INADDR_ANY)
+    };
+    // Stays on the local network, and this member queues its own commands directly
+    uint8_t ttl = 1;
+    uint8_t loop = 0;
+    if (bind(group_socket, (struct sockaddr*)&bind_addr, sizeof(bind_addr)) < 0 ||
+        setsockopt(group_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0 ||
+        setsockopt(group_socket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+        setsockopt(group_socket, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+        close(group_socket);
+        group_socket = -1;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void group_init(led_t* group_led)
+{
+    led = group_led;
+    sender_id = esp_random();
+    sequence = esp_random();
+    group_clock_init(&group_clock);
+    group_pending_init(&pending);
+    group_dedup_init(&dedup);
+
+    group_lock = xSemaphoreCreateMutex();
+    if (!group_lock) {
+        ESP_LOGE(GROUP_TAG, "Failed to create group lock");
+        return;
+    }
+    const esp_timer_create_args_t apply_timer_args = {
+        .callback = apply_timer_callback,
+        .name = "group apply"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&apply_timer_args, &apply_timer));
+    if (xTaskCreatePinnedToCore(group_apply_task, "group apply", GROUP_APPLY_TASK_STACK_SIZE, NULL, GROUP_APPLY_TASK_PRIORITY, &apply_task, GROUP_TASK_CORE) != pdPASS) {
+        ESP_LOGE(GROUP_TAG, "Failed to create group apply task");
+        return;
+    }
+    led_set_time_base(&group_time_base);
+
+    // Power saving holds packets for the next beacon, a delay that is different on every member
+    esp_wifi_set_ps(WIFI_PS_NONE);
+    if (open_socket() != ESP_OK) {
+        ESP_LOGE(GROUP_TAG, "Failed to join %s:%d: errno %d", CONFIG_LED_GROUP_ADDRESS, CONFIG_LED_GROUP_PORT, errno);
+        return;
+    }
+
+    if (xTaskCreatePinnedToCore(group_task, "group", GROUP_TASK_STACK_SIZE, NULL, GROUP_TASK_PRIORITY, NULL, GROUP_TASK_CORE) != pdPASS) {
+        ESP_LOGE(GROUP_TAG, "Failed to create group task");
+        return;
+    }
+    ESP_LOGI(GROUP_TAG, "Joined group %d at %s:%d as %s", CONFIG_LED_GROUP_ID, CONFIG_LED_GROUP_ADDRESS, CONFIG_LED_GROUP_PORT,
+             is_leader() ? "clock leader" : "member");
+}
+
+esp_err_t group_send(const group_action_t* action, uint32_t delay_ms)
+{
+    group_packet_t packet = {
+        .type = GROUP_PACKET_COMMAND,
+        .group = CONFIG_LED_GROUP_ID,
+        .sender = sender_id,
+        .command.action = *action
+    };
+
+    xSemaphoreTake(group_lock, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    if (group_socket < 0 || !synced(now)) {
+        xSemaphoreGive(group_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    packet.sequence = ++sequence;
+    packet.command.execute_at = (is_leader() ? now : group_clock_to_group(&group_clock, now)) + (int64_t)delay_ms * MICRO_PER_MILLI;
+    esp_err_t err = queue_command(packet.command.execute_at, action);
+    xSemaphoreGive(group_lock);
+    if (err != ESP_OK) return err;
+
+    uint8_t buf[GROUP_PACKET_MAX_SIZE];
+    size_t len = group_packet_encode(&packet, buf);
+    int sent = 0;
+    for (int i = 0; i < GROUP_COMMAND_REPEATS; i++) {
+        if (sendto(group_socket, buf, len, 0, (const struct sockaddr*)&group_addr, sizeof(group_addr)) == (int)len) {
+            sent++;
+        }
+    }
+    return sent ? ESP_OK : ESP_FAIL;
+}
+
+void group_get_status(group_status_t* status)
+{
+    xSemaphoreTake(group_lock, portMAX_DELAY);
+    status->leader = is_leader();
+    status->synced = synced(esp_timer_get_time());
+    status->offset_us = is_leader() ? 0 : group_clock_offset(&group_clock, esp_timer_get_time());
+    status->drift_ppb = is_leader() ? 0 : group_clock_drift_ppb(&group_clock);
+    status->delay_us = is_leader() ? 0 : group_clock_delay(&group_clock);
+    status->pending = group_pending_count(&pending);
+    xSemaphoreGive(group_lock);
+}
+
+#endif // CONFIG_LED_GROUP
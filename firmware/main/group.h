@@ -0,0 +1,73 @@
+#ifndef GROUP_H
+#define GROUP_H
+
+#include <errno.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "led_manager.h"
+#include "group_protocol.h"
+
+#define GROUP_DEFAULT_DELAY_MS 300      // Covers multicast being held for the AP's next DTIM beacon
+#define GROUP_MAX_DELAY_MS 60000
+
+/**
+ * @brief   Snapshot of the group member, filled by group_get_status
+ */
+typedef struct {
+    bool leader;                //!< This member's clock is the group clock
+    bool synced;                //!< Leader, or a sync reply arrived recently enough to trust the offset
+    int64_t offset_us;          //!< Group clock minus local clock
+    int64_t delay_us;           //!< Round trip the offset comes from, its error is at most half of it
+    int32_t drift_ppb;          //!< How much faster the group clock runs
+    uint8_t pending;            //!< Commands waiting for their execution time
+} group_status_t;
+
+/**
+ * @brief   Joins the multicast group set by menuconfig and starts the task that keeps the group clock
+ *          and receives commands
+ *
+ * @note One member per group is the clock leader (CONFIG_LED_GROUP_LEADER), the others sync to it every
+ *       half second with a request/reply exchange and keep the offset of the fastest recent exchange,
+ *       carried forward by the measured drift. Commands carry an execution time on the leader's clock and
+ *       are run by a task an esp_timer wakes at the local equivalent, so every member changes in the same
+ *       frame. Blinky, Morse Code and scrolling text run on the group clock too, so they stay in phase across
+ *       members.
+ *       Turns Wi-Fi power saving off, which delays packets by up to a beacon interval. Only built with
+ *       CONFIG_LED_GROUP, needs the network up
+ *
+ * @param led: LED commands change
+ */
+void group_init(led_t* led);
+
+/**
+ * @brief   Sends a command to every member of the group, this one included, to run delay_ms from now
+ *
+ * @note Sent a few times since multicast over Wi-Fi is not acknowledged, members drop the repeats
+ *
+ * @param action: What to change
+ * @param delay_ms: Time until every member runs it, must cover the network latency
+ *
+ * @return
+ *      - ESP_OK: Command sent and queued here
+ *      - ESP_ERR_INVALID_STATE: If this member has no group clock yet
+ *      - ESP_ERR_NO_MEM: If GROUP_MAX_PENDING commands are already waiting here
+ *      - ESP_FAIL: If sending failed
+ */
+esp_err_t group_send(const group_action_t* action, uint32_t delay_ms);
+
+/**
+ * @brief   Reports the group clock and the queued commands
+ *
+ * @param status: Filled with the current status
+ */
+void group_get_status(group_status_t* status);
+
+#endif // GROUP_H
@@ -0,0 +1,301 @@
+#include "group_protocol.h"
+
+#define GROUP_MAGIC_0 'L'
+#define GROUP_MAGIC_1 'G'
+#define GROUP_PROTOCOL_VERSION 1
+#define GROUP_HEADER_SIZE 13            // Magic, version, type, group, sender, sequence
+#define GROUP_SYNC_REQUEST_SIZE (GROUP_HEADER_SIZE + 8)
+#define GROUP_SYNC_REPLY_SIZE (GROUP_HEADER_SIZE + 4 + 3 * 8)
+#define GROUP_COMMAND_SIZE (GROUP_HEADER_SIZE + 8 + 1 + 1 + 4 + 4)
+#define GROUP_DRIFT_MIN_SAMPLES 3
+#define GROUP_DRIFT_MIN_SPAN 1000000    // Exchanges closer together than this give no usable slope
+#define GROUP_DRIFT_MAX 0.0005          // 500 ppm, far outside any crystal, anything beyond is noise
+
+// Command flag bits
+#define GROUP_FLAG_HAS_STATE 0x01
+#define GROUP_FLAG_STATE 0x02
+#define GROUP_FLAG_HAS_MODE 0x04
+#define GROUP_FLAG_HAS_COLOR 0x08
+#define GROUP_FLAG_HAS_DURATION 0x10
+
+static uint8_t* put_u32(uint8_t* p, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        *p++ = value >> (8 * i);
+    }
+    return p;
+}
+
+static uint8_t* put_i64(uint8_t* p, int64_t value)
+{
+    p = put_u32(p, (uint64_t)value);
+    return put_u32(p, (uint64_t)value >> 32);
+}
+
+static uint32_t get_u32(const uint8_t** p)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)(*p)[i] << (8 * i);
+    }
+    *p += 4;
+    return value;
+}
+
+static int64_t get_i64(const uint8_t** p)
+{
+    uint64_t low = get_u32(p);
+    uint64_t high = get_u32(p);
+    return (int64_t)(high << 32 | low);
+}
+
+size_t group_packet_encode(const group_packet_t* packet, uint8_t buf[GROUP_PACKET_MAX_SIZE])
+{
+    uint8_t* p = buf;
+    *p++ = GROUP_MAGIC_0;
+    *p++ = GROUP_MAGIC_1;
+    *p++ = GROUP_PROTOCOL_VERSION;
+    *p++ = packet->type;
+    *p++ = packet->group;
+    p = put_u32(p, packet->sender);
+    p = put_u32(p, packet->sequence);
+
+    switch (packet->type) {
+        case GROUP_PACKET_SYNC_REQUEST:
+            p = put_i64(p, packet->sync_request.t1);
+            break;
+        case GROUP_PACKET_SYNC_REPLY:
+            p = put_u32(p, packet->sync_reply.requester);
+            p = put_i64(p, packet->sync_reply.t1);
+            p = put_i64(p, packet->sync_reply.t2);
+            p = put_i64(p, packet->sync_reply.t3);
+            break;
+        case GROUP_PACKET_COMMAND: {
+            const group_action_t* action = &packet->command.action;
+            p = put_i64(p, packet->command.execute_at);
+            *p++ = (action->has_state ? GROUP_FLAG_HAS_STATE : 0) | (action->state ? GROUP_FLAG_STATE : 0) |
+                   (action->has_mode ? GROUP_FLAG_HAS_MODE : 0) | (action->has_color ? GROUP_FLAG_HAS_COLOR : 0) |
+                   (action->has_duration ? GROUP_FLAG_HAS_DURATION : 0);
+            *p++ = action->mode;
+            memcpy(p, action->rgbw, 4);
+            p += 4;
+            p = put_u32(p, action->blink_duration);
+            break;
+        }
+    }
+    return p - buf;
+}
+
+static bool valid_mode(uint8_t mode)
+{
+    return mode == GROUP_MODE_LIGHT || mode == GROUP_MODE_BLINKY || mode == GROUP_MODE_AUDIO;
+}
+
+bool group_packet_decode(const uint8_t* buf, size_t len, group_packet_t* packet)
+{
+    if (len < GROUP_HEADER_SIZE || buf[0] != GROUP_MAGIC_0 || buf[1] != GROUP_MAGIC_1 || buf[2] != GROUP_PROTOCOL_VERSION) {
+        return false;
+    }
+    const uint8_t* p = buf + 3;
+    packet->type = *p++;
+    packet->group = *p++;
+    packet->sender = get_u32(&p);
+    packet->sequence = get_u32(&p);
+
+    switch (packet->type) {
+        case GROUP_PACKET_SYNC_REQUEST:
+            if (len != GROUP_SYNC_REQUEST_SIZE) return false;
+            packet->sync_request.t1 = get_i64(&p);
+            return true;
+        case GROUP_PACKET_SYNC_REPLY:
+            if (len != GROUP_SYNC_REPLY_SIZE) return false;
+            packet->sync_reply.requester = get_u32(&p);
+            packet->sync_reply.t1 = get_i64(&p);
+            packet->sync_reply.t2 = get_i64(&p);
+            packet->sync_reply.t3 = get_i64(&p);
+            return true;
+        case GROUP_PACKET_COMMAND: {
+            if (len != GROUP_COMMAND_SIZE) return false;
+            group_action_t* action = &packet->command.action;
+            packet->command.execute_at = get_i64(&p);
+            uint8_t flags = *p++;
+            action->has_state = flags & GROUP_FLAG_HAS_STATE;
+            action->state = flags & GROUP_FLAG_STATE;
+            action->has_mode = flags & GROUP_FLAG_HAS_MODE;
+            action->has_color = flags & GROUP_FLAG_HAS_COLOR;
+            action->has_duration = flags & GROUP_FLAG_HAS_DURATION;
+            action->mode = *p++;
+            memcpy(action->rgbw, p, 4);
+            p += 4;
+            action->blink_duration = get_u32(&p);
+            // Anyone on the network can send one, only modes a member can run without more data are applied
+            return !action->has_mode || valid_mode(action->mode);
+        }
+        default:
+            return false;
+    }
+}
+
+void group_clock_init(group_clock_t* clock)
+{
+    clock->next = 0;
+    clock->count = 0;
+    clock->reference = 0;
+    clock->offset = 0;
+    clock->delay = 0;
+    clock->drift = 0;
+}
+
+// Slope of offset over time across the exchanges delayed at most twice the best one, 0 unless it stands out
+// from the noise: under heavy jitter a wrong drift carried forward is worse than none
+static double estimate_drift(const group_clock_t* clock)
+{
+    int64_t max_delay = 2 * clock->delay;
+    uint8_t used = 0;
+    int64_t first = clock->reference;
+    int64_t last = clock->reference;
+    // Relative to the best exchange so the sums stay small
+    double sum_t = 0, sum_o = 0, sum_tt = 0, sum_to = 0, sum_oo = 0;
+    for (uint8_t i = 0; i < clock->count; i++) {
+        if (clock->delays[i] > max_delay) continue;
+        double t = clock->times[i] - clock->reference;
+        double o = clock->offsets[i] - clock->offset;
+        sum_t += t;
+        sum_o += o;
+        sum_tt += t * t;
+        sum_to += t * o;
+        sum_oo += o * o;
+        if (clock->times[i] < first) first = clock->times[i];
+        if (clock->times[i] > last) last = clock->times[i];
+        used++;
+    }
+    if (used < GROUP_DRIFT_MIN_SAMPLES || last - first < GROUP_DRIFT_MIN_SPAN) return 0;
+    double s_tt = sum_tt - sum_t * sum_t / used;
+    double s_to = sum_to - sum_t * sum_o / used;
+    double s_oo = sum_oo - sum_o * sum_o / used;
+    double drift = s_to / s_tt;
+    // Kept if it is over twice its standard error, drift^2 > 4 * residual variance / s_tt
+    double residual = s_oo - drift * s_to;
+    if (drift * drift * s_tt * (used - 2) <= 4 * residual) return 0;
+    return drift > GROUP_DRIFT_MAX || drift < -GROUP_DRIFT_MAX ? 0 : drift;
+}
+
+void group_clock_add_sample(group_clock_t* clock, int64_t t1, int64_t t2, int64_t t3, int64_t t4)
+{
+    int64_t delay = (t4 - t1) - (t3 - t2);
+    if (delay < 0) return;
+    clock->times[clock->next] = t1 + (t4 - t1) / 2;
+    clock->offsets[clock->next] = ((t2 - t1) + (t3 - t4)) / 2;
+    clock->delays[clock->next] = delay;
+    clock->next = (clock->next + 1) % GROUP_CLOCK_SAMPLES;
+    if (clock->count < GROUP_CLOCK_SAMPLES) clock->count++;
+
+    // The best exchange also drops out once it is GROUP_CLOCK_SAMPLES old, so drift errors can't build up
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < clock->count; i++) {
+        if (clock->delays[i] < clock->delays[best]) best = i;
+    }
+    clock->reference = clock->times[best];
+    clock->offset = clock->offsets[best];
+    clock->delay = clock->delays[best];
+    clock->drift = estimate_drift(clock);
+}
+
+bool group_clock_synced(const group_clock_t* clock)
+{
+    return clock->count > 0;
+}
+
+int64_t group_clock_offset(const group_clock_t* clock, int64_t local)
+{
+    return clock->offset + (int64_t)(clock->drift * (local - clock->reference));
+}
+
+int32_t group_clock_drift_ppb(const group_clock_t* clock)
+{
+    return (int32_t)(clock->drift * 1e9);
+}
+
+int64_t group_clock_to_group(const group_clock_t* clock, int64_t local)
+{
+    return local + group_clock_offset(clock, local);
+}
+
+int64_t group_clock_to_local(const group_clock_t* clock, int64_t group)
+{
+    // The offset changes a few microseconds a second at most, evaluating it at the rough local time is exact enough
+    int64_t local = group - clock->offset;
+    return group - group_clock_offset(clock, local);
+}
+
+int64_t group_clock_delay(const group_clock_t* clock)
+{
+    return clock->delay;
+}
+
+void group_pending_init(group_pending_t* pending)
+{
+    pending->count = 0;
+}
+
+bool group_pending_add(group_pending_t* pending, int64_t at, const group_action_t* action)
+{
+    if (pending->count >= GROUP_MAX_PENDING) return false;
+    // A handful of entries, insertion keeps them sorted with the earliest at the front
+    uint8_t slot = pending->count;
+    while (slot > 0 && pending->entries[slot - 1].at > at) {
+        pending->entries[slot] = pending->entries[slot - 1];
+        slot--;
+    }
+    pending->entries[slot].at = at;
+    pending->entries[slot].action = *action;
+    pending->count++;
+    return true;
+}
+
+bool group_pending_next(const group_pending_t* pending, int64_t* at)
+{
+    if (pending->count == 0) return false;
+    *at = pending->entries[0].at;
+    return true;
+}
+
+uint8_t group_pending_count(const group_pending_t* pending)
+{
+    return pending->count;
+}
+
+bool group_pending_pop_due(group_pending_t* pending, int64_t now, group_action_t* action)
+{
+    if (pending->count == 0 || pending->entries[0].at > now) return false;
+    *action = pending->entries[0].action;
+    pending->count--;
+    memmove(&pending->entries[0], &pending->entries[1], pending->count * sizeof(pending->entries[0]));
+    return true;
+}
+
+void group_dedup_init(group_dedup_t* dedup)
+{
+    dedup->count = 0;
+    dedup->next = 0;
+}
+
+bool group_dedup_seen(group_dedup_t* dedup, uint32_t sender, uint32_t sequence)
+{
+    for (uint8_t i = 0; i < dedup->count; i++) {
+        if (dedup->senders[i] != sender) continue;
+        if ((int32_t)(sequence - dedup->sequences[i]) <= 0) return true;
+        dedup->sequences[i] = sequence;
+        return false;
+    }
+    uint8_t slot;
+    if (dedup->count < GROUP_MAX_SENDERS) {
+        slot = dedup->count++;
+    } else {
+        slot = dedup->next;
+        dedup->next = (dedup->next + 1) % GROUP_MAX_SENDERS;
+    }
+    dedup->senders[slot] = sender;
+    dedup->sequences[slot] = sequence;
+    return false;
+}
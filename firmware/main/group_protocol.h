@@ -0,0 +1,289 @@
+#ifndef GROUP_PROTOCOL_H
+#define GROUP_PROTOCOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// Only depends on the C library so it can be built and tested on a host
+
+#define GROUP_PACKET_MAX_SIZE 48
+#define GROUP_CLOCK_SAMPLES 16          // Sync exchanges the offset and drift are estimated from
+#define GROUP_MAX_PENDING 8             // Commands waiting for their execution time
+#define GROUP_MAX_SENDERS 16            // Senders whose last sequence is remembered
+
+/**
+ * @brief   Group packet types
+ */
+typedef enum {
+    GROUP_PACKET_SYNC_REQUEST = 1,      //!< Member asks the clock leader for its time
+    GROUP_PACKET_SYNC_REPLY,            //!< Leader's receive and send times for one request
+    GROUP_PACKET_COMMAND                //!< Action every member applies at the same group time
+} group_packet_type_t;
+
+// led_mode_t values a command may carry. Morse Code blinks a string commands don't carry, so it stays off the group
+#define GROUP_MODE_LIGHT 0
+#define GROUP_MODE_BLINKY 1
+#define GROUP_MODE_AUDIO 3
+
+/**
+ * @brief   What a group command changes on each member, like one /batch operation on the whole LED
+ */
+typedef struct {
+    bool has_state;
+    bool state;
+    bool has_mode;
+    uint8_t mode;               //!< One of the GROUP_MODE_* led_mode_t values, a byte so the protocol has no dependency on the LED
+    bool has_color;
+    uint8_t rgbw[4];
+    bool has_duration;
+    uint32_t blink_duration;
+} group_action_t;
+
+/**
+ * @brief   Decoded group packet. Times are microseconds, on the clock named by each member
+ */
+typedef struct {
+    group_packet_type_t type;
+    uint8_t group;              //!< Packets from other groups sharing the address are dropped
+    uint32_t sender;            //!< Random per boot, so a restarted sender's sequence numbers are never stale
+    uint32_t sequence;          //!< Repeats of one packet share it
+    union {
+        struct {
+            int64_t t1;         //!< Requester's clock when sent
+        } sync_request;
+        struct {
+            uint32_t requester;
+            int64_t t1;         //!< Copied from the request
+            int64_t t2;         //!< Leader's clock when the request arrived
+            int64_t t3;         //!< Leader's clock when the reply was sent
+        } sync_reply;
+        struct {
+            int64_t execute_at; //!< Group (leader) clock
+            group_action_t action;
+        } command;
+    };
+} group_packet_t;
+
+/**
+ * @brief   Estimate of the leader's clock from sync exchanges
+ *
+ * @note Treat every member as private
+ */
+typedef struct {
+    int64_t times[GROUP_CLOCK_SAMPLES];         // Local clock halfway through each exchange
+    int64_t offsets[GROUP_CLOCK_SAMPLES];       // Leader minus local clock, per exchange
+    int64_t delays[GROUP_CLOCK_SAMPLES];        // Round trip minus the leader's turnaround, per exchange
+    uint8_t next;
+    uint8_t count;
+    int64_t reference;                          // Time of the exchange with the shortest round trip
+    int64_t offset;                             // Its offset
+    int64_t delay;                              // Its round trip
+    double drift;                               // Offset change per local microsecond
+} group_clock_t;
+
+/**
+ * @brief   Command queued for its local execution time
+ */
+typedef struct {
+    int64_t at;                 //!< Local clock
+    group_action_t action;
+} group_pending_entry_t;
+
+/**
+ * @brief   Commands waiting to run, earliest first
+ *
+ * @note Treat every member as private
+ */
+typedef struct {
+    group_pending_entry_t entries[GROUP_MAX_PENDING];
+    uint8_t count;
+} group_pending_t;
+
+/**
+ * @brief   Last sequence number seen per sender, to drop repeated packets
+ *
+ * @note Treat every member as private
+ */
+typedef struct {
+    uint32_t senders[GROUP_MAX_SENDERS];
+    uint32_t sequences[GROUP_MAX_SENDERS];
+    uint8_t count;
+    uint8_t next;               // Slot replaced when a new sender arrives and the table is full
+} group_dedup_t;
+
+/**
+ * @brief   Serializes a packet, little-endian
+ *
+ * @param packet: Packet to encode
+ * @param buf: Filled with the packet
+ *
+ * @return Bytes written
+ */
+size_t group_packet_encode(const group_packet_t* packet, uint8_t buf[GROUP_PACKET_MAX_SIZE]);
+
+/**
+ * @brief   Parses a received packet
+ *
+ * @param buf: Received bytes
+ * @param len: Number of bytes received
+ * @param packet: Filled with the packet
+ *
+ * @return true if buf holds a packet of this protocol version, of a known type and with the right size, and
+ *         for a command, no mode or one of the GROUP_MODE_* values
+ */
+bool group_packet_decode(const uint8_t* buf, size_t len, group_packet_t* packet);
+
+/**
+ * @brief   Forgets every sync exchange
+ *
+ * @param clock: Clock to reset
+ */
+void group_clock_init(group_clock_t* clock);
+
+/**
+ * @brief   Adds one sync exchange, NTP style: offset ((t2 - t1) + (t3 - t4)) / 2, delay (t4 - t1) - (t3 - t2)
+ *
+ * @note The offset used is the one from the exchange with the shortest delay among the last GROUP_CLOCK_SAMPLES,
+ *       since queuing only ever adds delay and an exchange that waited on one leg is off by half the wait. It is
+ *       carried forward by the drift between the clocks, the least-squares slope of the offsets of the exchanges
+ *       that were not delayed much, since two crystals 50 ppm apart drift 50 us every second. The drift is
+ *       left at 0 while it is within the noise of the offsets. Exchanges with a negative delay are
+ *       impossible and ignored
+ *
+ * @param clock: Clock
+ * @param t1: Local clock when the request was sent
+ * @param t2: Leader's clock when the request arrived
+ * @param t3: Leader's clock when the reply was sent
+ * @param t4: Local clock when the reply arrived
+ */
+void group_clock_add_sample(group_clock_t* clock, int64_t t1, int64_t t2, int64_t t3, int64_t t4);
+
+/**
+ * @brief   Checks that at least one exchange has been added
+ *
+ * @param clock: Clock
+ *
+ * @return true if the clock holds an offset
+ */
+bool group_clock_synced(const group_clock_t* clock);
+
+/**
+ * @brief   Converts a local time to the group (leader) clock
+ *
+ * @param clock: Synced clock
+ * @param local: Local time
+ *
+ * @return Group time
+ */
+int64_t group_clock_to_group(const group_clock_t* clock, int64_t local);
+
+/**
+ * @brief   Converts a group time to the local clock
+ *
+ * @param clock: Synced clock
+ * @param group: Group time
+ *
+ * @return Local time
+ */
+int64_t group_clock_to_local(const group_clock_t* clock, int64_t group);
+
+/**
+ * @brief   Gets the group (leader) clock minus the local clock
+ *
+ * @param clock: Synced clock
+ * @param local: Local time the offset is wanted at, it changes with the drift
+ *
+ * @return Offset in the clock's unit
+ */
+int64_t group_clock_offset(const group_clock_t* clock, int64_t local);
+
+/**
+ * @brief   Gets how much faster the group clock runs than the local one
+ *
+ * @param clock: Synced clock
+ *
+ * @return Drift in parts per billion
+ */
+int32_t group_clock_drift_ppb(const group_clock_t* clock);
+
+/**
+ * @brief   Gets the round trip of the exchange the offset comes from, the offset's error is at most half of it
+ *
+ * @param clock: Synced clock
+ *
+ * @return Delay in the clock's unit
+ */
+int64_t group_clock_delay(const group_clock_t* clock);
+
+/**
+ * @brief   Empties a pending queue
+ *
+ * @param pending: Queue to set up
+ */
+void group_pending_init(group_pending_t* pending);
+
+/**
+ * @brief   Queues a command in execution order, after commands due at the same time
+ *
+ * @param pending: Queue
+ * @param at: Local execution time
+ * @param action: Action to copy in
+ *
+ * @return false if GROUP_MAX_PENDING commands are already queued
+ */
+bool group_pending_add(group_pending_t* pending, int64_t at, const group_action_t* action);
+
+/**
+ * @brief   Gets the earliest execution time
+ *
+ * @param pending: Queue
+ * @param at: Set to the earliest execution time
+ *
+ * @return false if the queue is empty
+ */
+bool group_pending_next(const group_pending_t* pending, int64_t* at);
+
+/**
+ * @brief   Gets the number of queued commands
+ *
+ * @param pending: Queue
+ *
+ * @return Number of commands
+ */
+uint8_t group_pending_count(const group_pending_t* pending);
+
+/**
+ * @brief   Takes the earliest command if it is due. Call until it returns false to get every command due at once
+ *
+ * @param pending: Queue
+ * @param now: Current local time
+ * @param action: Set to the due command's action
+ *
+ * @return true if a command was due
+ */
+bool group_pending_pop_due(group_pending_t* pending, int64_t now, group_action_t* action);
+
+/**
+ * @brief   Empties a dedup table
+ *
+ * @param dedup: Table to set up
+ */
+void group_dedup_init(group_dedup_t* dedup);
+
+/**
+ * @brief   Records a packet's sequence number and reports whether it was already handled
+ *
+ * @note Sequence numbers are compared with wraparound, a packet older than the last one seen from its sender
+ *       is treated as seen
+ *
+ * @param dedup: Table
+ * @param sender: Packet's sender
+ * @param sequence: Packet's sequence number
+ *
+ * @return true if the packet is a repeat or out of date
+ */
+bool group_dedup_seen(group_dedup_t* dedup, uint32_t sender, uint32_t sequence);
+
+#endif // GROUP_PROTOCOL_H
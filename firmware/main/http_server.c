@@ -1,9 +1,16 @@
 #include "http_server.h"
 
-#define LIGHT_BUF_SIZE 32
-#define BLINKY_BUF_SIZE 32
-#define MORSE_BUF_SIZE 256
-#define COLOR_BUF_SIZE 64
+#define RECV_CHUNK_SIZE 64
+#define BATCH_MAX_OPS 16
+#define MODE_NAME_MAX_LEN 7
+#define STATE_CACHE_SIZE (192 + LED_MORSE_CODE_MAX_LEN * 6) // Worst case every Morse character needs a \u00XX escape
+#define ETAG_SIZE 20
+#define PIXEL_CHUNK_SIZE 256
+#define QUERY_VALUE_SIZE 8
+#define ZONE_CHUNK_SIZE 160 // One zone entry, the longest is about 130 characters
+#define SCHEDULE_CHUNK_SIZE 224 // The header or one rule entry, see SCHEDULE_HEADER_MAX and SCHEDULE_RULE_MAX
+#define GROUP_STATUS_SIZE 160
+#define SERVER_CORE 0 // Network side, the render task owns the other core
 
 static const char* SERVER_TAG = "http server";
 
@@ -15,6 +22,55 @@ static esp_err_t light_handler(httpd_req_t*);
 static esp_err_t blinky_handler(httpd_req_t*);
 static esp_err_t morse_handler(httpd_req_t*);
 static esp_err_t color_handler(httpd_req_t*);
+static esp_err_t batch_handler(httpd_req_t*);
+static esp_err_t state_handler(httpd_req_t*);
+static esp_err_t pixels_handler(httpd_req_t*);
+static esp_err_t zones_handler(httpd_req_t*);
+static esp_err_t matrix_handler(httpd_req_t*);
+static esp_err_t text_handler(httpd_req_t*);
+#if CONFIG_LED_AUDIO
+static esp_err_t audio_handler(httpd_req_t*);
+#endif
+static esp_err_t schedule_get_handler(httpd_req_t*);
+static esp_err_t schedule_add_handler(httpd_req_t*);
+static esp_err_t schedule_delete_handler(httpd_req_t*);
+#if CONFIG_LED_GROUP
+static esp_err_t group_get_handler(httpd_req_t*);
+static esp_err_t group_send_handler(httpd_req_t*);
+#endif
+
+// Every URI goes through timed_handler, which records the real handler's latency
+typedef struct {
+    esp_err_t (*handler)(httpd_req_t*);
+    metric_id_t metric;
+} timed_handler_t;
+
+static esp_err_t timed_handler(httpd_req_t*);
+
+static timed_handler_t light_timed = { light_handler, METRIC_HANDLER_LIGHT };
+static timed_handler_t blinky_timed = { blinky_handler, METRIC_HANDLER_BLINKY };
+static timed_handler_t morse_timed = { morse_handler, METRIC_HANDLER_MORSE };
+static timed_handler_t color_timed = { color_handler, METRIC_HANDLER_COLOR };
+static timed_handler_t batch_timed = { batch_handler, METRIC_HANDLER_BATCH };
+static timed_handler_t state_timed = { state_handler, METRIC_HANDLER_STATE };
+static timed_handler_t pixels_timed = { pixels_handler, METRIC_HANDLER_PIXELS };
+static timed_handler_t zones_timed = { zones_handler, METRIC_HANDLER_ZONES };
+static timed_handler_t matrix_timed = { matrix_handler, METRIC_HANDLER_MATRIX };
+static timed_handler_t text_timed = { text_handler, METRIC_HANDLER_TEXT };
+#if CONFIG_LED_AUDIO
+static timed_handler_t audio_timed = { audio_handler, METRIC_HANDLER_AUDIO };
+#endif
+static timed_handler_t schedule_get_timed = { schedule_get_handler, METRIC_HANDLER_SCHEDULE };
+static timed_handler_t schedule_add_timed = { schedule_add_handler, METRIC_HANDLER_SCHEDULE };
+static timed_handler_t schedule_delete_timed = { schedule_delete_handler, METRIC_HANDLER_SCHEDULE };
+#if CONFIG_LED_GROUP
+static timed_handler_t group_get_timed = { group_get_handler, METRIC_HANDLER_GROUP };
+static timed_handler_t group_send_timed = { group_send_handler, METRIC_HANDLER_GROUP };
+#endif
+static timed_handler_t events_timed = { event_stream_handler, METRIC_HANDLER_EVENTS };
+#if CONFIG_LED_LIVE
+static timed_handler_t live_timed = { live_channel_handler, METRIC_HANDLER_LIVE };
+#endif
 
 // Server and Config
 static httpd_handle_t server = NULL;
@@ -24,181 +80,1288 @@ static httpd_config_t server_config = HTTPD_DEFAULT_CONFIG();
 static httpd_uri_t light_uri = {
     .uri = "/light",
     .method = HTTP_POST,
-    .handler = light_handler,
-    .user_ctx = NULL
+    .handler = timed_handler,
+    .user_ctx = &light_timed
 };
 static httpd_uri_t blinky_uri = {
     .uri = "/blinky",
     .method = HTTP_POST,
-    .handler = blinky_handler,
-    .user_ctx = NULL
+    .handler = timed_handler,
+    .user_ctx = &blinky_timed
 };
 static httpd_uri_t morse_uri = {
     .uri = "/morse",
     .method = HTTP_POST,
-    .handler = morse_handler,
-    .user_ctx = NULL
+    .handler = timed_handler,
+    .user_ctx = &morse_timed
 };
 static httpd_uri_t color_uri = {
     .uri = "/color",
     .method = HTTP_POST,
-    .handler = color_handler,
+    .handler = timed_handler,
+    .user_ctx = &color_timed
+};
+
+static httpd_uri_t batch_uri = {
+    .uri = "/batch",
+    .method = HTTP_POST,
+    .handler = timed_handler,
+    .user_ctx = &batch_timed
+};
+
+static httpd_uri_t state_uri = {
+    .uri = "/state",
+    .method = HTTP_GET,
+    .handler = timed_handler,
+    .user_ctx = &state_timed
+};
+static httpd_uri_t pixels_uri = {
+    .uri = "/state/pixels",
+    .method = HTTP_GET,
+    .handler = timed_handler,
+    .user_ctx = &pixels_timed
+};
+static httpd_uri_t zones_uri = {
+    .uri = "/zones",
+    .method = HTTP_GET,
+    .handler = timed_handler,
+    .user_ctx = &zones_timed
+};
+static httpd_uri_t matrix_uri = {
+    .uri = "/matrix",
+    .method = HTTP_POST,
+    .handler = timed_handler,
+    .user_ctx = &matrix_timed
+};
+static httpd_uri_t text_uri = {
+    .uri = "/text",
+    .method = HTTP_POST,
+    .handler = timed_handler,
+    .user_ctx = &text_timed
+};
+#if CONFIG_LED_AUDIO
+static httpd_uri_t audio_uri = {
+    .uri = "/audio",
+    .method = HTTP_POST,
+    .handler = timed_handler,
+    .user_ctx = &audio_timed
+};
+#endif
+static httpd_uri_t schedule_get_uri = {
+    .uri = "/schedule",
+    .method = HTTP_GET,
+    .handler = timed_handler,
+    .user_ctx = &schedule_get_timed
+};
+static httpd_uri_t schedule_add_uri = {
+    .uri = "/schedule",
+    .method = HTTP_POST,
+    .handler = timed_handler,
+    .user_ctx = &schedule_add_timed
+};
+static httpd_uri_t schedule_delete_uri = {
+    .uri = "/schedule",
+    .method = HTTP_DELETE,
+    .handler = timed_handler,
+    .user_ctx = &schedule_delete_timed
+};
+
+#if CONFIG_LED_GROUP
+static httpd_uri_t group_get_uri = {
+    .uri = "/group",
+    .method = HTTP_GET,
+    .handler = timed_handler,
+    .user_ctx = &group_get_timed
+};
+
+static httpd_uri_t group_send_uri = {
+    .uri = "/group",
+    .method = HTTP_POST,
+    .handler = timed_handler,
+    .user_ctx = &group_send_timed
+};
+#endif
+static httpd_uri_t events_uri = {
+    .uri = "/events",
+    .method = HTTP_GET,
+    .handler = timed_handler,
+    .user_ctx = &events_timed
+};
+#if CONFIG_LED_LIVE
+static httpd_uri_t live_uri = {
+    .uri = "/live",
+    .method = HTTP_GET,
+    .handler = timed_handler,
+    .user_ctx = &live_timed,
+    .is_websocket = true
+};
+#endif
+#if CONFIG_LED_METRICS
+static httpd_uri_t metrics_uri = {
+    .uri = "/metrics",
+    .method = HTTP_GET,
+    .handler = metrics_handler,
+    .user_ctx = NULL
+};
+#endif
+#if CONFIG_LED_TRACE
+static httpd_uri_t trace_uri = {
+    .uri = "/trace",
+    .method = HTTP_GET,
+    .handler = trace_handler,
     .user_ctx = NULL
 };
+#endif
 
-// JSON Helpers
-static esp_err_t read_request_payload(httpd_req_t* req, char* buf, size_t buf_size)
+// Batch operation, validated in full before any of them touch the LED
+typedef struct {
+    uint16_t start;
+    uint16_t count;             // 0 targets every pixel
+    uint8_t rgbw[4];            // White is optional and defaults to 0
+    bool has_color;
+    bool state;
+    bool has_state;
+    uint32_t duration;
+    bool has_duration;
+    char* morse_code;           // Owned by the op until handed to set_led_morse_code
+    led_mode_t mode;
+    bool has_mode;
+} batch_op_t;
+
+typedef enum {
+    BATCH_START,
+    BATCH_COUNT,
+    BATCH_RED,
+    BATCH_GREEN,
+    BATCH_BLUE,
+    BATCH_WHITE,
+    BATCH_STATE,
+    BATCH_DURATION,
+    BATCH_MORSE,
+    BATCH_MODE,
+    BATCH_ZONE,
+    BATCH_FIELD_COUNT
+} batch_field_t;
+
+typedef struct {
+    batch_op_t ops[BATCH_MAX_OPS];
+    size_t op_count;
+    // Field destinations, reused for every record
+    batch_op_t current;
+    char morse_code[LED_MORSE_CODE_MAX_LEN + 1];
+    char mode[MODE_NAME_MAX_LEN + 1];
+    char zone[ZONE_NAME_MAX_LEN + 1];
+    json_field_t fields[BATCH_FIELD_COUNT];
+    led_status_t status;        // For the stored Morse code string
+} batch_context_t;
+
+// httpd runs one handler at a time, so a single context is enough and keeps it off the task stack
+static batch_context_t batch;
+
+// Serialized /state body, rebuilt only when the LED version moves on
+static char state_cache[STATE_CACHE_SIZE];
+static size_t state_cache_len;
+static uint32_t state_cache_version;
+static bool state_cache_valid = false;
+// Random per boot so ETags from before a restart never match
+static uint32_t boot_id;
+
+static esp_err_t timed_handler(httpd_req_t* req)
 {
-    int payload_len = req->content_len;
-    int char_index = 0;
-    int received = 0;
+    const timed_handler_t* timed = req->user_ctx;
+    metric_span_t span = metrics_begin();
+    trace_record(TRACE_REQUEST, timed->metric);
+    esp_err_t err = timed->handler(req);
+    metrics_end(timed->metric, span);
+    return err;
+}
 
-    if (payload_len >= buf_size) {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Content too long");
-        return ESP_FAIL;
-    }
+// JSON Helpers
+static esp_err_t parse_request_fields(httpd_req_t* req, json_stream_t* stream)
+{
+    // Body is fed to the parser as it arrives, so only the field buffers limit its size
+    char chunk[RECV_CHUNK_SIZE];
+    size_t remaining = req->content_len;
+    esp_err_t err = ESP_OK;
 
-    while (char_index < payload_len) {
-        received = httpd_req_recv(req, buf + char_index, payload_len - char_index);
+    while (remaining > 0 && err == ESP_OK) {
+        int received = httpd_req_recv(req, chunk, remaining < RECV_CHUNK_SIZE ? remaining : RECV_CHUNK_SIZE);
         if (received <= 0) {
             httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read request");
             return ESP_FAIL;
         }
-        char_index += received;
+        remaining -= received;
+        err = json_stream_feed(stream, chunk, received);
+    }
+    if (err == ESP_OK) {
+        err = json_stream_finish(stream);
     }
-    buf[payload_len] = '\0'; // Null-terminate JSON string for parsing
-    return ESP_OK;
-}
 
-static cJSON* json_parser(const char* buf)
-{
-    cJSON* json = cJSON_Parse(buf);
-    if (json == NULL) {
-        ESP_LOGE(SERVER_TAG, "Failed to parse JSON string");
+    switch (err) {
+        case ESP_OK:
+            return ESP_OK;
+        case ESP_ERR_INVALID_ARG:
+            ESP_LOGE(SERVER_TAG, "Field of wrong type or out of range in JSON");
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid field value");
+            break;
+        case ESP_ERR_INVALID_SIZE:
+            ESP_LOGE(SERVER_TAG, "Field too long in JSON");
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Field too long");
+            break;
+        case ESP_ERR_NO_MEM:
+            ESP_LOGE(SERVER_TAG, "Too many items in JSON");
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Too many items");
+            break;
+        default:
+            ESP_LOGE(SERVER_TAG, "Failed to parse JSON string");
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
     }
-    return json;
+    return ESP_FAIL;
 }
 
 // URI Handlers
 static esp_err_t light_handler(httpd_req_t* req)
 {
-    char buf[LIGHT_BUF_SIZE];
-    ESP_ERROR_CHECK(read_request_payload(req, buf, LIGHT_BUF_SIZE));
-    cJSON* json = json_parser(buf);
-    if (json == NULL) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+    bool state;
+    json_field_t fields[] = {
+        { .key = "state", .type = JSON_FIELD_BOOL, .dest = &state }
+    };
+    json_stream_t stream;
+    json_stream_init(&stream, fields, 1);
+    if (parse_request_fields(req, &stream) != ESP_OK) {
         return ESP_FAIL;
     }
 
-    cJSON* state_item = cJSON_GetObjectItem(json, "state");
-    if (state_item == NULL) {
+    if (!fields[0].found) {
         ESP_LOGE(SERVER_TAG, "Missing 'state' field in JSON");
-        cJSON_Delete(json);
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing or invalid 'state' field");
         return ESP_FAIL;
     }
 
-    if (cJSON_IsTrue(state_item)) {
-        set_led_state(led, ON);
-    } else if (cJSON_IsFalse(state_item)) {
-        set_led_state(led, OFF);
-    } else {
-        ESP_LOGE(SERVER_TAG, "Unknown light command in JSON");
-        cJSON_Delete(json);
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown light command");
-        return ESP_FAIL;
-    }
-
+    set_led_state(led, state);
     set_led_mode(led, LED_MODE_LIGHT);
-    cJSON_Delete(json);
     httpd_resp_sendstr(req, "Successfully activated Light mode");
     return ESP_OK;
 }
 
 static esp_err_t blinky_handler(httpd_req_t* req)
 {
-    char buf[BLINKY_BUF_SIZE];
-    ESP_ERROR_CHECK(read_request_payload(req, buf, BLINKY_BUF_SIZE));
-    cJSON* json = json_parser(buf);
-    if (json == NULL) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+    uint32_t duration;
+    json_field_t fields[] = {
+        { .key = "duration", .type = JSON_FIELD_UINT32, .dest = &duration }
+    };
+    json_stream_t stream;
+    json_stream_init(&stream, fields, 1);
+    if (parse_request_fields(req, &stream) != ESP_OK) {
         return ESP_FAIL;
     }
 
-    cJSON* duration_item = cJSON_GetObjectItem(json, "duration");
-    if (duration_item == NULL) {
+    if (!fields[0].found) {
         ESP_LOGE(SERVER_TAG, "Missing 'duration' field in JSON");
-        cJSON_Delete(json);
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing 'duration' field");
         return ESP_FAIL;
     }
-    uint32_t duration = duration_item->valueint;
     set_led_blink_duration(led, duration);
     set_led_mode(led, LED_MODE_BLINKY);
 
-    cJSON_Delete(json);
     httpd_resp_sendstr(req, "Successfully activated Blinky mode");
     return ESP_OK;
 }
 
 static esp_err_t morse_handler(httpd_req_t* req)
 {
-    char buf[MORSE_BUF_SIZE];
-    ESP_ERROR_CHECK(read_request_payload(req, buf, MORSE_BUF_SIZE));
-    cJSON* json = json_parser(buf);
-    if (json == NULL) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+    char morse_code[LED_MORSE_CODE_MAX_LEN + 1];
+    json_field_t fields[] = {
+        { .key = "morse", .type = JSON_FIELD_STRING, .dest = morse_code, .dest_size = sizeof(morse_code) }
+    };
+    json_stream_t stream;
+    json_stream_init(&stream, fields, 1);
+    if (parse_request_fields(req, &stream) != ESP_OK) {
         return ESP_FAIL;
     }
 
-    cJSON* morse_code_item = cJSON_GetObjectItem(json, "morse");
-    if (morse_code_item == NULL || morse_code_item->valuestring == NULL) {
+    if (!fields[0].found) {
         ESP_LOGE(SERVER_TAG, "Missing or invalid 'morse' field in JSON");
-        cJSON_Delete(json);
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing or invalid 'morse' field");
         return ESP_FAIL;
     }
-    char* morse_code = morse_code_item->valuestring;
     set_led_morse_code(led, strdup(morse_code));
     set_led_mode(led, LED_MODE_MORSE);
 
-    cJSON_Delete(json);
     httpd_resp_sendstr(req, "Successfully activated Morse Code mode");
     return ESP_OK;
 }
 
 static esp_err_t color_handler(httpd_req_t* req)
 {
-    char buf[COLOR_BUF_SIZE];
-    ESP_ERROR_CHECK(read_request_payload(req, buf, COLOR_BUF_SIZE));
-    cJSON* json = json_parser(buf);
-    if (json == NULL) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+    uint8_t red, green, blue;
+    uint8_t white = 0;
+    char zone_name[ZONE_NAME_MAX_LEN + 1];
+    json_field_t fields[] = {
+        { .key = "red", .type = JSON_FIELD_UINT8, .dest = &red },
+        { .key = "green", .type = JSON_FIELD_UINT8, .dest = &green },
+        { .key = "blue", .type = JSON_FIELD_UINT8, .dest = &blue },
+        { .key = "white", .type = JSON_FIELD_UINT8, .dest = &white },  // Optional
+        { .key = "zone", .type = JSON_FIELD_STRING, .dest = zone_name, .dest_size = sizeof(zone_name) }  // Optional
+    };
+    json_stream_t stream;
+    json_stream_init(&stream, fields, 5);
+    if (parse_request_fields(req, &stream) != ESP_OK) {
         return ESP_FAIL;
     }
 
-    cJSON* red_item = cJSON_GetObjectItem(json, "red");
-    cJSON* green_item = cJSON_GetObjectItem(json, "green");
-    cJSON* blue_item = cJSON_GetObjectItem(json, "blue");
-    if (red_item == NULL || green_item == NULL || blue_item == NULL) {
+    if (!fields[0].found || !fields[1].found || !fields[2].found) {
         ESP_LOGE(SERVER_TAG, "Missing color field(s) in JSON");
-        cJSON_Delete(json);
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing color field(s)");
         return ESP_FAIL;
     }
-    uint8_t red = red_item->valueint;
-    uint8_t green = green_item->valueint;
-    uint8_t blue = blue_item->valueint;
-    set_led_rgb(led, red, green, blue);
+    if (fields[4].found) {
+        const zone_t* zone = get_led_zone(led, zone_name);
+        if (!zone) {
+            ESP_LOGE(SERVER_TAG, "Unknown zone '%s'", zone_name);
+            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown zone");
+            return ESP_FAIL;
+        }
+        set_led_pixel_rgbw(led, zone->start, zone->length, red, green, blue, white);
+    } else {
+        set_led_rgbw(led, red, green, blue, white);
+    }
 
-    cJSON_Delete(json);
     httpd_resp_sendstr(req, "Successfully updated LED color");
     return ESP_OK;
 }
 
+static esp_err_t parse_mode_name(const char* name, led_mode_t* mode)
+{
+    if (strcmp(name, "light") == 0) {
+        *mode = LED_MODE_LIGHT;
+    } else if (strcmp(name, "blinky") == 0) {
+        *mode = LED_MODE_BLINKY;
+    } else if (strcmp(name, "morse") == 0) {
+        *mode = LED_MODE_MORSE;
+#if CONFIG_LED_AUDIO
+    } else if (strcmp(name, "audio") == 0) {
+        *mode = LED_MODE_AUDIO;
+#endif
+    } else {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+static void free_batch_ops()
+{
+    for (size_t i = 0; i < batch.op_count; i++) {
+        free(batch.ops[i].morse_code);
+    }
+    batch.op_count = 0;
+}
+
+static esp_err_t batch_record_handler(json_field_t* fields, size_t field_count, void* ctx)
+{
+    batch_op_t* op = &batch.current;
+
+    if (batch.op_count >= BATCH_MAX_OPS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Colors are all-or-nothing, a range only makes sense with a color
+    bool any_color = fields[BATCH_RED].found || fields[BATCH_GREEN].found || fields[BATCH_BLUE].found;
+    op->has_color = fields[BATCH_RED].found && fields[BATCH_GREEN].found && fields[BATCH_BLUE].found;
+    if (any_color != op->has_color) {
+        ESP_LOGE(SERVER_TAG, "Batch operation has a partial color");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (fields[BATCH_WHITE].found && !op->has_color) {
+        ESP_LOGE(SERVER_TAG, "Batch operation has white but no color");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!fields[BATCH_WHITE].found) op->rgbw[3] = 0;
+    if (!fields[BATCH_START].found) op->start = 0;
+    if (!fields[BATCH_COUNT].found) op->count = 0;
+    if ((fields[BATCH_START].found || fields[BATCH_COUNT].found || fields[BATCH_ZONE].found) && !op->has_color) {
+        ESP_LOGE(SERVER_TAG, "Batch operation has a pixel range but no color");
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Within a zone, start and count are relative to it
+    uint16_t base = 0;
+    uint16_t length = get_led_length(led);
+    if (fields[BATCH_ZONE].found) {
+        const zone_t* zone = get_led_zone(led, batch.zone);
+        if (!zone) {
+            ESP_LOGE(SERVER_TAG, "Unknown zone '%s' in batch operation", batch.zone);
+            return ESP_ERR_INVALID_ARG;
+        }
+        base = zone->start;
+        length = zone->length;
+    }
+    uint16_t count = op->count ? op->count : length - op->start;
+    if (op->start >= length || count > length - op->start) {
+        ESP_LOGE(SERVER_TAG, "Batch operation pixel range out of bounds");
+        return ESP_ERR_INVALID_ARG;
+    }
+    op->start += base;
+    op->count = count;
+
+    op->has_state = fields[BATCH_STATE].found;
+    op->has_duration = fields[BATCH_DURATION].found;
+    op->has_mode = fields[BATCH_MODE].found;
+    if (op->has_mode && parse_mode_name(batch.mode, &op->mode) != ESP_OK) {
+        ESP_LOGE(SERVER_TAG, "Unknown mode '%s' in batch operation", batch.mode);
+        return ESP_ERR_INVALID_ARG;
+    }
+    op->morse_code = NULL;
+    if (fields[BATCH_MORSE].found) {
+        op->morse_code = strdup(batch.morse_code);
+        if (!op->morse_code) return ESP_ERR_NO_MEM;
+    }
+
+    batch.ops[batch.op_count++] = *op;
+    return ESP_OK;
+}
+
+// Morse mode blinks the stored string, so one must be stored already or set anywhere in the batch,
+// which applies every string before the mode takes effect at the commit
+static bool batch_morse_valid()
+{
+    bool switches_to_morse = false;
+    for (size_t i = 0; i < batch.op_count; i++) {
+        if (batch.ops[i].morse_code) return true;
+        switches_to_morse |= batch.ops[i].has_mode && batch.ops[i].mode == LED_MODE_MORSE;
+    }
+    if (!switches_to_morse) return true;
+    get_led_status(led, &batch.status);
+    return batch.status.has_morse_code;
+}
+
+static void apply_batch_op(const batch_op_t* op)
+{
+    if (op->has_color) {
+        set_led_pixel_rgbw(led, op->start, op->count, op->rgbw[0], op->rgbw[1], op->rgbw[2], op->rgbw[3]);
+    }
+    if (op->has_state) {
+        set_led_state(led, op->state);
+    }
+    if (op->has_duration) {
+        set_led_blink_duration(led, op->duration);
+    }
+    if (op->morse_code) {
+        set_led_morse_code(led, op->morse_code);
+    }
+    if (op->has_mode) {
+        set_led_mode(led, op->mode);
+    } else if (op->has_state) {
+        // A bare state change shows up the same way /light would show it
+        set_led_mode(led, LED_MODE_LIGHT);
+    }
+}
+
+static esp_err_t batch_handler(httpd_req_t* req)
+{
+    batch_op_t* current = &batch.current;
+    json_field_t fields[BATCH_FIELD_COUNT] = {
+        [BATCH_START] = { .key = "start", .type = JSON_FIELD_UINT16, .dest = &current->start },
+        [BATCH_COUNT] = { .key = "count", .type = JSON_FIELD_UINT16, .dest = &current->count },
+        [BATCH_RED] = { .key = "red", .type = JSON_FIELD_UINT8, .dest = &current->rgbw[0] },
+        [BATCH_GREEN] = { .key = "green", .type = JSON_FIELD_UINT8, .dest = &current->rgbw[1] },
+        [BATCH_BLUE] = { .key = "blue", .type = JSON_FIELD_UINT8, .dest = &current->rgbw[2] },
+        [BATCH_WHITE] = { .key = "white", .type = JSON_FIELD_UINT8, .dest = &current->rgbw[3] },
+        [BATCH_STATE] = { .key = "state", .type = JSON_FIELD_BOOL, .dest = &current->state },
+        [BATCH_DURATION] = { .key = "duration", .type = JSON_FIELD_UINT32, .dest = &current->duration },
+        [BATCH_MORSE] = { .key = "morse", .type = JSON_FIELD_STRING, .dest = batch.morse_code, .dest_size = sizeof(batch.morse_code) },
+        [BATCH_MODE] = { .key = "mode", .type = JSON_FIELD_STRING, .dest = batch.mode, .dest_size = sizeof(batch.mode) },
+        [BATCH_ZONE] = { .key = "zone", .type = JSON_FIELD_STRING, .dest = batch.zone, .dest_size = sizeof(batch.zone) }
+    };
+    memcpy(batch.fields, fields, sizeof(fields));
+    batch.op_count = 0;
+
+    // Body is an array of operation objects: [{...}, {...}]
+    json_stream_t stream;
+    json_stream_init(&stream, batch.fields, BATCH_FIELD_COUNT);
+    json_stream_set_record_handler(&stream, 2, batch_record_handler, NULL);
+    if (parse_request_fields(req, &stream) != ESP_OK) {
+        free_batch_ops();
+        return ESP_FAIL;
+    }
+    if (batch.op_count == 0) {
+        ESP_LOGE(SERVER_TAG, "Empty batch");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No operations in batch");
+        return ESP_FAIL;
+    }
+    if (!batch_morse_valid()) {
+        ESP_LOGE(SERVER_TAG, "Batch switches to Morse mode without a Morse code string");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Morse mode needs a 'morse' string");
+        free_batch_ops();
+        return ESP_FAIL;
+    }
+
+    // Everything validated, apply as one change so only the final state is shown
+    led_batch_begin(led);
+    for (size_t i = 0; i < batch.op_count; i++) {
+        apply_batch_op(&batch.ops[i]);
+        // Ownership of the string moved to the LED
+        batch.ops[i].morse_code = NULL;
+    }
+    led_batch_commit(led);
+    ESP_LOGI(SERVER_TAG, "Applied batch of %u operations", (unsigned)batch.op_count);
+    batch.op_count = 0;
+
+    httpd_resp_sendstr(req, "Successfully applied batch");
+    return ESP_OK;
+}
+
+static const char* mode_name(led_mode_t mode)
+{
+    switch (mode) {
+        case LED_MODE_LIGHT:
+            return "light";
+        case LED_MODE_BLINKY:
+            return "blinky";
+        case LED_MODE_MORSE:
+            return "morse";
+        case LED_MODE_AUDIO:
+            return "audio";
+        default:
+            return "unknown";
+    }
+}
+
+static size_t json_escape(char* out, size_t out_size, const char* str)
+{
+    size_t len = 0;
+    for (; *str && len + 7 < out_size; str++) {
+        uint8_t c = *str;
+        if (c == '"' || c == '\\') {
+            out[len++] = '\\';
+            out[len++] = c;
+        } else if (c < 0x20) {
+            len += snprintf(out + len, out_size - len, "\\u%04x", c);
+        } else {
+            out[len++] = c;
+        }
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static void refresh_state_cache()
+{
+    // Most polls find nothing changed, so skip the status copy (Morse code included) when the cache is current
+    if (state_cache_valid && get_led_version(led) == state_cache_version) {
+        return;
+    }
+    led_status_t status;
+    get_led_status(led, &status);
+
+    size_t len = snprintf(
+        state_cache,
+        STATE_CACHE_SIZE,
+        "{\"version\":%" PRIu32 ",\"mode\":\"%s\",\"state\":%s,\"duration\":%" PRIu32
+        ",\"red\":%u,\"green\":%u,\"blue\":%u,\"white\":%u,\"length\":%u,\"morse\":",
+        status.version,
+        mode_name(status.mode),
+        status.state ? "true" : "false",
+        status.blink_duration,
+        status.rgb[0],
+        status.rgb[1],
+        status.rgb[2],
+        status.white,
+        status.length
+    );
+    if (status.has_morse_code) {
+        state_cache[len++] = '"';
+        len += json_escape(state_cache + len, STATE_CACHE_SIZE - len - 2, status.morse_code);
+        state_cache[len++] = '"';
+    } else {
+        len += snprintf(state_cache + len, STATE_CACHE_SIZE - len, "null");
+    }
+    len += snprintf(state_cache + len, STATE_CACHE_SIZE - len, "}");
+
+    state_cache_len = len;
+    state_cache_version = status.version;
+    state_cache_valid = true;
+}
+
+static void format_etag(char* etag, uint32_t version)
+{
+    snprintf(etag, ETAG_SIZE, "\"%08" PRIx32 "-%08" PRIx32 "\"", boot_id, version);
+}
+
+// Whether If-None-Match names etag. The header is a comma-separated list of tags or *, compared weakly as
+// caches and proxies may send W/ versions of the tags they were given
+static bool if_none_match(httpd_req_t* req, const char* etag)
+{
+    size_t header_len = httpd_req_get_hdr_value_len(req, "If-None-Match");
+    if (header_len == 0) {
+        return false;
+    }
+    char header[header_len + 1];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", header, header_len + 1) != ESP_OK) {
+        return false;
+    }
+    size_t etag_len = strlen(etag);
+    const char* tag = header;
+    for (;;) {
+        tag += strspn(tag, " \t,");
+        if (*tag == '\0') {
+            return false;
+        }
+        if (*tag == '*') {
+            return true;
+        }
+        if (strncmp(tag, "W/", 2) == 0) {
+            tag += 2;
+        }
+        const char* end = *tag == '"' ? strchr(tag + 1, '"') : NULL;
+        if (!end) {
+            return false;       // Malformed, nothing after it can be trusted
+        }
+        if ((size_t)(end + 1 - tag) == etag_len && memcmp(tag, etag, etag_len) == 0) {
+            return true;
+        }
+        tag = end + 1;
+    }
+}
+
+static esp_err_t send_not_modified(httpd_req_t* req)
+{
+    httpd_resp_set_status(req, "304 Not Modified");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+static esp_err_t state_handler(httpd_req_t* req)
+{
+    char etag[ETAG_SIZE];
+
+    refresh_state_cache();
+    format_etag(etag, state_cache_version);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    if (if_none_match(req, etag)) {
+        return send_not_modified(req);
+    }
+    httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+    return httpd_resp_send(req, state_cache, state_cache_len);
+}
+
+static esp_err_t get_query_u16(const char* query, const char* key, uint16_t* value)
+{
+    char buf[QUERY_VALUE_SIZE];
+    if (httpd_query_key_value(query, key, buf, sizeof(buf)) != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    char* end;
+    unsigned long parsed = strtoul(buf, &end, 10);
+    if (*buf == '\0' || *end != '\0' || parsed > UINT16_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *value = parsed;
+    return ESP_OK;
+}
+
+static esp_err_t pixels_handler(httpd_req_t* req)
+{
+    uint16_t base = 0;
+    uint16_t length = get_led_length(led);
+    uint16_t start = 0;
+    uint16_t count = 0;
+
+    size_t query_len = httpd_req_get_url_query_len(req);
+    if (query_len > 0) {
+        char query[query_len + 1];
+        httpd_req_get_url_query_str(req, query, query_len + 1);
+        if (get_query_u16(query, "start", &start) == ESP_ERR_INVALID_ARG ||
+            get_query_u16(query, "count", &count) == ESP_ERR_INVALID_ARG) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid 'start' or 'count'");
+            return ESP_FAIL;
+        }
+        // Within a zone, start and count are relative to it
+        char zone_name[ZONE_NAME_MAX_LEN + 1];
+        if (httpd_query_key_value(query, "zone", zone_name, sizeof(zone_name)) == ESP_OK) {
+            const zone_t* zone = get_led_zone(led, zone_name);
+            if (!zone) {
+                httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown zone");
+                return ESP_FAIL;
+            }
+            base = zone->start;
+            length = zone->length;
+        }
+    }
+    if (count == 0 && start < length) {
+        count = length - start;
+    }
+    if (start >= length || count > length - start) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Pixel range out of bounds");
+        return ESP_FAIL;
+    }
+    start += base;
+
+    // A client that is current gets its answer without copying anything
+    char etag[ETAG_SIZE];
+    format_etag(etag, get_led_version(led));
+    if (if_none_match(req, etag)) {
+        httpd_resp_set_hdr(req, "ETag", etag);
+        return send_not_modified(req);
+    }
+
+    // One snapshot so the body never mixes two versions, and the ETag is the version it came from
+    uint8_t (*pixels)[4] = malloc(count * sizeof(pixels[0]));
+    if (!pixels) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Pixel range too large");
+        return ESP_FAIL;
+    }
+    uint32_t version;
+    get_led_pixels_rgbw(led, start, count, pixels, &version);
+    format_etag(etag, version);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+
+    // Formatted from the snapshot in chunks, no intermediate document
+    esp_err_t err = ESP_OK;
+    char chunk[PIXEL_CHUNK_SIZE];
+    size_t len = snprintf(chunk, PIXEL_CHUNK_SIZE, "{\"version\":%" PRIu32 ",\"start\":%u,\"pixels\":[", version, start);
+    for (uint16_t i = 0; i < count && err == ESP_OK; i++) {
+        const uint8_t* rgbw = pixels[i];
+        len += snprintf(chunk + len, PIXEL_CHUNK_SIZE - len, "%s[%u,%u,%u,%u]", i ? "," : "", rgbw[0], rgbw[1], rgbw[2], rgbw[3]);
+        // Longest pixel entry is 18 characters
+        if (len > PIXEL_CHUNK_SIZE - 20) {
+            err = httpd_resp_send_chunk(req, chunk, len);
+            len = 0;
+        }
+    }
+    free(pixels);
+    if (err != ESP_OK) {
+        return ESP_FAIL;
+    }
+    len += snprintf(chunk + len, PIXEL_CHUNK_SIZE - len, "]}");
+    if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static esp_err_t zones_handler(httpd_req_t* req)
+{
+    const zone_t* zones;
+    uint8_t zone_count = get_led_zones(led, &zones);
+    httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+
+    // One zone per chunk, the table is fixed so there's nothing to cache
+    char chunk[ZONE_CHUNK_SIZE];
+    size_t len = snprintf(chunk, ZONE_CHUNK_SIZE, "{\"zones\":[");
+    for (uint8_t i = 0; i < zone_count; i++) {
+        const zone_t* zone = &zones[i];
+        len += snprintf(
+            chunk + len,
+            ZONE_CHUNK_SIZE - len,
+            "%s{\"name\":\"%s\",\"start\":%u,\"length\":%u,\"width\":%u,\"height\":%u,\"layout\":\"%s\"}",
+            i ? "," : "",
+            zone->name,
+            zone->start,
+            zone->length,
+            zone->width,
+            zone->length / zone->width,
+            zone_layout_name(zone->layout)
+        );
+        if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        len = 0;
+    }
+    len += snprintf(chunk + len, ZONE_CHUNK_SIZE - len, "]}");
+    if (httpd_resp_send_chunk(req, chunk, len) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// Reads the whole body into buf, which holds exactly req->content_len bytes
+static esp_err_t receive_body(httpd_req_t* req, uint8_t* buf)
+{
+    size_t received_total = 0;
+    while (received_total < req->content_len) {
+        int received = httpd_req_recv(req, (char*)buf + received_total, req->content_len - received_total);
+        if (received <= 0) {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read request");
+            return ESP_FAIL;
+        }
+        received_total += received;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t matrix_handler(httpd_req_t* req)
+{
+    uint16_t x = 0;
+    uint16_t y = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    char zone_name[ZONE_NAME_MAX_LEN + 1];
+    char format[QUERY_VALUE_SIZE] = "rgb";
+
+    size_t query_len = httpd_req_get_url_query_len(req);
+    char query[query_len + 1];
+    if (query_len == 0 || httpd_req_get_url_query_str(req, query, query_len + 1) != ESP_OK ||
+        httpd_query_key_value(query, "zone", zone_name, sizeof(zone_name)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing 'zone'");
+        return ESP_FAIL;
+    }
+    if (get_query_u16(query, "x", &x) == ESP_ERR_INVALID_ARG || get_query_u16(query, "y", &y) == ESP_ERR_INVALID_ARG ||
+        get_query_u16(query, "width", &width) == ESP_ERR_INVALID_ARG || get_query_u16(query, "height", &height) == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid 'x', 'y', 'width' or 'height'");
+        return ESP_FAIL;
+    }
+    httpd_query_key_value(query, "format", format, sizeof(format));
+    bool has_white = strcmp(format, "rgbw") == 0;
+    if (!has_white && strcmp(format, "rgb") != 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown 'format'");
+        return ESP_FAIL;
+    }
+
+    const zone_t* zone = get_led_zone(led, zone_name);
+    if (!zone) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown zone");
+        return ESP_FAIL;
+    }
+    // Without a size, the bitmap covers the zone from x, y to its far corner
+    uint16_t rows = zone->length / zone->width;
+    if (width == 0 && x < zone->width) width = zone->width - x;
+    if (height == 0 && y < rows) height = rows - y;
+    if (x >= zone->width || width > zone->width - x || y >= rows || height > rows - y) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bitmap outside of zone");
+        return ESP_FAIL;
+    }
+    uint32_t pixel_count = width * height;
+    if (req->content_len != pixel_count * (has_white ? 4 : 3)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Body size doesn't match the bitmap");
+        return ESP_FAIL;
+    }
+
+    uint8_t (*bitmap)[4] = malloc(pixel_count * sizeof(bitmap[0]));
+    uint8_t* rgb = has_white ? NULL : malloc(req->content_len);
+    if (!bitmap || (!has_white && !rgb)) {
+        free(bitmap);
+        free(rgb);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Bitmap too large");
+        return ESP_FAIL;
+    }
+    esp_err_t err = receive_body(req, has_white ? (uint8_t*)bitmap : rgb);
+    if (err == ESP_OK && !has_white) {
+        matrix_unpack_rgb(rgb, bitmap, pixel_count);
+    }
+    free(rgb);
+    if (err != ESP_OK) {
+        free(bitmap);
+        return ESP_FAIL;
+    }
+    if (led_matrix_blit(led, zone, x, y, width, height, bitmap) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Zone is not a matrix");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_sendstr(req, "Successfully drew bitmap");
+    return ESP_OK;
+}
+
+static esp_err_t text_handler(httpd_req_t* req)
+{
+    char text[LED_TEXT_MAX_LEN + 1];
+    char zone_name[ZONE_NAME_MAX_LEN + 1];
+    uint16_t speed = 10;
+    uint8_t rgbw[4] = {255, 255, 255, 0};
+    json_field_t fields[] = {
+        { .key = "text", .type = JSON_FIELD_STRING, .dest = text, .dest_size = sizeof(text) },
+        { .key = "zone", .type = JSON_FIELD_STRING, .dest = zone_name, .dest_size = sizeof(zone_name) },
+        { .key = "speed", .type = JSON_FIELD_UINT16, .dest = &speed },     // Optional
+        { .key = "red", .type = JSON_FIELD_UINT8, .dest = &rgbw[0] },      // Optional
+        { .key = "green", .type = JSON_FIELD_UINT8, .dest = &rgbw[1] },    // Optional
+        { .key = "blue", .type = JSON_FIELD_UINT8, .dest = &rgbw[2] },     // Optional
+        { .key = "white", .type = JSON_FIELD_UINT8, .dest = &rgbw[3] }     // Optional
+    };
+    json_stream_t stream;
+    json_stream_init(&stream, fields, 7);
+    if (parse_request_fields(req, &stream) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    // No text stops whatever is scrolling
+    if (!fields[0].found || text[0] == '\0') {
+        set_led_text(led, NULL, NULL, 0, NULL);
+        httpd_resp_sendstr(req, "Successfully stopped text");
+        return ESP_OK;
+    }
+    if (!fields[1].found) {
+        ESP_LOGE(SERVER_TAG, "Missing 'zone' field in JSON");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing 'zone' field");
+        return ESP_FAIL;
+    }
+    const zone_t* zone = get_led_zone(led, zone_name);
+    if (!zone) {
+        ESP_LOGE(SERVER_TAG, "Unknown zone '%s'", zone_name);
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown zone");
+        return ESP_FAIL;
+    }
+    if (set_led_text(led, zone, strdup(text), speed, rgbw) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Zone is not a matrix or speed is 0");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_sendstr(req, "Successfully started text");
+    return ESP_OK;
+}
+
+#if CONFIG_LED_AUDIO
+static esp_err_t audio_handler(httpd_req_t* req)
+{
+    // Nothing to configure, the colors come from /color and the levels from the microphone
+    set_led_mode(led, LED_MODE_AUDIO);
+    httpd_resp_sendstr(req, "Successfully activated Audio mode");
+    return ESP_OK;
+}
+#endif
+
+// Longest pieces of the schedule document, each sent whole within one chunk
+#define SCHEDULE_HEADER_MAX "{\"time\":-9223372036854775808,\"synced\":false,\"timezone\":\"" CONFIG_LED_TIMEZONE \
+                            "\",\"next\":-9223372036854775808,\"rules\":["
+#define SCHEDULE_RULE_MAX ",{\"id\":255,\"weekdays\":255,\"hour\":255,\"minute\":255,\"state\":false,\"mode\":\"unknown\"" \
+                          ",\"red\":255,\"green\":255,\"blue\":255,\"white\":255,\"duration\":4294967295}"
+_Static_assert(sizeof(SCHEDULE_HEADER_MAX) <= SCHEDULE_CHUNK_SIZE, "LED_TIMEZONE too long for a schedule chunk");
+_Static_assert(sizeof(SCHEDULE_RULE_MAX) <= SCHEDULE_CHUNK_SIZE, "schedule rule too long for a schedule chunk");
+
+typedef struct {
+    httpd_req_t* req;
+    char buf[SCHEDULE_CHUNK_SIZE];
+    size_t len;
+} chunk_writer_t;
+
+static esp_err_t chunk_flush(chunk_writer_t* writer)
+{
+    if (writer->len == 0) {
+        return ESP_OK;
+    }
+    esp_err_t err = httpd_resp_send_chunk(writer->req, writer->buf, writer->len);
+    writer->len = 0;
+    return err;
+}
+
+// Appends formatted text, first sending what is buffered if it would not fit. Never writes past the buffer,
+// and fails rather than sending a truncated piece if the text is longer than a whole chunk
+static esp_err_t chunk_printf(chunk_writer_t* writer, const char* format, ...)
+{
+    for (;;) {
+        size_t space = SCHEDULE_CHUNK_SIZE - writer->len;
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(writer->buf + writer->len, space, format, args);
+        va_end(args);
+        if (written >= 0 && (size_t)written < space) {
+            writer->len += written;
+            return ESP_OK;
+        }
+        if (written < 0 || writer->len == 0) {
+            return ESP_FAIL;
+        }
+        if (chunk_flush(writer) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+}
+
+// Writes a time as seconds since the epoch, or null for SCHEDULE_NEVER
+static esp_err_t chunk_print_time(chunk_writer_t* writer, time_t time)
+{
+    if (time == SCHEDULE_NEVER) {
+        return chunk_printf(writer, "null");
+    }
+    return chunk_printf(writer, "%lld", (long long)time);
+}
+
+static esp_err_t schedule_format_rule(chunk_writer_t* writer, uint8_t id, const schedule_rule_t* rule)
+{
+    esp_err_t err = chunk_printf(writer, "%s{\"id\":%u,\"weekdays\":%u,\"hour\":%u,\"minute\":%u",
+                                 id ? "," : "", id, rule->weekdays, rule->hour, rule->minute);
+    if (err == ESP_OK && rule->has_state) {
+        err = chunk_printf(writer, ",\"state\":%s", rule->state ? "true" : "false");
+    }
+    if (err == ESP_OK && rule->has_mode) {
+        err = chunk_printf(writer, ",\"mode\":\"%s\"", mode_name((led_mode_t)rule->mode));
+    }
+    if (err == ESP_OK && rule->has_color) {
+        err = chunk_printf(writer, ",\"red\":%u,\"green\":%u,\"blue\":%u,\"white\":%u",
+                           rule->rgbw[0], rule->rgbw[1], rule->rgbw[2], rule->rgbw[3]);
+    }
+    if (err == ESP_OK && rule->has_duration) {
+        err = chunk_printf(writer, ",\"duration\":%" PRIu32, rule->blink_duration);
+    }
+    if (err == ESP_OK) {
+        err = chunk_printf(writer, "}");
+    }
+    return err;
+}
+
+static esp_err_t schedule_get_handler(httpd_req_t* req)
+{
+    static schedule_rule_t rules[SCHEDULE_MAX_RULES]; // Only one handler runs at a time
+    scheduler_status_t status;
+    scheduler_get_status(&status);
+    uint8_t rule_count = scheduler_get_rules(rules);
+    httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+
+    // The header in its own chunk, then one rule per chunk like /zones
+    chunk_writer_t writer = { .req = req };
+    esp_err_t err = chunk_printf(&writer, "{\"time\":");
+    if (err == ESP_OK) {
+        err = chunk_print_time(&writer, status.time_valid ? status.now : SCHEDULE_NEVER);
+    }
+    if (err == ESP_OK) {
+        err = chunk_printf(&writer, ",\"synced\":%s,\"timezone\":\"%s\",\"next\":",
+                           status.synced ? "true" : "false", CONFIG_LED_TIMEZONE);
+    }
+    if (err == ESP_OK) {
+        err = chunk_print_time(&writer, status.next_fire);
+    }
+    if (err == ESP_OK) {
+        err = chunk_printf(&writer, ",\"rules\":[");
+    }
+    if (err == ESP_OK) {
+        err = chunk_flush(&writer);
+    }
+    for (uint8_t i = 0; i < rule_count && err == ESP_OK; i++) {
+        err = schedule_format_rule(&writer, i, &rules[i]);
+        if (err == ESP_OK) {
+            err = chunk_flush(&writer);
+        }
+    }
+    if (err == ESP_OK) {
+        err = chunk_printf(&writer, "]}");
+    }
+    if (err == ESP_OK) {
+        err = chunk_flush(&writer);
+    }
+    if (err != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+typedef enum {
+    SCHEDULE_WEEKDAYS,
+    SCHEDULE_HOUR,
+    SCHEDULE_MINUTE,
+    SCHEDULE_STATE,
+    SCHEDULE_MODE,
+    SCHEDULE_RED,
+    SCHEDULE_GREEN,
+    SCHEDULE_BLUE,
+    SCHEDULE_WHITE,
+    SCHEDULE_DURATION,
+    SCHEDULE_FIELD_COUNT
+} schedule_field_t;
+
+static esp_err_t schedule_add_handler(httpd_req_t* req)
+{
+    schedule_rule_t rule = { .weekdays = SCHEDULE_EVERY_DAY };
+    char mode[MODE_NAME_MAX_LEN + 1];
+    json_field_t fields[SCHEDULE_FIELD_COUNT] = {
+        [SCHEDULE_WEEKDAYS] = { .key = "weekdays", .type = JSON_FIELD_UINT8, .dest = &rule.weekdays },    // Optional
+        [SCHEDULE_HOUR] = { .key = "hour", .type = JSON_FIELD_UINT8, .dest = &rule.hour },
+        [SCHEDULE_MINUTE] = { .key = "minute", .type = JSON_FIELD_UINT8, .dest = &rule.minute },
+        [SCHEDULE_STATE] = { .key = "state", .type = JSON_FIELD_BOOL, .dest = &rule.state },
+        [SCHEDULE_MODE] = { .key = "mode", .type = JSON_FIELD_STRING, .dest = mode, .dest_size = sizeof(mode) },
+        [SCHEDULE_RED] = { .key = "red", .type = JSON_FIELD_UINT8, .dest = &rule.rgbw[0] },
+        [SCHEDULE_GREEN] = { .key = "green", .type = JSON_FIELD_UINT8, .dest = &rule.rgbw[1] },
+        [SCHEDULE_BLUE] = { .key = "blue", .type = JSON_FIELD_UINT8, .dest = &rule.rgbw[2] },
+        [SCHEDULE_WHITE] = { .key = "white", .type = JSON_FIELD_UINT8, .dest = &rule.rgbw[3] },
+        [SCHEDULE_DURATION] = { .key = "duration", .type = JSON_FIELD_UINT32, .dest = &rule.blink_duration }
+    };
+    json_stream_t stream;
+    json_stream_init(&stream, fields, SCHEDULE_FIELD_COUNT);
+    if (parse_request_fields(req, &stream) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    if (!fields[SCHEDULE_HOUR].found || !fields[SCHEDULE_MINUTE].found) {
+        ESP_LOGE(SERVER_TAG, "Missing 'hour' or 'minute' field in JSON");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing 'hour' or 'minute' field");
+        return ESP_FAIL;
+    }
+    // Same rules as a /batch operation: a color needs all of red, green and blue
+    bool has_rgb = fields[SCHEDULE_RED].found && fields[SCHEDULE_GREEN].found && fields[SCHEDULE_BLUE].found;
+    if (!has_rgb && (fields[SCHEDULE_RED].found || fields[SCHEDULE_GREEN].found || fields[SCHEDULE_BLUE].found || fields[SCHEDULE_WHITE].found)) {
+        ESP_LOGE(SERVER_TAG, "Incomplete color in schedule rule");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Incomplete color");
+        return ESP_FAIL;
+    }
+    rule.has_color = has_rgb;
+    rule.has_state = fields[SCHEDULE_STATE].found;
+    rule.has_duration = fields[SCHEDULE_DURATION].found;
+    rule.has_mode = fields[SCHEDULE_MODE].found;
+    if (rule.has_mode) {
+        led_mode_t parsed;
+        if (parse_mode_name(mode, &parsed) != ESP_OK) {
+            ESP_LOGE(SERVER_TAG, "Unknown mode '%s' in schedule rule", mode);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown mode");
+            return ESP_FAIL;
+        }
+        // scheduler_add_rule turns it away too, this names the reason
+        if (parsed == LED_MODE_MORSE) {
+            ESP_LOGE(SERVER_TAG, "Morse mode in schedule rule");
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Morse mode can't be scheduled");
+            return ESP_FAIL;
+        }
+        rule.mode = parsed;
+    }
+
+    switch (scheduler_add_rule(&rule)) {
+        case ESP_OK:
+            break;
+        case ESP_ERR_INVALID_ARG:
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid time, weekdays, or nothing to change");
+            return ESP_FAIL;
+        case ESP_ERR_NO_MEM:
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Schedule is full");
+            return ESP_FAIL;
+        default:
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Rule added but not saved");
+            return ESP_FAIL;
+    }
+
+    httpd_resp_sendstr(req, "Successfully added schedule rule");
+    return ESP_OK;
+}
+
+static esp_err_t schedule_delete_handler(httpd_req_t* req)
+{
+    uint16_t id;
+    size_t query_len = httpd_req_get_url_query_len(req);
+    char query[query_len + 1];
+    if (query_len == 0 || httpd_req_get_url_query_str(req, query, query_len + 1) != ESP_OK ||
+        get_query_u16(query, "id", &id) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing or invalid 'id'");
+        return ESP_FAIL;
+    }
+
+    switch (id > UINT8_MAX ? ESP_ERR_NOT_FOUND : scheduler_remove_rule(id)) {
+        case ESP_OK:
+            break;
+        case ESP_ERR_NOT_FOUND:
+            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown rule");
+            return ESP_FAIL;
+        default:
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Rule removed but not saved");
+            return ESP_FAIL;
+    }
+
+    httpd_resp_sendstr(req, "Successfully removed schedule rule");
+    return ESP_OK;
+}
+
+#if CONFIG_LED_GROUP
+static esp_err_t group_get_handler(httpd_req_t* req)
+{
+    group_status_t status;
+    group_get_status(&status);
+    char body[GROUP_STATUS_SIZE];
+    snprintf(body, sizeof(body), "{\"group\":%d,\"leader\":%s,\"synced\":%s,\"offset_us\":%lld,\"delay_us\":%lld,\"drift_ppb\":%ld,\"pending\":%u}",
+             CONFIG_LED_GROUP_ID, status.leader ? "true" : "false", status.synced ? "true" : "false",
+             (long long)status.offset_us, (long long)status.delay_us, (long)status.drift_ppb, status.pending);
+    httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+    httpd_resp_sendstr(req, body);
+    return ESP_OK;
+}
+
+typedef enum {
+    GROUP_DELAY,
+    GROUP_STATE,
+    GROUP_MODE,
+    GROUP_RED,
+    GROUP_GREEN,
+    GROUP_BLUE,
+    GROUP_WHITE,
+    GROUP_DURATION,
+    GROUP_FIELD_COUNT
+} group_field_t;
+
+static esp_err_t group_send_handler(httpd_req_t* req)
+{
+    group_action_t action = {0};
+    uint32_t delay_ms = GROUP_DEFAULT_DELAY_MS;
+    char mode[MODE_NAME_MAX_LEN + 1];
+    json_field_t fields[GROUP_FIELD_COUNT] = {
+        [GROUP_DELAY] = { .key = "delay", .type = JSON_FIELD_UINT32, .dest = &delay_ms },     // Optional
+        [GROUP_STATE] = { .key = "state", .type = JSON_FIELD_BOOL, .dest = &action.state },
+        [GROUP_MODE] = { .key = "mode", .type = JSON_FIELD_STRING, .dest = mode, .dest_size = sizeof(mode) },
+        [GROUP_RED] = { .key = "red", .type = JSON_FIELD_UINT8, .dest = &action.rgbw[0] },
+        [GROUP_GREEN] = { .key = "green", .type = JSON_FIELD_UINT8, .dest = &action.rgbw[1] },
+        [GROUP_BLUE] = { .key = "blue", .type = JSON_FIELD_UINT8, .dest = &action.rgbw[2] },
+        [GROUP_WHITE] = { .key = "white", .type = JSON_FIELD_UINT8, .dest = &action.rgbw[3] },
+        [GROUP_DURATION] = { .key = "duration", .type = JSON_FIELD_UINT32, .dest = &action.blink_duration }
+    };
+    json_stream_t stream;
+    json_stream_init(&stream, fields, GROUP_FIELD_COUNT);
+    if (parse_request_fields(req, &stream) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    // Same rules as a /batch operation: a color needs all of red, green and blue
+    bool has_rgb = fields[GROUP_RED].found && fields[GROUP_GREEN].found && fields[GROUP_BLUE].found;
+    if (!has_rgb && (fields[GROUP_RED].found || fields[GROUP_GREEN].found || fields[GROUP_BLUE].found || fields[GROUP_WHITE].found)) {
+        ESP_LOGE(SERVER_TAG, "Incomplete color in group command");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Incomplete color");
+        return ESP_FAIL;
+    }
+    action.has_color = has_rgb;
+    action.has_state = fields[GROUP_STATE].found;
+    action.has_duration = fields[GROUP_DURATION].found;
+    action.has_mode = fields[GROUP_MODE].found;
+    if (action.has_mode) {
+        led_mode_t parsed;
+        if (parse_mode_name(mode, &parsed) != ESP_OK) {
+            ESP_LOGE(SERVER_TAG, "Unknown mode '%s' in group command", mode);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown mode");
+            return ESP_FAIL;
+        }
+        // Members would need the Morse string too, which commands don't carry
+        if (parsed == LED_MODE_MORSE) {
+            ESP_LOGE(SERVER_TAG, "Morse mode in group command");
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Morse mode can't be sent to the group");
+            return ESP_FAIL;
+        }
+        action.mode = parsed;
+    }
+    if (!action.has_color && !action.has_state && !action.has_duration && !action.has_mode) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Nothing to change");
+        return ESP_FAIL;
+    }
+    if (delay_ms > GROUP_MAX_DELAY_MS) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Delay too long");
+        return ESP_FAIL;
+    }
+
+    switch (group_send(&action, delay_ms)) {
+        case ESP_OK:
+            break;
+        case ESP_ERR_INVALID_STATE:
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Not synced to the group clock");
+            return ESP_FAIL;
+        case ESP_ERR_NO_MEM:
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Too many pending commands");
+            return ESP_FAIL;
+        default:
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to send command");
+            return ESP_FAIL;
+    }
+
+    httpd_resp_sendstr(req, "Successfully sent group command");
+    return ESP_OK;
+}
+#endif // CONFIG_LED_GROUP
+
 // Helpers
 static void start_server()
 {
+    // The default of 8 handlers is too few for every endpoint
+    server_config.max_uri_handlers = 24;
+    server_config.core_id = SERVER_CORE;
     ESP_ERROR_CHECK(httpd_start(&server, &server_config));
     ESP_LOGI(SERVER_TAG, "HTTP server started");
 }
@@ -209,6 +1372,32 @@ static void register_uri_handlers()
     ESP_ERROR_CHECK(httpd_register_uri_handler(server, &blinky_uri));
     ESP_ERROR_CHECK(httpd_register_uri_handler(server, &morse_uri));
     ESP_ERROR_CHECK(httpd_register_uri_handler(server, &color_uri));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &batch_uri));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &state_uri));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &pixels_uri));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &zones_uri));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &matrix_uri));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &text_uri));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &schedule_get_uri));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &schedule_add_uri));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &schedule_delete_uri));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &events_uri));
+#if CONFIG_LED_AUDIO
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &audio_uri));
+#endif
+#if CONFIG_LED_LIVE
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &live_uri));
+#endif
+#if CONFIG_LED_GROUP
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &group_get_uri));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &group_send_uri));
+#endif
+#if CONFIG_LED_METRICS
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &metrics_uri));
+#endif
+#if CONFIG_LED_TRACE
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &trace_uri));
+#endif
     ESP_LOGI(SERVER_TAG, "URI handlers registered");
 }
 
@@ -217,14 +1406,24 @@ static void register_uri_handlers()
 void http_server_init()
 {
     // Setting up server
+    boot_id = esp_random();
     start_server();
     register_uri_handlers();
 
     // Creating LED, preparing iterator for Morse Code mode, initializing timers
-    led = create_led(0);
+    led = create_led(0, CONFIG_MAX_LEDS);
     morse_iterator.led = led;
     morse_iterator.index = 0;
     led_timers_init(led, &morse_iterator);
+    event_stream_init(led);
+#if CONFIG_LED_LIVE
+    live_channel_init(led);
+#endif
+    scheduler_init(led);
+    discovery_init(led);
+#if CONFIG_LED_GROUP
+    group_init(led);
+#endif
 
     // Ensure LED off after flash
     set_led_state(led, OFF);
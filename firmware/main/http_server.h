@@ -2,11 +2,18 @@
 #define HTTP_SERVER_H
 
 #include "string.h"
+#include <stdarg.h>
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_http_server.h"
-#include "cJSON.h"
+#include "esp_random.h"
+#include "json_stream.h"
 #include "led_manager.h"
+#include "event_stream.h"
+#include "live_channel.h"
+#include "scheduler.h"
+#include "discovery.h"
+#include "group.h"
 
 /**
  * @brief   Starts a simple HTTP server, defines URIs, and registers handlers to handle them.
@@ -0,0 +1,402 @@
+#include "json_stream.h"
+#include <string.h>
+
+enum {
+    JS_VALUE,           // Expecting any value
+    JS_VALUE_OR_END,    // Expecting a value or ']' (just after '[')
+    JS_KEY,             // Expecting a key (just after ',' in an object)
+    JS_KEY_OR_END,      // Expecting a key or '}' (just after '{')
+    JS_COLON,
+    JS_COMMA_OR_END,
+    JS_STRING,
+    JS_STRING_ESCAPE,
+    JS_STRING_UNICODE,
+    JS_NUMBER,
+    JS_LITERAL,
+    JS_DONE
+};
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool in_object(const json_stream_t* stream)
+{
+    return stream->depth > 0 && (stream->container_stack & (1u << (stream->depth - 1)));
+}
+
+static void clear_found(json_stream_t* stream)
+{
+    for (size_t i = 0; i < stream->field_count; i++) {
+        stream->fields[i].found = false;
+    }
+}
+
+static json_field_t* find_field(json_stream_t* stream)
+{
+    if (stream->key_overflow || stream->depth != stream->record_depth || !in_object(stream)) {
+        return NULL;
+    }
+    for (size_t i = 0; i < stream->field_count; i++) {
+        if (strcmp(stream->fields[i].key, stream->key) == 0) {
+            return &stream->fields[i];
+        }
+    }
+    return NULL;
+}
+
+static void value_done(json_stream_t* stream)
+{
+    stream->active_field = NULL;
+    stream->state = stream->depth == 0 ? JS_DONE : JS_COMMA_OR_END;
+}
+
+static esp_err_t push_container(json_stream_t* stream, bool object)
+{
+    // Containers under a bound key never match the scalar field types
+    if (stream->active_field) return ESP_ERR_INVALID_ARG;
+    if (stream->depth >= JSON_STREAM_MAX_DEPTH) return ESP_FAIL;
+
+    if (object) {
+        stream->container_stack |= 1u << stream->depth;
+    } else {
+        stream->container_stack &= ~(1u << stream->depth);
+    }
+    stream->depth++;
+    stream->state = object ? JS_KEY_OR_END : JS_VALUE_OR_END;
+    return ESP_OK;
+}
+
+static esp_err_t pop_container(json_stream_t* stream, bool object)
+{
+    if (stream->depth == 0 || in_object(stream) != object) return ESP_FAIL;
+
+    if (object && stream->depth == stream->record_depth && stream->on_record) {
+        esp_err_t err = stream->on_record(stream->fields, stream->field_count, stream->ctx);
+        clear_found(stream);
+        if (err != ESP_OK) return err;
+    }
+    stream->depth--;
+    value_done(stream);
+    return ESP_OK;
+}
+
+static esp_err_t store_number(json_stream_t* stream)
+{
+    json_field_t* field = stream->active_field;
+    if (!stream->number_digits) return ESP_FAIL;
+    if (!field) return ESP_OK;
+    if (stream->number_negative || !stream->number_integral) return ESP_ERR_INVALID_ARG;
+
+    switch (field->type) {
+        case JSON_FIELD_UINT8:
+            if (stream->number > UINT8_MAX) return ESP_ERR_INVALID_ARG;
+            *(uint8_t*)field->dest = stream->number;
+            break;
+        case JSON_FIELD_UINT16:
+            if (stream->number > UINT16_MAX) return ESP_ERR_INVALID_ARG;
+            *(uint16_t*)field->dest = stream->number;
+            break;
+        case JSON_FIELD_UINT32:
+            *(uint32_t*)field->dest = stream->number;
+            break;
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+    field->found = true;
+    return ESP_OK;
+}
+
+static esp_err_t store_literal(json_stream_t* stream)
+{
+    json_field_t* field = stream->active_field;
+    if (!field) return ESP_OK;
+    // null leaves the field unset, which callers already report as missing
+    if (field->type != JSON_FIELD_BOOL || stream->literal[0] == 'n') return ESP_ERR_INVALID_ARG;
+
+    *(bool*)field->dest = stream->literal[0] == 't';
+    field->found = true;
+    return ESP_OK;
+}
+
+static esp_err_t string_char(json_stream_t* stream, char c)
+{
+    if (stream->in_key) {
+        if (stream->key_len < JSON_STREAM_KEY_MAX) {
+            stream->key[stream->key_len++] = c;
+        } else {
+            stream->key_overflow = true;
+        }
+        return ESP_OK;
+    }
+
+    json_field_t* field = stream->active_field;
+    if (!field) return ESP_OK;
+    // Room must remain for the terminator
+    if (stream->str_len + 1 >= field->dest_size) return ESP_ERR_INVALID_SIZE;
+    ((char*)field->dest)[stream->str_len++] = c;
+    return ESP_OK;
+}
+
+static esp_err_t string_end(json_stream_t* stream)
+{
+    if (stream->in_key) {
+        stream->key[stream->key_len] = '\0';
+        stream->in_key = false;
+        stream->active_field = find_field(stream);
+        stream->state = JS_COLON;
+        return ESP_OK;
+    }
+
+    json_field_t* field = stream->active_field;
+    if (field) {
+        ((char*)field->dest)[stream->str_len] = '\0';
+        field->found = true;
+    }
+    value_done(stream);
+    return ESP_OK;
+}
+
+static esp_err_t begin_value(json_stream_t* stream, char c)
+{
+    json_field_t* field = stream->active_field;
+
+    switch (c) {
+        case '{':
+            return push_container(stream, true);
+        case '[':
+            return push_container(stream, false);
+        case '"':
+            if (field && field->type != JSON_FIELD_STRING) return ESP_ERR_INVALID_ARG;
+            if (field && field->dest_size == 0) return ESP_ERR_INVALID_SIZE;
+            stream->str_len = 0;
+            stream->state = JS_STRING;
+            return ESP_OK;
+        case 't':
+            stream->literal = "true";
+            break;
+        case 'f':
+            stream->literal = "false";
+            break;
+        case 'n':
+            stream->literal = "null";
+            break;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                stream->number = 0;
+                stream->number_negative = c == '-';
+                stream->number_digits = false;
+                stream->number_integral = true;
+                stream->state = JS_NUMBER;
+                // Reprocessed by the JS_NUMBER state unless it is the sign
+                return c == '-' ? ESP_OK : ESP_ERR_NOT_FINISHED;
+            }
+            return ESP_FAIL;
+    }
+    stream->literal_pos = 1;
+    stream->state = JS_LITERAL;
+    return ESP_OK;
+}
+
+static esp_err_t number_char(json_stream_t* stream, char c)
+{
+    if (c >= '0' && c <= '9') {
+        stream->number_digits = true;
+        if (!stream->number_integral) return ESP_OK;
+        uint32_t digit = c - '0';
+        if (stream->number > (UINT32_MAX - digit) / 10) {
+            // Only an error if someone wants the value
+            if (stream->active_field) return ESP_ERR_INVALID_ARG;
+            stream->number_integral = false;
+            return ESP_OK;
+        }
+        stream->number = stream->number * 10 + digit;
+        return ESP_OK;
+    }
+    if (c == '.' || c == 'e' || c == 'E' || c == '+' || (c == '-' && !stream->number_integral)) {
+        stream->number_integral = false;
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FINISHED;
+}
+
+void json_stream_init(json_stream_t* stream, json_field_t* fields, size_t field_count)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->fields = fields;
+    stream->field_count = field_count;
+    stream->record_depth = 1;
+    stream->state = JS_VALUE;
+    clear_found(stream);
+}
+
+void json_stream_set_record_handler(json_stream_t* stream, uint8_t depth, json_record_cb_t on_record, void* ctx)
+{
+    stream->record_depth = depth;
+    stream->on_record = on_record;
+    stream->ctx = ctx;
+}
+
+esp_err_t json_stream_feed(json_stream_t* stream, const char* data, size_t len)
+{
+    esp_err_t err = ESP_OK;
+    size_t i = 0;
+
+    while (i < len) {
+        char c = data[i];
+
+        switch (stream->state) {
+            case JS_VALUE:
+            case JS_VALUE_OR_END:
+                if (is_space(c)) break;
+                if (c == ']' && stream->state == JS_VALUE_OR_END) {
+                    err = pop_container(stream, false);
+                    break;
+                }
+                err = begin_value(stream, c);
+                if (err == ESP_ERR_NOT_FINISHED) {
+                    // First digit belongs to the number, feed it again in JS_NUMBER
+                    err = ESP_OK;
+                    continue;
+                }
+                break;
+            case JS_KEY:
+            case JS_KEY_OR_END:
+                if (is_space(c)) break;
+                if (c == '}' && stream->state == JS_KEY_OR_END) {
+                    err = pop_container(stream, true);
+                } else if (c == '"') {
+                    stream->in_key = true;
+                    stream->key_len = 0;
+                    stream->key_overflow = false;
+                    stream->state = JS_STRING;
+                } else {
+                    err = ESP_FAIL;
+                }
+                break;
+            case JS_COLON:
+                if (is_space(c)) break;
+                if (c == ':') {
+                    stream->state = JS_VALUE;
+                } else {
+                    err = ESP_FAIL;
+                }
+                break;
+            case JS_COMMA_OR_END:
+                if (is_space(c)) break;
+                if (c == ',') {
+                    stream->state = in_object(stream) ? JS_KEY : JS_VALUE;
+                } else if (c == '}' || c == ']') {
+                    err = pop_container(stream, c == '}');
+                } else {
+                    err = ESP_FAIL;
+                }
+                break;
+            case JS_STRING:
+                if (c == '"') {
+                    err = string_end(stream);
+                } else if (c == '\\') {
+                    stream->state = JS_STRING_ESCAPE;
+                } else if ((uint8_t)c < 0x20) {
+                    err = ESP_FAIL;
+                } else {
+                    err = string_char(stream, c);
+                }
+                break;
+            case JS_STRING_ESCAPE:
+                stream->state = JS_STRING;
+                switch (c) {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        err = string_char(stream, c);
+                        break;
+                    case 'b':
+                        err = string_char(stream, '\b');
+                        break;
+                    case 'f':
+                        err = string_char(stream, '\f');
+                        break;
+                    case 'n':
+                        err = string_char(stream, '\n');
+                        break;
+                    case 'r':
+                        err = string_char(stream, '\r');
+                        break;
+                    case 't':
+                        err = string_char(stream, '\t');
+                        break;
+                    case 'u':
+                        stream->unicode = 0;
+                        stream->unicode_digits = 0;
+                        stream->state = JS_STRING_UNICODE;
+                        break;
+                    default:
+                        err = ESP_FAIL;
+                }
+                break;
+            case JS_STRING_UNICODE: {
+                uint8_t nibble;
+                if (c >= '0' && c <= '9') {
+                    nibble = c - '0';
+                } else if (c >= 'a' && c <= 'f') {
+                    nibble = c - 'a' + 10;
+                } else if (c >= 'A' && c <= 'F') {
+                    nibble = c - 'A' + 10;
+                } else {
+                    err = ESP_FAIL;
+                    break;
+                }
+                stream->unicode = (stream->unicode << 4) | nibble;
+                if (++stream->unicode_digits == 4) {
+                    // Every field we bind is ASCII, anything wider is replaced rather than UTF-8 encoded
+                    err = string_char(stream, stream->unicode < 0x80 ? (char)stream->unicode : '?');
+                    stream->state = JS_STRING;
+                }
+                break;
+            }
+            case JS_NUMBER:
+                err = number_char(stream, c);
+                if (err == ESP_ERR_NOT_FINISHED) {
+                    // Delimiter ends the number and is then handled by the next state
+                    err = store_number(stream);
+                    if (err == ESP_OK) {
+                        value_done(stream);
+                        continue;
+                    }
+                }
+                break;
+            case JS_LITERAL:
+                if (c != stream->literal[stream->literal_pos]) {
+                    err = ESP_FAIL;
+                    break;
+                }
+                if (stream->literal[++stream->literal_pos] == '\0') {
+                    err = store_literal(stream);
+                    value_done(stream);
+                }
+                break;
+            case JS_DONE:
+                if (!is_space(c)) err = ESP_FAIL;
+                break;
+            default:
+                err = ESP_FAIL;
+        }
+
+        if (err != ESP_OK) return err;
+        i++;
+    }
+    return ESP_OK;
+}
+
+esp_err_t json_stream_finish(json_stream_t* stream)
+{
+    // A bare top-level number has no delimiter to end it
+    if (stream->state == JS_NUMBER && stream->depth == 0) {
+        esp_err_t err = store_number(stream);
+        if (err != ESP_OK) return err;
+        value_done(stream);
+    }
+    return stream->state == JS_DONE ? ESP_OK : ESP_FAIL;
+}
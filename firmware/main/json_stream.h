@@ -0,0 +1,123 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define JSON_STREAM_KEY_MAX 15      // Longest key that can bind to a field, longer keys are skipped
+#define JSON_STREAM_MAX_DEPTH 32    // Nesting limit, one bit of container_stack per level
+
+typedef enum {
+    JSON_FIELD_BOOL,    //!< true/false literal, stored as bool
+    JSON_FIELD_UINT8,   //!< Integer 0 - 255, stored as uint8_t
+    JSON_FIELD_UINT16,  //!< Integer 0 - 65535, stored as uint16_t
+    JSON_FIELD_UINT32,  //!< Non-negative integer, stored as uint32_t
+    JSON_FIELD_STRING   //!< String copied into a caller-owned buffer of dest_size bytes (including the terminator)
+} json_field_type_t;
+
+/**
+ * @brief   Binds a JSON key to a typed destination, filled in as the value streams past
+ */
+typedef struct {
+    const char* key;            //!< Key to match (exact, case-sensitive)
+    json_field_type_t type;     //!< Expected value type
+    void* dest;                 //!< Where the value is written
+    size_t dest_size;           //!< Size of dest, only used by JSON_FIELD_STRING
+    bool found;                 //!< Set by the parser once a value of the right type was stored
+} json_field_t;
+
+/**
+ * @brief   Called whenever an object at the record depth closes, see json_stream_set_record_handler
+ *
+ * @note The parser clears every field's found flag after the callback returns, ready for the next record
+ *
+ * @return
+ *      - ESP_OK: Keep parsing
+ *      - Anything else: Parsing stops and json_stream_feed returns this error
+ */
+typedef esp_err_t (*json_record_cb_t)(json_field_t* fields, size_t field_count, void* ctx);
+
+/**
+ * @brief   Streaming JSON tokenizer state. No DOM is built and nothing is allocated,
+ *          values of known keys are written straight into their json_field_t destinations
+ *
+ * @note Treat every member below the first comment as private
+ */
+typedef struct {
+    json_field_t* fields;
+    size_t field_count;
+    uint8_t record_depth;       //!< Object depth whose keys bind to fields (1 = top-level object)
+    json_record_cb_t on_record;
+    void* ctx;
+
+    // Tokenizer internals
+    uint8_t state;
+    uint8_t depth;
+    uint32_t container_stack;   // Bit n set if the container at depth n + 1 is an object
+    bool in_key;
+    char key[JSON_STREAM_KEY_MAX + 1];
+    uint8_t key_len;
+    bool key_overflow;
+    json_field_t* active_field; // Field bound to the value being parsed, NULL when skipping
+    size_t str_len;
+    uint16_t unicode;
+    uint8_t unicode_digits;
+    uint32_t number;
+    bool number_negative;
+    bool number_digits;
+    bool number_integral;       // False once a fraction or exponent has been seen
+    const char* literal;
+    uint8_t literal_pos;
+} json_stream_t;
+
+/**
+ * @brief   Prepares a parser that binds keys of the top-level object to fields
+ *
+ * @param stream: Parser state, usually on the caller's stack
+ * @param fields: Field table, found flags are cleared here
+ * @param field_count: Number of entries in fields
+ */
+void json_stream_init(json_stream_t* stream, json_field_t* fields, size_t field_count);
+
+/**
+ * @brief   Binds fields to objects nested at depth instead of the top-level object and invokes
+ *          on_record every time one of them closes (e.g. depth 2 for each object in [{...}, {...}])
+ *
+ * @param stream: Parser state, already initialized with json_stream_init
+ * @param depth: Object depth whose keys bind to fields
+ * @param on_record: Callback invoked per completed record
+ * @param ctx: Passed through to on_record
+ */
+void json_stream_set_record_handler(json_stream_t* stream, uint8_t depth, json_record_cb_t on_record, void* ctx);
+
+/**
+ * @brief   Feeds the next chunk of the document, may be called with any split of the input
+ *
+ * @param stream: Parser state
+ * @param data: Chunk bytes, not null-terminated
+ * @param len: Number of bytes in data
+ *
+ * @return
+ *      - ESP_OK: Chunk consumed
+ *      - ESP_FAIL: Malformed JSON
+ *      - ESP_ERR_INVALID_ARG: A bound key had a value of the wrong type or out of range
+ *      - ESP_ERR_INVALID_SIZE: A bound string did not fit its destination
+ *      - Any error returned by the record callback
+ */
+esp_err_t json_stream_feed(json_stream_t* stream, const char* data, size_t len);
+
+/**
+ * @brief   Signals the end of input
+ *
+ * @param stream: Parser state
+ *
+ * @return
+ *      - ESP_OK: A complete JSON value was parsed
+ *      - ESP_FAIL: The document was truncated or empty
+ *      - ESP_ERR_INVALID_ARG: A trailing top-level number did not fit its field
+ */
+esp_err_t json_stream_finish(json_stream_t* stream);
+
+#endif // JSON_STREAM_H
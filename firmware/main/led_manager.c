@@ -1,119 +1,416 @@
 #include "led_manager.h"
 
 #define MICRO_PER_MILLI 1000
+#define MICRO_PER_SECOND 1000000
 #define DOT_MS 100
 #define DASH_MS (DOT_MS * 3)
 #define DOT_DASH_SEP_MS DOT_MS
 #define CHAR_SEP_MS DASH_MS
 #define WORD_SEP_MS (DOT_MS * 7)
 
+#define RENDER_TASK_STACK_SIZE 4096
+#define RENDER_TASK_PRIORITY (configMAX_PRIORITIES - 5) // Above httpd and app tasks, below esp_timer and Wi-Fi
+#define RENDER_TASK_CORE (portNUM_PROCESSORS - 1)   // Core 1 on the S3, the network stack stays on core 0
+#define COMMAND_QUEUE_LENGTH 32     // Must be a power of two, a full /batch posts well over this and waits for the owner
+#define AUDIO_QUEUE_LENGTH 4        // Must be a power of two, blocks arrive every 23 ms at 22050 Hz
+#define AUDIO_FLASH_DECAY_SHIFT 2   // A beat's flash loses a quarter of its brightness per block
+#define LOG_BURST 5                 // Render task log lines allowed back to back
+#define LOG_REFILL_MS 1000          // One more line allowed per interval after the burst
+
 static const char* LED_TAG = "led strip";
 
 enum {
     RED,
     GREEN,
-    BLUE
+    BLUE,
+    WHITE
 };
 
+#if CONFIG_LED_RGBW
+#define WHITE_BALANCE CONFIG_LED_BALANCE_WHITE
+#define WHITE_CURRENT_MA CONFIG_LED_CURRENT_WHITE_MA
+#else
+#define WHITE_BALANCE 255
+#define WHITE_CURRENT_MA 0
+#endif
+
 // The LED strip object
 static led_strip_handle_t led_handle;
 
 static esp_timer_handle_t blinky_timer;
 static esp_timer_handle_t morse_code_timer;
+static esp_timer_handle_t text_timer;
+
+// Notification bits posted to the render task, multiple posts before it runs collapse into one wake
+enum {
+    RENDER_EVENT_COMMAND = BIT0,    // led_commands has entries
+    RENDER_EVENT_BLINK = BIT1,      // Blinky timer fired, take the next step then push
+    RENDER_EVENT_MORSE = BIT2,      // Morse code timer fired, advance then push
+    RENDER_EVENT_TEXT = BIT3,       // Text timer fired, scroll one column then push
+    RENDER_EVENT_AUDIO = BIT4       // audio_features has entries
+};
+
+typedef enum {
+    LED_COMMAND_MODE,
+    LED_COMMAND_STATE,
+    LED_COMMAND_DURATION,
+    LED_COMMAND_MORSE,
+    LED_COMMAND_RGBW,               // Whole LED, pixels.start/count unused
+    LED_COMMAND_PIXEL_RGBW,
+    LED_COMMAND_BATCH_BEGIN,
+    LED_COMMAND_BATCH_COMMIT,
+    LED_COMMAND_MATRIX_BLIT,
+    LED_COMMAND_MATRIX_FILL,
+    LED_COMMAND_MATRIX_SCROLL,
+    LED_COMMAND_TEXT
+} led_command_type_t;
+
+// One setter call, queued by any task and applied by the render task
+typedef struct {
+    led_command_type_t type;
+    led_t* led;
+    union {
+        led_mode_t mode;
+        bool state;
+        uint32_t blink_duration;
+        char* morse_code;           // Owned by the command until applied
+        struct {
+            uint16_t start;
+            uint16_t count;
+            uint8_t rgbw[4];
+        } pixels;
+        struct {
+            const zone_t* zone;
+            uint16_t x;             // Rectangle for blit and fill
+            uint16_t y;
+            uint16_t width;
+            uint16_t height;
+            int16_t dx;             // Offset for scroll
+            int16_t dy;
+            uint8_t rgbw[4];        // Fill color, also scrolled in
+            uint8_t (*bitmap)[4];   // Blit source, owned by the command until applied
+        } matrix;
+        struct {
+            const zone_t* zone;
+            char* text;             // Owned by the command until applied, NULL stops the text
+            uint32_t column_us;     // Time per column
+            uint8_t rgbw[4];
+        } text;
+    };
+} led_command_t;
+
+// The render task owns every led_t: it alone applies commands, so setters never race the timers
+static TaskHandle_t render_task;
+static led_t* render_led;
+static morse_iterator_t* render_iterator;
+static bool frame_due;              // Render task only, set when the output needs pushing
+static led_command_t command_buffer[COMMAND_QUEUE_LENGTH];
+static uint32_t command_sequences[COMMAND_QUEUE_LENGTH];
+static mpsc_queue_t led_commands;
+static audio_features_t audio_buffer[AUDIO_QUEUE_LENGTH];
+static spsc_queue_t audio_features;
+// Held by the render task while it writes config or pixels and by readers while they copy them out
+static portMUX_TYPE led_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int64_t local_time_to_local(int64_t time)
+{
+    return time;
+}
+
+static const led_time_base_t local_time_base = {
+    .now = esp_timer_get_time,
+    .to_local = local_time_to_local
+};
+// Set from any task, read by the render task whenever it arms an effect timer
+static const led_time_base_t* time_base = &local_time_base;
+static int64_t morse_next;          // Render task only, effect time the current Morse element ends
+
+// Token bucket for render task logging, only touched by the render task
+static uint32_t log_tokens = LOG_BURST;
+static uint32_t log_suppressed;
+static int64_t log_refill_us;
 
 typedef struct {
     led_mode_t mode;
     bool state;
     uint32_t blink_duration;
     char* morse_code;
-    uint8_t rgb[3];
+    uint8_t rgbw[4];
 } led_config_t;
 
+// Scrolling text is drawn straight into a zone's output, so the stored pixels keep what was set
+typedef struct {
+    char* text;                 // NULL while no text scrolls
+    const zone_t* zone;
+    text_scroller_t scroller;
+    uint8_t colors[2][4];       // Corrected background and text color
+    uint8_t (*column)[4];       // Next column scrolled in, one pixel per zone row
+    uint16_t first;             // Pixels showing the text, first to end - 1, empty without text
+    uint16_t end;
+    uint32_t column_us;         // Time per column
+} led_text_t;
+
 struct led_t {
     led_strip_handle_t led_handle;
-    uint8_t index;
+    uint16_t index;
+    uint16_t length;
+    uint8_t (*pixels)[4];   // Per-pixel color and explicit white, shown while the LED is on
+    uint8_t (*output)[4];   // pixels after color correction, render task only
+    power_limit_t power;    // Tracks the current of output as pixels change
+    uint16_t* remap;        // Strip position i shows output[remap[i]], from the zone table
+    uint8_t (*preview)[3];  // Downsampled last frame for get_led_preview, written by the render task under led_lock
+    uint16_t preview_length;
+    uint32_t preview_frame;
+    zone_table_t zones;     // Fixed after create_led, so readable from any task
+    led_text_t text;
+    uint8_t audio_gains[AUDIO_BANDS];   // Brightness of each band's run of pixels in audio mode, render task only
+    uint8_t audio_flash;                // Beat flash, fading with every block
     led_config_t config;
+    bool lit;               // What the hardware shows right now, toggled by the blink timers without touching config.state
+    uint32_t version;       // Bumped by every setter so readers can tell when config or pixels changed
+    led_change_cb_t on_change;
+    bool batching;          // Inside led_batch_begin/led_batch_commit, hardware updates are deferred
+    bool pending_light;
+    bool pending_mode;
 };
 
-// LED Strip Config
-static led_strip_config_t strip_config = {
-    .strip_gpio_num = CONFIG_LED_GPIO,
+// LED Strip Config, a single WS2812 (GRB) or SK6812 (GRBW) strip through the RMT backend
+static multi_strip_config_t strip_config = {
+    .gpios = {CONFIG_LED_GPIO},
+    .output_count = 1,
     .max_leds = CONFIG_MAX_LEDS,
-    .led_model = LED_MODEL_WS2812,
-    .color_component_format = LED_STRIP_COLOR_COMPONENT_FMT_GRB,
-    .flags.invert_out = false,
-};
-
-// RMT Backend Configuration
-static led_strip_rmt_config_t rmt_config = {
-    .clk_src = RMT_CLK_SRC_DEFAULT,
     .resolution_hz = 10 * 1000 * 1000, // RMT counter clock frequency: 10MHz
     .mem_block_symbols = 64,           // the memory size of each RMT channel, in words (4 bytes)
-    .flags.with_dma = false,
+#if CONFIG_LED_RGBW
+    .rgbw = true,
+#endif
 };
 
+// Built once in led_manager_init, read by the render task on every frame
+static color_correct_t color_tables;
+
 // My Led Struct Configuration
 static led_config_t config = {
     .mode = LED_MODE_LIGHT,
     .state = OFF,
-    .rgb = {25, 25, 25}
+    .rgbw = {25, 25, 25, 0}
 };
 
-static void activate_light(led_t* led)
+// Only called from the render task, after the change is stored
+static void notify_change(led_t* led, uint32_t changed, uint16_t first_pixel, uint16_t last_pixel)
+{
+    // Under the lock so a reader never pairs the new version with the old data
+    portENTER_CRITICAL(&led_lock);
+    __atomic_store_n(&led->version, led->version + 1, __ATOMIC_RELAXED);
+    portEXIT_CRITICAL(&led_lock);
+    if (led->on_change) {
+        led->on_change(led->version, changed, first_pixel, last_pixel);
+    }
+}
+
+static bool log_allowed()
+{
+    int64_t now = esp_timer_get_time();
+    if (log_tokens < LOG_BURST && now - log_refill_us >= LOG_REFILL_MS * MICRO_PER_MILLI) {
+        log_tokens++;
+        log_refill_us = now;
+    }
+    if (log_tokens == 0) {
+        log_suppressed++;
+        return false;
+    }
+    log_tokens--;
+    if (log_suppressed) {
+        ESP_LOGW(LED_TAG, "%" PRIu32 " log lines suppressed", log_suppressed);
+        log_suppressed = 0;
+    }
+    return true;
+}
+
+// Rate-limited logging for the render task, which can run on every blink
+#define RENDER_LOGI(format, ...) do { if (log_allowed()) ESP_LOGI(LED_TAG, format, ##__VA_ARGS__); } while (0)
+#define RENDER_LOGE(format, ...) do { if (log_allowed()) ESP_LOGE(LED_TAG, format, ##__VA_ARGS__); } while (0)
+
+// White extraction and balance, done when a pixel is set so the stored colors stay what was set
+static void correct_color(const uint8_t rgbw[4], uint8_t out[4])
+{
+#if CONFIG_LED_RGBW
+    color_correct_rgbw(&color_tables, rgbw, out);
+#else
+    color_correct_rgb(&color_tables, rgbw, out);
+#endif
+}
+
+// Only called from the render task, samples the frame just pushed for get_led_preview
+static void update_preview(led_t* led, uint32_t scale, const uint32_t* band_scales)
 {
-    if (led->config.state) {
-        ESP_ERROR_CHECK(
-            led_strip_set_pixel(
-                led->led_handle,
-                led->index,
-                led->config.rgb[RED],
-                led->config.rgb[GREEN],
-                led->config.rgb[BLUE]
-            )
-        );
+    portENTER_CRITICAL(&led_lock);
+    if (led->lit) {
+        for (uint16_t p = 0; p < led->preview_length; p++) {
+            uint16_t i = (uint32_t)p * led->length / led->preview_length;
+            const uint8_t* out = led->output[i];
+            uint32_t pixel_scale = band_scales ? band_scales[i * AUDIO_BANDS / led->length] : scale;
+            uint32_t white = power_limit_apply(out[WHITE], pixel_scale);
+            for (int channel = RED; channel <= BLUE; channel++) {
+                uint32_t value = power_limit_apply(out[channel], pixel_scale) + white;
+                led->preview[p][channel] = value > 255 ? 255 : value;
+            }
+        }
+    } else {
+        memset(led->preview, 0, led->preview_length * sizeof(led->preview[0]));
+    }
+    led->preview_frame++;
+    portEXIT_CRITICAL(&led_lock);
+}
+
+// Only called from the render task
+static void render_frame(led_t* led)
+{
+    metric_span_t frame_span = metrics_begin();
+    metric_span_t refresh_span;
+    trace_record(TRACE_RENDER_START, led->length);
+    if (led->lit) {
+        // The sums are already current, so staying in budget costs nothing until the frame is over it
+        uint32_t output_ma;
+        uint32_t scale = power_limit_scale(&led->power, &output_ma);
+        metrics_set_gauge(METRIC_GAUGE_POWER_ESTIMATED, power_limit_estimate_ma(&led->power));
+        metrics_set_gauge(METRIC_GAUGE_POWER_OUTPUT, output_ma);
+        // Audio mode only ever dims, so it folds into the power scale and the frame stays in budget
+        bool audio = led->config.mode == LED_MODE_AUDIO;
+        uint32_t band_scales[AUDIO_BANDS];
+        if (audio) {
+            for (uint8_t band = 0; band < AUDIO_BANDS; band++) {
+                uint32_t gain = led->audio_gains[band];
+                band_scales[band] = scale * (gain + (gain >> 7)) >> 8;  // 255 maps to 256, unchanged
+            }
+        }
+        uint8_t out[4];
+        for (uint16_t i = 0; i < led->length; i++) {
+            // Zone layouts are a gather through the remap, identity outside any zone
+            memcpy(out, led->output[led->remap[i]], 4);
+            uint32_t pixel_scale = audio ? band_scales[i * AUDIO_BANDS / led->length] : scale;
+            if (pixel_scale < POWER_LIMIT_FULL_SCALE) {
+                for (int channel = RED; channel <= WHITE; channel++) {
+                    out[channel] = power_limit_apply(out[channel], pixel_scale);
+                }
+            }
+#if CONFIG_LED_RGBW
+            ESP_ERROR_CHECK(led_strip_set_pixel_rgbw(led->led_handle, led->index + i, out[RED], out[GREEN], out[BLUE], out[WHITE]));
+#else
+            ESP_ERROR_CHECK(led_strip_set_pixel(led->led_handle, led->index + i, out[RED], out[GREEN], out[BLUE]));
+#endif
+        }
         // Push the LED color out to the device
+        refresh_span = metrics_begin();
+        trace_record(TRACE_REFRESH_START, 0);
         ESP_ERROR_CHECK(led_strip_refresh(led->led_handle));
-        ESP_LOGI(LED_TAG, "LED On");
+        trace_record(TRACE_REFRESH_END, 0);
+        metrics_end(METRIC_REFRESH, refresh_span);
+        update_preview(led, scale, audio ? band_scales : NULL);
+        RENDER_LOGI("LED On");
     } else {
         // Turns off the LED strip
+        refresh_span = metrics_begin();
+        trace_record(TRACE_REFRESH_START, 0);
         ESP_ERROR_CHECK(led_strip_clear(led->led_handle));
-        ESP_LOGI(LED_TAG, "LED Off");
+        trace_record(TRACE_REFRESH_END, 0);
+        metrics_end(METRIC_REFRESH, refresh_span);
+        metrics_set_gauge(METRIC_GAUGE_POWER_ESTIMATED, led->power.idle_ma);
+        metrics_set_gauge(METRIC_GAUGE_POWER_OUTPUT, led->power.idle_ma);
+        update_preview(led, 0, NULL);
+        RENDER_LOGI("LED Off");
+    }
+    trace_record(TRACE_RENDER_END, led->length);
+    metrics_end(METRIC_FRAME, frame_span);
+}
+
+// Every frame goes through here, so a batch holds each of them until its commit
+static void activate_light(led_t* led)
+{
+    if (led->batching) {
+        led->pending_light = true;
+        return;
     }
+    frame_due = true;
+}
+
+static int64_t effect_now()
+{
+    return __atomic_load_n(&time_base, __ATOMIC_ACQUIRE)->now();
+}
+
+// Restarts a one-shot timer to fire when the effect clock reaches at
+static void start_at(esp_timer_handle_t timer, int64_t at)
+{
+    int64_t wait = __atomic_load_n(&time_base, __ATOMIC_ACQUIRE)->to_local(at) - esp_timer_get_time();
+    esp_timer_stop(timer);
+    ESP_ERROR_CHECK(esp_timer_start_once(timer, wait > 0 ? wait : 0));
+}
+
+// Period boundary closest to time, so a timer firing slightly early still lands on its own step
+static int64_t nearest_step(int64_t time, int64_t period)
+{
+    return (time + period / 2) / period * period;
+}
+
+// A zero duration has no steps to land on, the shortest blink is a millisecond
+static int64_t blink_period(const led_t* led)
+{
+    return (led->config.blink_duration ? led->config.blink_duration : 1) * (int64_t)MICRO_PER_MILLI;
+}
+
+// Lit on even periods of the effect clock, so every controller on the same clock blinks together
+static void blink_step(led_t* led, int64_t step)
+{
+    int64_t period = blink_period(led);
+    led->lit = step / period % 2 == 0;
+    start_at(blinky_timer, step + period);
+    activate_light(led);
 }
 
 static void activate_blinky(led_t* led)
 {
-    ESP_ERROR_CHECK(
-        esp_timer_start_periodic(
-            blinky_timer,
-            led->config.blink_duration * MICRO_PER_MILLI
-        )
-    );
-    ESP_LOGI(LED_TAG, "Blinking LED with duration %" PRIu32 " ms", led->config.blink_duration);
+    int64_t period = blink_period(led);
+    int64_t now = effect_now();
+    blink_step(led, now - now % period);
+    RENDER_LOGI("Blinking LED with duration %" PRIu32 " ms", led->config.blink_duration);
 }
 
-static void activate_morse()
+static void activate_morse(led_t* led)
 {
-    ESP_ERROR_CHECK(esp_timer_start_once(morse_code_timer, 0));
+    // Nothing to blink until a string is set, stay dark rather than start the timer
+    if (!led->config.morse_code) {
+        RENDER_LOGE("Morse mode without a Morse code string");
+        led->lit = OFF;
+        activate_light(led);
+        return;
+    }
+    // Starts on the next dot boundary and every element is a whole number of dots
+    int64_t period = DOT_MS * MICRO_PER_MILLI;
+    int64_t now = effect_now();
+    morse_next = now - now % period + period;
+    start_at(morse_code_timer, morse_next);
 }
 
 static void blinky_timer_callback(void* arg)
 {
-    led_t* led = (led_t*)arg;
-    set_led_state(led, !led->config.state);
-    activate_light(led);
+    metric_span_t span = metrics_begin();
+    trace_record(TRACE_TIMER_FIRE, METRIC_TIMER_BLINKY);
+    xTaskNotify(render_task, RENDER_EVENT_BLINK, eSetBits);
+    metrics_end(METRIC_TIMER_BLINKY, span);
 }
 
+// Runs in the render task, which pushes the new output right after
 static void morse_blink(morse_iterator_t* iterator, bool state, int milliseconds)
 {
-    set_led_state(iterator->led, state);
-    activate_light(iterator->led);
-    ESP_ERROR_CHECK(
-        esp_timer_start_once(
-            morse_code_timer,
-            milliseconds * MICRO_PER_MILLI
-        )
-    );
+    iterator->led->lit = state;
+    // Elements are timed from the end of the last one rather than from now, unless the time base jumped
+    int64_t now = effect_now();
+    if (llabs(now - morse_next) > DOT_MS * MICRO_PER_MILLI) {
+        morse_next = nearest_step(now, DOT_MS * MICRO_PER_MILLI);
+    }
+    morse_next += milliseconds * MICRO_PER_MILLI;
+    start_at(morse_code_timer, morse_next);
 }
 
 static bool is_gap(char current_char, char next_char)
@@ -122,23 +419,25 @@ static bool is_gap(char current_char, char next_char)
             (next_char == '.' || next_char == '-');
 }
 
-static void morse_code_timer_callback(void* arg)
+static void morse_code_step(morse_iterator_t* iterator)
 {
-    morse_iterator_t* iterator = (morse_iterator_t*)arg;
-
+    if (!iterator->led->config.morse_code) {
+        iterator->led->lit = OFF;
+        iterator->index = 0;
+        return;
+    }
     // Setting gap and str_len at start of morse code string
     if (iterator->index == 0) {
         iterator->gap = false;
         iterator->str_len = strlen(iterator->led->config.morse_code);
-        ESP_LOGI(LED_TAG, "Starting to blink morse code string %s", iterator->led->config.morse_code);
+        RENDER_LOGI("Starting to blink morse code string %s", iterator->led->config.morse_code);
     }
 
     // Stop timer (by not starting again) and reset index and light once end of morse code string reached
     if (iterator->index > iterator->str_len - 1) {
-        set_led_state(iterator->led, OFF);
-        activate_light(iterator->led);
+        iterator->led->lit = OFF;
         iterator->index = 0;
-        ESP_LOGI(LED_TAG, "Finished morse code");
+        RENDER_LOGI("Finished morse code");
         return;
     }
 
@@ -147,7 +446,7 @@ static void morse_code_timer_callback(void* arg)
         morse_blink(iterator, OFF, DOT_DASH_SEP_MS);
         // Reset gap once gap execution finished
         iterator->gap = false;
-        ESP_LOGI(LED_TAG, "Pausing %d ms for gap", DOT_DASH_SEP_MS);
+        RENDER_LOGI("Pausing %d ms for gap", DOT_DASH_SEP_MS);
         return;
     }
 
@@ -155,22 +454,22 @@ static void morse_code_timer_callback(void* arg)
     switch (current_char) {
         case '.':
             morse_blink(iterator, ON, DOT_MS);
-            ESP_LOGI(LED_TAG, "Blinking %d ms for dot", DOT_MS);
+            RENDER_LOGI("Blinking %d ms for dot", DOT_MS);
             break;
         case '-':
             morse_blink(iterator, ON, DASH_MS);
-            ESP_LOGI(LED_TAG, "Blinking %d ms for dash", DASH_MS);
+            RENDER_LOGI("Blinking %d ms for dash", DASH_MS);
             break;
         case ' ':
             morse_blink(iterator, OFF, CHAR_SEP_MS);
-            ESP_LOGI(LED_TAG, "Pausing %d ms before next English character", CHAR_SEP_MS);
+            RENDER_LOGI("Pausing %d ms before next English character", CHAR_SEP_MS);
             break;
         case '/':
             morse_blink(iterator, OFF, WORD_SEP_MS);
-            ESP_LOGI(LED_TAG, "Pausing %d ms before next word", WORD_SEP_MS);
+            RENDER_LOGI("Pausing %d ms before next word", WORD_SEP_MS);
             break;
         default:
-            ESP_LOGE(LED_TAG, "Unknown character in morse code string");
+            RENDER_LOGE("Unknown character in morse code string");
     }
     // Increase index if a character was just read
     iterator->index++;
@@ -183,97 +482,721 @@ static void morse_code_timer_callback(void* arg)
     }
 }
 
-led_t* create_led(uint8_t index)
+static void morse_code_timer_callback(void* arg)
 {
-    led_t* led = malloc(sizeof(led_t));
-    if (!led) return NULL;
-    led->led_handle = led_handle;
-    led->index = index;
-    led->config = config;
-    return led;
+    metric_span_t span = metrics_begin();
+    trace_record(TRACE_TIMER_FIRE, METRIC_TIMER_MORSE);
+    xTaskNotify(render_task, RENDER_EVENT_MORSE, eSetBits);
+    metrics_end(METRIC_TIMER_MORSE, span);
 }
 
-esp_err_t destroy_led(led_t* led)
+static void text_timer_callback(void* arg)
 {
-    if (!led) return ESP_FAIL;
-    if (led->config.morse_code) {
-        free(led->config.morse_code);
+    metric_span_t span = metrics_begin();
+    trace_record(TRACE_TIMER_FIRE, METRIC_TIMER_TEXT);
+    xTaskNotify(render_task, RENDER_EVENT_TEXT, eSetBits);
+    metrics_end(METRIC_TIMER_TEXT, span);
+}
+
+// Pixels under scrolling text show the text, their output is recomputed once it stops
+static bool shows_text(const led_t* led, uint16_t pixel)
+{
+    return pixel >= led->text.first && pixel < led->text.end;
+}
+
+// Runs in the render task. Only the new column is rendered, the rest of the zone shifts, so the
+// work besides one memmove per row is O(rows)
+static void text_step(led_t* led)
+{
+    led_text_t* text = &led->text;
+    const zone_t* zone = text->zone;
+    uint16_t rows = zone->length / zone->width;
+    // Text is centered vertically, rows above it wrap to large values and stay background
+    uint16_t top = rows > FONT_HEIGHT ? (rows - FONT_HEIGHT) / 2 : 0;
+    uint8_t bits = text_scroller_next_column(&text->scroller);
+
+    for (uint16_t row = 0; row < rows; row++) {
+        uint16_t font_row = row - top;
+        const uint8_t* color = text->colors[font_row < FONT_HEIGHT && (bits >> font_row & 1)];
+        // The power estimate loses the column leaving on the left and gains the new one
+        power_limit_update(&led->power, led->output[zone->start + row * zone->width], color);
+        memcpy(text->column[row], color, 4);
     }
-    free(led);
-    return ESP_OK;
+    matrix_t matrix = { .pixels = &led->output[zone->start], .width = zone->width, .height = rows };
+    matrix_shift_in_column(&matrix, text->column);
 }
 
-void set_led_mode(led_t* led, led_mode_t mode)
+// Runs in the render task for every block, in any mode, so a flash is already fading in step with the
+// music when audio mode starts
+static void audio_step(led_t* led, const audio_features_t* features)
 {
+    if (features->beat) {
+        led->audio_flash = UINT8_MAX;
+    } else {
+        led->audio_flash -= (led->audio_flash + (1 << AUDIO_FLASH_DECAY_SHIFT) - 1) >> AUDIO_FLASH_DECAY_SHIFT;
+    }
+    for (uint8_t band = 0; band < AUDIO_BANDS; band++) {
+        led->audio_gains[band] = features->bands[band] > led->audio_flash ? features->bands[band] : led->audio_flash;
+    }
+}
+
+// The apply_* functions run in the render task, one per led_command_type_t
+static void apply_mode(led_t* led, led_mode_t mode)
+{
+    led->config.mode = mode;
+    notify_change(led, LED_CHANGE_MODE, 0, 0);
+    if (led->batching) {
+        led->pending_mode = true;
+        return;
+    }
+
     // Returns ESP_ERR_INVALID_STATE if timer is not running
     // It won't always be running, but this doesn't seem to cause issues/stop execution
     esp_timer_stop(blinky_timer);
     esp_timer_stop(morse_code_timer);
+    // Drop ticks the stopped timers already posted
+    ulTaskNotifyValueClear(NULL, RENDER_EVENT_BLINK | RENDER_EVENT_MORSE);
 
-    led->config.mode = mode;
     switch (mode) {
         case LED_MODE_LIGHT:
+            led->lit = led->config.state;
             activate_light(led);
             break;
         case LED_MODE_BLINKY:
             activate_blinky(led);
             break;
         case LED_MODE_MORSE:
-            activate_morse();
+            activate_morse(led);
+            break;
+        case LED_MODE_AUDIO:
+            // Dark until the next block of audio is drawn
+            memset(led->audio_gains, 0, sizeof(led->audio_gains));
+            led->lit = ON;
+            activate_light(led);
             break;
         default:
-            ESP_LOGE(LED_TAG, "Unknown LED mode");
+            RENDER_LOGE("Unknown LED mode");
     }
 }
 
-void set_led_state(led_t* led, bool state)
+static void apply_morse_code(led_t* led, char* morse_code)
 {
-    led->config.state = state;
+    portENTER_CRITICAL(&led_lock);
+    char* old_morse_code = led->config.morse_code;
+    led->config.morse_code = morse_code;
+    portEXIT_CRITICAL(&led_lock);
+    // Free old morse_code string if it exists, no reader can still hold it
+    free(old_morse_code);
+    notify_change(led, LED_CHANGE_MORSE, 0, 0);
 }
 
-void set_led_blink_duration(led_t* led, uint32_t blink_duration)
+static void apply_pixel_rgbw(led_t* led, bool whole_led, uint16_t start, uint16_t count, const uint8_t rgbw[4])
+{
+    portENTER_CRITICAL(&led_lock);
+    if (whole_led) {
+        memcpy(led->config.rgbw, rgbw, 4);
+    }
+    for (uint16_t i = start; i < start + count; i++) {
+        memcpy(led->pixels[i], rgbw, 4);
+    }
+    portEXIT_CRITICAL(&led_lock);
+
+    // Only the changed pixels move the power estimate
+    uint8_t out[4];
+    correct_color(rgbw, out);
+    for (uint16_t i = start; i < start + count; i++) {
+        if (shows_text(led, i)) continue;
+        power_limit_update(&led->power, led->output[i], out);
+        memcpy(led->output[i], out, 4);
+    }
+    notify_change(led, whole_led ? LED_CHANGE_COLOR | LED_CHANGE_PIXELS : LED_CHANGE_PIXELS, start, start + count - 1);
+
+    if (led->lit) {
+        activate_light(led);
+    }
+    RENDER_LOGI("Set pixels %u-%u color to R: %u, G: %u, B: %u, W: %u", start, start + count - 1, rgbw[RED], rgbw[GREEN], rgbw[BLUE], rgbw[WHITE]);
+}
+
+// Recomputes the color-corrected output and its power for pixels written in place
+static void refresh_output(led_t* led, uint16_t start, uint16_t count)
 {
-    led->config.blink_duration = blink_duration;
+    uint8_t rgbw[4];
+    uint8_t out[4];
+    for (uint16_t i = start; i < start + count; i++) {
+        if (shows_text(led, i)) continue;
+        // Only the render task writes pixels, so reading them needs no lock
+        memcpy(rgbw, led->pixels[i], 4);
+        correct_color(rgbw, out);
+        power_limit_update(&led->power, led->output[i], out);
+        memcpy(led->output[i], out, 4);
+    }
 }
 
-void set_led_morse_code(led_t* led, char* morse_code)
+static void apply_matrix(led_t* led, const led_command_t* command)
+{
+    const zone_t* zone = command->matrix.zone;
+    matrix_t matrix = {
+        .pixels = &led->pixels[zone->start],
+        .width = zone->width,
+        .height = zone->length / zone->width
+    };
+    // Blit and fill touch whole rows from the first to the last of the rectangle
+    uint16_t first = zone->start + command->matrix.y * zone->width + command->matrix.x;
+    uint16_t count = (command->matrix.height - 1) * zone->width + command->matrix.width;
+
+    portENTER_CRITICAL(&led_lock);
+    switch (command->type) {
+        case LED_COMMAND_MATRIX_BLIT:
+            matrix_blit(&matrix, command->matrix.x, command->matrix.y, command->matrix.width, command->matrix.height, command->matrix.bitmap);
+            break;
+        case LED_COMMAND_MATRIX_FILL:
+            matrix_fill_rect(&matrix, command->matrix.x, command->matrix.y, command->matrix.width, command->matrix.height, command->matrix.rgbw);
+            break;
+        default:
+            matrix_scroll(&matrix, command->matrix.dx, command->matrix.dy, command->matrix.rgbw);
+            first = zone->start;
+            count = zone->length;
+            break;
+    }
+    portEXIT_CRITICAL(&led_lock);
+    free(command->matrix.bitmap);
+
+    refresh_output(led, first, count);
+    notify_change(led, LED_CHANGE_PIXELS, first, first + count - 1);
+    if (led->lit) {
+        activate_light(led);
+    }
+}
+
+static void apply_text(led_t* led, const led_command_t* command)
+{
+    led_text_t* text = &led->text;
+    const zone_t* zone = command->text.zone;
+
+    esp_timer_stop(text_timer);
+    ulTaskNotifyValueClear(NULL, RENDER_EVENT_TEXT);
+    free(text->text);
+    free(text->column);
+    text->text = NULL;
+    text->column = NULL;
+    if (text->end) {
+        // Back to the stored pixels
+        uint16_t first = text->first;
+        text->first = text->end = 0;
+        refresh_output(led, first, text->zone->length);
+    }
+
+    if (command->text.text) {
+        text->column = malloc((zone->length / zone->width) * sizeof(text->column[0]));
+        if (!text->column) {
+            RENDER_LOGE("No memory for scrolling text");
+            free(command->text.text);
+        } else {
+            text->text = command->text.text;
+            text->zone = zone;
+            memset(text->colors[0], 0, 4);
+            correct_color(command->text.rgbw, text->colors[1]);
+            // Start from a blank zone with the text entering from the right
+            for (uint16_t i = zone->start; i < zone->start + zone->length; i++) {
+                power_limit_update(&led->power, led->output[i], text->colors[0]);
+                memcpy(led->output[i], text->colors[0], 4);
+            }
+            text->first = zone->start;
+            text->end = zone->start + zone->length;
+            text_scroller_start(&text->scroller, text->text, zone->width);
+            text->column_us = command->text.column_us;
+            int64_t now = effect_now();
+            start_at(text_timer, now - now % text->column_us + text->column_us);
+            RENDER_LOGI("Scrolling \"%s\" on %s", text->text, zone->name);
+        }
+    }
+    if (led->lit) {
+        activate_light(led);
+    }
+}
+
+static void apply_batch_commit(led_t* led)
+{
+    led->batching = false;
+    if (led->pending_mode) {
+        // Restarts timers and pushes the final state in one go
+        apply_mode(led, led->config.mode);
+    } else if (led->pending_light) {
+        activate_light(led);
+    }
+}
+
+static void apply_command(led_command_t* command)
+{
+    led_t* led = command->led;
+
+    switch (command->type) {
+        case LED_COMMAND_MODE:
+            apply_mode(led, command->mode);
+            break;
+        case LED_COMMAND_STATE:
+            led->config.state = command->state;
+            notify_change(led, LED_CHANGE_STATE, 0, 0);
+            break;
+        case LED_COMMAND_DURATION:
+            led->config.blink_duration = command->blink_duration;
+            notify_change(led, LED_CHANGE_DURATION, 0, 0);
+            break;
+        case LED_COMMAND_MORSE:
+            apply_morse_code(led, command->morse_code);
+            break;
+        case LED_COMMAND_RGBW:
+            apply_pixel_rgbw(led, true, 0, led->length, command->pixels.rgbw);
+            break;
+        case LED_COMMAND_PIXEL_RGBW:
+            apply_pixel_rgbw(led, false, command->pixels.start, command->pixels.count, command->pixels.rgbw);
+            break;
+        case LED_COMMAND_BATCH_BEGIN:
+            led->batching = true;
+            led->pending_light = false;
+            led->pending_mode = false;
+            break;
+        case LED_COMMAND_BATCH_COMMIT:
+            apply_batch_commit(led);
+            break;
+        case LED_COMMAND_MATRIX_BLIT:
+        case LED_COMMAND_MATRIX_FILL:
+        case LED_COMMAND_MATRIX_SCROLL:
+            apply_matrix(led, command);
+            break;
+        case LED_COMMAND_TEXT:
+            apply_text(led, command);
+            break;
+    }
+}
+
+// Called by the setters from any task
+static void post_command(const led_command_t* command)
+{
+    // The render task outranks every producer and drains on each wake, so a full queue clears within a tick
+    while (!mpsc_queue_push(&led_commands, command)) {
+        xTaskNotify(render_task, RENDER_EVENT_COMMAND, eSetBits);
+        vTaskDelay(1);
+    }
+    xTaskNotify(render_task, RENDER_EVENT_COMMAND, eSetBits);
+}
+
+static void led_render_task(void* arg)
+{
+    uint32_t events;
+    led_command_t command;
+
+    for (;;) {
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+        if (events & RENDER_EVENT_COMMAND) {
+            while (mpsc_queue_pop(&led_commands, &command)) {
+                apply_command(&command);
+                if (command.type == LED_COMMAND_MODE || command.type == LED_COMMAND_BATCH_COMMIT) {
+                    // Ticks taken with this wake may belong to a pattern just stopped
+                    events &= ~(RENDER_EVENT_BLINK | RENDER_EVENT_MORSE);
+                }
+            }
+        }
+        if (events & RENDER_EVENT_BLINK) {
+            blink_step(render_led, nearest_step(effect_now(), blink_period(render_led)));
+        }
+        if (events & RENDER_EVENT_MORSE) {
+            morse_code_step(render_iterator);
+            activate_light(render_led);
+        }
+        if (events & RENDER_EVENT_TEXT && render_led->text.text) {
+            uint32_t column_us = render_led->text.column_us;
+            start_at(text_timer, nearest_step(effect_now(), column_us) + column_us);
+            text_step(render_led);
+            // Nothing to push while the LED is dark, the text keeps moving regardless
+            if (render_led->lit) {
+                activate_light(render_led);
+            }
+        }
+        if (events & RENDER_EVENT_AUDIO) {
+            audio_features_t features;
+            bool drawn = false;
+            while (spsc_queue_pop(&audio_features, &features)) {
+                audio_step(render_led, &features);
+                drawn = true;
+            }
+            // Only audio mode shows the features
+            if (drawn && render_led->config.mode == LED_MODE_AUDIO) {
+                activate_light(render_led);
+            }
+        }
+        // Commands within one wake are coalesced into a single refresh
+        if (frame_due) {
+            frame_due = false;
+            render_frame(render_led);
+        }
+    }
+}
+
+led_t* create_led(uint16_t index, uint16_t length)
+{
+    if (length == 0 || index + length > CONFIG_MAX_LEDS) return NULL;
+    led_t* led = calloc(1, sizeof(led_t));
+    if (!led) return NULL;
+    led->pixels = malloc(length * sizeof(led->pixels[0]));
+    led->output = calloc(length, sizeof(led->output[0]));
+    led->remap = malloc(length * sizeof(led->remap[0]));
+    led->preview_length = length < LED_PREVIEW_PIXELS ? length : LED_PREVIEW_PIXELS;
+    led->preview = calloc(led->preview_length, sizeof(led->preview[0]));
+    if (!led->pixels || !led->output || !led->remap || !led->preview) {
+        free(led->pixels);
+        free(led->output);
+        free(led->remap);
+        free(led->preview);
+        free(led);
+        return NULL;
+    }
+    led->led_handle = led_handle;
+    led->index = index;
+    led->length = length;
+    led->config = config;
+    uint16_t channel_ma[COLOR_CHANNELS] = {CONFIG_LED_CURRENT_RED_MA, CONFIG_LED_CURRENT_GREEN_MA, CONFIG_LED_CURRENT_BLUE_MA, WHITE_CURRENT_MA};
+    power_limit_init(&led->power, channel_ma, length * CONFIG_LED_IDLE_CURRENT_UA / 1000, CONFIG_LED_POWER_LIMIT_MA);
+    uint8_t out[4];
+    correct_color(config.rgbw, out);
+    for (uint16_t i = 0; i < length; i++) {
+        memcpy(led->pixels[i], config.rgbw, 4);
+        power_limit_update(&led->power, led->output[i], out);
+        memcpy(led->output[i], out, 4);
+    }
+    if (zone_table_parse(CONFIG_LED_ZONES, length, &led->zones) != ESP_OK) {
+        ESP_LOGE(LED_TAG, "Invalid zone list \"%s\", using no zones", CONFIG_LED_ZONES);
+        led->zones.count = 0;
+    }
+    zone_table_compile(&led->zones, length, led->remap);
+    return led;
+}
+
+esp_err_t destroy_led(led_t* led)
 {
-    // Free old morse_code string if it exists
+    if (!led) return ESP_FAIL;
     if (led->config.morse_code) {
         free(led->config.morse_code);
     }
-    led->config.morse_code = morse_code;
+    free(led->text.text);
+    free(led->text.column);
+    free(led->pixels);
+    free(led->output);
+    free(led->remap);
+    free(led->preview);
+    free(led);
+    return ESP_OK;
+}
+
+void set_led_mode(led_t* led, led_mode_t mode)
+{
+    led_command_t command = { .type = LED_COMMAND_MODE, .led = led, .mode = mode };
+    post_command(&command);
+}
+
+void set_led_state(led_t* led, bool state)
+{
+    led_command_t command = { .type = LED_COMMAND_STATE, .led = led, .state = state };
+    post_command(&command);
+}
+
+void set_led_blink_duration(led_t* led, uint32_t blink_duration)
+{
+    led_command_t command = { .type = LED_COMMAND_DURATION, .led = led, .blink_duration = blink_duration };
+    post_command(&command);
+}
+
+void set_led_morse_code(led_t* led, char* morse_code)
+{
+    led_command_t command = { .type = LED_COMMAND_MORSE, .led = led, .morse_code = morse_code };
+    post_command(&command);
 }
 
 void set_led_rgb(led_t* led, uint8_t red, uint8_t green, uint8_t blue)
 {
-    uint8_t rgb_array[3] = {red, green, blue};
-    memcpy(led->config.rgb, rgb_array, 3);
+    set_led_rgbw(led, red, green, blue, 0);
+}
 
-    if (led->config.state == ON) {
-        activate_light(led);
+void set_led_rgbw(led_t* led, uint8_t red, uint8_t green, uint8_t blue, uint8_t white)
+{
+    led_command_t command = { .type = LED_COMMAND_RGBW, .led = led, .pixels.rgbw = {red, green, blue, white} };
+    post_command(&command);
+}
+
+esp_err_t set_led_pixel_rgb(led_t* led, uint16_t start, uint16_t count, uint8_t red, uint8_t green, uint8_t blue)
+{
+    return set_led_pixel_rgbw(led, start, count, red, green, blue, 0);
+}
+
+esp_err_t set_led_pixel_rgbw(led_t* led, uint16_t start, uint16_t count, uint8_t red, uint8_t green, uint8_t blue, uint8_t white)
+{
+    // The length never changes after create_led, so the range can be checked before queueing
+    if (count == 0 || start >= led->length || count > led->length - start) {
+        ESP_LOGE(LED_TAG, "Pixel range %u+%u outside of %u pixels", start, count, led->length);
+        return ESP_ERR_INVALID_ARG;
     }
-    ESP_LOGI(LED_TAG, "Set LED color to R: %u, G: %u, B: %u", red, green, blue);
+
+    led_command_t command = {
+        .type = LED_COMMAND_PIXEL_RGBW,
+        .led = led,
+        .pixels = { .start = start, .count = count, .rgbw = {red, green, blue, white} }
+    };
+    post_command(&command);
+    return ESP_OK;
+}
+
+uint16_t get_led_length(const led_t* led)
+{
+    return led->length;
+}
+
+uint32_t get_led_version(const led_t* led)
+{
+    return __atomic_load_n(&led->version, __ATOMIC_RELAXED);
+}
+
+void get_led_status(const led_t* led, led_status_t* status)
+{
+    portENTER_CRITICAL(&led_lock);
+    status->mode = led->config.mode;
+    status->state = led->config.state;
+    status->blink_duration = led->config.blink_duration;
+    status->has_morse_code = led->config.morse_code != NULL;
+    if (status->has_morse_code) {
+        strlcpy(status->morse_code, led->config.morse_code, sizeof(status->morse_code));
+    } else {
+        status->morse_code[0] = '\0';
+    }
+    memcpy(status->rgb, led->config.rgbw, 3);
+    status->white = led->config.rgbw[WHITE];
+    status->length = led->length;
+    status->version = led->version;
+    portEXIT_CRITICAL(&led_lock);
+}
+
+esp_err_t get_led_pixel_rgb(const led_t* led, uint16_t pixel, uint8_t rgb[3])
+{
+    if (pixel >= led->length) return ESP_ERR_INVALID_ARG;
+    portENTER_CRITICAL(&led_lock);
+    memcpy(rgb, led->pixels[pixel], 3);
+    portEXIT_CRITICAL(&led_lock);
+    return ESP_OK;
+}
+
+esp_err_t get_led_pixel_rgbw(const led_t* led, uint16_t pixel, uint8_t rgbw[4])
+{
+    if (pixel >= led->length) return ESP_ERR_INVALID_ARG;
+    portENTER_CRITICAL(&led_lock);
+    memcpy(rgbw, led->pixels[pixel], 4);
+    portEXIT_CRITICAL(&led_lock);
+    return ESP_OK;
+}
+
+esp_err_t get_led_pixels_rgbw(const led_t* led, uint16_t start, uint16_t count, uint8_t (*rgbw)[4], uint32_t* version)
+{
+    if (start >= led->length || count > led->length - start) return ESP_ERR_INVALID_ARG;
+    portENTER_CRITICAL(&led_lock);
+    memcpy(rgbw, led->pixels[start], count * sizeof(rgbw[0]));
+    *version = led->version;
+    portEXIT_CRITICAL(&led_lock);
+    return ESP_OK;
+}
+
+uint32_t get_led_preview(const led_t* led, uint8_t (*preview)[3], uint16_t* count)
+{
+    portENTER_CRITICAL(&led_lock);
+    memcpy(preview, led->preview, led->preview_length * sizeof(led->preview[0]));
+    *count = led->preview_length;
+    uint32_t frame = led->preview_frame;
+    portEXIT_CRITICAL(&led_lock);
+    return frame;
+}
+
+// A matrix zone and, for blit and fill, a rectangle inside it
+static bool matrix_rect_valid(const zone_t* zone, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    if (zone->layout != ZONE_LAYOUT_MATRIX && zone->layout != ZONE_LAYOUT_SERPENTINE) {
+        ESP_LOGE(LED_TAG, "Zone %s is not a matrix", zone->name);
+        return false;
+    }
+    uint16_t rows = zone->length / zone->width;
+    if (width == 0 || height == 0 || x >= zone->width || width > zone->width - x || y >= rows || height > rows - y) {
+        ESP_LOGE(LED_TAG, "Rectangle %ux%u at %u,%u outside of %s", width, height, x, y, zone->name);
+        return false;
+    }
+    return true;
+}
+
+esp_err_t led_matrix_blit(led_t* led, const zone_t* zone, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t (*bitmap)[4])
+{
+    if (!matrix_rect_valid(zone, x, y, width, height)) {
+        free(bitmap);
+        return ESP_ERR_INVALID_ARG;
+    }
+    led_command_t command = {
+        .type = LED_COMMAND_MATRIX_BLIT,
+        .led = led,
+        .matrix = { .zone = zone, .x = x, .y = y, .width = width, .height = height, .bitmap = bitmap }
+    };
+    post_command(&command);
+    return ESP_OK;
+}
+
+esp_err_t led_matrix_fill_rect(led_t* led, const zone_t* zone, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t rgbw[4])
+{
+    if (!matrix_rect_valid(zone, x, y, width, height)) return ESP_ERR_INVALID_ARG;
+    led_command_t command = {
+        .type = LED_COMMAND_MATRIX_FILL,
+        .led = led,
+        .matrix = { .zone = zone, .x = x, .y = y, .width = width, .height = height }
+    };
+    memcpy(command.matrix.rgbw, rgbw, 4);
+    post_command(&command);
+    return ESP_OK;
+}
+
+esp_err_t led_matrix_scroll(led_t* led, const zone_t* zone, int16_t dx, int16_t dy, const uint8_t fill[4])
+{
+    if (!matrix_rect_valid(zone, 0, 0, zone->width, zone->length / zone->width)) return ESP_ERR_INVALID_ARG;
+    led_command_t command = {
+        .type = LED_COMMAND_MATRIX_SCROLL,
+        .led = led,
+        .matrix = { .zone = zone, .dx = dx, .dy = dy }
+    };
+    memcpy(command.matrix.rgbw, fill, 4);
+    post_command(&command);
+    return ESP_OK;
+}
+
+esp_err_t set_led_text(led_t* led, const zone_t* zone, char* text, uint16_t speed, const uint8_t rgbw[4])
+{
+    if (text && (!zone || !matrix_rect_valid(zone, 0, 0, zone->width, zone->length / zone->width) ||
+                 speed == 0 || strlen(text) > LED_TEXT_MAX_LEN)) {
+        free(text);
+        return ESP_ERR_INVALID_ARG;
+    }
+    led_command_t command = {
+        .type = LED_COMMAND_TEXT,
+        .led = led,
+        .text = { .zone = zone, .text = text, .column_us = text ? MICRO_PER_SECOND / speed : 0 }
+    };
+    if (rgbw) {
+        memcpy(command.text.rgbw, rgbw, 4);
+    }
+    post_command(&command);
+    return ESP_OK;
+}
+
+const zone_t* get_led_zone(const led_t* led, const char* name)
+{
+    return zone_table_find(&led->zones, name);
+}
+
+uint8_t get_led_zones(const led_t* led, const zone_t** zones)
+{
+    *zones = led->zones.zones;
+    return led->zones.count;
+}
+
+void led_audio_push(const audio_features_t* features)
+{
+    if (spsc_queue_push(&audio_features, features)) {
+        xTaskNotify(render_task, RENDER_EVENT_AUDIO, eSetBits);
+    }
+}
+
+void set_led_change_callback(led_t* led, led_change_cb_t on_change)
+{
+    led->on_change = on_change;
+}
+
+void led_set_time_base(const led_time_base_t* base)
+{
+    __atomic_store_n(&time_base, base ? base : &local_time_base, __ATOMIC_RELEASE);
+}
+
+void led_batch_begin(led_t* led)
+{
+    led_command_t command = { .type = LED_COMMAND_BATCH_BEGIN, .led = led };
+    post_command(&command);
+}
+
+void led_batch_commit(led_t* led)
+{
+    led_command_t command = { .type = LED_COMMAND_BATCH_COMMIT, .led = led };
+    post_command(&command);
 }
 
 void led_timers_init(led_t* led, morse_iterator_t* morse_iterator)
 {
+    render_led = led;
+    render_iterator = morse_iterator;
+    ESP_ERROR_CHECK(mpsc_queue_init(&led_commands, command_buffer, command_sequences, sizeof(led_command_t), COMMAND_QUEUE_LENGTH));
+    ESP_ERROR_CHECK(spsc_queue_init(&audio_features, audio_buffer, sizeof(audio_features_t), AUDIO_QUEUE_LENGTH));
+    // Must exist before anything can post to it
+    if (xTaskCreatePinnedToCore(led_render_task, "led render", RENDER_TASK_STACK_SIZE, NULL, RENDER_TASK_PRIORITY, &render_task, RENDER_TASK_CORE) != pdPASS) {
+        ESP_LOGE(LED_TAG, "Failed to create render task");
+        return;
+    }
+
+    // Callbacks only post to the render task, they don't need the LED
     const esp_timer_create_args_t blinky_timer_args = {
         .callback = blinky_timer_callback,
-        .arg = led,
-        .name = "periodic"
+        .name = "blinky"
     };
     const esp_timer_create_args_t morse_code_timer_args = {
         .callback = morse_code_timer_callback,
-        .arg = morse_iterator,
-        .name = "oneshot"
+        .name = "morse"
+    };
+    const esp_timer_create_args_t text_timer_args = {
+        .callback = text_timer_callback,
+        .name = "text"
     };
     ESP_ERROR_CHECK(esp_timer_create(&blinky_timer_args, &blinky_timer));
     ESP_ERROR_CHECK(esp_timer_create(&morse_code_timer_args, &morse_code_timer));
+    ESP_ERROR_CHECK(esp_timer_create(&text_timer_args, &text_timer));
+}
+
+static void create_strip_task(void* arg)
+{
+#if CONFIG_LED_MULTI_OUTPUT
+    // Several strips refreshed together, each channel limited to its own memory block so all of them fit
+    multi_strip_config_t multi_config = {
+        .max_leds = CONFIG_MAX_LEDS,
+        .resolution_hz = strip_config.resolution_hz,
+        .rgbw = strip_config.rgbw,
+        .mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL
+    };
+    ESP_ERROR_CHECK(multi_strip_parse_gpios(CONFIG_LED_OUTPUT_GPIOS, multi_config.gpios, MULTI_STRIP_MAX_OUTPUTS, &multi_config.output_count));
+    ESP_ERROR_CHECK(multi_strip_new_rmt_device(&multi_config, &led_handle));
+#elif CONFIG_LED_PARALLEL_OUTPUT
+    // 8 or 16 strips clocked out together by the LCD peripheral
+    parallel_strip_config_t parallel_config = {
+        .wr_gpio = CONFIG_LED_PARALLEL_WR_GPIO,
+        .dc_gpio = CONFIG_LED_PARALLEL_DC_GPIO,
+        .max_leds = CONFIG_MAX_LEDS
+    };
+    ESP_ERROR_CHECK(multi_strip_parse_gpios(CONFIG_LED_PARALLEL_GPIOS, parallel_config.data_gpios, PARALLEL_STRIP_MAX_LANES, &parallel_config.lane_count));
+    ESP_ERROR_CHECK(parallel_strip_new_lcd_device(&parallel_config, &led_handle));
+#else
+    // Creating the LED strip based on RMT TX channel, checks for errors. Same backend as the multi-output
+    // mode rather than led_strip_new_rmt_device, so refreshes only send the changed prefix
+    ESP_ERROR_CHECK(multi_strip_new_rmt_device(&strip_config, &led_handle));
+#endif
+    xTaskNotifyGive((TaskHandle_t)arg);
+    vTaskDelete(NULL);
 }
 
 void led_manager_init()
 {
-    // Creating the LED strip based on RMT TX channel, checks for errors
-    ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_handle));
+    uint8_t balance[COLOR_CHANNELS] = {CONFIG_LED_BALANCE_RED, CONFIG_LED_BALANCE_GREEN, CONFIG_LED_BALANCE_BLUE, WHITE_BALANCE};
+    color_correct_init(&color_tables, CONFIG_LED_WHITE_TEMPERATURE, balance);
+
+    // The RMT interrupt is installed on the core that creates the channel, so transmit
+    // completion is handled next to the render task instead of competing with Wi-Fi
+    if (xTaskCreatePinnedToCore(create_strip_task, "led strip init", RENDER_TASK_STACK_SIZE, xTaskGetCurrentTaskHandle(), RENDER_TASK_PRIORITY, NULL, RENDER_TASK_CORE) != pdPASS) {
+        ESP_LOGE(LED_TAG, "Failed to create LED strip init task");
+        return;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 }
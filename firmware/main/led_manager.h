@@ -3,19 +3,70 @@
 
 #include <string.h>
 #include "esp_err.h"
+#include "esp_bit_defs.h"
 #include "esp_log.h"
 #include "led_strip.h"
 #include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "metrics.h"
+#include "trace.h"
+#include "mpsc_queue.h"
+#include "multi_strip.h"
+#include "parallel_strip.h"
+#include "color_correct.h"
+#include "power_limit.h"
+#include "zone_map.h"
+#include "matrix.h"
+#include "text_scroller.h"
+#include "spsc_queue.h"
+#include "audio_analysis.h"
 
 #define ON true
 #define OFF false
+#define LED_MORSE_CODE_MAX_LEN 255 // morse_iterator_t indexes the string with a uint8_t
+#define LED_TEXT_MAX_LEN 255
+#define LED_PREVIEW_PIXELS 256      // Longer LEDs are downsampled for get_led_preview
 
 typedef enum {
     LED_MODE_LIGHT,
     LED_MODE_BLINKY,
-    LED_MODE_MORSE
+    LED_MODE_MORSE,
+    LED_MODE_AUDIO
 } led_mode_t;
 
+/**
+ * @brief   Bits passed to an led_change_cb_t describing what a setter changed
+ */
+typedef enum {
+    LED_CHANGE_MODE = BIT0,
+    LED_CHANGE_STATE = BIT1,
+    LED_CHANGE_DURATION = BIT2,
+    LED_CHANGE_MORSE = BIT3,
+    LED_CHANGE_COLOR = BIT4,     //!< Whole-LED color from set_led_rgb or set_led_rgbw
+    LED_CHANGE_PIXELS = BIT5     //!< Pixel colors, first_pixel to last_pixel inclusive
+} led_change_t;
+
+/**
+ * @brief   Called after every setter's change is stored
+ * 
+ * @note Runs in the render task, which applies all setters, and must stay short, e.g. record the change and wake a worker
+ * 
+ * @param version: New LED version
+ * @param changed: Bitmask of led_change_t
+ * @param first_pixel: First changed pixel, only meaningful with LED_CHANGE_PIXELS
+ * @param last_pixel: Last changed pixel, only meaningful with LED_CHANGE_PIXELS
+ */
+typedef void (*led_change_cb_t)(uint32_t version, uint32_t changed, uint16_t first_pixel, uint16_t last_pixel);
+
+/**
+ * @brief   Clock the timed effects run on, converted to the local esp_timer clock to arm their timers
+ */
+typedef struct {
+    int64_t (*now)(void);               //!< Effect time now, in microseconds
+    int64_t (*to_local)(int64_t time);  //!< esp_timer time at which the effect clock reaches time
+} led_time_base_t;
+
 /**
  * @brief   LED pixel struct handling mode, state, blink duration, Morse code, and color, along with additional necessary ESP features
  */
@@ -32,15 +83,34 @@ typedef struct {
 } morse_iterator_t;
 
 /**
- * @brief   Allocates memory for a new led_t object
+ * @brief   Snapshot of an LED's configuration, filled by get_led_status
+ */
+typedef struct {
+    led_mode_t mode;            //!< Current mode
+    bool state;                 //!< State set by set_led_state (Light mode on/off), not the momentary blink output
+    uint32_t blink_duration;    //!< Blink duration in milliseconds
+    bool has_morse_code;        //!< False until a Morse code string is set
+    char morse_code[LED_MORSE_CODE_MAX_LEN + 1];    //!< Copy of the Morse code string, empty without one
+    uint8_t rgb[3];             //!< Color last set for the whole LED by set_led_rgb or set_led_rgbw
+    uint8_t white;              //!< Explicit white last set for the whole LED, 0 after set_led_rgb
+    uint16_t length;            //!< Number of pixels
+    uint32_t version;           //!< Same as get_led_version
+} led_status_t;
+
+/**
+ * @brief   Allocates memory for a new led_t object covering a run of pixels that share mode and state
+ * 
+ * @param index: The index of the first LED pixel within an led strip. If using a single LED like a DevKit onboard LED, set index to 0
+ * 
+ * @param length: Number of pixels, index + length must not exceed CONFIG_MAX_LEDS. Use 1 for a single LED
  * 
- * @param index: The index of the LED pixel within an led strip, used in configuring the pixel. If using a single LED like a DevKit onboard LED, set index to 0
+ * @note Frames are dimmed as a whole whenever the LED's estimated current exceeds CONFIG_LED_POWER_LIMIT_MA
  * 
  * @return
  *      - A pointer to an led_t instance
- *      - NULL: If memory allocation fails
+ *      - NULL: If memory allocation fails or the pixel range is invalid
  */
-led_t* create_led(uint8_t index);
+led_t* create_led(uint16_t index, uint16_t length);
 
 /**
  * @brief   Frees the memory of an led_t instance
@@ -58,6 +128,9 @@ esp_err_t destroy_led(led_t* led);
  * 
  * @note If an invalid mode is passed, an error is logged, and no action is taken.
  * 
+ * @note Like every setter, this queues the change for the render task and returns without waiting. Setters
+ *       may be called from any task and are applied in the order they were queued
+ * 
  * @param led: LED pixel
  * @param mode: Mode to begin (enum)
  *          - LED_MODE_LIGHT: Sets the LED to either on or off depending on what's set by set_led_state. Off by default
@@ -65,6 +138,9 @@ esp_err_t destroy_led(led_t* led);
  *          - LED_MODE_MORSE: Blinks out some pattern based on a Morse code string set by set_led_morse_code
  *                  Note: When indicating spaces between English words in Morse code, use a forward slash (/) with no spaces on either side
  *                  Example: "hi bob" translates to ".... ../-... --- -..."
+ *          - LED_MODE_AUDIO: Lights the LED from the features given to led_audio_push. The pixels are split into
+ *                  AUDIO_BANDS runs along the strip, lowest band first, each dimmed to its band's loudness, and
+ *                  the whole LED flashes to full on every beat. Dark until audio arrives
  */
 void set_led_mode(led_t* led, led_mode_t mode);
 
@@ -96,12 +172,12 @@ void set_led_blink_duration(led_t* led, uint32_t duration);
  * @note Frees the old Morse code string if it exists before storing the new one
  * 
  * @param led: LED pixel
- * @param morse_code: String to be stored in preparation to blink
+ * @param morse_code: Heap string of at most LED_MORSE_CODE_MAX_LEN characters to be stored in preparation to blink, ownership passes to the LED
  */
 void set_led_morse_code(led_t* led, char* morse_code);
 
 /**
- * @brief   Sets the LED pixel color
+ * @brief   Sets the color of every pixel in the LED
  * 
  * @note After changing the internal data stored in led, if the LED hardware is on, this function resets it to ON with the new color (effectively pushing the change to the hardware)
  * 
@@ -113,16 +189,309 @@ void set_led_morse_code(led_t* led, char* morse_code);
 void set_led_rgb(led_t* led, uint8_t red, uint8_t green, uint8_t blue);
 
 /**
- * @brief   Prepares 2 timers for the Blinky and Morse Code modes
+ * @brief   Sets the color and explicit white of every pixel in the LED
+ * 
+ * @note With CONFIG_LED_RGBW, the white part of red, green and blue is moved onto the white LED when the
+ *       frame is sent and white is added on top. On RGB strips white is mixed from red, green and blue at
+ *       CONFIG_LED_WHITE_TEMPERATURE. Pushes the change to the hardware if the LED is on, just like set_led_rgb
+ * 
+ * @param led: LED pixel
+ * @param red: Red part of color
+ * @param green: Green part of color
+ * @param blue: Blue part of color
+ * @param white: White added to the color
+ */
+void set_led_rgbw(led_t* led, uint8_t red, uint8_t green, uint8_t blue, uint8_t white);
+
+/**
+ * @brief   Sets the color of a range of pixels within the LED
+ * 
+ * @note Pushes the change to the hardware if the LED is on, just like set_led_rgb
+ * 
+ * @param led: LED pixel
+ * @param start: First pixel, relative to the LED's index
+ * @param count: Number of pixels to set
+ * @param red: Red part of color
+ * @param green: Green part of color
+ * @param blue: Blue part of color
+ * 
+ * @return
+ *      - ESP_OK: Pixels updated
+ *      - ESP_ERR_INVALID_ARG: If the range is empty or exceeds the LED's length
+ */
+esp_err_t set_led_pixel_rgb(led_t* led, uint16_t start, uint16_t count, uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * @brief   Sets the color and explicit white of a range of pixels within the LED, see set_led_rgbw
+ * 
+ * @param led: LED pixel
+ * @param start: First pixel, relative to the LED's index
+ * @param count: Number of pixels to set
+ * @param red: Red part of color
+ * @param green: Green part of color
+ * @param blue: Blue part of color
+ * @param white: White added to the color
+ * 
+ * @return
+ *      - ESP_OK: Pixels updated
+ *      - ESP_ERR_INVALID_ARG: If the range is empty or exceeds the LED's length
+ */
+esp_err_t set_led_pixel_rgbw(led_t* led, uint16_t start, uint16_t count, uint8_t red, uint8_t green, uint8_t blue, uint8_t white);
+
+/**
+ * @brief   Gets the number of pixels covered by the LED
+ * 
+ * @param led: LED pixel
+ * 
+ * @return Length passed to create_led
+ */
+uint16_t get_led_length(const led_t* led);
+
+/**
+ * @brief   Gets the LED's state version, which every setter increments
+ * 
+ * @note Blink and Morse code output toggling is not a state change and leaves the version alone. Setters are
+ *       applied by the render task, so the version moves shortly after a setter returns rather than during it
+ * 
+ * @param led: LED pixel
+ * 
+ * @return Current version, equal versions mean nothing observable through get_led_status or get_led_pixel_rgb changed
+ */
+uint32_t get_led_version(const led_t* led);
+
+/**
+ * @brief   Copies the LED's configuration into status
+ * 
+ * @note Safe from any task, the copy is taken under the same lock the render task writes with
+ * 
+ * @param led: LED pixel
+ * @param status: Filled with the current configuration
+ */
+void get_led_status(const led_t* led, led_status_t* status);
+
+/**
+ * @brief   Gets the color stored for one pixel
+ * 
+ * @param led: LED pixel
+ * @param pixel: Pixel, relative to the LED's index
+ * @param rgb: Filled with red, green and blue
+ * 
+ * @return
+ *      - ESP_OK: rgb filled
+ *      - ESP_ERR_INVALID_ARG: If pixel is outside the LED
+ */
+esp_err_t get_led_pixel_rgb(const led_t* led, uint16_t pixel, uint8_t rgb[3]);
+
+/**
+ * @brief   Gets the color and explicit white stored for one pixel
+ * 
+ * @note This is the color as set, before white extraction and balance
+ * 
+ * @param led: LED pixel
+ * @param pixel: Pixel, relative to the LED's index
+ * @param rgbw: Filled with red, green, blue and white
+ * 
+ * @return
+ *      - ESP_OK: rgbw filled
+ *      - ESP_ERR_INVALID_ARG: If pixel is outside the LED
+ */
+esp_err_t get_led_pixel_rgbw(const led_t* led, uint16_t pixel, uint8_t rgbw[4]);
+
+/**
+ * @brief   Copies a range of stored pixels and the version they belong to in one snapshot
+ * 
+ * @note Taken under a single hold of the lock the render task writes with, so the pixels are all from one
+ *       version, unlike a loop over get_led_pixel_rgbw. This is the color as set, before white extraction and balance
+ * 
+ * @param led: LED pixel
+ * @param start: First pixel, relative to the LED's index
+ * @param count: Pixels to copy
+ * @param rgbw: Filled with red, green, blue and white of each pixel, room for count
+ * @param version: Set to the version of the copied pixels, as get_led_version would have returned
+ * 
+ * @return
+ *      - ESP_OK: rgbw and version filled
+ *      - ESP_ERR_INVALID_ARG: If the range is not inside the LED
+ */
+esp_err_t get_led_pixels_rgbw(const led_t* led, uint16_t start, uint16_t count, uint8_t (*rgbw)[4], uint32_t* version);
+
+/**
+ * @brief   Gets the last rendered frame as it is shown, downsampled to at most LED_PREVIEW_PIXELS
+ * 
+ * @note Pixels are in logical order, so matrix zones read row by row. The colors are the output after
+ *       white balance, the power limit and audio levels, with the white channel added back into red,
+ *       green and blue; all black while the LED is dark. Longer LEDs keep every length / count-th pixel
+ * 
+ * @param led: LED pixel
+ * @param preview: Filled with red, green and blue of each preview pixel, room for LED_PREVIEW_PIXELS
+ * @param count: Set to the number of preview pixels, the smaller of the LED's length and LED_PREVIEW_PIXELS
+ * 
+ * @return Frame number, incremented by every rendered frame, so equal numbers mean an unchanged preview
+ */
+uint32_t get_led_preview(const led_t* led, uint8_t (*preview)[3], uint16_t* count);
+
+/**
+ * @brief   Scrolls text right to left across a matrix zone, one font column per step, looping with a gap
+ *          the width of the zone. Replaces any text already scrolling, only one zone shows text at a time
+ * 
+ * @note The text is drawn into the zone's output only: the stored pixels, the version and get_led_pixel_rgbw
+ *       are unaffected, and the zone shows its stored pixels again once the text stops. It keeps scrolling
+ *       while the LED is off and is shown whenever the LED is lit
+ * 
+ * @param led: LED pixel
+ * @param zone: Matrix or serpentine zone from get_led_zone, ignored when stopping
+ * @param text: Heap string of at most LED_TEXT_MAX_LEN printable ASCII characters, ownership passes to the
+ *              LED, also on error. NULL stops the text
+ * @param speed: Columns per second
+ * @param rgbw: Text color, on a dark background. Ignored when stopping
+ * 
+ * @return
+ *      - ESP_OK: Text queued
+ *      - ESP_ERR_INVALID_ARG: If the zone isn't a matrix, speed is 0 or the text is too long
+ */
+esp_err_t set_led_text(led_t* led, const zone_t* zone, char* text, uint16_t speed, const uint8_t rgbw[4]);
+
+/**
+ * @brief   Looks up one of the zones from CONFIG_LED_ZONES
+ * 
+ * @note Pixels are stored in zone order: zone pixel i is pixel zone->start + i for every setter and getter,
+ *       and the zone's wiring (reversed, serpentine) is applied when the frame is sent. Zones never change
+ *       after create_led, so this is safe from any task
+ * 
+ * @param led: LED pixel
+ * @param name: Zone name
+ * 
+ * @return The zone, or NULL if there is none with that name
+ */
+const zone_t* get_led_zone(const led_t* led, const char* name);
+
+/**
+ * @brief   Gets every zone from CONFIG_LED_ZONES
+ * 
+ * @param led: LED pixel
+ * @param zones: Set to the LED's zones, valid as long as the LED
+ * 
+ * @return Number of zones
+ */
+uint8_t get_led_zones(const led_t* led, const zone_t** zones);
+
+/**
+ * @brief   Copies a bitmap into a rectangle of a matrix zone, row by row
+ * 
+ * @note Matrix zones are addressed row-major whatever their wiring, see get_led_zone. Pushes the change
+ *       to the hardware if the LED is on, just like set_led_rgb
+ * 
+ * @param led: LED pixel
+ * @param zone: Matrix or serpentine zone from get_led_zone
+ * @param x: Left column
+ * @param y: Top row
+ * @param width: Bitmap width
+ * @param height: Bitmap height
+ * @param bitmap: Heap array of width * height RGBW pixels, row-major. Ownership passes to the LED, also on error
+ * 
+ * @return
+ *      - ESP_OK: Blit queued
+ *      - ESP_ERR_INVALID_ARG: If the zone isn't a matrix or the rectangle doesn't fit in it
+ */
+esp_err_t led_matrix_blit(led_t* led, const zone_t* zone, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint8_t (*bitmap)[4]);
+
+/**
+ * @brief   Sets a rectangle of a matrix zone to one color
+ * 
+ * @param led: LED pixel
+ * @param zone: Matrix or serpentine zone from get_led_zone
+ * @param x: Left column
+ * @param y: Top row
+ * @param width: Rectangle width
+ * @param height: Rectangle height
+ * @param rgbw: Red, green, blue and white
+ * 
+ * @return
+ *      - ESP_OK: Fill queued
+ *      - ESP_ERR_INVALID_ARG: If the zone isn't a matrix or the rectangle doesn't fit in it
+ */
+esp_err_t led_matrix_fill_rect(led_t* led, const zone_t* zone, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t rgbw[4]);
+
+/**
+ * @brief   Moves the contents of a matrix zone, pixels moved off an edge are dropped
+ * 
+ * @param led: LED pixel
+ * @param zone: Matrix or serpentine zone from get_led_zone
+ * @param dx: Columns to move right, negative moves left
+ * @param dy: Rows to move down, negative moves up
+ * @param fill: Red, green, blue and white of the pixels scrolled in
+ * 
+ * @return
+ *      - ESP_OK: Scroll queued
+ *      - ESP_ERR_INVALID_ARG: If the zone isn't a matrix
+ */
+esp_err_t led_matrix_scroll(led_t* led, const zone_t* zone, int16_t dx, int16_t dy, const uint8_t fill[4]);
+
+/**
+ * @brief   Hands one block's audio features to the render task, which redraws the LED with them in audio mode
+ * 
+ * @note Only call from one task, normally as the callback of audio_input_init: the features go through a
+ *       single-producer queue. Never blocks, features are dropped while the render task is behind. Not a
+ *       state change, so the version stays the same
+ * 
+ * @param features: Features of the latest block
+ */
+void led_audio_push(const audio_features_t* features);
+
+/**
+ * @brief   Registers the callback invoked on every change, replacing any previous one
  * 
  * @param led: LED pixel
- * @param morse_iterator: Struct passed to morse_code_timer to control blink pattern
+ * @param on_change: Callback, or NULL to stop notifications
+ */
+void set_led_change_callback(led_t* led, led_change_cb_t on_change);
+
+/**
+ * @brief   Sets the clock Blinky, Morse Code and scrolling text are timed on, replacing the local esp_timer clock
+ * 
+ * @note Effects step on whole periods of the time base (blink duration, Morse dot, text column) rather than
+ *       on free-running timers, so controllers sharing a time base stay in phase however far apart their
+ *       crystals drift, and a jump in the time base only moves the next step. Both functions are called
+ *       from the render task and must stay short
+ * 
+ * @param time_base: Time base, must stay valid, or NULL for the local clock
+ */
+void led_set_time_base(const led_time_base_t* time_base);
+
+/**
+ * @brief   Starts a batch of changes. Until led_batch_commit, setters only update the internal data
+ *          and mode changes are recorded rather than started, so no intermediate state reaches the hardware
+ * 
+ * @param led: LED pixel
+ */
+void led_batch_begin(led_t* led);
+
+/**
+ * @brief   Ends a batch, starting the last mode set in it (if any) or otherwise refreshing the
+ *          hardware once if a change was deferred
+ * 
+ * @param led: LED pixel
+ */
+void led_batch_commit(led_t* led);
+
+/**
+ * @brief   Starts the render task and prepares 2 timers for the Blinky and Morse Code modes
+ * 
+ * @note All strip output happens in the render task, pinned to the last core. The timer callbacks and
+ *       setters only post to it, so neither the esp_timer task nor callers ever wait on a refresh
+ * 
+ * @param led: LED pixel rendered by the task
+ * @param morse_iterator: Struct the render task advances on each morse_code_timer tick to control blink pattern
  */
 void led_timers_init(led_t* led, morse_iterator_t* morse_iterator);
 
 /**
  * @brief   Creates LED strip based on RMT TX channel
  *          Essentially initializes the handle to be used in the led_t struct within http_server
+ * 
+ * @note The channel is created from the render core so its transmit interrupt runs there too. With
+ *       CONFIG_LED_MULTI_OUTPUT, one channel per GPIO in CONFIG_LED_OUTPUT_GPIOS is combined into a single strip.
+ *       With CONFIG_LED_PARALLEL_OUTPUT, the LCD peripheral drives one strip per GPIO in CONFIG_LED_PARALLEL_GPIOS
  */
 void led_manager_init();
 
@@ -0,0 +1,276 @@
+#include "live_channel.h"
+
+#if CONFIG_LED_LIVE
+
+#define LIVE_MAX_PREVIEW_CLIENTS 4
+#define LIVE_PREVIEW_MAX_FPS 20
+#define MICRO_PER_SECOND 1000000
+
+static const char* LIVE_TAG = "live channel";
+
+// A client receiving preview frames, only touched from the httpd task
+typedef struct {
+    httpd_handle_t server;      // NULL while the slot is free
+    int fd;
+    uint32_t interval_us;
+    int64_t last_sent_us;
+    uint32_t frame;             // Preview frame last encoded for the client
+    bool announced;             // Sent at least one message, which tells the client the preview length
+    uint8_t sent[LED_PREVIEW_PIXELS][3];    // Preview as the client holds it, black on subscribe
+} live_client_t;
+
+static led_t* led;
+// httpd runs one handler at a time, so one message and its operations are enough and stay off the task stack
+static uint8_t message[LIVE_MAX_MESSAGE_SIZE];
+static live_op_t ops[LIVE_MAX_OPS];
+static live_client_t clients[LIVE_MAX_PREVIEW_CLIENTS];
+static uint8_t preview[LED_PREVIEW_PIXELS][3];
+static uint8_t frame_message[LIVE_FRAME_HEADER + FRAME_DIFF_MAX_SIZE(LED_PREVIEW_PIXELS)];
+static esp_timer_handle_t preview_timer;
+static httpd_handle_t preview_server;   // Set before the timer first starts, there is only one server
+static bool preview_queued;     // Set by the timer, cleared by the work it queued
+
+static bool valid_mode(uint8_t mode)
+{
+    switch (mode) {
+        case LED_MODE_LIGHT:
+        case LED_MODE_BLINKY:
+            return true;
+#if CONFIG_LED_AUDIO
+        case LED_MODE_AUDIO:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+static bool valid_op(const live_op_t* op, uint16_t length)
+{
+    switch (op->type) {
+        case LIVE_OP_MODE:
+            return valid_mode(op->mode);
+        case LIVE_OP_PIXELS:
+            return op->pixels.count > 0 && op->pixels.start < length && op->pixels.count <= length - op->pixels.start;
+        default:
+            return true;
+    }
+}
+
+static void apply_op(const live_op_t* op)
+{
+    switch (op->type) {
+        case LIVE_OP_STATE:
+            set_led_state(led, op->state);
+            break;
+        case LIVE_OP_MODE:
+            set_led_mode(led, (led_mode_t)op->mode);
+            break;
+        case LIVE_OP_DURATION:
+            set_led_blink_duration(led, op->duration);
+            break;
+        case LIVE_OP_COLOR:
+            set_led_rgbw(led, op->pixels.rgbw[0], op->pixels.rgbw[1], op->pixels.rgbw[2], op->pixels.rgbw[3]);
+            break;
+        case LIVE_OP_PIXELS:
+            set_led_pixel_rgbw(led, op->pixels.start, op->pixels.count,
+                               op->pixels.rgbw[0], op->pixels.rgbw[1], op->pixels.rgbw[2], op->pixels.rgbw[3]);
+            break;
+        case LIVE_OP_PREVIEW:
+            break;
+    }
+}
+
+static bool socket_writable(int fd)
+{
+    fd_set write_fds;
+    FD_ZERO(&write_fds);
+    FD_SET(fd, &write_fds);
+    struct timeval no_wait = {0};
+    return select(fd + 1, NULL, &write_fds, NULL, &no_wait) > 0;
+}
+
+static live_client_t* find_client(int fd)
+{
+    for (int i = 0; i < LIVE_MAX_PREVIEW_CLIENTS; i++) {
+        if (clients[i].server && clients[i].fd == fd) return &clients[i];
+    }
+    return NULL;
+}
+
+static bool any_client()
+{
+    for (int i = 0; i < LIVE_MAX_PREVIEW_CLIENTS; i++) {
+        if (clients[i].server) return true;
+    }
+    return false;
+}
+
+static void remove_client(live_client_t* client)
+{
+    client->server = NULL;
+    if (!any_client()) {
+        esp_timer_stop(preview_timer);
+    }
+}
+
+static void subscribe(httpd_req_t* req, uint8_t fps)
+{
+    int fd = httpd_req_to_sockfd(req);
+    live_client_t* client = find_client(fd);
+    if (fps == 0) {
+        if (client) remove_client(client);
+        return;
+    }
+    if (!client) {
+        for (int i = 0; i < LIVE_MAX_PREVIEW_CLIENTS && !client; i++) {
+            if (!clients[i].server) client = &clients[i];
+        }
+        if (!client) {
+            ESP_LOGW(LIVE_TAG, "No free preview slot for socket %d", fd);
+            return;
+        }
+        memset(client->sent, 0, sizeof(client->sent));
+        client->announced = false;
+        client->last_sent_us = 0;
+    }
+    bool first = !any_client();
+    client->server = req->handle;
+    client->fd = fd;
+    client->interval_us = MICRO_PER_SECOND / (fps < LIVE_PREVIEW_MAX_FPS ? fps : LIVE_PREVIEW_MAX_FPS);
+    if (first) {
+        preview_server = req->handle;
+        esp_timer_start_periodic(preview_timer, MICRO_PER_SECOND / LIVE_PREVIEW_MAX_FPS);
+    }
+    ESP_LOGI(LIVE_TAG, "Previewing to socket %d at %u fps", fd, (unsigned)(MICRO_PER_SECOND / client->interval_us));
+}
+
+// Runs in the httpd task like the handlers, so the clients need no lock
+static void send_previews(void* arg)
+{
+    __atomic_store_n(&preview_queued, false, __ATOMIC_RELAXED);
+    int64_t now = esp_timer_get_time();
+    uint16_t count = 0;
+    uint32_t frame = 0;
+    bool fetched = false;
+
+    for (int i = 0; i < LIVE_MAX_PREVIEW_CLIENTS; i++) {
+        live_client_t* client = &clients[i];
+        if (!client->server || now - client->last_sent_us < client->interval_us) continue;
+        if (httpd_ws_get_fd_info(client->server, client->fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            remove_client(client);
+            continue;
+        }
+        if (!fetched) {
+            frame = get_led_preview(led, preview, &count);
+            fetched = true;
+        }
+        if (client->announced && client->frame == frame) continue;
+        // A slow client skips frames, its sent copy stays behind so the next diff covers them
+        if (!socket_writable(client->fd)) continue;
+
+        size_t len = live_encode_frame_header(frame_message, count);
+        size_t ranges = frame_diff_encode(client->sent, (const uint8_t (*)[3])preview, count, frame_message + len);
+        client->frame = frame;
+        if (ranges == 0 && client->announced) continue;
+        httpd_ws_frame_t ws_frame = {
+            .type = HTTPD_WS_TYPE_BINARY,
+            .payload = frame_message,
+            .len = len + ranges,
+            .final = true
+        };
+        if (httpd_ws_send_frame_async(client->server, client->fd, &ws_frame) != ESP_OK) {
+            ESP_LOGW(LIVE_TAG, "Preview to socket %d failed", client->fd);
+            httpd_sess_trigger_close(client->server, client->fd);
+            remove_client(client);
+            continue;
+        }
+        client->announced = true;
+        client->last_sent_us = now;
+    }
+}
+
+static void preview_timer_callback(void* arg)
+{
+    // One pass at a time, a busy server skips ticks rather than queueing them
+    if (__atomic_exchange_n(&preview_queued, true, __ATOMIC_RELAXED)) return;
+    if (httpd_queue_work(preview_server, send_previews, NULL) != ESP_OK) {
+        __atomic_store_n(&preview_queued, false, __ATOMIC_RELAXED);
+    }
+}
+
+void live_channel_init(led_t* live_led)
+{
+    led = live_led;
+    const esp_timer_create_args_t preview_timer_args = {
+        .callback = preview_timer_callback,
+        .name = "live preview"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&preview_timer_args, &preview_timer));
+}
+
+esp_err_t live_channel_handler(httpd_req_t* req)
+{
+    // The upgrade request, every later call is one frame
+    if (req->method == HTTP_GET) {
+        int fd = httpd_req_to_sockfd(req);
+        // The socket number may have belonged to a client that has since gone
+        live_client_t* stale = find_client(fd);
+        if (stale) remove_client(stale);
+        ESP_LOGI(LIVE_TAG, "Client connected on socket %d", fd);
+        return ESP_OK;
+    }
+
+    // Header first for the length, the payload has to be read either way to keep the stream in step
+    httpd_ws_frame_t frame = { .payload = message };
+    esp_err_t err = httpd_ws_recv_frame(req, &frame, 0);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (frame.len > LIVE_MAX_MESSAGE_SIZE) {
+        ESP_LOGW(LIVE_TAG, "Closing client after a %u byte message", (unsigned)frame.len);
+        return ESP_FAIL;
+    }
+    if (frame.len > 0) {
+        err = httpd_ws_recv_frame(req, &frame, frame.len);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    // Text frames carry nothing for now, pings are answered by httpd
+    if (frame.type != HTTPD_WS_TYPE_BINARY) {
+        return ESP_OK;
+    }
+
+    size_t op_count;
+    if (!live_decode(message, frame.len, ops, LIVE_MAX_OPS, &op_count)) {
+        ESP_LOGW(LIVE_TAG, "Dropping malformed message");
+        return ESP_OK;
+    }
+    uint16_t length = get_led_length(led);
+    for (size_t i = 0; i < op_count; i++) {
+        if (!valid_op(&ops[i], length)) {
+            ESP_LOGW(LIVE_TAG, "Dropping message with invalid operation %u", (unsigned)i);
+            return ESP_OK;
+        }
+    }
+
+    // Everything validated, apply as one change so only the final state is shown
+    size_t led_ops = 0;
+    for (size_t i = 0; i < op_count; i++) {
+        if (ops[i].type == LIVE_OP_PREVIEW) {
+            subscribe(req, ops[i].fps);
+        } else {
+            led_ops++;
+        }
+    }
+    if (led_ops == 0) return ESP_OK;
+    led_batch_begin(led);
+    for (size_t i = 0; i < op_count; i++) {
+        apply_op(&ops[i]);
+    }
+    led_batch_commit(led);
+    return ESP_OK;
+}
+
+#endif // CONFIG_LED_LIVE
@@ -0,0 +1,39 @@
+#ifndef LIVE_CHANNEL_H
+#define LIVE_CHANNEL_H
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_http_server.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "led_manager.h"
+#include "live_protocol.h"
+#include "frame_diff.h"
+
+/**
+ * @brief   Sets the LED live channel messages change and preview frames show, and creates the preview timer
+ *
+ * @param led: LED changed by every client
+ */
+void live_channel_init(led_t* led);
+
+/**
+ * @brief   WebSocket URI handler for the live channel, a persistent connection carrying binary control messages
+ *
+ * @note Each binary message is a sequence of live_op_type_t operations, decoded by live_decode and applied like
+ *       a /batch: validated in full, then in order as one change. Invalid messages are dropped without closing
+ *       the connection, oversized ones close it. Morse Code needs a string and stays on HTTP. LIVE_OP_PREVIEW
+ *       subscribes the connection to preview frames: LIVE_FRAME_MESSAGE messages carrying the get_led_preview
+ *       ranges that changed since the client's last frame, encoded by frame_diff_encode against what that
+ *       client already holds, so a slow client skips frames without losing pixels. Up to 4 clients, at most
+ *       20 frames per second. Only built with CONFIG_LED_LIVE
+ *
+ * @param req: Upgrade request on the first call, then one received frame per call
+ *
+ * @return
+ *      - ESP_OK: Connected, or message handled
+ *      - ESP_FAIL: Message too large or unreadable, httpd closes the connection
+ */
+esp_err_t live_channel_handler(httpd_req_t* req);
+
+#endif // LIVE_CHANNEL_H
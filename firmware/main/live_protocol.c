@@ -0,0 +1,78 @@
+#include "live_protocol.h"
+
+static uint16_t get_u16(const uint8_t* p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+    return get_u16(p) | (uint32_t)get_u16(p + 2) << 16;
+}
+
+// Bytes after the operation byte, 0 for an unknown operation
+static size_t payload_size(uint8_t type)
+{
+    switch (type) {
+        case LIVE_OP_STATE:
+        case LIVE_OP_MODE:
+        case LIVE_OP_PREVIEW:
+            return 1;
+        case LIVE_OP_DURATION:
+        case LIVE_OP_COLOR:
+            return 4;
+        case LIVE_OP_PIXELS:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+size_t live_encode_frame_header(uint8_t* out, uint16_t count)
+{
+    out[0] = LIVE_FRAME_MESSAGE;
+    out[1] = count & 0xFF;
+    out[2] = count >> 8;
+    return LIVE_FRAME_HEADER;
+}
+
+bool live_decode(const uint8_t* buf, size_t len, live_op_t* ops, size_t max_ops, size_t* op_count)
+{
+    size_t count = 0;
+    size_t pos = 0;
+
+    while (pos < len) {
+        uint8_t type = buf[pos];
+        size_t size = payload_size(type);
+        if (size == 0 || len - pos - 1 < size || count >= max_ops) return false;
+        const uint8_t* p = buf + pos + 1;
+        live_op_t* op = &ops[count++];
+        op->type = type;
+        switch (type) {
+            case LIVE_OP_STATE:
+                if (p[0] > 1) return false;
+                op->state = p[0];
+                break;
+            case LIVE_OP_MODE:
+                op->mode = p[0];
+                break;
+            case LIVE_OP_DURATION:
+                op->duration = get_u32(p);
+                break;
+            case LIVE_OP_COLOR:
+                memcpy(op->pixels.rgbw, p, 4);
+                break;
+            case LIVE_OP_PIXELS:
+                op->pixels.start = get_u16(p);
+                op->pixels.count = get_u16(p + 2);
+                memcpy(op->pixels.rgbw, p + 4, 4);
+                break;
+            case LIVE_OP_PREVIEW:
+                op->fps = p[0];
+                break;
+        }
+        pos += 1 + size;
+    }
+    *op_count = count;
+    return true;
+}
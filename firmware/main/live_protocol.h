@@ -0,0 +1,73 @@
+#ifndef LIVE_PROTOCOL_H
+#define LIVE_PROTOCOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// Only depends on the C library so it can be built and tested on a host
+
+#define LIVE_MAX_MESSAGE_SIZE 512
+#define LIVE_MAX_OPS 64                 // A message of nothing but state changes
+#define LIVE_FRAME_MESSAGE 0x80         // First byte of preview frames sent to clients, never an operation
+#define LIVE_FRAME_HEADER 3             // LIVE_FRAME_MESSAGE, preview pixel count (2 bytes)
+
+/**
+ * @brief   Live channel operations, the first byte of each one in a message
+ *
+ * @note Multi-byte fields are little-endian. Every operation but LIVE_OP_PREVIEW is one LED setter,
+ *       so a message is a /batch without the JSON: its operations apply in order and show as one change
+ */
+typedef enum {
+    LIVE_OP_STATE = 1,      //!< state (1 byte, 0 or 1)
+    LIVE_OP_MODE,           //!< led_mode_t (1 byte)
+    LIVE_OP_DURATION,       //!< Blink duration in ms (4 bytes)
+    LIVE_OP_COLOR,          //!< Whole LED red, green, blue, white (4 bytes)
+    LIVE_OP_PIXELS,         //!< start (2 bytes), count (2 bytes), red, green, blue, white (4 bytes)
+    LIVE_OP_PREVIEW         //!< Preview frames per second for this client (1 byte), 0 stops them
+} live_op_type_t;
+
+/**
+ * @brief   Decoded live channel operation
+ */
+typedef struct {
+    live_op_type_t type;
+    union {
+        bool state;
+        uint8_t mode;               //!< Not checked against led_mode_t, the protocol has no dependency on the LED
+        uint32_t duration;
+        uint8_t fps;
+        struct {
+            uint16_t start;         //!< LIVE_OP_PIXELS only, not checked against the LED length
+            uint16_t count;
+            uint8_t rgbw[4];
+        } pixels;                   //!< LIVE_OP_COLOR and LIVE_OP_PIXELS
+    };
+} live_op_t;
+
+/**
+ * @brief   Writes the header of a preview frame message, followed by frame_diff_encode ranges
+ *
+ * @param out: At least LIVE_FRAME_HEADER bytes
+ * @param count: Pixels in the preview, so a client can size it before any range arrives
+ *
+ * @return LIVE_FRAME_HEADER
+ */
+size_t live_encode_frame_header(uint8_t* out, uint16_t count);
+
+/**
+ * @brief   Splits a live channel message into its operations
+ *
+ * @param buf: Message payload
+ * @param len: Payload length
+ * @param ops: Filled with the operations in message order
+ * @param max_ops: Capacity of ops
+ * @param op_count: Set to the number of operations
+ *
+ * @return true if the whole message is well-formed operations and fits in ops. Nothing may be
+ *         applied otherwise, a truncated message would leave the LED half changed
+ */
+bool live_decode(const uint8_t* buf, size_t len, live_op_t* ops, size_t max_ops, size_t* op_count);
+
+#endif // LIVE_PROTOCOL_H
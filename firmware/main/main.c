@@ -4,6 +4,8 @@
 #include "wifi_manager.h"
 #include "http_server.h"
 #include "led_manager.h"
+#include "metrics.h"
+#include "audio_input.h"
 
 void app_main(void)
 {
@@ -17,7 +19,12 @@ void app_main(void)
     * Therefore, no wait bits are needed, but led_manager_init must
     * precede http_server_init
     */
+    metrics_init();
     wifi_manager_init();
     led_manager_init();
     http_server_init();
+#if CONFIG_LED_AUDIO
+    // Feeds the render task started by http_server_init
+    audio_input_init(led_audio_push);
+#endif
 }
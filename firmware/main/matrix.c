@@ -0,0 +1,75 @@
+#include "matrix.h"
+
+void matrix_blit(const matrix_t* matrix, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t (*bitmap)[MATRIX_BYTES_PER_PIXEL])
+{
+    size_t row_bytes = width * MATRIX_BYTES_PER_PIXEL;
+    for (uint16_t row = 0; row < height; row++) {
+        memcpy(matrix->pixels[(y + row) * matrix->width + x], bitmap[row * width], row_bytes);
+    }
+}
+
+void matrix_fill_rect(const matrix_t* matrix, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t rgbw[MATRIX_BYTES_PER_PIXEL])
+{
+    if (width == 0 || height == 0) return;
+    uint8_t (*first)[MATRIX_BYTES_PER_PIXEL] = &matrix->pixels[y * matrix->width + x];
+    for (uint16_t column = 0; column < width; column++) {
+        memcpy(first[column], rgbw, MATRIX_BYTES_PER_PIXEL);
+    }
+    size_t row_bytes = width * MATRIX_BYTES_PER_PIXEL;
+    for (uint16_t row = 1; row < height; row++) {
+        memcpy(first[row * matrix->width], first, row_bytes);
+    }
+}
+
+void matrix_scroll(const matrix_t* matrix, int16_t dx, int16_t dy, const uint8_t fill[MATRIX_BYTES_PER_PIXEL])
+{
+    uint16_t width = matrix->width;
+    uint16_t height = matrix->height;
+    uint16_t shift_x = dx < 0 ? -dx : dx;
+    uint16_t shift_y = dy < 0 ? -dy : dy;
+    if (shift_x >= width || shift_y >= height) {
+        matrix_fill_rect(matrix, 0, 0, width, height, fill);
+        return;
+    }
+
+    // Whole rows move in one go, rows are contiguous
+    if (dy > 0) {
+        memmove(matrix->pixels[shift_y * width], matrix->pixels[0], (height - shift_y) * width * MATRIX_BYTES_PER_PIXEL);
+        matrix_fill_rect(matrix, 0, 0, width, shift_y, fill);
+    } else if (dy < 0) {
+        memmove(matrix->pixels[0], matrix->pixels[shift_y * width], (height - shift_y) * width * MATRIX_BYTES_PER_PIXEL);
+        matrix_fill_rect(matrix, 0, height - shift_y, width, shift_y, fill);
+    }
+
+    if (dx == 0) return;
+    size_t kept_bytes = (width - shift_x) * MATRIX_BYTES_PER_PIXEL;
+    for (uint16_t row = 0; row < height; row++) {
+        uint8_t (*line)[MATRIX_BYTES_PER_PIXEL] = &matrix->pixels[row * width];
+        if (dx > 0) {
+            memmove(line[shift_x], line[0], kept_bytes);
+        } else {
+            memmove(line[0], line[shift_x], kept_bytes);
+        }
+    }
+    matrix_fill_rect(matrix, dx > 0 ? 0 : width - shift_x, 0, shift_x, height, fill);
+}
+
+void matrix_shift_in_column(const matrix_t* matrix, const uint8_t (*column)[MATRIX_BYTES_PER_PIXEL])
+{
+    size_t kept_bytes = (matrix->width - 1) * MATRIX_BYTES_PER_PIXEL;
+    for (uint16_t row = 0; row < matrix->height; row++) {
+        uint8_t (*line)[MATRIX_BYTES_PER_PIXEL] = &matrix->pixels[row * matrix->width];
+        memmove(line[0], line[1], kept_bytes);
+        memcpy(line[matrix->width - 1], column[row], MATRIX_BYTES_PER_PIXEL);
+    }
+}
+
+void matrix_unpack_rgb(const uint8_t* rgb, uint8_t (*rgbw)[MATRIX_BYTES_PER_PIXEL], uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        rgbw[i][0] = rgb[3 * i];
+        rgbw[i][1] = rgb[3 * i + 1];
+        rgbw[i][2] = rgb[3 * i + 2];
+        rgbw[i][3] = 0;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Only depends on the C library so it can be built and tested on a host
+
+#define MATRIX_BYTES_PER_PIXEL 4 // Red, green, blue, white
+
+/**
+ * @brief   Row-major view of a rectangle of RGBW pixels, pixel (x, y) is pixels[y * width + x]
+ *
+ * @note Primitives don't clip, callers check rectangles against width and height first
+ */
+typedef struct {
+    uint8_t (*pixels)[MATRIX_BYTES_PER_PIXEL];
+    uint16_t width;
+    uint16_t height;
+} matrix_t;
+
+/**
+ * @brief   Copies a packed bitmap into the matrix one row at a time
+ *
+ * @param matrix: Destination
+ * @param x: Left column of the destination rectangle
+ * @param y: Top row of the destination rectangle
+ * @param width: Bitmap width
+ * @param height: Bitmap height
+ * @param bitmap: width * height RGBW pixels, row-major
+ */
+void matrix_blit(const matrix_t* matrix, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t (*bitmap)[MATRIX_BYTES_PER_PIXEL]);
+
+/**
+ * @brief   Sets every pixel of a rectangle to one color
+ *
+ * @note Only the first row is written pixel by pixel, the others are copies of it
+ *
+ * @param matrix: Destination
+ * @param x: Left column
+ * @param y: Top row
+ * @param width: Rectangle width
+ * @param height: Rectangle height
+ * @param rgbw: Color
+ */
+void matrix_fill_rect(const matrix_t* matrix, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t rgbw[MATRIX_BYTES_PER_PIXEL]);
+
+/**
+ * @brief   Moves the whole matrix by dx columns and dy rows, filling the uncovered pixels with one color
+ *
+ * @param matrix: Matrix to scroll
+ * @param dx: Columns to move right, negative moves left
+ * @param dy: Rows to move down, negative moves up
+ * @param fill: Color of the pixels scrolled in
+ */
+void matrix_scroll(const matrix_t* matrix, int16_t dx, int16_t dy, const uint8_t fill[MATRIX_BYTES_PER_PIXEL]);
+
+/**
+ * @brief   Moves every row one column left and writes a new column at the right edge, the step of a
+ *          horizontal scroll without redrawing anything
+ *
+ * @param matrix: Matrix to scroll
+ * @param column: height pixels, top to bottom, for the rightmost column
+ */
+void matrix_shift_in_column(const matrix_t* matrix, const uint8_t (*column)[MATRIX_BYTES_PER_PIXEL]);
+
+/**
+ * @brief   Widens packed RGB pixels to RGBW with white 0, for bitmaps uploaded without white
+ *
+ * @param rgb: count * 3 bytes
+ * @param rgbw: Filled with count pixels, must not overlap rgb
+ * @param count: Pixels to convert
+ */
+void matrix_unpack_rgb(const uint8_t* rgb, uint8_t (*rgbw)[MATRIX_BYTES_PER_PIXEL], uint32_t count);
+
+#endif // MATRIX_H
@@ -0,0 +1,192 @@
+#include "metrics.h"
+#include "esp_rom_sys.h"
+
+#define METRIC_BUCKETS 12
+#define METRIC_LINE_SIZE 256
+#define METRIC_LABEL_SIZE 48
+#define CALIBRATION_ROUNDS 1000
+
+static const char* METRICS_TAG = "metrics";
+
+// Upper bounds in microseconds, +Inf is the total count
+static const uint32_t BUCKET_BOUNDS_US[METRIC_BUCKETS] = {
+    10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000
+};
+static const char* BUCKET_LABELS[METRIC_BUCKETS] = {
+    "0.00001", "0.000025", "0.00005", "0.0001", "0.00025", "0.0005",
+    "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05"
+};
+
+typedef struct {
+    const char* family;
+    const char* help;
+    const char* label;          // "name=\"value\"" or NULL
+} metric_info_t;
+
+// Entries of one family must be adjacent so HELP/TYPE are printed once
+static const metric_info_t METRIC_INFO[METRIC_COUNT] = {
+    [METRIC_FRAME] = { "led_frame_seconds", "Time to write all pixels and refresh the strip", NULL },
+    [METRIC_REFRESH] = { "led_refresh_seconds", "Time spent in led_strip_refresh/led_strip_clear", NULL },
+    [METRIC_TIMER_BLINKY] = { "led_timer_callback_seconds", "Time spent in esp_timer callbacks", "timer=\"blinky\"" },
+    [METRIC_TIMER_MORSE] = { "led_timer_callback_seconds", NULL, "timer=\"morse\"" },
+    [METRIC_TIMER_TEXT] = { "led_timer_callback_seconds", NULL, "timer=\"text\"" },
+    [METRIC_AUDIO_BLOCK] = { "led_audio_block_seconds", "Time to analyse one block of microphone samples", NULL },
+    [METRIC_HANDLER_LIGHT] = { "led_http_handler_seconds", "Time spent in URI handlers", "uri=\"/light\"" },
+    [METRIC_HANDLER_BLINKY] = { "led_http_handler_seconds", NULL, "uri=\"/blinky\"" },
+    [METRIC_HANDLER_MORSE] = { "led_http_handler_seconds", NULL, "uri=\"/morse\"" },
+    [METRIC_HANDLER_COLOR] = { "led_http_handler_seconds", NULL, "uri=\"/color\"" },
+    [METRIC_HANDLER_BATCH] = { "led_http_handler_seconds", NULL, "uri=\"/batch\"" },
+    [METRIC_HANDLER_STATE] = { "led_http_handler_seconds", NULL, "uri=\"/state\"" },
+    [METRIC_HANDLER_PIXELS] = { "led_http_handler_seconds", NULL, "uri=\"/state/pixels\"" },
+    [METRIC_HANDLER_ZONES] = { "led_http_handler_seconds", NULL, "uri=\"/zones\"" },
+    [METRIC_HANDLER_MATRIX] = { "led_http_handler_seconds", NULL, "uri=\"/matrix\"" },
+    [METRIC_HANDLER_TEXT] = { "led_http_handler_seconds", NULL, "uri=\"/text\"" },
+    [METRIC_HANDLER_AUDIO] = { "led_http_handler_seconds", NULL, "uri=\"/audio\"" },
+    [METRIC_HANDLER_SCHEDULE] = { "led_http_handler_seconds", NULL, "uri=\"/schedule\"" },
+    [METRIC_HANDLER_GROUP] = { "led_http_handler_seconds", NULL, "uri=\"/group\"" },
+    [METRIC_HANDLER_EVENTS] = { "led_http_handler_seconds", NULL, "uri=\"/events\"" },
+    [METRIC_HANDLER_LIVE] = { "led_http_handler_seconds", NULL, "uri=\"/live\"" }
+};
+
+typedef struct {
+    uint32_t buckets[METRIC_BUCKETS];
+    uint32_t count;
+    uint32_t sum_us;            // Wraps after ~71 minutes of accumulated time, fine for rate()
+} metric_hist_t;
+
+// One set per core so the hot path never contends, summed when scraped
+static metric_hist_t histograms[portNUM_PROCESSORS][METRIC_COUNT];
+static uint32_t ticks_per_us;
+static uint32_t overhead_cycles;
+
+typedef struct {
+    const char* name;
+    const char* help;
+} gauge_info_t;
+
+static const gauge_info_t GAUGE_INFO[METRIC_GAUGE_COUNT] = {
+    [METRIC_GAUGE_POWER_ESTIMATED] = { "led_power_estimated_milliamps", "Estimated strip current of the current frame before power limiting" },
+    [METRIC_GAUGE_POWER_OUTPUT] = { "led_power_output_milliamps", "Estimated strip current after power limiting" }
+};
+static uint32_t gauges[METRIC_GAUGE_COUNT];
+
+#if CONFIG_LED_METRICS
+void metrics_end(metric_id_t id, metric_span_t span)
+{
+    uint32_t cycles = esp_cpu_get_cycle_count() - span.cycles;
+    int core = xPortGetCoreID();
+    if (core != span.core || ticks_per_us == 0) return;
+
+    uint32_t us = cycles / ticks_per_us;
+    metric_hist_t* hist = &histograms[core][id];
+    // Tasks on the same core can still preempt each other, relaxed atomics keep the adds whole
+    for (int i = 0; i < METRIC_BUCKETS; i++) {
+        if (us <= BUCKET_BOUNDS_US[i]) {
+            __atomic_fetch_add(&hist->buckets[i], 1, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+    __atomic_fetch_add(&hist->sum_us, us, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+}
+
+void metrics_set_gauge(metric_gauge_t id, uint32_t value)
+{
+    __atomic_store_n(&gauges[id], value, __ATOMIC_RELAXED);
+}
+#endif // CONFIG_LED_METRICS
+
+void metrics_init()
+{
+    ticks_per_us = esp_rom_get_cpu_ticks_per_us();
+
+#if CONFIG_LED_METRICS
+    // Time empty spans into a scratch slot, then wipe it so it doesn't skew real data
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < CALIBRATION_ROUNDS; i++) {
+        metrics_end(METRIC_FRAME, metrics_begin());
+    }
+    overhead_cycles = (esp_cpu_get_cycle_count() - start) / CALIBRATION_ROUNDS;
+    memset(histograms, 0, sizeof(histograms));
+    ESP_LOGI(METRICS_TAG, "Instrumentation overhead %" PRIu32 " cycles per span", overhead_cycles);
+#endif
+}
+
+static esp_err_t send_histogram(httpd_req_t* req, metric_id_t id)
+{
+    const metric_info_t* info = &METRIC_INFO[id];
+    char line[METRIC_LINE_SIZE];
+    size_t len;
+
+    if (info->help) {
+        len = snprintf(line, METRIC_LINE_SIZE, "# HELP %s %s\n# TYPE %s histogram\n", info->family, info->help, info->family);
+        if (httpd_resp_send_chunk(req, line, len) != ESP_OK) return ESP_FAIL;
+    }
+
+    metric_hist_t total = {0};
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        const metric_hist_t* hist = &histograms[core][id];
+        for (int i = 0; i < METRIC_BUCKETS; i++) {
+            total.buckets[i] += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+        }
+        total.count += __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+        total.sum_us += __atomic_load_n(&hist->sum_us, __ATOMIC_RELAXED);
+    }
+
+    const char* sep = info->label ? "," : "";
+    const char* label = info->label ? info->label : "";
+    char label_set[METRIC_LABEL_SIZE] = "";
+    if (info->label) {
+        snprintf(label_set, METRIC_LABEL_SIZE, "{%s}", info->label);
+    }
+    uint32_t cumulative = 0;
+    for (int i = 0; i < METRIC_BUCKETS; i++) {
+        cumulative += total.buckets[i];
+        len = snprintf(line, METRIC_LINE_SIZE, "%s_bucket{%s%sle=\"%s\"} %" PRIu32 "\n", info->family, label, sep, BUCKET_LABELS[i], cumulative);
+        if (httpd_resp_send_chunk(req, line, len) != ESP_OK) return ESP_FAIL;
+    }
+    len = snprintf(
+        line,
+        METRIC_LINE_SIZE,
+        "%s_bucket{%s%sle=\"+Inf\"} %" PRIu32 "\n%s_sum%s %" PRIu32 ".%06" PRIu32 "\n%s_count%s %" PRIu32 "\n",
+        info->family, label, sep, total.count,
+        info->family, label_set, total.sum_us / 1000000, total.sum_us % 1000000,
+        info->family, label_set, total.count
+    );
+    return httpd_resp_send_chunk(req, line, len);
+}
+
+esp_err_t metrics_handler(httpd_req_t* req)
+{
+    char line[METRIC_LINE_SIZE];
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        if (send_histogram(req, id) != ESP_OK) return ESP_FAIL;
+    }
+
+    size_t len = snprintf(
+        line,
+        METRIC_LINE_SIZE,
+        "# HELP led_metrics_overhead_cycles CPU cycles added by timing one span\n"
+        "# TYPE led_metrics_overhead_cycles gauge\nled_metrics_overhead_cycles %" PRIu32 "\n",
+        overhead_cycles
+    );
+    if (httpd_resp_send_chunk(req, line, len) != ESP_OK) return ESP_FAIL;
+
+    for (int id = 0; id < METRIC_GAUGE_COUNT; id++) {
+        const gauge_info_t* info = &GAUGE_INFO[id];
+        len = snprintf(
+            line,
+            METRIC_LINE_SIZE,
+            "# HELP %s %s\n# TYPE %s gauge\n%s %" PRIu32 "\n",
+            info->name,
+            info->help,
+            info->name,
+            info->name,
+            __atomic_load_n(&gauges[id], __ATOMIC_RELAXED)
+        );
+        if (httpd_resp_send_chunk(req, line, len) != ESP_OK) return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
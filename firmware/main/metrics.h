@@ -0,0 +1,132 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/**
+ * @brief   Timed code paths, each backed by a fixed-bucket latency histogram
+ */
+typedef enum {
+    METRIC_FRAME,               //!< activate_light: pixel writes plus refresh
+    METRIC_REFRESH,             //!< led_strip_refresh/led_strip_clear wire time
+    METRIC_TIMER_BLINKY,        //!< Blinky esp_timer callback
+    METRIC_TIMER_MORSE,         //!< Morse code esp_timer callback
+    METRIC_TIMER_TEXT,          //!< Scrolling text esp_timer callback
+    METRIC_AUDIO_BLOCK,         //!< Analysis of one block of microphone samples
+    METRIC_HANDLER_LIGHT,
+    METRIC_HANDLER_BLINKY,
+    METRIC_HANDLER_MORSE,
+    METRIC_HANDLER_COLOR,
+    METRIC_HANDLER_BATCH,
+    METRIC_HANDLER_STATE,
+    METRIC_HANDLER_PIXELS,
+    METRIC_HANDLER_ZONES,
+    METRIC_HANDLER_MATRIX,
+    METRIC_HANDLER_TEXT,
+    METRIC_HANDLER_AUDIO,
+    METRIC_HANDLER_SCHEDULE,
+    METRIC_HANDLER_GROUP,
+    METRIC_HANDLER_EVENTS,
+    METRIC_HANDLER_LIVE,
+    METRIC_COUNT
+} metric_id_t;
+
+/**
+ * @brief   Sampled values, each reported as a gauge holding the last value set
+ */
+typedef enum {
+    METRIC_GAUGE_POWER_ESTIMATED,   //!< Estimated strip current before power limiting, in mA
+    METRIC_GAUGE_POWER_OUTPUT,      //!< Estimated strip current actually driven, in mA
+    METRIC_GAUGE_COUNT
+} metric_gauge_t;
+
+/**
+ * @brief   Start of a timed span, returned by metrics_begin
+ */
+typedef struct {
+    uint32_t cycles;
+    int core;
+} metric_span_t;
+
+#if CONFIG_LED_METRICS
+
+/**
+ * @brief   Starts timing a span with the CPU cycle counter
+ *
+ * @return Span to pass to metrics_end
+ */
+static inline metric_span_t metrics_begin(void)
+{
+    metric_span_t span = {
+        .core = xPortGetCoreID(),
+        .cycles = esp_cpu_get_cycle_count()
+    };
+    return span;
+}
+
+/**
+ * @brief   Ends a span and records its duration in the metric's histogram for the current core
+ *
+ * @note Lock-free: each core only writes its own counters. Spans whose task migrated to the
+ *       other core are dropped, since the two cycle counters are not synchronized
+ *
+ * @param id: Metric to record into
+ * @param span: Value returned by metrics_begin
+ */
+void metrics_end(metric_id_t id, metric_span_t span);
+
+/**
+ * @brief   Sets a gauge to its latest value
+ *
+ * @note Lock-free, the value is stored atomically
+ *
+ * @param id: Gauge to set
+ * @param value: New value
+ */
+void metrics_set_gauge(metric_gauge_t id, uint32_t value);
+
+#else
+
+static inline metric_span_t metrics_begin(void)
+{
+    metric_span_t span = {0};
+    return span;
+}
+
+static inline void metrics_end(metric_id_t id, metric_span_t span)
+{
+}
+
+static inline void metrics_set_gauge(metric_gauge_t id, uint32_t value)
+{
+}
+
+#endif // CONFIG_LED_METRICS
+
+/**
+ * @brief   Measures the cost of a metrics_begin/metrics_end pair, reported alongside the metrics
+ *
+ * @note Call once at startup, before anything else records
+ */
+void metrics_init();
+
+/**
+ * @brief   URI handler serving every metric in Prometheus text exposition format
+ *
+ * @param req: Request
+ *
+ * @return
+ *      - ESP_OK: Metrics sent
+ *      - ESP_FAIL: Sending failed
+ */
+esp_err_t metrics_handler(httpd_req_t* req);
+
+#endif // METRICS_H
@@ -0,0 +1,56 @@
+#include "mpsc_queue.h"
+
+esp_err_t mpsc_queue_init(mpsc_queue_t* queue, void* buffer, uint32_t* sequences, size_t item_size, uint32_t capacity)
+{
+    if (item_size == 0 || capacity == 0 || (capacity & (capacity - 1))) return ESP_ERR_INVALID_ARG;
+    queue->buffer = buffer;
+    queue->sequences = sequences;
+    queue->item_size = item_size;
+    queue->mask = capacity - 1;
+    queue->head = 0;
+    queue->tail = 0;
+    for (uint32_t i = 0; i < capacity; i++) {
+        queue->sequences[i] = i;
+    }
+    return ESP_OK;
+}
+
+bool mpsc_queue_push(mpsc_queue_t* queue, const void* item)
+{
+    uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    uint32_t* sequence;
+
+    for (;;) {
+        sequence = &queue->sequences[head & queue->mask];
+        int32_t diff = (int32_t)(__atomic_load_n(sequence, __ATOMIC_ACQUIRE) - head);
+        if (diff == 0) {
+            // Slot is free for this index, claim it unless another producer got there first
+            if (__atomic_compare_exchange_n(&queue->head, &head, head + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Slot still holds the item from one lap ago
+            return false;
+        } else {
+            head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    memcpy(queue->buffer + (head & queue->mask) * queue->item_size, item, queue->item_size);
+    // Publishes the item, the consumer only reads it after seeing this sequence
+    __atomic_store_n(sequence, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool mpsc_queue_pop(mpsc_queue_t* queue, void* item)
+{
+    uint32_t tail = queue->tail;
+    uint32_t* sequence = &queue->sequences[tail & queue->mask];
+    if (__atomic_load_n(sequence, __ATOMIC_ACQUIRE) != tail + 1) return false;
+
+    memcpy(item, queue->buffer + (tail & queue->mask) * queue->item_size, queue->item_size);
+    // Hands the slot back to the producers for the next lap
+    __atomic_store_n(sequence, tail + queue->mask + 1, __ATOMIC_RELEASE);
+    queue->tail = tail + 1;
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "esp_err.h"
+
+/**
+ * @brief   Bounded lock-free ring of fixed-size items with any number of producer tasks and one consumer task
+ *
+ * @note Treat every member as private. Producers claim a slot with a compare-and-swap and publish it through
+ *       the slot's sequence number, so no producer ever takes a lock or waits on the consumer. A producer
+ *       preempted between claiming and publishing holds back later items until it resumes, nothing is lost
+ */
+typedef struct {
+    uint8_t* buffer;
+    uint32_t* sequences;    // Per slot: index it can be claimed at, or index + 1 once published
+    size_t item_size;
+    uint32_t mask;          // Capacity - 1
+    uint32_t head;          // Next index to claim, shared by the producers
+    uint32_t tail;          // Next index to pop, consumer only
+} mpsc_queue_t;
+
+/**
+ * @brief   Prepares a queue over caller-owned storage
+ *
+ * @param queue: Queue to initialize
+ * @param buffer: Storage for capacity * item_size bytes, must outlive the queue
+ * @param sequences: Storage for capacity sequence numbers, must outlive the queue
+ * @param item_size: Size of one item in bytes
+ * @param capacity: Number of items, must be a power of two
+ *
+ * @return
+ *      - ESP_OK: Queue ready
+ *      - ESP_ERR_INVALID_ARG: If capacity is not a power of two or item_size is 0
+ */
+esp_err_t mpsc_queue_init(mpsc_queue_t* queue, void* buffer, uint32_t* sequences, size_t item_size, uint32_t capacity);
+
+/**
+ * @brief   Copies an item into the queue. Safe from any task
+ *
+ * @param queue: Queue
+ * @param item: Item of item_size bytes
+ *
+ * @return true if pushed, false if the queue is full
+ */
+bool mpsc_queue_push(mpsc_queue_t* queue, const void* item);
+
+/**
+ * @brief   Copies the oldest published item out of the queue. Only call from the consumer task
+ *
+ * @param queue: Queue
+ * @param item: Filled with item_size bytes
+ *
+ * @return true if an item was popped, false if the queue is empty
+ */
+bool mpsc_queue_pop(mpsc_queue_t* queue, void* item);
+
+#endif // MPSC_QUEUE_H
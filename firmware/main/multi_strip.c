@@ -0,0 +1,330 @@
+#include "multi_strip.h"
+
+#define MICRO_PER_SECOND 1000000
+#define BYTES_PER_PIXEL 3
+#define BYTES_PER_PIXEL_RGBW 4
+#define RESET_US 280            // Latch time, long enough for WS2812B-V5
+#define TRANS_QUEUE_DEPTH 4
+
+static const char* MULTI_STRIP_TAG = "multi strip";
+
+// WS2812/SK6812 bytes followed by the reset low time, one instance per channel since encoders keep state
+typedef struct {
+    rmt_encoder_t base;
+    rmt_encoder_handle_t bytes_encoder;
+    rmt_encoder_handle_t copy_encoder;
+    bool sending_reset;
+    rmt_symbol_word_t reset_code;
+} ws2812_encoder_t;
+
+typedef struct {
+    led_strip_t base;
+    uint8_t output_count;
+    uint32_t max_leds;
+    uint32_t pixels_per_output;
+    uint8_t bytes_per_pixel;            // BYTES_PER_PIXEL, or BYTES_PER_PIXEL_RGBW for SK6812
+    rmt_channel_handle_t channels[MULTI_STRIP_MAX_OUTPUTS];
+    rmt_encoder_handle_t encoders[MULTI_STRIP_MAX_OUTPUTS];
+    rmt_sync_manager_handle_t sync;     // NULL without hardware sync, outputs then start microseconds apart
+    // Per output, one past the last pixel changed since the last refresh. WS2812 pixels past the end
+    // of a transmission keep what they latched, so only this prefix needs sending
+    uint32_t dirty_end[MULTI_STRIP_MAX_OUTPUTS];
+    uint8_t pixel_buf[];                // GRB or GRBW, outputs back to back
+} multi_strip_t;
+
+static size_t ws2812_encode(rmt_encoder_t* encoder, rmt_channel_handle_t channel, const void* data, size_t size, rmt_encode_state_t* ret_state)
+{
+    ws2812_encoder_t* ws2812 = __containerof(encoder, ws2812_encoder_t, base);
+    rmt_encode_state_t session_state = RMT_ENCODING_RESET;
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    size_t encoded = 0;
+
+    if (!ws2812->sending_reset) {
+        encoded += ws2812->bytes_encoder->encode(ws2812->bytes_encoder, channel, data, size, &session_state);
+        if (session_state & RMT_ENCODING_COMPLETE) {
+            ws2812->sending_reset = true;
+        }
+        if (session_state & RMT_ENCODING_MEM_FULL) {
+            // Resumed from here once the channel has room again
+            *ret_state = RMT_ENCODING_MEM_FULL;
+            return encoded;
+        }
+    }
+    encoded += ws2812->copy_encoder->encode(ws2812->copy_encoder, channel, &ws2812->reset_code, sizeof(ws2812->reset_code), &session_state);
+    if (session_state & RMT_ENCODING_COMPLETE) {
+        ws2812->sending_reset = false;
+        state |= RMT_ENCODING_COMPLETE;
+    }
+    if (session_state & RMT_ENCODING_MEM_FULL) {
+        state |= RMT_ENCODING_MEM_FULL;
+    }
+    *ret_state = state;
+    return encoded;
+}
+
+static esp_err_t ws2812_reset(rmt_encoder_t* encoder)
+{
+    ws2812_encoder_t* ws2812 = __containerof(encoder, ws2812_encoder_t, base);
+    rmt_encoder_reset(ws2812->bytes_encoder);
+    rmt_encoder_reset(ws2812->copy_encoder);
+    ws2812->sending_reset = false;
+    return ESP_OK;
+}
+
+static esp_err_t ws2812_del(rmt_encoder_t* encoder)
+{
+    ws2812_encoder_t* ws2812 = __containerof(encoder, ws2812_encoder_t, base);
+    if (ws2812->bytes_encoder) rmt_del_encoder(ws2812->bytes_encoder);
+    if (ws2812->copy_encoder) rmt_del_encoder(ws2812->copy_encoder);
+    free(ws2812);
+    return ESP_OK;
+}
+
+static esp_err_t new_ws2812_encoder(uint32_t resolution_hz, bool rgbw, rmt_encoder_handle_t* ret_encoder)
+{
+    ws2812_encoder_t* ws2812 = calloc(1, sizeof(ws2812_encoder_t));
+    if (!ws2812) return ESP_ERR_NO_MEM;
+    ws2812->base.encode = ws2812_encode;
+    ws2812->base.reset = ws2812_reset;
+    ws2812->base.del = ws2812_del;
+
+    uint32_t ticks_per_us = resolution_hz / MICRO_PER_SECOND;
+    // WS2812: T0H 0.3 us, T0L 0.9 us, T1H 0.9 us, T1L 0.3 us, sent G7...G0 R7...R0 B7...B0
+    // SK6812: T1H 0.6 us, T1L 0.6 us, with W7...W0 after blue
+    uint32_t t1h = rgbw ? 6 : 9;
+    rmt_bytes_encoder_config_t bytes_config = {
+        .bit0 = { .level0 = 1, .duration0 = 3 * ticks_per_us / 10, .level1 = 0, .duration1 = 9 * ticks_per_us / 10 },
+        .bit1 = { .level0 = 1, .duration0 = t1h * ticks_per_us / 10, .level1 = 0, .duration1 = (12 - t1h) * ticks_per_us / 10 },
+        .flags.msb_first = 1
+    };
+    rmt_copy_encoder_config_t copy_config = {};
+    esp_err_t err = rmt_new_bytes_encoder(&bytes_config, &ws2812->bytes_encoder);
+    if (err == ESP_OK) {
+        err = rmt_new_copy_encoder(&copy_config, &ws2812->copy_encoder);
+    }
+    if (err != ESP_OK) {
+        ws2812_del(&ws2812->base);
+        return err;
+    }
+
+    uint32_t reset_ticks = ticks_per_us * RESET_US / 2;
+    ws2812->reset_code = (rmt_symbol_word_t) { .level0 = 0, .duration0 = reset_ticks, .level1 = 0, .duration1 = reset_ticks };
+    *ret_encoder = &ws2812->base;
+    return ESP_OK;
+}
+
+static uint32_t output_length(const multi_strip_t* multi, uint8_t output)
+{
+    uint32_t first = output * multi->pixels_per_output;
+    return multi->max_leds - first < multi->pixels_per_output ? multi->max_leds - first : multi->pixels_per_output;
+}
+
+static void mark_dirty(multi_strip_t* multi, uint32_t index)
+{
+    uint8_t output = index / multi->pixels_per_output;
+    uint32_t end = index % multi->pixels_per_output + 1;
+    if (end > multi->dirty_end[output]) {
+        multi->dirty_end[output] = end;
+    }
+}
+
+static esp_err_t multi_strip_set_pixel(led_strip_t* strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    multi_strip_t* multi = __containerof(strip, multi_strip_t, base);
+    if (index >= multi->max_leds) return ESP_ERR_INVALID_ARG;
+    uint8_t* pixel = &multi->pixel_buf[index * multi->bytes_per_pixel];
+    // On RGBW outputs this leaves white as it was
+    if (pixel[0] == green && pixel[1] == red && pixel[2] == blue) return ESP_OK;
+    pixel[0] = green;
+    pixel[1] = red;
+    pixel[2] = blue;
+    mark_dirty(multi, index);
+    return ESP_OK;
+}
+
+static esp_err_t multi_strip_set_pixel_rgbw(led_strip_t* strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    multi_strip_t* multi = __containerof(strip, multi_strip_t, base);
+    if (multi->bytes_per_pixel != BYTES_PER_PIXEL_RGBW) return ESP_ERR_NOT_SUPPORTED;
+    if (index >= multi->max_leds) return ESP_ERR_INVALID_ARG;
+    uint8_t* pixel = &multi->pixel_buf[index * BYTES_PER_PIXEL_RGBW];
+    if (pixel[0] == green && pixel[1] == red && pixel[2] == blue && pixel[3] == white) return ESP_OK;
+    pixel[0] = green;
+    pixel[1] = red;
+    pixel[2] = blue;
+    pixel[3] = white;
+    mark_dirty(multi, index);
+    return ESP_OK;
+}
+
+static esp_err_t multi_strip_refresh(led_strip_t* strip)
+{
+    multi_strip_t* multi = __containerof(strip, multi_strip_t, base);
+    rmt_transmit_config_t transmit_config = { .loop_count = 0 };
+    bool sent[MULTI_STRIP_MAX_OUTPUTS] = {0};
+    bool any_dirty = false;
+    esp_err_t err;
+
+    for (uint8_t i = 0; i < multi->output_count; i++) {
+        any_dirty |= multi->dirty_end[i] > 0;
+    }
+    if (!any_dirty) return ESP_OK;
+
+    // With a sync manager, nothing goes out until every channel has its transmission queued
+    if (multi->sync) {
+        err = rmt_sync_reset(multi->sync);
+        if (err != ESP_OK) return err;
+    }
+    for (uint8_t i = 0; i < multi->output_count; i++) {
+        uint32_t count = multi->dirty_end[i];
+        if (count == 0) {
+            if (!multi->sync) continue;
+            // Synced channels all have to transmit, resending the first pixel is harmless
+            count = 1;
+        }
+        uint32_t first = i * multi->pixels_per_output;
+        err = rmt_transmit(multi->channels[i], multi->encoders[i], &multi->pixel_buf[first * multi->bytes_per_pixel], count * multi->bytes_per_pixel, &transmit_config);
+        if (err != ESP_OK) return err;
+        sent[i] = true;
+        multi->dirty_end[i] = 0;
+    }
+    for (uint8_t i = 0; i < multi->output_count; i++) {
+        if (!sent[i]) continue;
+        err = rmt_tx_wait_all_done(multi->channels[i], -1);
+        if (err != ESP_OK) return err;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t multi_strip_clear(led_strip_t* strip)
+{
+    multi_strip_t* multi = __containerof(strip, multi_strip_t, base);
+    // Only the prefix up to the last lit pixel has to go dark
+    for (uint8_t i = 0; i < multi->output_count; i++) {
+        const uint8_t* pixels = &multi->pixel_buf[i * multi->pixels_per_output * multi->bytes_per_pixel];
+        for (uint32_t end = output_length(multi, i); end > multi->dirty_end[i]; end--) {
+            const uint8_t* pixel = &pixels[(end - 1) * multi->bytes_per_pixel];
+            bool lit = false;
+            for (uint8_t byte = 0; byte < multi->bytes_per_pixel; byte++) {
+                lit |= pixel[byte] != 0;
+            }
+            if (lit) {
+                multi->dirty_end[i] = end;
+                break;
+            }
+        }
+    }
+    memset(multi->pixel_buf, 0, multi->max_leds * multi->bytes_per_pixel);
+    return multi_strip_refresh(strip);
+}
+
+static esp_err_t multi_strip_del(led_strip_t* strip)
+{
+    multi_strip_t* multi = __containerof(strip, multi_strip_t, base);
+    if (multi->sync) {
+        rmt_del_sync_manager(multi->sync);
+    }
+    for (uint8_t i = 0; i < multi->output_count; i++) {
+        if (multi->channels[i]) {
+            rmt_disable(multi->channels[i]);
+            rmt_del_channel(multi->channels[i]);
+        }
+        if (multi->encoders[i]) {
+            rmt_del_encoder(multi->encoders[i]);
+        }
+    }
+    free(multi);
+    return ESP_OK;
+}
+
+static esp_err_t create_output(multi_strip_t* multi, const multi_strip_config_t* config, uint8_t output)
+{
+    rmt_tx_channel_config_t channel_config = {
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .gpio_num = config->gpios[output],
+        .mem_block_symbols = config->mem_block_symbols,
+        .resolution_hz = config->resolution_hz,
+        .trans_queue_depth = TRANS_QUEUE_DEPTH
+    };
+    esp_err_t err = rmt_new_tx_channel(&channel_config, &multi->channels[output]);
+    if (err != ESP_OK) {
+        ESP_LOGE(MULTI_STRIP_TAG, "Failed to create RMT TX channel for GPIO %d", config->gpios[output]);
+        return err;
+    }
+    err = new_ws2812_encoder(config->resolution_hz, config->rgbw, &multi->encoders[output]);
+    if (err != ESP_OK) return err;
+    return rmt_enable(multi->channels[output]);
+}
+
+esp_err_t multi_strip_new_rmt_device(const multi_strip_config_t* config, led_strip_handle_t* ret_strip)
+{
+    if (config->output_count == 0 || config->output_count > MULTI_STRIP_MAX_OUTPUTS || config->max_leds < config->output_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t bytes_per_pixel = config->rgbw ? BYTES_PER_PIXEL_RGBW : BYTES_PER_PIXEL;
+    multi_strip_t* multi = calloc(1, sizeof(multi_strip_t) + config->max_leds * bytes_per_pixel);
+    if (!multi) return ESP_ERR_NO_MEM;
+    multi->bytes_per_pixel = bytes_per_pixel;
+    multi->output_count = config->output_count;
+    multi->max_leds = config->max_leds;
+    multi->pixels_per_output = (config->max_leds + config->output_count - 1) / config->output_count;
+    multi->base.set_pixel = multi_strip_set_pixel;
+    multi->base.set_pixel_rgbw = multi_strip_set_pixel_rgbw;
+    multi->base.refresh = multi_strip_refresh;
+    multi->base.clear = multi_strip_clear;
+    multi->base.del = multi_strip_del;
+    // What the strips show at power up is unknown, so the first refresh sends everything
+    for (uint8_t i = 0; i < config->output_count; i++) {
+        multi->dirty_end[i] = output_length(multi, i);
+    }
+
+    esp_err_t err = ESP_OK;
+    for (uint8_t i = 0; i < config->output_count && err == ESP_OK; i++) {
+        err = create_output(multi, config, i);
+    }
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    if (err == ESP_OK && config->output_count > 1) {
+        rmt_sync_manager_config_t sync_config = {
+            .tx_channel_array = multi->channels,
+            .array_size = config->output_count
+        };
+        err = rmt_new_sync_manager(&sync_config, &multi->sync);
+    }
+#endif
+    if (err != ESP_OK) {
+        multi_strip_del(&multi->base);
+        return err;
+    }
+
+    ESP_LOGI(
+        MULTI_STRIP_TAG,
+        "%u %s outputs of up to %" PRIu32 " pixels, %s start",
+        config->output_count,
+        config->rgbw ? "RGBW" : "RGB",
+        multi->pixels_per_output,
+        multi->sync ? "synchronized" : "unsynchronized"
+    );
+    *ret_strip = &multi->base;
+    return ESP_OK;
+}
+
+esp_err_t multi_strip_parse_gpios(const char* list, int* gpios, uint8_t max_gpios, uint8_t* count)
+{
+    *count = 0;
+    while (*list) {
+        while (*list == ' ') list++;
+        char* end;
+        long gpio = strtol(list, &end, 10);
+        if (end == list || gpio < 0 || *count == max_gpios) return ESP_ERR_INVALID_ARG;
+        gpios[(*count)++] = gpio;
+        list = end;
+        while (*list == ' ') list++;
+        if (*list == ',') {
+            list++;
+        } else if (*list) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return *count ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
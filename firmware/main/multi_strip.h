@@ -0,0 +1,64 @@
+#ifndef MULTI_STRIP_H
+#define MULTI_STRIP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "soc/soc_caps.h"
+#include "driver/rmt_tx.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+
+#define MULTI_STRIP_MAX_OUTPUTS 8
+
+/**
+ * @brief   Configuration for multi_strip_new_rmt_device
+ */
+typedef struct {
+    int gpios[MULTI_STRIP_MAX_OUTPUTS]; //!< Data GPIO of each output, in pixel order
+    uint8_t output_count;               //!< Number of outputs used from gpios, each takes one RMT TX channel
+    uint32_t max_leds;                  //!< Pixels across all outputs, split evenly with any remainder short on the last output
+    uint32_t resolution_hz;             //!< RMT counter clock, 10 MHz gives exact WS2812 timings
+    size_t mem_block_symbols;           //!< RMT memory per channel, in symbols
+    bool rgbw;                          //!< SK6812 GRBW pixels (4 bytes) instead of WS2812 GRB
+} multi_strip_config_t;
+
+/**
+ * @brief   Creates one WS2812 (GRB) or SK6812 (GRBW) strip per GPIO and presents them as a single led_strip_handle_t,
+ *          so led_strip_set_pixel/led_strip_set_pixel_rgbw/led_strip_refresh work unchanged over one logical pixel space
+ *
+ * @note A refresh starts every output at once (through an RMT sync manager where the chip has one) and
+ *       waits for all of them, so frame time follows the longest output rather than the sum of outputs.
+ *       Each output only sends up to its last pixel that changed since the previous refresh, and a
+ *       refresh with nothing changed sends nothing. Channels stay enabled between refreshes
+ *
+ * @param config: Outputs and pixel count
+ * @param ret_strip: Filled with the combined strip
+ *
+ * @return
+ *      - ESP_OK: Strip created
+ *      - ESP_ERR_INVALID_ARG: If there are no outputs, too many, or fewer pixels than outputs
+ *      - ESP_ERR_NO_MEM: If the pixel buffer could not be allocated
+ *      - Others: Errors from the RMT driver, e.g. when every TX channel is taken
+ */
+esp_err_t multi_strip_new_rmt_device(const multi_strip_config_t* config, led_strip_handle_t* ret_strip);
+
+/**
+ * @brief   Parses a comma-separated GPIO list such as "38,39,40,41", as used by the output GPIO Kconfig options
+ *
+ * @param list: GPIO numbers separated by commas, spaces are ignored
+ * @param gpios: Filled with the parsed GPIOs
+ * @param max_gpios: Capacity of gpios
+ * @param count: Filled with the number of GPIOs parsed
+ *
+ * @return
+ *      - ESP_OK: List parsed
+ *      - ESP_ERR_INVALID_ARG: If the list is empty, malformed or longer than max_gpios
+ */
+esp_err_t multi_strip_parse_gpios(const char* list, int* gpios, uint8_t max_gpios, uint8_t* count);
+
+#endif // MULTI_STRIP_H
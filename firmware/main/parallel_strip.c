@@ -0,0 +1,182 @@
+#include "parallel_strip.h"
+
+#define BYTES_PER_PIXEL 3
+#define PCLK_HZ 2400000         // One 417 ns slot per word, so a WS2812 bit is 1.25 us
+#define RESET_US 280
+#define RESET_WORDS (PCLK_HZ / 1000 * RESET_US / 1000 + 1)
+
+static const char* PARALLEL_STRIP_TAG = "parallel strip";
+
+typedef struct {
+    led_strip_t base;
+    uint8_t lane_count;
+    uint32_t max_leds;
+    uint32_t pixels_per_lane;
+    esp_lcd_i80_bus_handle_t bus;
+    esp_lcd_panel_io_handle_t io;
+    TaskHandle_t waiting_task;  // Task blocked in refresh until the DMA transfer is done
+    void* dma_buf;              // Encoded words, followed by RESET_WORDS of zeros when sent
+    size_t dma_size;
+    size_t word_size;
+    // One past the last pixel changed since the last refresh, in every lane. All lanes share a clock,
+    // so the longest dirty prefix goes out on all of them, pixels past it keep what they latched
+    uint32_t dirty_end;
+    uint8_t pixel_buf[];        // GRB, lane-major so a lane's pixels are contiguous
+} parallel_strip_t;
+
+static bool IRAM_ATTR transfer_done(esp_lcd_panel_io_handle_t io, esp_lcd_panel_io_event_data_t* event, void* ctx)
+{
+    parallel_strip_t* parallel = ctx;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(parallel->waiting_task, &woken);
+    return woken == pdTRUE;
+}
+
+static esp_err_t parallel_strip_set_pixel(led_strip_t* strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    parallel_strip_t* parallel = __containerof(strip, parallel_strip_t, base);
+    if (index >= parallel->max_leds) return ESP_ERR_INVALID_ARG;
+    uint8_t* pixel = &parallel->pixel_buf[index * BYTES_PER_PIXEL];
+    if (pixel[0] == green && pixel[1] == red && pixel[2] == blue) return ESP_OK;
+    pixel[0] = green;
+    pixel[1] = red;
+    pixel[2] = blue;
+    uint32_t end = index % parallel->pixels_per_lane + 1;
+    if (end > parallel->dirty_end) {
+        parallel->dirty_end = end;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t parallel_strip_set_pixel_rgbw(led_strip_t* strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    // Lanes are 3 component WS2812
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static esp_err_t parallel_strip_refresh(led_strip_t* strip)
+{
+    parallel_strip_t* parallel = __containerof(strip, parallel_strip_t, base);
+    if (parallel->dirty_end == 0) return ESP_OK;
+    size_t lane_stride = parallel->pixels_per_lane * BYTES_PER_PIXEL;
+    size_t dirty_bytes = parallel->dirty_end * BYTES_PER_PIXEL;
+    size_t words;
+
+    if (parallel->lane_count == 8) {
+        words = bit_transpose_encode_8(parallel->pixel_buf, lane_stride, dirty_bytes, parallel->dma_buf);
+    } else {
+        words = bit_transpose_encode_16(parallel->pixel_buf, lane_stride, dirty_bytes, parallel->dma_buf);
+    }
+    uint8_t* reset = (uint8_t*)parallel->dma_buf + words * parallel->word_size;
+    memset(reset, 0, RESET_WORDS * parallel->word_size);
+    parallel->dirty_end = 0;
+
+    parallel->waiting_task = xTaskGetCurrentTaskHandle();
+    // No command phase, the dirty prefix and reset go out as data
+    esp_err_t err = esp_lcd_panel_io_tx_color(parallel->io, -1, parallel->dma_buf, (words + RESET_WORDS) * parallel->word_size);
+    if (err != ESP_OK) return err;
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    return ESP_OK;
+}
+
+static esp_err_t parallel_strip_clear(led_strip_t* strip)
+{
+    parallel_strip_t* parallel = __containerof(strip, parallel_strip_t, base);
+    // Only the prefix up to the last lit pixel in any lane has to go dark
+    for (uint8_t lane = 0; lane < parallel->lane_count; lane++) {
+        const uint8_t* pixels = &parallel->pixel_buf[lane * parallel->pixels_per_lane * BYTES_PER_PIXEL];
+        for (uint32_t end = parallel->pixels_per_lane; end > parallel->dirty_end; end--) {
+            const uint8_t* pixel = &pixels[(end - 1) * BYTES_PER_PIXEL];
+            if (pixel[0] || pixel[1] || pixel[2]) {
+                parallel->dirty_end = end;
+                break;
+            }
+        }
+    }
+    memset(parallel->pixel_buf, 0, parallel->lane_count * parallel->pixels_per_lane * BYTES_PER_PIXEL);
+    return parallel_strip_refresh(strip);
+}
+
+static esp_err_t parallel_strip_del(led_strip_t* strip)
+{
+    parallel_strip_t* parallel = __containerof(strip, parallel_strip_t, base);
+    if (parallel->io) {
+        esp_lcd_panel_io_del(parallel->io);
+    }
+    if (parallel->bus) {
+        esp_lcd_del_i80_bus(parallel->bus);
+    }
+    heap_caps_free(parallel->dma_buf);
+    free(parallel);
+    return ESP_OK;
+}
+
+static esp_err_t create_bus(parallel_strip_t* parallel, const parallel_strip_config_t* config)
+{
+    esp_lcd_i80_bus_config_t bus_config = {
+        .clk_src = LCD_CLK_SRC_DEFAULT,
+        .dc_gpio_num = config->dc_gpio,
+        .wr_gpio_num = config->wr_gpio,
+        .bus_width = config->lane_count,
+        .max_transfer_bytes = parallel->dma_size
+    };
+    memcpy(bus_config.data_gpio_nums, config->data_gpios, config->lane_count * sizeof(int));
+    esp_err_t err = esp_lcd_new_i80_bus(&bus_config, &parallel->bus);
+    if (err != ESP_OK) {
+        ESP_LOGE(PARALLEL_STRIP_TAG, "Failed to create %u lane LCD bus", config->lane_count);
+        return err;
+    }
+
+    esp_lcd_panel_io_i80_config_t io_config = {
+        .cs_gpio_num = -1,
+        .pclk_hz = PCLK_HZ,
+        .trans_queue_depth = 1,
+        .on_color_trans_done = transfer_done,
+        .user_ctx = parallel,
+        .lcd_cmd_bits = 8,
+        .lcd_param_bits = 8,
+        .dc_levels = { .dc_data_level = 1 }
+    };
+    return esp_lcd_new_panel_io_i80(parallel->bus, &io_config, &parallel->io);
+}
+
+esp_err_t parallel_strip_new_lcd_device(const parallel_strip_config_t* config, led_strip_handle_t* ret_strip)
+{
+    if ((config->lane_count != 8 && config->lane_count != 16) || config->max_leds < config->lane_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t pixels_per_lane = (config->max_leds + config->lane_count - 1) / config->lane_count;
+    // Padded to whole lanes so the transpose never reads past the buffer
+    parallel_strip_t* parallel = calloc(1, sizeof(parallel_strip_t) + config->lane_count * pixels_per_lane * BYTES_PER_PIXEL);
+    if (!parallel) return ESP_ERR_NO_MEM;
+    parallel->lane_count = config->lane_count;
+    parallel->max_leds = config->max_leds;
+    parallel->pixels_per_lane = pixels_per_lane;
+    parallel->base.set_pixel = parallel_strip_set_pixel;
+    parallel->base.set_pixel_rgbw = parallel_strip_set_pixel_rgbw;
+    parallel->base.refresh = parallel_strip_refresh;
+    parallel->base.clear = parallel_strip_clear;
+    parallel->base.del = parallel_strip_del;
+    // What the strips show at power up is unknown, so the first refresh sends everything
+    parallel->dirty_end = pixels_per_lane;
+
+    parallel->word_size = config->lane_count / 8;
+    size_t words = pixels_per_lane * BYTES_PER_PIXEL * 8 * BIT_TRANSPOSE_WORDS_PER_BIT + RESET_WORDS;
+    parallel->dma_size = words * parallel->word_size;
+    parallel->dma_buf = heap_caps_calloc(1, parallel->dma_size, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (!parallel->dma_buf) {
+        parallel_strip_del(&parallel->base);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = create_bus(parallel, config);
+    if (err != ESP_OK) {
+        parallel_strip_del(&parallel->base);
+        return err;
+    }
+
+    ESP_LOGI(PARALLEL_STRIP_TAG, "%u lanes of %" PRIu32 " pixels, %u byte DMA buffer", config->lane_count, pixels_per_lane, (unsigned)parallel->dma_size);
+    *ret_strip = &parallel->base;
+    return ESP_OK;
+}
@@ -0,0 +1,53 @@
+#ifndef PARALLEL_STRIP_H
+#define PARALLEL_STRIP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_lcd_panel_io.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+#include "bit_transpose.h"
+
+#define PARALLEL_STRIP_MAX_LANES 16
+
+/**
+ * @brief   Configuration for parallel_strip_new_lcd_device
+ */
+typedef struct {
+    int data_gpios[PARALLEL_STRIP_MAX_LANES];   //!< Data GPIO of each lane, lane l drives strip l
+    uint8_t lane_count;                         //!< 8 or 16, the LCD bus width
+    int wr_gpio;                                //!< Pixel clock the peripheral insists on driving, leave it unconnected
+    int dc_gpio;                                //!< Data/command line the peripheral insists on driving, leave it unconnected
+    uint32_t max_leds;                          //!< Pixels across all lanes, split evenly in lane order
+} parallel_strip_config_t;
+
+/**
+ * @brief   Creates 8 or 16 WS2812 (GRB) strips clocked out together by the LCD (i80) peripheral with DMA,
+ *          presented as a single led_strip_handle_t over one logical pixel space
+ *
+ * @note Each refresh transposes the per-strip pixel buffers into parallel words with bit_transpose and
+ *       waits for the DMA transfer, so frame time depends only on pixels per lane. Only the prefix up to
+ *       the last pixel changed in any lane since the previous refresh is sent. The DMA buffer needs
+ *       max_leds / lane_count * 72 words of internal RAM
+ *
+ * @param config: Lanes, control pins and pixel count
+ * @param ret_strip: Filled with the combined strip
+ *
+ * @return
+ *      - ESP_OK: Strip created
+ *      - ESP_ERR_INVALID_ARG: If lane_count is not 8 or 16 or there are fewer pixels than lanes
+ *      - ESP_ERR_NO_MEM: If the pixel or DMA buffer could not be allocated
+ *      - Others: Errors from the LCD driver
+ */
+esp_err_t parallel_strip_new_lcd_device(const parallel_strip_config_t* config, led_strip_handle_t* ret_strip);
+
+#endif // PARALLEL_STRIP_H
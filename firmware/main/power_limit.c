@@ -0,0 +1,43 @@
+#include "power_limit.h"
+
+void power_limit_init(power_limit_t* limit, const uint16_t channel_ma[COLOR_CHANNELS], uint32_t idle_ma, uint32_t budget_ma)
+{
+    for (int channel = 0; channel < COLOR_CHANNELS; channel++) {
+        limit->sums[channel] = 0;
+        limit->channel_ma[channel] = channel_ma[channel];
+    }
+    limit->idle_ma = idle_ma;
+    limit->budget_ma = budget_ma;
+}
+
+// Current of the lit channels alone
+static uint32_t channels_ma(const power_limit_t* limit)
+{
+    uint64_t total = 0;
+    for (int channel = 0; channel < COLOR_CHANNELS; channel++) {
+        total += (uint64_t)limit->sums[channel] * limit->channel_ma[channel];
+    }
+    return (total + 254) / 255;
+}
+
+uint32_t power_limit_estimate_ma(const power_limit_t* limit)
+{
+    return limit->idle_ma + channels_ma(limit);
+}
+
+uint32_t power_limit_scale(const power_limit_t* limit, uint32_t* limited_ma)
+{
+    uint32_t lit_ma = channels_ma(limit);
+    uint32_t scale = POWER_LIMIT_FULL_SCALE;
+
+    // A dark frame has nothing to dim, even when the idle draw alone is over the budget
+    if (limit->budget_ma && lit_ma && limit->idle_ma + lit_ma > limit->budget_ma) {
+        // Whatever is left once the idle draw is paid for goes to the channels
+        uint32_t available_ma = limit->budget_ma > limit->idle_ma ? limit->budget_ma - limit->idle_ma : 0;
+        scale = (uint64_t)available_ma * POWER_LIMIT_FULL_SCALE / lit_ma;
+    }
+    if (limited_ma) {
+        *limited_ma = limit->idle_ma + (uint32_t)((uint64_t)lit_ma * scale / POWER_LIMIT_FULL_SCALE);
+    }
+    return scale;
+}
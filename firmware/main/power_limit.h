@@ -0,0 +1,80 @@
+#ifndef POWER_LIMIT_H
+#define POWER_LIMIT_H
+
+#include <stdint.h>
+#include "color_correct.h"
+
+// Only depends on the C library so it can be built and tested on a host
+
+#define POWER_LIMIT_FULL_SCALE (1 << 16) // power_limit_scale result that leaves the frame unchanged
+
+/**
+ * @brief   Running current estimate for a run of pixels, kept up to date per changed pixel
+ *          so a frame never has to be scanned to know its current draw
+ *
+ * @note Treat every member as private
+ */
+typedef struct {
+    uint32_t sums[COLOR_CHANNELS];          // Sum of each output channel over every pixel
+    uint16_t channel_ma[COLOR_CHANNELS];    // Current of one pixel's channel at 255
+    uint32_t idle_ma;                       // Drawn by the pixels' drivers even when dark
+    uint32_t budget_ma;                     // 0 for no limit
+} power_limit_t;
+
+/**
+ * @brief   Prepares a limiter for pixels that are all dark
+ *
+ * @param limit: Limiter to set up
+ * @param channel_ma: Current of one pixel's red, green, blue and white channel at full brightness, in mA
+ * @param idle_ma: Current of all pixels when dark, in mA
+ * @param budget_ma: Current the frame must stay under including idle_ma, 0 for no limit
+ */
+void power_limit_init(power_limit_t* limit, const uint16_t channel_ma[COLOR_CHANNELS], uint32_t idle_ma, uint32_t budget_ma);
+
+/**
+ * @brief   Accounts for one pixel changing from old to new, O(1)
+ *
+ * @param limit: Limiter
+ * @param old: Channel values the pixel is replacing
+ * @param new: Channel values the pixel now outputs
+ */
+static inline void power_limit_update(power_limit_t* limit, const uint8_t old[COLOR_CHANNELS], const uint8_t new[COLOR_CHANNELS])
+{
+    for (int channel = 0; channel < COLOR_CHANNELS; channel++) {
+        limit->sums[channel] += new[channel] - old[channel];
+    }
+}
+
+/**
+ * @brief   Estimates the current of the pixels as they are, without any scaling
+ *
+ * @param limit: Limiter
+ *
+ * @return Estimated current in mA
+ */
+uint32_t power_limit_estimate_ma(const power_limit_t* limit);
+
+/**
+ * @brief   Works out how far the frame has to be dimmed to stay within the budget
+ *
+ * @param limit: Limiter
+ * @param limited_ma: If not NULL, filled with the estimated current after scaling
+ *
+ * @return Scale for power_limit_apply, POWER_LIMIT_FULL_SCALE when the frame is within budget or dark
+ */
+uint32_t power_limit_scale(const power_limit_t* limit, uint32_t* limited_ma);
+
+/**
+ * @brief   Scales one channel value, rounding down so the scaled frame never exceeds the estimate
+ *
+ * @param value: Channel value
+ * @param scale: Result of power_limit_scale
+ *
+ * @return Scaled value
+ */
+static inline uint8_t power_limit_apply(uint8_t value, uint32_t scale)
+{
+    return (value * scale) >> 16;
+}
+
+#endif // POWER_LIMIT_H
@@ -0,0 +1,140 @@
+#include "schedule.h"
+
+#define DAYS_PER_WEEK 7
+
+static void swap_entries(schedule_t* schedule, uint8_t a, uint8_t b)
+{
+    schedule_entry_t entry = schedule->heap[a];
+    schedule->heap[a] = schedule->heap[b];
+    schedule->heap[b] = entry;
+}
+
+static void sift_up(schedule_t* schedule, uint8_t slot)
+{
+    while (slot > 0) {
+        uint8_t parent = (slot - 1) / 2;
+        if (schedule->heap[parent].at <= schedule->heap[slot].at) return;
+        swap_entries(schedule, parent, slot);
+        slot = parent;
+    }
+}
+
+static void sift_down(schedule_t* schedule, uint8_t slot)
+{
+    for (;;) {
+        uint8_t earliest = slot;
+        uint8_t left = 2 * slot + 1;
+        uint8_t right = left + 1;
+        if (left < schedule->heap_size && schedule->heap[left].at < schedule->heap[earliest].at) earliest = left;
+        if (right < schedule->heap_size && schedule->heap[right].at < schedule->heap[earliest].at) earliest = right;
+        if (earliest == slot) return;
+        swap_entries(schedule, slot, earliest);
+        slot = earliest;
+    }
+}
+
+static void queue_rule(schedule_t* schedule, uint8_t index, time_t now)
+{
+    time_t at = schedule_next_fire(&schedule->rules[index], now);
+    if (at == SCHEDULE_NEVER) return;
+    uint8_t slot = schedule->heap_size++;
+    schedule->heap[slot].at = at;
+    schedule->heap[slot].rule = index;
+    sift_up(schedule, slot);
+}
+
+void schedule_init(schedule_t* schedule)
+{
+    schedule->count = 0;
+    schedule->heap_size = 0;
+}
+
+bool schedule_rule_valid(const schedule_rule_t* rule)
+{
+    return rule->weekdays != 0 && (rule->weekdays & ~SCHEDULE_EVERY_DAY) == 0 &&
+           rule->hour < 24 && rule->minute < 60 &&
+           (rule->has_state || rule->has_mode || rule->has_color || rule->has_duration);
+}
+
+// mktime picks either time of a wall clock time repeated when daylight saving ends, depending on earlier
+// calls, so take the earlier one every time and the rule fires once
+static time_t first_local_time(const struct tm* day, int offset, const schedule_rule_t* rule, int* weekday)
+{
+    struct tm candidate = {
+        .tm_year = day->tm_year,
+        .tm_mon = day->tm_mon,
+        .tm_mday = day->tm_mday + offset,
+        .tm_hour = rule->hour,
+        .tm_min = rule->minute,
+        .tm_isdst = -1      // Whatever daylight saving applies on that day
+    };
+    struct tm other = candidate;
+    // Normalizes the day of the month and fills in tm_wday
+    time_t at = mktime(&candidate);
+    *weekday = candidate.tm_wday;
+    other.tm_isdst = !candidate.tm_isdst;
+    time_t other_at = mktime(&other);
+    // Only a real second reading of the same time, not one shifted by the other offset
+    if (other_at < at && other.tm_hour == rule->hour && other.tm_min == rule->minute) {
+        return other_at;
+    }
+    return at;
+}
+
+time_t schedule_next_fire(const schedule_rule_t* rule, time_t after)
+{
+    struct tm today;
+    localtime_r(&after, &today);
+    // Today's time may already have passed, so a rule on one weekday can be up to 7 days out
+    for (int offset = 0; offset <= DAYS_PER_WEEK; offset++) {
+        int weekday;
+        time_t at = first_local_time(&today, offset, rule, &weekday);
+        if (at > after && (rule->weekdays >> weekday & 1)) {
+            return at;
+        }
+    }
+    return SCHEDULE_NEVER;
+}
+
+esp_err_t schedule_add(schedule_t* schedule, const schedule_rule_t* rule, time_t now)
+{
+    if (!schedule_rule_valid(rule)) return ESP_ERR_INVALID_ARG;
+    if (schedule->count >= SCHEDULE_MAX_RULES) return ESP_ERR_NO_MEM;
+    uint8_t index = schedule->count++;
+    schedule->rules[index] = *rule;
+    queue_rule(schedule, index, now);
+    return ESP_OK;
+}
+
+esp_err_t schedule_remove(schedule_t* schedule, uint8_t index, time_t now)
+{
+    if (index >= schedule->count) return ESP_ERR_NOT_FOUND;
+    memmove(&schedule->rules[index], &schedule->rules[index + 1], (schedule->count - index - 1) * sizeof(schedule->rules[0]));
+    schedule->count--;
+    // Every later rule changed index, rare enough to just requeue them all
+    schedule_rebuild(schedule, now);
+    return ESP_OK;
+}
+
+void schedule_rebuild(schedule_t* schedule, time_t now)
+{
+    schedule->heap_size = 0;
+    for (uint8_t i = 0; i < schedule->count; i++) {
+        queue_rule(schedule, i, now);
+    }
+}
+
+time_t schedule_peek(const schedule_t* schedule)
+{
+    return schedule->heap_size ? schedule->heap[0].at : SCHEDULE_NEVER;
+}
+
+bool schedule_pop_due(schedule_t* schedule, time_t now, uint8_t* index)
+{
+    if (schedule->heap_size == 0 || schedule->heap[0].at > now) return false;
+    *index = schedule->heap[0].rule;
+    // The rule's next fire replaces it at the top, every rule has one so the heap never shrinks here
+    schedule->heap[0].at = schedule_next_fire(&schedule->rules[*index], now);
+    sift_down(schedule, 0);
+    return true;
+}
@@ -0,0 +1,143 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "esp_err.h"
+
+// Only depends on the C library so it can be built and tested on a host
+
+#define SCHEDULE_MAX_RULES 32
+#define SCHEDULE_EVERY_DAY 0x7F     // All weekday bits
+#define SCHEDULE_NEVER ((time_t)-1)
+
+/**
+ * @brief   A time of day on some weekdays and what to change then, like one /batch operation on the whole LED
+ *
+ * @note Stored in NVS as is, so keep new members at the end
+ */
+typedef struct {
+    uint8_t weekdays;           //!< Bit 0 Sunday to bit 6 Saturday, the tm_wday numbering
+    uint8_t hour;               //!< Local time, 0-23
+    uint8_t minute;             //!< 0-59
+    bool has_state;
+    bool state;
+    bool has_mode;
+    uint8_t mode;               //!< led_mode_t, a byte so the rule has no dependency on the LED
+    bool has_color;
+    uint8_t rgbw[4];
+    bool has_duration;
+    uint32_t blink_duration;
+} schedule_rule_t;
+
+/**
+ * @brief   One queued fire of a rule
+ */
+typedef struct {
+    time_t at;
+    uint8_t rule;               // Index in schedule_t.rules
+} schedule_entry_t;
+
+/**
+ * @brief   Rules and a min-heap of their next fire times, so finding the next due rule is O(1)
+ *          and firing one is O(log n)
+ *
+ * @note Treat every member as private
+ */
+typedef struct {
+    schedule_rule_t rules[SCHEDULE_MAX_RULES];
+    uint8_t count;
+    schedule_entry_t heap[SCHEDULE_MAX_RULES];     // Next fire of every rule, earliest first
+    uint8_t heap_size;
+} schedule_t;
+
+/**
+ * @brief   Empties a schedule
+ *
+ * @param schedule: Schedule to set up
+ */
+void schedule_init(schedule_t* schedule);
+
+/**
+ * @brief   Checks that a rule has a time, at least one weekday and something to change
+ *
+ * @param rule: Rule to check
+ *
+ * @return true if the rule can be added
+ */
+bool schedule_rule_valid(const schedule_rule_t* rule);
+
+/**
+ * @brief   Gets the first time a rule fires after a given time
+ *
+ * @note Uses the local time zone (TZ), so rules follow daylight saving. A time skipped by a
+ *       daylight saving change fires that much later, one repeated fires once
+ *
+ * @param rule: Valid rule
+ * @param after: Time the result must be later than
+ *
+ * @return Fire time, or SCHEDULE_NEVER if the rule has no weekdays
+ */
+time_t schedule_next_fire(const schedule_rule_t* rule, time_t after);
+
+/**
+ * @brief   Adds a rule and queues its next fire time after now
+ *
+ * @param schedule: Schedule
+ * @param rule: Rule to copy in
+ * @param now: Current time
+ *
+ * @return
+ *      - ESP_OK: Rule added as the last rule
+ *      - ESP_ERR_INVALID_ARG: If the rule is not valid
+ *      - ESP_ERR_NO_MEM: If the schedule already holds SCHEDULE_MAX_RULES rules
+ */
+esp_err_t schedule_add(schedule_t* schedule, const schedule_rule_t* rule, time_t now);
+
+/**
+ * @brief   Removes a rule, later rules move down one index
+ *
+ * @param schedule: Schedule
+ * @param index: Rule to remove
+ * @param now: Current time
+ *
+ * @return
+ *      - ESP_OK: Rule removed
+ *      - ESP_ERR_NOT_FOUND: If there is no rule at index
+ */
+esp_err_t schedule_remove(schedule_t* schedule, uint8_t index, time_t now);
+
+/**
+ * @brief   Requeues every rule from now, after the clock jumped or first became valid
+ *
+ * @param schedule: Schedule
+ * @param now: Current time
+ */
+void schedule_rebuild(schedule_t* schedule, time_t now);
+
+/**
+ * @brief   Gets the earliest queued fire time
+ *
+ * @param schedule: Schedule
+ *
+ * @return Fire time, or SCHEDULE_NEVER without rules
+ */
+time_t schedule_peek(const schedule_t* schedule);
+
+/**
+ * @brief   Takes the earliest rule if it is due and queues its next fire after now. Call until it
+ *          returns false to get every rule due at once
+ *
+ * @note A rule that fell several fires behind, e.g. while the task was starved, fires once
+ *
+ * @param schedule: Schedule
+ * @param now: Current time
+ * @param index: Set to the due rule's index
+ *
+ * @return true if a rule was due
+ */
+bool schedule_pop_due(schedule_t* schedule, time_t now, uint8_t* index);
+
+#endif // SCHEDULE_H
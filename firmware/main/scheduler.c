@@ -0,0 +1,199 @@
+#include "scheduler.h"
+
+#define SCHEDULER_TASK_STACK_SIZE 3072
+#define SCHEDULER_TASK_PRIORITY 3
+#define SCHEDULER_TASK_CORE 0           // Network side, next to httpd and Wi-Fi
+#define SCHEDULER_TICK_MS 1000
+#define SCHEDULER_JUMP_S 120            // Clock moved more than this between ticks, requeue every rule
+#define SCHEDULER_VALID_AFTER 1704067200    // 2024-01-01, anything earlier is a clock that was never set
+#define SCHEDULER_NVS_NAMESPACE "schedule"
+#define SCHEDULER_NVS_KEY "rules"
+
+static const char* SCHEDULER_TAG = "scheduler";
+
+static led_t* led;
+static TaskHandle_t scheduler_task;
+// Held by the task while it runs rules and by the setters while they change them
+static SemaphoreHandle_t schedule_lock;
+static schedule_t schedule;
+static bool synced;
+
+static bool time_valid(time_t now)
+{
+    return now >= SCHEDULER_VALID_AFTER;
+}
+
+static void on_time_sync(struct timeval* tv)
+{
+    __atomic_store_n(&synced, true, __ATOMIC_RELAXED);
+    // Requeue on the next tick rather than waiting up to a second
+    xTaskNotifyGive(scheduler_task);
+}
+
+// A rule has no Morse code string of its own, and the LED may have none when it fires
+static bool morse_rule(const schedule_rule_t* rule)
+{
+    return rule->has_mode && rule->mode == LED_MODE_MORSE;
+}
+
+// Same order as a /batch operation, so a rule behaves like posting it
+static void run_rule(const schedule_rule_t* rule)
+{
+    led_batch_begin(led);
+    if (rule->has_color) {
+        set_led_rgbw(led, rule->rgbw[0], rule->rgbw[1], rule->rgbw[2], rule->rgbw[3]);
+    }
+    if (rule->has_state) {
+        set_led_state(led, rule->state);
+    }
+    if (rule->has_duration) {
+        set_led_blink_duration(led, rule->blink_duration);
+    }
+    if (rule->has_mode) {
+        set_led_mode(led, (led_mode_t)rule->mode);
+    } else if (rule->has_state) {
+        set_led_mode(led, LED_MODE_LIGHT);
+    }
+    led_batch_commit(led);
+}
+
+// Only called with schedule_lock held
+static esp_err_t save_rules()
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(SCHEDULER_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(handle, SCHEDULER_NVS_KEY, schedule.rules, schedule.count * sizeof(schedule.rules[0]));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+static void load_rules(time_t now)
+{
+    static schedule_rule_t stored[SCHEDULE_MAX_RULES];
+    size_t size = sizeof(stored);
+    nvs_handle_t handle;
+    if (nvs_open(SCHEDULER_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return; // Nothing saved yet
+    }
+    esp_err_t err = nvs_get_blob(handle, SCHEDULER_NVS_KEY, stored, &size);
+    nvs_close(handle);
+    if (err != ESP_OK || size % sizeof(stored[0]) != 0) {
+        if (err != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(SCHEDULER_TAG, "Ignoring saved rules: %s", err == ESP_OK ? "size mismatch" : esp_err_to_name(err));
+        }
+        return;
+    }
+    for (size_t i = 0; i < size / sizeof(stored[0]); i++) {
+        // Also drops Morse rules saved before they were turned away
+        if (morse_rule(&stored[i]) || schedule_add(&schedule, &stored[i], now) != ESP_OK) {
+            ESP_LOGW(SCHEDULER_TAG, "Dropping invalid saved rule %u", (unsigned)i);
+        }
+    }
+    ESP_LOGI(SCHEDULER_TAG, "Loaded %u rules", schedule.count);
+}
+
+static void scheduler_task_run(void* arg)
+{
+    bool was_valid = false;
+    time_t last_tick = 0;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SCHEDULER_TICK_MS));
+        time_t now = time(NULL);
+        if (!time_valid(now)) {
+            // No network time yet, the LED keeps whatever it was last set to
+            continue;
+        }
+
+        xSemaphoreTake(schedule_lock, portMAX_DELAY);
+        if (!was_valid || now < last_tick || now - last_tick > SCHEDULER_JUMP_S) {
+            // Fire times from the old clock are meaningless, and fires jumped over are skipped rather than replayed
+            schedule_rebuild(&schedule, now);
+            ESP_LOGI(SCHEDULER_TAG, "%s, %u rules queued", was_valid ? "Clock jumped" : "Time set", schedule.count);
+            was_valid = true;
+        }
+        last_tick = now;
+        // O(1) when nothing is due, which is almost every tick
+        uint8_t index;
+        while (schedule_pop_due(&schedule, now, &index)) {
+            run_rule(&schedule.rules[index]);
+            ESP_LOGI(SCHEDULER_TAG, "Ran rule %u", index);
+        }
+        xSemaphoreGive(schedule_lock);
+    }
+}
+
+void scheduler_init(led_t* scheduled_led)
+{
+    led = scheduled_led;
+    setenv("TZ", CONFIG_LED_TIMEZONE, 1);
+    tzset();
+
+    schedule_init(&schedule);
+    schedule_lock = xSemaphoreCreateMutex();
+    if (!schedule_lock) {
+        ESP_LOGE(SCHEDULER_TAG, "Failed to create schedule lock");
+        return;
+    }
+    load_rules(time(NULL));
+
+    if (xTaskCreatePinnedToCore(scheduler_task_run, "scheduler", SCHEDULER_TASK_STACK_SIZE, NULL, SCHEDULER_TASK_PRIORITY, &scheduler_task, SCHEDULER_TASK_CORE) != pdPASS) {
+        ESP_LOGE(SCHEDULER_TAG, "Failed to create scheduler task");
+        return;
+    }
+
+    // The RTC keeps the time across a restart, so rules can run before the first sync
+    esp_sntp_config_t sntp_config = ESP_NETIF_SNTP_DEFAULT_CONFIG(CONFIG_LED_SNTP_SERVER);
+    sntp_config.sync_cb = on_time_sync;
+    esp_err_t err = esp_netif_sntp_init(&sntp_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(SCHEDULER_TAG, "Failed to start SNTP: %s", esp_err_to_name(err));
+    }
+}
+
+esp_err_t scheduler_add_rule(const schedule_rule_t* rule)
+{
+    if (morse_rule(rule)) return ESP_ERR_INVALID_ARG;
+    xSemaphoreTake(schedule_lock, portMAX_DELAY);
+    esp_err_t err = schedule_add(&schedule, rule, time(NULL));
+    if (err == ESP_OK) {
+        err = save_rules();
+    }
+    xSemaphoreGive(schedule_lock);
+    return err;
+}
+
+esp_err_t scheduler_remove_rule(uint8_t index)
+{
+    xSemaphoreTake(schedule_lock, portMAX_DELAY);
+    esp_err_t err = schedule_remove(&schedule, index, time(NULL));
+    if (err == ESP_OK) {
+        err = save_rules();
+    }
+    xSemaphoreGive(schedule_lock);
+    return err;
+}
+
+uint8_t scheduler_get_rules(schedule_rule_t rules[SCHEDULE_MAX_RULES])
+{
+    xSemaphoreTake(schedule_lock, portMAX_DELAY);
+    uint8_t count = schedule.count;
+    memcpy(rules, schedule.rules, count * sizeof(schedule.rules[0]));
+    xSemaphoreGive(schedule_lock);
+    return count;
+}
+
+void scheduler_get_status(scheduler_status_t* status)
+{
+    xSemaphoreTake(schedule_lock, portMAX_DELAY);
+    status->now = time(NULL);
+    status->time_valid = time_valid(status->now);
+    status->synced = __atomic_load_n(&synced, __ATOMIC_RELAXED);
+    status->next_fire = status->time_valid ? schedule_peek(&schedule) : SCHEDULE_NEVER;
+    status->rule_count = schedule.count;
+    xSemaphoreGive(schedule_lock);
+}
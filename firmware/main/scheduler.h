@@ -0,0 +1,81 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_netif_sntp.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "led_manager.h"
+#include "schedule.h"
+
+/**
+ * @brief   Snapshot of the scheduler, filled by scheduler_get_status
+ */
+typedef struct {
+    bool time_valid;            //!< The clock holds a real date, from SNTP or kept by the RTC across a restart
+    bool synced;                //!< SNTP has set the clock since boot
+    time_t now;                 //!< Current time, only meaningful with time_valid
+    time_t next_fire;           //!< Next time a rule runs, SCHEDULE_NEVER without rules or time
+    uint8_t rule_count;
+} scheduler_status_t;
+
+/**
+ * @brief   Loads the rules saved in NVS, starts SNTP and starts the task that runs rules when they are due
+ *
+ * @note Rules run in local time set by CONFIG_LED_TIMEZONE. Until the clock holds a real date no rule runs,
+ *       and whenever the clock jumps (first sync, a large correction) every rule is requeued from the new
+ *       time, so fires skipped over are not replayed all at once. Needs NVS and the network up
+ *
+ * @param led: LED the rules change
+ */
+void scheduler_init(led_t* led);
+
+/**
+ * @brief   Adds a rule and saves every rule to NVS
+ *
+ * @param rule: Rule to copy in
+ *
+ * @return
+ *      - ESP_OK: Rule added as the last rule
+ *      - ESP_ERR_INVALID_ARG: If the rule is not valid, see schedule_rule_valid, or sets Morse mode
+ *      - ESP_ERR_NO_MEM: If there are already SCHEDULE_MAX_RULES rules
+ *      - Others: NVS errors, the rule stays active until the next restart
+ */
+esp_err_t scheduler_add_rule(const schedule_rule_t* rule);
+
+/**
+ * @brief   Removes a rule and saves the remaining ones to NVS, later rules move down one index
+ *
+ * @param index: Rule to remove
+ *
+ * @return
+ *      - ESP_OK: Rule removed
+ *      - ESP_ERR_NOT_FOUND: If there is no rule at index
+ *      - Others: NVS errors, the rule comes back after a restart
+ */
+esp_err_t scheduler_remove_rule(uint8_t index);
+
+/**
+ * @brief   Copies every rule out, in index order
+ *
+ * @param rules: Filled with the rules
+ *
+ * @return Number of rules
+ */
+uint8_t scheduler_get_rules(schedule_rule_t rules[SCHEDULE_MAX_RULES]);
+
+/**
+ * @brief   Reports the clock and the next fire time
+ *
+ * @param status: Filled with the current status
+ */
+void scheduler_get_status(scheduler_status_t* status);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,36 @@
+#include "spsc_queue.h"
+
+esp_err_t spsc_queue_init(spsc_queue_t* queue, void* buffer, size_t item_size, uint32_t capacity)
+{
+    if (item_size == 0 || capacity == 0 || (capacity & (capacity - 1))) return ESP_ERR_INVALID_ARG;
+    queue->buffer = buffer;
+    queue->item_size = item_size;
+    queue->mask = capacity - 1;
+    queue->head = 0;
+    queue->tail = 0;
+    return ESP_OK;
+}
+
+bool spsc_queue_push(spsc_queue_t* queue, const void* item)
+{
+    uint32_t head = queue->head;
+    // Acquire pairs with the consumer's release, so a freed slot is really done being read
+    uint32_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+    if (head - tail > queue->mask) return false;
+
+    memcpy(queue->buffer + (head & queue->mask) * queue->item_size, item, queue->item_size);
+    // Publishes the item before the consumer can see the new head
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool spsc_queue_pop(spsc_queue_t* queue, void* item)
+{
+    uint32_t tail = queue->tail;
+    uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    if (head == tail) return false;
+
+    memcpy(item, queue->buffer + (tail & queue->mask) * queue->item_size, queue->item_size);
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
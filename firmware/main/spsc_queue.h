@@ -0,0 +1,59 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "esp_err.h"
+
+/**
+ * @brief   Lock-free ring of fixed-size items with exactly one producer task and one consumer task,
+ *          which may run on different cores
+ *
+ * @note Treat every member as private. The producer only writes head and the consumer only writes
+ *       tail, so neither side ever blocks or takes a lock
+ */
+typedef struct {
+    uint8_t* buffer;
+    size_t item_size;
+    uint32_t mask;          // Capacity - 1
+    uint32_t head;          // Items ever pushed, written by the producer
+    uint32_t tail;          // Items ever popped, written by the consumer
+} spsc_queue_t;
+
+/**
+ * @brief   Prepares a queue over a caller-owned buffer of capacity * item_size bytes
+ *
+ * @param queue: Queue to initialize
+ * @param buffer: Storage for the items, must outlive the queue
+ * @param item_size: Size of one item in bytes
+ * @param capacity: Number of items, must be a power of two
+ *
+ * @return
+ *      - ESP_OK: Queue ready
+ *      - ESP_ERR_INVALID_ARG: If capacity is not a power of two or item_size is 0
+ */
+esp_err_t spsc_queue_init(spsc_queue_t* queue, void* buffer, size_t item_size, uint32_t capacity);
+
+/**
+ * @brief   Copies an item into the queue. Only call from the producer task
+ *
+ * @param queue: Queue
+ * @param item: Item of item_size bytes
+ *
+ * @return true if pushed, false if the queue is full
+ */
+bool spsc_queue_push(spsc_queue_t* queue, const void* item);
+
+/**
+ * @brief   Copies the oldest item out of the queue. Only call from the consumer task
+ *
+ * @param queue: Queue
+ * @param item: Filled with item_size bytes
+ *
+ * @return true if an item was popped, false if the queue is empty
+ */
+bool spsc_queue_pop(spsc_queue_t* queue, void* item);
+
+#endif // SPSC_QUEUE_H
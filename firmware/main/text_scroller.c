@@ -0,0 +1,30 @@
+#include "text_scroller.h"
+
+void text_scroller_start(text_scroller_t* scroller, const char* text, uint16_t gap_columns)
+{
+    scroller->text = text;
+    scroller->length = strlen(text);
+    scroller->index = 0;
+    scroller->column = 0;
+    // Something has to be emitted each step, even for an empty string
+    scroller->gap_columns = gap_columns ? gap_columns : 1;
+}
+
+uint8_t text_scroller_next_column(text_scroller_t* scroller)
+{
+    uint8_t bits = 0;
+
+    if (scroller->index < scroller->length) {
+        if (scroller->column < FONT_WIDTH) {
+            bits = font_glyph(scroller->text[scroller->index])[scroller->column];
+        }
+        if (++scroller->column == FONT_WIDTH + TEXT_SCROLLER_SPACING) {
+            scroller->column = 0;
+            scroller->index++;
+        }
+    } else if (++scroller->column >= scroller->gap_columns) {
+        scroller->column = 0;
+        scroller->index = 0;
+    }
+    return bits;
+}
@@ -0,0 +1,44 @@
+#ifndef TEXT_SCROLLER_H
+#define TEXT_SCROLLER_H
+
+#include <stdint.h>
+#include <string.h>
+#include "font.h"
+
+// Only depends on the C library so it can be built and tested on a host
+
+#define TEXT_SCROLLER_SPACING 1 // Blank columns after every glyph
+
+/**
+ * @brief   Walks a string one font column at a time, looping with a blank gap after the end
+ *
+ * @note Treat every member as private
+ */
+typedef struct {
+    const char* text;
+    uint16_t length;
+    uint16_t index;         // Character being emitted, length while in the gap
+    uint16_t column;        // Column within the glyph and spacing, or within the gap
+    uint16_t gap_columns;
+} text_scroller_t;
+
+/**
+ * @brief   Starts walking a string from its first column
+ *
+ * @param scroller: Scroller to set up
+ * @param text: String to show, must outlive the scroller. An empty string only produces blank columns
+ * @param gap_columns: Blank columns between the end of the text and its next repeat, usually the matrix
+ *                     width so the text leaves the matrix before coming back
+ */
+void text_scroller_start(text_scroller_t* scroller, const char* text, uint16_t gap_columns);
+
+/**
+ * @brief   Gets the next column to scroll in, O(1)
+ *
+ * @param scroller: Scroller
+ *
+ * @return Column bits, bit n set for a lit pixel in font row n (bit 0 is the top row)
+ */
+uint8_t text_scroller_next_column(text_scroller_t* scroller);
+
+#endif // TEXT_SCROLLER_H
@@ -0,0 +1,61 @@
+#include "trace.h"
+
+#define TRACE_MASK (CONFIG_LED_TRACE_ENTRIES - 1)
+#define TRACE_SEND_ENTRIES 64
+
+#if CONFIG_LED_TRACE
+_Static_assert((CONFIG_LED_TRACE_ENTRIES & TRACE_MASK) == 0, "LED_TRACE_ENTRIES must be a power of two");
+
+static trace_entry_t ring[CONFIG_LED_TRACE_ENTRIES];
+// Total entries ever claimed, the slot is head & TRACE_MASK
+static uint32_t head;
+
+void trace_record(trace_event_t event, uint16_t arg)
+{
+    uint32_t index = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    trace_entry_t* entry = &ring[index & TRACE_MASK];
+    entry->timestamp_us = (uint32_t)esp_timer_get_time();
+    entry->event = event;
+    entry->core = xPortGetCoreID();
+    entry->arg = arg;
+}
+
+esp_err_t trace_handler(httpd_req_t* req)
+{
+    uint32_t end = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    uint32_t count = end < CONFIG_LED_TRACE_ENTRIES ? end : CONFIG_LED_TRACE_ENTRIES;
+    uint32_t start = end - count;
+
+    trace_header_t header = {
+        .magic = TRACE_MAGIC,
+        .version = TRACE_FORMAT_VERSION,
+        .entry_size = sizeof(trace_entry_t),
+        .count = count,
+        .dropped = start
+    };
+    httpd_resp_set_type(req, HTTPD_TYPE_OCTET);
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"trace.bin\"");
+    if (httpd_resp_send_chunk(req, (const char*)&header, sizeof(header)) != ESP_OK) return ESP_FAIL;
+
+    // Copied out in blocks so slow sockets don't hold up the producers
+    trace_entry_t block[TRACE_SEND_ENTRIES];
+    for (uint32_t sent = 0; sent < count;) {
+        uint32_t n = count - sent < TRACE_SEND_ENTRIES ? count - sent : TRACE_SEND_ENTRIES;
+        for (uint32_t i = 0; i < n; i++) {
+            block[i] = ring[(start + sent + i) & TRACE_MASK];
+        }
+        if (httpd_resp_send_chunk(req, (const char*)block, n * sizeof(trace_entry_t)) != ESP_OK) return ESP_FAIL;
+        sent += n;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+#else
+
+esp_err_t trace_handler(httpd_req_t* req)
+{
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Tracing disabled");
+    return ESP_FAIL;
+}
+
+#endif // CONFIG_LED_TRACE
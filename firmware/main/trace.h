@@ -0,0 +1,84 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define TRACE_MAGIC "LEDT"
+#define TRACE_FORMAT_VERSION 1
+
+/**
+ * @brief   Events recorded in the trace ring
+ */
+typedef enum {
+    TRACE_RENDER_START,     //!< activate_light entered, arg = pixel count
+    TRACE_RENDER_END,
+    TRACE_REFRESH_START,    //!< led_strip_refresh/led_strip_clear started
+    TRACE_REFRESH_END,
+    TRACE_REQUEST,          //!< URI handler entered, arg = metric_id_t of the handler
+    TRACE_TIMER_FIRE        //!< esp_timer callback entered, arg = metric_id_t of the timer
+} trace_event_t;
+
+/**
+ * @brief   One trace entry as stored in the ring and sent by GET /trace (8 bytes, little-endian)
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp_us;  //!< Low 32 bits of esp_timer_get_time, wraps every ~71 minutes
+    uint8_t event;          //!< trace_event_t
+    uint8_t core;           //!< Core the event was recorded on
+    uint16_t arg;           //!< Event specific, see trace_event_t
+} trace_entry_t;
+
+/**
+ * @brief   Header preceding the entries in a GET /trace dump (16 bytes, little-endian)
+ */
+typedef struct __attribute__((packed)) {
+    char magic[4];          //!< TRACE_MAGIC
+    uint16_t version;       //!< TRACE_FORMAT_VERSION
+    uint16_t entry_size;    //!< sizeof(trace_entry_t)
+    uint32_t count;         //!< Entries following the header, oldest first
+    uint32_t dropped;       //!< Entries overwritten before this dump
+} trace_header_t;
+
+#if CONFIG_LED_TRACE
+
+/**
+ * @brief   Appends an event to the trace ring, overwriting the oldest entry when full
+ *
+ * @note Lock-free and safe from any task: the slot is claimed with an atomic increment
+ *
+ * @param event: Event to record
+ * @param arg: Event specific argument
+ */
+void trace_record(trace_event_t event, uint16_t arg);
+
+#else
+
+static inline void trace_record(trace_event_t event, uint16_t arg)
+{
+}
+
+#endif // CONFIG_LED_TRACE
+
+/**
+ * @brief   URI handler dumping the trace ring as a trace_header_t followed by trace_entry_t records
+ *
+ * @note Convert the dump with firmware/tools/trace_to_chrome.c. Entries recorded while the dump
+ *       is in progress may overwrite the oldest ones being sent
+ *
+ * @param req: Request
+ *
+ * @return
+ *      - ESP_OK: Dump sent
+ *      - ESP_FAIL: Sending failed
+ */
+esp_err_t trace_handler(httpd_req_t* req);
+
+#endif // TRACE_H
@@ -0,0 +1,128 @@
+#include "zone_map.h"
+
+static esp_err_t parse_u16(const char** cursor, uint16_t* value)
+{
+    char* end;
+    unsigned long parsed = strtoul(*cursor, &end, 10);
+    if (end == *cursor || parsed > UINT16_MAX) return ESP_ERR_INVALID_ARG;
+    *value = parsed;
+    *cursor = end;
+    return ESP_OK;
+}
+
+// One name:start:size[:flag] entry, stops at the comma or end of string
+static esp_err_t parse_zone(const char** cursor, zone_t* zone)
+{
+    const char* s = *cursor;
+    size_t name_len = strcspn(s, ":,");
+    if (name_len == 0 || name_len > ZONE_NAME_MAX_LEN || s[name_len] != ':') return ESP_ERR_INVALID_ARG;
+    memcpy(zone->name, s, name_len);
+    zone->name[name_len] = '\0';
+    s += name_len + 1;
+
+    if (parse_u16(&s, &zone->start) != ESP_OK || *s++ != ':') return ESP_ERR_INVALID_ARG;
+    if (parse_u16(&s, &zone->width) != ESP_OK || zone->width == 0) return ESP_ERR_INVALID_ARG;
+    if (*s == 'x') {
+        uint16_t height;
+        s++;
+        if (parse_u16(&s, &height) != ESP_OK || height == 0 || (uint32_t)zone->width * height > UINT16_MAX) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        zone->length = zone->width * height;
+        zone->layout = ZONE_LAYOUT_MATRIX;
+        if (strncmp(s, ":s", 2) == 0) {
+            zone->layout = ZONE_LAYOUT_SERPENTINE;
+            s += 2;
+        }
+    } else {
+        zone->length = zone->width;
+        zone->layout = ZONE_LAYOUT_SEGMENT;
+        if (strncmp(s, ":r", 2) == 0) {
+            zone->layout = ZONE_LAYOUT_REVERSED;
+            s += 2;
+        }
+    }
+    *cursor = s;
+    return ESP_OK;
+}
+
+esp_err_t zone_table_parse(const char* spec, uint16_t pixel_count, zone_table_t* table)
+{
+    table->count = 0;
+    while (*spec == ' ') spec++;
+    while (*spec) {
+        if (table->count == ZONE_MAX_COUNT) return ESP_ERR_NO_MEM;
+        zone_t* zone = &table->zones[table->count];
+        if (parse_zone(&spec, zone) != ESP_OK) return ESP_ERR_INVALID_ARG;
+        if (zone->start >= pixel_count || zone->length > pixel_count - zone->start) return ESP_ERR_INVALID_ARG;
+        for (uint8_t i = 0; i < table->count; i++) {
+            const zone_t* other = &table->zones[i];
+            if (strcmp(other->name, zone->name) == 0) return ESP_ERR_INVALID_ARG;
+            if (zone->start < other->start + other->length && other->start < zone->start + zone->length) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+        table->count++;
+
+        while (*spec == ' ') spec++;
+        if (*spec == ',') {
+            spec++;
+            while (*spec == ' ') spec++;
+            if (!*spec) return ESP_ERR_INVALID_ARG;
+        } else if (*spec) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+void zone_table_compile(const zone_table_t* table, uint16_t pixel_count, uint16_t* remap)
+{
+    for (uint16_t i = 0; i < pixel_count; i++) {
+        remap[i] = i;
+    }
+    for (uint8_t z = 0; z < table->count; z++) {
+        const zone_t* zone = &table->zones[z];
+        for (uint16_t i = 0; i < zone->length; i++) {
+            uint16_t row = i / zone->width;
+            uint16_t column = i % zone->width;
+            uint16_t wired;
+            switch (zone->layout) {
+                case ZONE_LAYOUT_REVERSED:
+                    wired = zone->length - 1 - i;
+                    break;
+                case ZONE_LAYOUT_SERPENTINE:
+                    wired = row * zone->width + (row & 1 ? zone->width - 1 - column : column);
+                    break;
+                default:
+                    wired = i;
+                    break;
+            }
+            remap[zone->start + wired] = zone->start + i;
+        }
+    }
+}
+
+const zone_t* zone_table_find(const zone_table_t* table, const char* name)
+{
+    for (uint8_t i = 0; i < table->count; i++) {
+        if (strcmp(table->zones[i].name, name) == 0) return &table->zones[i];
+    }
+    return NULL;
+}
+
+const char* zone_layout_name(zone_layout_t layout)
+{
+    switch (layout) {
+        case ZONE_LAYOUT_SEGMENT:
+            return "segment";
+        case ZONE_LAYOUT_REVERSED:
+            return "reversed";
+        case ZONE_LAYOUT_MATRIX:
+            return "matrix";
+        case ZONE_LAYOUT_SERPENTINE:
+            return "serpentine";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef ZONE_MAP_H
+#define ZONE_MAP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_err.h"
+
+#define ZONE_MAX_COUNT 16
+#define ZONE_NAME_MAX_LEN 15
+
+/**
+ * @brief   How a zone's pixels are wired
+ */
+typedef enum {
+    ZONE_LAYOUT_SEGMENT,        //!< Pixels run forward from the zone's start
+    ZONE_LAYOUT_REVERSED,       //!< Pixels run backward, zone pixel 0 is the last one wired
+    ZONE_LAYOUT_MATRIX,         //!< Rows of width pixels, each wired left to right
+    ZONE_LAYOUT_SERPENTINE      //!< Rows of width pixels, odd rows wired right to left
+} zone_layout_t;
+
+/**
+ * @brief   Named run of pixels, addressed from 0 to length - 1 in its own order
+ *
+ * @note Matrix zones are addressed row-major, pixel y * width + x is column x of row y
+ */
+typedef struct {
+    char name[ZONE_NAME_MAX_LEN + 1];
+    uint16_t start;             //!< First pixel the zone covers
+    uint16_t length;            //!< Pixels covered, width * height for matrices
+    uint16_t width;             //!< Pixels per row for matrices, length otherwise
+    zone_layout_t layout;
+} zone_t;
+
+/**
+ * @brief   Set of non-overlapping zones
+ */
+typedef struct {
+    zone_t zones[ZONE_MAX_COUNT];
+    uint8_t count;
+} zone_table_t;
+
+/**
+ * @brief   Parses a zone list such as "desk:0:60,shelf:60:30:r,panel:90:16x16:s"
+ *
+ * @note Each entry is name:start:length, with an optional :r for a reversed segment, or
+ *       name:start:WIDTHxHEIGHT for a matrix, with an optional :s when rows alternate direction
+ *
+ * @param spec: Zones separated by commas, spaces around entries are ignored. An empty string gives no zones
+ * @param pixel_count: Pixels the zones must fit in
+ * @param table: Filled with the zones
+ *
+ * @return
+ *      - ESP_OK: Zones parsed
+ *      - ESP_ERR_INVALID_ARG: If an entry is malformed, out of range, overlaps another, or reuses a name
+ *      - ESP_ERR_NO_MEM: If there are more than ZONE_MAX_COUNT zones
+ */
+esp_err_t zone_table_parse(const char* spec, uint16_t pixel_count, zone_table_t* table);
+
+/**
+ * @brief   Builds the remap array applied when a frame is flushed: pixel i of the strip shows
+ *          stored pixel remap[i]
+ *
+ * @note Each zone keeps the stored pixels start to start + length - 1 in its own order and only
+ *       permutes them. Pixels outside every zone map to themselves
+ *
+ * @param table: Parsed zones
+ * @param pixel_count: Length of remap
+ * @param remap: Filled with the stored pixel shown at each strip position
+ */
+void zone_table_compile(const zone_table_t* table, uint16_t pixel_count, uint16_t* remap);
+
+/**
+ * @brief   Looks up a zone by name
+ *
+ * @param table: Parsed zones
+ * @param name: Zone name
+ *
+ * @return The zone, or NULL if there is none with that name
+ */
+const zone_t* zone_table_find(const zone_table_t* table, const char* name);
+
+/**
+ * @brief   Gets the name of a layout as used by GET /zones
+ *
+ * @param layout: Layout
+ *
+ * @return "segment", "reversed", "matrix" or "serpentine"
+ */
+const char* zone_layout_name(zone_layout_t layout);
+
+#endif // ZONE_MAP_H
@@ -0,0 +1,196 @@
+/*
+ * Parse time and memory of json_stream.c against cJSON, on a /color body and a 16 operation /batch body.
+ *
+ * Built by the host test project; cJSON is compared when its sources are found (ESP-IDF's json
+ * component through IDF_PATH, or -DCJSON_DIR=<directory with cJSON.c>):
+ *     ./bench_json_stream [iterations]
+ *
+ * Stack is measured by painting a region below the caller, running one parse and finding the deepest
+ * byte it changed, so it is approximate and depends on the host compiler. cJSON's heap is counted
+ * through cJSON_InitHooks; json_stream allocates nothing.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "json_stream.h"
+#if HAVE_CJSON
+#include "cJSON.h"
+#endif
+
+#define STACK_PAINT_SIZE 16384
+#define STACK_PAINT 0xa5
+
+static const char* COLOR_BODY = "{\"red\": 255, \"green\": 128, \"blue\": 0, \"white\": 12}";
+
+static char batch_body[2048];
+
+typedef struct {
+    bool state;
+    uint8_t rgbw[4];
+    uint16_t start;
+    uint16_t count;
+    uint32_t duration;
+    char mode[8];
+} operation_t;
+
+static volatile uint32_t sink; // Keeps the parsed values alive
+
+static void build_batch_body()
+{
+    size_t len = snprintf(batch_body, sizeof(batch_body), "[");
+    for (int i = 0; i < 16; i++) {
+        len += snprintf(batch_body + len, sizeof(batch_body) - len,
+                        "%s{\"start\":%d,\"count\":4,\"red\":%d,\"green\":%d,\"blue\":%d,\"state\":true,\"mode\":\"light\"}",
+                        i ? "," : "", i * 4, i * 16, 255 - i * 16, i);
+    }
+    snprintf(batch_body + len, sizeof(batch_body) - len, "]");
+}
+
+static esp_err_t stream_record(json_field_t* fields, size_t field_count, void* ctx)
+{
+    operation_t* op = fields[0].dest;
+    sink += op->start + op->rgbw[0];
+    return ESP_OK;
+}
+
+static __attribute__((noinline)) void stream_parse(const char* body, bool batch)
+{
+    operation_t op = {0};
+    json_field_t fields[] = {
+        { .key = "start", .type = JSON_FIELD_UINT16, .dest = &op.start },
+        { .key = "count", .type = JSON_FIELD_UINT16, .dest = &op.count },
+        { .key = "red", .type = JSON_FIELD_UINT8, .dest = &op.rgbw[0] },
+        { .key = "green", .type = JSON_FIELD_UINT8, .dest = &op.rgbw[1] },
+        { .key = "blue", .type = JSON_FIELD_UINT8, .dest = &op.rgbw[2] },
+        { .key = "white", .type = JSON_FIELD_UINT8, .dest = &op.rgbw[3] },
+        { .key = "state", .type = JSON_FIELD_BOOL, .dest = &op.state },
+        { .key = "mode", .type = JSON_FIELD_STRING, .dest = op.mode, .dest_size = sizeof(op.mode) }
+    };
+    json_stream_t stream;
+    json_stream_init(&stream, fields, sizeof(fields) / sizeof(fields[0]));
+    if (batch) {
+        json_stream_set_record_handler(&stream, 2, stream_record, NULL);
+    }
+    // The handlers feed whatever httpd_req_recv returns, a 128 byte chunk at a time here
+    size_t len = strlen(body);
+    for (size_t pos = 0; pos < len; pos += 128) {
+        if (json_stream_feed(&stream, body + pos, len - pos < 128 ? len - pos : 128) != ESP_OK) abort();
+    }
+    if (json_stream_finish(&stream) != ESP_OK) abort();
+    sink += op.rgbw[0];
+}
+
+#if HAVE_CJSON
+static size_t heap_now;
+static size_t heap_peak;
+
+// Each block carries its size in front so free can take it off
+static void* counting_malloc(size_t size)
+{
+    size_t* block = malloc(sizeof(size_t) + size);
+    if (!block) return NULL;
+    *block = size;
+    heap_now += size;
+    if (heap_now > heap_peak) heap_peak = heap_now;
+    return block + 1;
+}
+
+static void counting_free(void* ptr)
+{
+    if (!ptr) return;
+    size_t* block = (size_t*)ptr - 1;
+    heap_now -= *block;
+    free(block);
+}
+
+static uint8_t cjson_number(const cJSON* object, const char* key)
+{
+    const cJSON* item = cJSON_GetObjectItemCaseSensitive(object, key);
+    return cJSON_IsNumber(item) ? item->valueint : 0;
+}
+
+static __attribute__((noinline)) void cjson_parse(const char* body, bool batch)
+{
+    cJSON* root = cJSON_Parse(body);
+    if (!root) abort();
+    const cJSON* op;
+    if (batch) {
+        cJSON_ArrayForEach(op, root) {
+            sink += cjson_number(op, "start") + cjson_number(op, "red") + cjson_number(op, "green") + cjson_number(op, "blue");
+            sink += cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(op, "state"));
+            sink += cJSON_IsString(cJSON_GetObjectItemCaseSensitive(op, "mode"));
+        }
+    } else {
+        sink += cjson_number(root, "red") + cjson_number(root, "green") + cjson_number(root, "blue") + cjson_number(root, "white");
+    }
+    cJSON_Delete(root);
+}
+#endif
+
+static __attribute__((noinline)) void paint_stack()
+{
+    volatile uint8_t area[STACK_PAINT_SIZE];
+    for (size_t i = 0; i < sizeof(area); i++) area[i] = STACK_PAINT;
+}
+
+static __attribute__((noinline)) size_t stack_used()
+{
+    volatile uint8_t area[STACK_PAINT_SIZE];
+    size_t untouched = 0;
+    while (untouched < sizeof(area) && area[untouched] == STACK_PAINT) untouched++;
+    return sizeof(area) - untouched;
+}
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench(const char* parser, void (*parse)(const char*, bool), const char* name, const char* body, bool batch, int iterations)
+{
+    // Warmed up first, so the dynamic linker resolving symbols isn't counted as the parser's stack
+    parse(body, batch);
+    paint_stack();
+    parse(body, batch);
+    size_t stack = stack_used();
+#if HAVE_CJSON
+    heap_now = heap_peak = 0;
+    parse(body, batch);
+    size_t heap = heap_peak;
+#else
+    size_t heap = 0;
+#endif
+
+    double start = now_ns();
+    for (int i = 0; i < iterations; i++) {
+        parse(body, batch);
+    }
+    double ns = (now_ns() - start) / iterations;
+    printf("%-11s %-6s %5zu bytes  %9.0f ns  %6.1f MB/s  stack ~%5zu  heap %6zu\n",
+           parser, name, strlen(body), ns, strlen(body) / ns * 1e3, stack, heap);
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+    build_batch_body();
+#if HAVE_CJSON
+    cJSON_Hooks hooks = { .malloc_fn = counting_malloc, .free_fn = counting_free };
+    cJSON_InitHooks(&hooks);
+#endif
+
+    printf("json_stream_t is %zu bytes\n", sizeof(json_stream_t));
+    bench("json_stream", stream_parse, "color", COLOR_BODY, false, iterations);
+    bench("json_stream", stream_parse, "batch", batch_body, true, iterations / 10);
+#if HAVE_CJSON
+    bench("cJSON", cjson_parse, "color", COLOR_BODY, false, iterations);
+    bench("cJSON", cjson_parse, "batch", batch_body, true, iterations / 10);
+#else
+    printf("cJSON not found, configure with -DCJSON_DIR=<directory with cJSON.c> to compare\n");
+#endif
+    return 0;
+}
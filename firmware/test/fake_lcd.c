@@ -0,0 +1,90 @@
+#include <stdlib.h>
+#include <string.h>
+#include "fake_lcd.h"
+
+fake_lcd_t fake_lcd;
+
+void fake_lcd_reset(void)
+{
+    free(fake_lcd.last_data);
+    memset(&fake_lcd, 0, sizeof(fake_lcd));
+}
+
+esp_err_t esp_lcd_new_i80_bus(const esp_lcd_i80_bus_config_t* bus_config, esp_lcd_i80_bus_handle_t* ret_bus)
+{
+    if (bus_config->bus_width != 8 && bus_config->bus_width != 16) return ESP_ERR_INVALID_ARG;
+    esp_lcd_i80_bus_handle_t bus = calloc(1, sizeof(*bus));
+    if (!bus) return ESP_ERR_NO_MEM;
+    bus->config = *bus_config;
+    fake_lcd.bus_config = *bus_config;
+    fake_lcd.live_buses++;
+    *ret_bus = bus;
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_del_i80_bus(esp_lcd_i80_bus_handle_t bus)
+{
+    fake_lcd.live_buses--;
+    free(bus);
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_new_panel_io_i80(esp_lcd_i80_bus_handle_t bus, const esp_lcd_panel_io_i80_config_t* io_config, esp_lcd_panel_io_handle_t* ret_io)
+{
+    esp_lcd_panel_io_handle_t io = calloc(1, sizeof(*io));
+    if (!io) return ESP_ERR_NO_MEM;
+    io->bus = bus;
+    io->config = *io_config;
+    fake_lcd.io_config = *io_config;
+    fake_lcd.live_ios++;
+    *ret_io = io;
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_io_del(esp_lcd_panel_io_handle_t io)
+{
+    fake_lcd.live_ios--;
+    free(io);
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_io_tx_color(esp_lcd_panel_io_handle_t io, int lcd_cmd, const void* color, size_t color_size)
+{
+    fake_lcd.over_max_transfer |= color_size > io->bus->config.max_transfer_bytes;
+    free(fake_lcd.last_data);
+    fake_lcd.last_data = malloc(color_size);
+    if (!fake_lcd.last_data) return ESP_ERR_NO_MEM;
+    memcpy(fake_lcd.last_data, color, color_size);
+    fake_lcd.last_size = color_size;
+    fake_lcd.last_cmd = lcd_cmd;
+    fake_lcd.transfers++;
+    if (io->config.on_color_trans_done) {
+        esp_lcd_panel_io_event_data_t event = {0};
+        io->config.on_color_trans_done(io, &event, io->config.user_ctx);
+    }
+    return ESP_OK;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    static int task;
+    return (TaskHandle_t)&task;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higher_priority_task_woken)
+{
+    fake_lcd.notifications++;
+    if (higher_priority_task_woken) *higher_priority_task_woken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_count_on_exit, TickType_t ticks_to_wait)
+{
+    uint32_t count = fake_lcd.notifications;
+    if (count == 0) {
+        // Would block forever on the device
+        fake_lcd.takes_without_notification++;
+        return 0;
+    }
+    fake_lcd.notifications = clear_count_on_exit ? 0 : count - 1;
+    return count;
+}
@@ -0,0 +1,42 @@
+#ifndef FAKE_LCD_H
+#define FAKE_LCD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_lcd_panel_io.h"
+#include "freertos/task.h"
+
+// A host i80 bus that keeps a copy of each color transfer and completes it at once, calling the
+// transfer-done callback as the DMA interrupt would, with task notifications for the one caller
+
+struct esp_lcd_i80_bus_t {
+    esp_lcd_i80_bus_config_t config;
+};
+
+struct esp_lcd_panel_io_t {
+    esp_lcd_i80_bus_handle_t bus;
+    esp_lcd_panel_io_i80_config_t config;
+};
+
+typedef struct {
+    int live_buses;
+    int live_ios;
+    uint32_t transfers;
+    int last_cmd;
+    uint8_t* last_data;             // Copy of the last transfer, freed by fake_lcd_reset
+    size_t last_size;
+    bool over_max_transfer;         // A transfer was longer than the bus's max_transfer_bytes
+    uint32_t notifications;         // Given and not yet taken
+    uint32_t takes_without_notification;
+    esp_lcd_i80_bus_config_t bus_config;
+    esp_lcd_panel_io_i80_config_t io_config;
+} fake_lcd_t;
+
+extern fake_lcd_t fake_lcd;
+
+/**
+ * @brief   Frees the last transfer and zeroes every counter, between tests
+ */
+void fake_lcd_reset(void);
+
+#endif // FAKE_LCD_H
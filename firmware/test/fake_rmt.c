@@ -0,0 +1,233 @@
+#include <stdlib.h>
+#include <string.h>
+#include "fake_rmt.h"
+
+typedef enum {
+    BYTES_ENCODER,
+    COPY_ENCODER
+} encoder_kind_t;
+
+typedef struct {
+    rmt_encoder_t base;
+    encoder_kind_t kind;
+    rmt_symbol_word_t bit0;
+    rmt_symbol_word_t bit1;
+    bool msb_first;
+    size_t position;                // Bits or symbols of the current data already written
+} fake_encoder_t;
+
+struct rmt_sync_manager_t {
+    int unused;
+};
+
+struct rmt_channel_t fake_rmt_channels[FAKE_RMT_TX_CHANNELS];
+uint32_t fake_rmt_sync_resets;
+int fake_rmt_live_encoders;
+static struct rmt_sync_manager_t sync_manager;
+static bool sync_in_use;
+
+static bool write_symbol(rmt_channel_handle_t channel, rmt_symbol_word_t symbol)
+{
+    if (channel->mem_used == channel->mem_block_symbols || channel->symbol_count == FAKE_RMT_MAX_SYMBOLS) return false;
+    channel->mem_used++;
+    channel->symbols[channel->symbol_count++] = symbol;
+    return true;
+}
+
+static size_t fake_encode(rmt_encoder_t* encoder, rmt_channel_handle_t channel, const void* data, size_t size, rmt_encode_state_t* ret_state)
+{
+    fake_encoder_t* fake = (fake_encoder_t*)encoder;
+    const uint8_t* bytes = data;
+    size_t total = fake->kind == BYTES_ENCODER ? size * 8 : size / sizeof(rmt_symbol_word_t);
+    size_t written = 0;
+    while (fake->position < total) {
+        rmt_symbol_word_t symbol;
+        if (fake->kind == BYTES_ENCODER) {
+            size_t bit = fake->position % 8;
+            bool one = bytes[fake->position / 8] >> (fake->msb_first ? 7 - bit : bit) & 1;
+            symbol = one ? fake->bit1 : fake->bit0;
+        } else {
+            memcpy(&symbol, &bytes[fake->position * sizeof(symbol)], sizeof(symbol));
+        }
+        if (!write_symbol(channel, symbol)) {
+            *ret_state = RMT_ENCODING_MEM_FULL;
+            return written;
+        }
+        fake->position++;
+        written++;
+    }
+    fake->position = 0;
+    *ret_state = RMT_ENCODING_COMPLETE;
+    return written;
+}
+
+static esp_err_t fake_reset(rmt_encoder_t* encoder)
+{
+    ((fake_encoder_t*)encoder)->position = 0;
+    return ESP_OK;
+}
+
+static esp_err_t fake_del(rmt_encoder_t* encoder)
+{
+    fake_rmt_live_encoders--;
+    free(encoder);
+    return ESP_OK;
+}
+
+static esp_err_t new_encoder(encoder_kind_t kind, rmt_encoder_handle_t* ret_encoder, fake_encoder_t** fake)
+{
+    *fake = calloc(1, sizeof(fake_encoder_t));
+    if (!*fake) return ESP_ERR_NO_MEM;
+    (*fake)->base.encode = fake_encode;
+    (*fake)->base.reset = fake_reset;
+    (*fake)->base.del = fake_del;
+    (*fake)->kind = kind;
+    fake_rmt_live_encoders++;
+    *ret_encoder = &(*fake)->base;
+    return ESP_OK;
+}
+
+void fake_rmt_reset(void)
+{
+    memset(fake_rmt_channels, 0, sizeof(fake_rmt_channels));
+    fake_rmt_sync_resets = 0;
+    fake_rmt_live_encoders = 0;
+    sync_in_use = false;
+}
+
+struct rmt_channel_t* fake_rmt_channel(int gpio)
+{
+    for (int i = 0; i < FAKE_RMT_TX_CHANNELS; i++) {
+        if (fake_rmt_channels[i].in_use && fake_rmt_channels[i].gpio == gpio) return &fake_rmt_channels[i];
+    }
+    return NULL;
+}
+
+size_t fake_rmt_decode(const struct rmt_channel_t* channel, uint32_t threshold, uint8_t* out)
+{
+    size_t bits = channel->symbol_count ? channel->symbol_count - 1 : 0;
+    memset(out, 0, bits / 8);
+    for (size_t i = 0; i < bits / 8 * 8; i++) {
+        if (channel->symbols[i].duration0 > threshold) {
+            out[i / 8] |= 0x80 >> (i % 8);
+        }
+    }
+    return bits / 8;
+}
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t* config, rmt_channel_handle_t* ret_chan)
+{
+    for (int i = 0; i < FAKE_RMT_TX_CHANNELS; i++) {
+        struct rmt_channel_t* channel = &fake_rmt_channels[i];
+        if (channel->in_use) continue;
+        memset(channel, 0, sizeof(*channel));
+        channel->in_use = true;
+        channel->gpio = config->gpio_num;
+        channel->resolution_hz = config->resolution_hz;
+        channel->mem_block_symbols = config->mem_block_symbols;
+        *ret_chan = channel;
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel)
+{
+    if (channel->enabled) return ESP_ERR_INVALID_STATE;
+    channel->in_use = false;
+    return ESP_OK;
+}
+
+esp_err_t rmt_enable(rmt_channel_handle_t channel)
+{
+    channel->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_disable(rmt_channel_handle_t channel)
+{
+    channel->enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t rmt_transmit(rmt_channel_handle_t channel, rmt_encoder_handle_t encoder, const void* payload, size_t payload_bytes, const rmt_transmit_config_t* config)
+{
+    if (!channel->enabled) return ESP_ERR_INVALID_STATE;
+    channel->symbol_count = 0;
+    channel->mem_used = 0;
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    // The driver calls the encoder again each time the hardware has drained the memory
+    while (!(state & RMT_ENCODING_COMPLETE)) {
+        size_t before = channel->symbol_count;
+        encoder->encode(encoder, channel, payload, payload_bytes, &state);
+        if (!(state & RMT_ENCODING_COMPLETE) && channel->symbol_count == before) {
+            return ESP_FAIL;            // An encoder that makes no progress on empty memory would hang
+        }
+        channel->mem_used = 0;
+    }
+    channel->transmissions++;
+    channel->last_bytes = payload_bytes;
+    channel->sync_reset_seen = fake_rmt_sync_resets;
+    channel->pending = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t channel, int timeout_ms)
+{
+    channel->pending = false;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t* config, rmt_encoder_handle_t* ret_encoder)
+{
+    fake_encoder_t* fake;
+    esp_err_t err = new_encoder(BYTES_ENCODER, ret_encoder, &fake);
+    if (err != ESP_OK) return err;
+    fake->bit0 = config->bit0;
+    fake->bit1 = config->bit1;
+    fake->msb_first = config->flags.msb_first;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t* config, rmt_encoder_handle_t* ret_encoder)
+{
+    fake_encoder_t* fake;
+    return new_encoder(COPY_ENCODER, ret_encoder, &fake);
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder)
+{
+    return encoder->del(encoder);
+}
+
+esp_err_t rmt_encoder_reset(rmt_encoder_handle_t encoder)
+{
+    return encoder->reset(encoder);
+}
+
+esp_err_t rmt_new_sync_manager(const rmt_sync_manager_config_t* config, rmt_sync_manager_handle_t* ret_synchro)
+{
+    if (sync_in_use) return ESP_ERR_NOT_FOUND;
+    for (size_t i = 0; i < config->array_size; i++) {
+        if (!config->tx_channel_array[i]->enabled) return ESP_ERR_INVALID_STATE;
+        config->tx_channel_array[i]->synced = true;
+    }
+    sync_in_use = true;
+    *ret_synchro = &sync_manager;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_sync_manager(rmt_sync_manager_handle_t synchro)
+{
+    for (int i = 0; i < FAKE_RMT_TX_CHANNELS; i++) {
+        fake_rmt_channels[i].synced = false;
+    }
+    sync_in_use = false;
+    return ESP_OK;
+}
+
+esp_err_t rmt_sync_reset(rmt_sync_manager_handle_t synchro)
+{
+    fake_rmt_sync_resets++;
+    return ESP_OK;
+}
@@ -0,0 +1,59 @@
+#ifndef FAKE_RMT_H
+#define FAKE_RMT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/rmt_tx.h"
+
+// A host RMT that runs the encoders into a channel memory of mem_block_symbols, emptying it whenever an
+// encoder reports it full like the hardware's ping-pong refill, and keeps the symbols of each channel's
+// last transmission
+
+#define FAKE_RMT_TX_CHANNELS 4      // Like the ESP32-S3
+#define FAKE_RMT_MAX_SYMBOLS 4096
+
+struct rmt_channel_t {
+    bool in_use;
+    int gpio;
+    uint32_t resolution_hz;
+    size_t mem_block_symbols;
+    size_t mem_used;                // Symbols written since the memory was last emptied
+    bool enabled;
+    bool pending;                   // Transmitted and not yet waited for
+    bool synced;
+    uint32_t transmissions;
+    size_t last_bytes;              // Payload size of the last transmission
+    uint32_t sync_reset_seen;       // fake_rmt_sync_resets when this channel last transmitted
+    rmt_symbol_word_t symbols[FAKE_RMT_MAX_SYMBOLS];
+    size_t symbol_count;            // Of the last transmission, data and reset
+};
+
+extern struct rmt_channel_t fake_rmt_channels[FAKE_RMT_TX_CHANNELS];
+extern uint32_t fake_rmt_sync_resets;
+extern int fake_rmt_live_encoders;  // Created and not yet deleted
+
+/**
+ * @brief   Frees every channel and zeroes the counters, between tests
+ */
+void fake_rmt_reset(void);
+
+/**
+ * @brief   Finds the channel created for a GPIO
+ *
+ * @return The channel, or NULL
+ */
+struct rmt_channel_t* fake_rmt_channel(int gpio);
+
+/**
+ * @brief   Decodes a transmission back to bytes by comparing each symbol's high time to the midpoint of
+ *          the bit0 and bit1 high times
+ *
+ * @param channel: Channel whose last transmission to decode
+ * @param threshold: Ticks, high times above it are ones
+ * @param out: Filled with the bytes, MSB first
+ *
+ * @return Bytes decoded, the trailing reset symbol is not counted
+ */
+size_t fake_rmt_decode(const struct rmt_channel_t* channel, uint32_t threshold, uint8_t* out);
+
+#endif // FAKE_RMT_H
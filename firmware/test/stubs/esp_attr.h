@@ -0,0 +1,8 @@
+#ifndef ESP_ATTR_H
+#define ESP_ATTR_H
+
+// Host stand-in for ESP-IDF's esp_attr.h, code placement means nothing on a host
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#endif // ESP_ATTR_H
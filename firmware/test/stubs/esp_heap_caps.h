@@ -0,0 +1,21 @@
+#ifndef ESP_HEAP_CAPS_H
+#define ESP_HEAP_CAPS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Host stand-in for ESP-IDF's esp_heap_caps.h, every capability is the ordinary heap
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+static inline void* heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    return calloc(n, size);
+}
+
+static inline void heap_caps_free(void* ptr)
+{
+    free(ptr);
+}
+
+#endif // ESP_HEAP_CAPS_H
@@ -0,0 +1,13 @@
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include <inttypes.h>
+
+// Host stand-in for ESP-IDF's esp_log.h, logs are dropped so test output is only the checks
+#define ESP_LOG_DROP(tag, format, ...) do { (void)(tag); } while (0)
+#define ESP_LOGE(tag, format, ...) ESP_LOG_DROP(tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_DROP(tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_DROP(tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_DROP(tag, format, ##__VA_ARGS__)
+
+#endif // ESP_LOG_H
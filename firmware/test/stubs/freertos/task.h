@@ -0,0 +1,16 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+// Host stand-in for FreeRTOS task notifications, for a single task: implemented by fake_lcd.c, where a
+// take without a pending notification fails the test rather than blocking
+
+typedef struct host_task_t* TaskHandle_t;
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higher_priority_task_woken);
+uint32_t ulTaskNotifyTake(BaseType_t clear_count_on_exit, TickType_t ticks_to_wait);
+
+#endif // TASK_H
@@ -0,0 +1,37 @@
+#ifndef LED_STRIP_H
+#define LED_STRIP_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip_interface.h"
+
+// Host stand-in for the led_strip component's API, which dispatches through the backend like these do
+
+typedef struct led_strip_t* led_strip_handle_t;
+
+static inline esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    return strip->set_pixel(strip, index, red, green, blue);
+}
+
+static inline esp_err_t led_strip_set_pixel_rgbw(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    return strip->set_pixel_rgbw(strip, index, red, green, blue, white);
+}
+
+static inline esp_err_t led_strip_refresh(led_strip_handle_t strip)
+{
+    return strip->refresh(strip);
+}
+
+static inline esp_err_t led_strip_clear(led_strip_handle_t strip)
+{
+    return strip->clear(strip);
+}
+
+static inline esp_err_t led_strip_del(led_strip_handle_t strip)
+{
+    return strip->del(strip);
+}
+
+#endif // LED_STRIP_H
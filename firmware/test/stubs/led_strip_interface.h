@@ -0,0 +1,19 @@
+#ifndef LED_STRIP_INTERFACE_H
+#define LED_STRIP_INTERFACE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Host stand-in for the led_strip component's backend interface
+
+typedef struct led_strip_t led_strip_t;
+
+struct led_strip_t {
+    esp_err_t (*set_pixel)(led_strip_t* strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
+    esp_err_t (*set_pixel_rgbw)(led_strip_t* strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
+    esp_err_t (*refresh)(led_strip_t* strip);
+    esp_err_t (*clear)(led_strip_t* strip);
+    esp_err_t (*del)(led_strip_t* strip);
+};
+
+#endif // LED_STRIP_INTERFACE_H
@@ -0,0 +1,6 @@
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+// Host stand-in for the generated sdkconfig.h, the host-built modules read no options of their own
+
+#endif // SDKCONFIG_H
@@ -0,0 +1,12 @@
+#ifndef SOC_CAPS_H
+#define SOC_CAPS_H
+
+// Host stand-in for the ESP32-S3 soc_caps.h, only what the host-built modules read. Tests override
+// SOC_RMT_SUPPORT_TX_SYNCHRO to build as for chips without RMT TX sync
+#ifndef SOC_RMT_SUPPORT_TX_SYNCHRO
+#define SOC_RMT_SUPPORT_TX_SYNCHRO 1
+#endif
+#define SOC_RMT_TX_CANDIDATES_PER_GROUP 4
+#define SOC_RMT_MEM_WORDS_PER_CHANNEL 48
+
+#endif // SOC_CAPS_H
@@ -0,0 +1,12 @@
+#ifndef HOST_SYS_CDEFS_H
+#define HOST_SYS_CDEFS_H
+
+// The C library's own, plus __containerof from newlib's, which the IDF driver interfaces are built on
+#include_next <sys/cdefs.h>
+#include <stddef.h>
+
+#ifndef __containerof
+#define __containerof(ptr, type, member) ((type*)((char*)(ptr) - offsetof(type, member)))
+#endif
+
+#endif // HOST_SYS_CDEFS_H
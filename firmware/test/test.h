@@ -0,0 +1,35 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+// Just enough of a test harness for ctest: failed checks are printed and counted, main returns test_result()
+static int test_failures;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_EQ(actual, expected) do { \
+    long long actual_ = (long long)(actual); \
+    long long expected_ = (long long)(expected); \
+    if (actual_ != expected_) { \
+        fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #actual, #expected, actual_, expected_); \
+        test_failures++; \
+    } \
+} while (0)
+
+static inline int test_result(const char* name)
+{
+    if (test_failures) {
+        fprintf(stderr, "%s: %d checks failed\n", name, test_failures);
+        return 1;
+    }
+    printf("%s: passed\n", name);
+    return 0;
+}
+
+#endif // TEST_H
@@ -0,0 +1,337 @@
+/*
+ * fft.c and audio_analysis.c on audio read from WAV data: bin placement and scaling of pure tones,
+ * the transform against a floating-point DFT, and beats found on a synthetic click track. The signals are
+ * synthesized as 16-bit mono WAV files in memory and go through the same reader as a recording would.
+ *
+ * Given a WAV file (16-bit PCM, mono, ideally 22050 Hz), prints the features of every block instead:
+ *     ./test_audio_analysis recording.wav
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fft.h"
+#include "audio_analysis.h"
+#include "test.h"
+
+#define SAMPLE_RATE 22050
+#define WAV_HEADER_SIZE 44
+
+typedef struct {
+    uint32_t sample_rate;
+    uint32_t count;
+    int16_t* samples;
+} wav_t;
+
+static void put_u16(uint8_t* at, uint16_t value)
+{
+    at[0] = value;
+    at[1] = value >> 8;
+}
+
+static void put_u32(uint8_t* at, uint32_t value)
+{
+    put_u16(at, value);
+    put_u16(at + 2, value >> 16);
+}
+
+static uint32_t get_u32(const uint8_t* at)
+{
+    return at[0] | at[1] << 8 | at[2] << 16 | (uint32_t)at[3] << 24;
+}
+
+static uint16_t get_u16(const uint8_t* at)
+{
+    return at[0] | at[1] << 8;
+}
+
+// Canonical 44 byte header followed by the samples, little-endian
+static uint8_t* wav_encode(const int16_t* samples, uint32_t count, size_t* size)
+{
+    *size = WAV_HEADER_SIZE + count * 2;
+    uint8_t* wav = malloc(*size);
+    memcpy(wav, "RIFF", 4);
+    put_u32(wav + 4, *size - 8);
+    memcpy(wav + 8, "WAVEfmt ", 8);
+    put_u32(wav + 16, 16);
+    put_u16(wav + 20, 1);               // PCM
+    put_u16(wav + 22, 1);               // Mono
+    put_u32(wav + 24, SAMPLE_RATE);
+    put_u32(wav + 28, SAMPLE_RATE * 2);
+    put_u16(wav + 32, 2);
+    put_u16(wav + 34, 16);
+    memcpy(wav + 36, "data", 4);
+    put_u32(wav + 40, count * 2);
+    for (uint32_t i = 0; i < count; i++) {
+        put_u16(wav + WAV_HEADER_SIZE + 2 * i, (uint16_t)samples[i]);
+    }
+    return wav;
+}
+
+// Walks the chunks for fmt and data, so files with extra chunks read too. Returns false for anything
+// other than 16-bit mono PCM
+static bool wav_decode(const uint8_t* data, size_t size, wav_t* wav)
+{
+    if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) return false;
+    bool format_ok = false;
+    for (size_t pos = 12; pos + 8 <= size;) {
+        uint32_t chunk_size = get_u32(data + pos + 4);
+        const uint8_t* body = data + pos + 8;
+        if (chunk_size > size - pos - 8) return false;
+        if (memcmp(data + pos, "fmt ", 4) == 0 && chunk_size >= 16) {
+            format_ok = get_u16(body) == 1 && get_u16(body + 2) == 1 && get_u16(body + 14) == 16;
+            wav->sample_rate = get_u32(body + 4);
+        } else if (memcmp(data + pos, "data", 4) == 0 && format_ok) {
+            wav->count = chunk_size / 2;
+            wav->samples = malloc(wav->count * sizeof(int16_t) + 1);
+            for (uint32_t i = 0; i < wav->count; i++) {
+                wav->samples[i] = (int16_t)get_u16(body + 2 * i);
+            }
+            return true;
+        }
+        pos += 8 + chunk_size + (chunk_size & 1);
+    }
+    return false;
+}
+
+// Synthesized samples through a WAV file and back, as the tests would get them from a recording
+static wav_t through_wav(const int16_t* samples, uint32_t count)
+{
+    size_t size;
+    uint8_t* file = wav_encode(samples, count, &size);
+    wav_t wav = {0};
+    CHECK(wav_decode(file, size, &wav));
+    CHECK_EQ(wav.count, count);
+    CHECK_EQ(wav.sample_rate, SAMPLE_RATE);
+    free(file);
+    return wav;
+}
+
+static double magnitude(fft_complex_t bin)
+{
+    return sqrt((double)fft_power(bin));
+}
+
+static void test_fft_sizes()
+{
+    static fft_t fft;
+    CHECK_EQ(fft_init(&fft, 8), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(fft_init(&fft, 48), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(fft_init(&fft, 2048), ESP_ERR_INVALID_ARG);
+    for (uint16_t points = 16; points <= FFT_MAX_POINTS; points *= 2) {
+        CHECK_EQ(fft_init(&fft, points), ESP_OK);
+    }
+}
+
+static void test_tone_bins()
+{
+    static fft_t fft;
+    static int16_t tone[AUDIO_BLOCK_SIZE];
+    static fft_complex_t spectrum[AUDIO_BLOCK_SIZE / 2 + 1];
+    fft_init(&fft, AUDIO_BLOCK_SIZE);
+
+    const uint16_t bins[] = { 1, 3, 23, 64, 100, 200, 255 };
+    for (size_t b = 0; b < sizeof(bins) / sizeof(bins[0]); b++) {
+        for (int amplitude = 32767; amplitude >= 4096; amplitude /= 2) {
+            for (int n = 0; n < AUDIO_BLOCK_SIZE; n++) {
+                tone[n] = (int16_t)lround(amplitude * sin(2 * M_PI * bins[b] * n / AUDIO_BLOCK_SIZE + 0.3));
+            }
+            wav_t wav = through_wav(tone, AUDIO_BLOCK_SIZE);
+            fft_real(&fft, wav.samples, spectrum);
+            free(wav.samples);
+
+            uint16_t loudest = 0;
+            double leak = 0;
+            for (uint16_t k = 0; k <= AUDIO_BLOCK_SIZE / 2; k++) {
+                if (fft_power(spectrum[k]) > fft_power(spectrum[loudest])) loudest = k;
+            }
+            for (uint16_t k = 0; k <= AUDIO_BLOCK_SIZE / 2; k++) {
+                if (k != bins[b] && magnitude(spectrum[k]) > leak) leak = magnitude(spectrum[k]);
+            }
+            // The spectrum is divided by points: amplitude / 2 in the tone's bin
+            double expected = amplitude / 2.0;
+            double got = magnitude(spectrum[bins[b]]);
+            CHECK_EQ(loudest, bins[b]);
+            if (fabs(got - expected) > expected * 0.02 || leak > 8) {
+                fprintf(stderr, "bin %u amplitude %d: %.1f, expected %.1f, largest other bin %.1f\n", bins[b], amplitude, got, expected, leak);
+                test_failures++;
+            }
+        }
+    }
+
+    // A constant lands in bin 0 at its own value
+    for (int n = 0; n < AUDIO_BLOCK_SIZE; n++) {
+        tone[n] = 10000;
+    }
+    fft_real(&fft, tone, spectrum);
+    CHECK(abs(spectrum[0].re - 10000) <= 2);
+    CHECK(magnitude(spectrum[1]) <= 2);
+}
+
+// Against a double-precision DFT divided by points, on noise that uses the whole range
+static void test_against_dft()
+{
+    static fft_t fft;
+    static int16_t noise[AUDIO_BLOCK_SIZE];
+    static fft_complex_t spectrum[AUDIO_BLOCK_SIZE / 2 + 1];
+    fft_init(&fft, AUDIO_BLOCK_SIZE);
+    srand(3);
+    for (int n = 0; n < AUDIO_BLOCK_SIZE; n++) {
+        noise[n] = (int16_t)(rand() % 65536 - 32768);
+    }
+    fft_real(&fft, noise, spectrum);
+
+    double worst = 0;
+    for (int k = 0; k <= AUDIO_BLOCK_SIZE / 2; k++) {
+        double re = 0, im = 0;
+        for (int n = 0; n < AUDIO_BLOCK_SIZE; n++) {
+            re += noise[n] * cos(2 * M_PI * k * n / AUDIO_BLOCK_SIZE);
+            im -= noise[n] * sin(2 * M_PI * k * n / AUDIO_BLOCK_SIZE);
+        }
+        double error = hypot(spectrum[k].re - re / AUDIO_BLOCK_SIZE, spectrum[k].im - im / AUDIO_BLOCK_SIZE);
+        if (error > worst) worst = error;
+    }
+    // Halving every stage costs about a bit of rounding per stage
+    if (worst > 8) {
+        fprintf(stderr, "FFT is off the DFT by up to %.2f\n", worst);
+        test_failures++;
+    }
+}
+
+static void process(audio_analysis_t* analysis, const wav_t* wav, uint32_t block, audio_features_t* features)
+{
+    audio_analysis_process(analysis, wav->samples + block * AUDIO_BLOCK_SIZE, features);
+}
+
+static void test_tone_band()
+{
+    static audio_analysis_t analysis;
+    audio_analysis_init(&analysis);
+    // 1 kHz is bin 23.2, in band 4 (bins 16 to 31)
+    uint32_t count = AUDIO_BLOCK_SIZE * 20;
+    int16_t* tone = malloc(count * sizeof(int16_t));
+    for (uint32_t n = 0; n < count; n++) {
+        tone[n] = (int16_t)lround(8000 * sin(2 * M_PI * 1000 * n / SAMPLE_RATE)) + 500;
+    }
+    wav_t wav = through_wav(tone, count);
+    free(tone);
+
+    audio_features_t features;
+    for (uint32_t block = 0; block < count / AUDIO_BLOCK_SIZE; block++) {
+        process(&analysis, &wav, block, &features);
+    }
+    CHECK_EQ(features.bands[4], 255);
+    for (int band = 0; band < AUDIO_BANDS; band++) {
+        if (band != 4) CHECK(features.bands[band] < features.bands[4]);
+    }
+    // The offset is removed before the window: left in, 500 through the Hann window would be about 250
+    // in bin 0, what remains is the tone's own partial period in the block
+    CHECK(abs(analysis.spectrum[0].re) < 64);
+    CHECK(features.level > 200);
+    CHECK(!features.beat);
+    free(wav.samples);
+
+    // Silence after the tone, the peaks are still high and there is nothing above the floor
+    int16_t silence[AUDIO_BLOCK_SIZE] = {0};
+    audio_analysis_process(&analysis, silence, &features);
+    CHECK_EQ(features.level, 0);
+    for (int band = 0; band < AUDIO_BANDS; band++) {
+        CHECK_EQ(features.bands[band], 0);
+    }
+}
+
+static void test_click_track()
+{
+    static audio_analysis_t analysis;
+    audio_analysis_init(&analysis);
+    // 120 BPM for 12 s: a 70 ms, 80 Hz thump with an exponential decay every half second over quiet
+    // broadband noise
+    const uint32_t period = SAMPLE_RATE / 2;
+    const uint32_t count = SAMPLE_RATE * 12 / AUDIO_BLOCK_SIZE * AUDIO_BLOCK_SIZE;
+    int16_t* track = malloc(count * sizeof(int16_t));
+    srand(5);
+    for (uint32_t n = 0; n < count; n++) {
+        uint32_t since = n % period;
+        double thump = since < SAMPLE_RATE * 70 / 1000 ? 20000 * exp(-(double)since / (SAMPLE_RATE * 0.02)) * sin(2 * M_PI * 80 * since / SAMPLE_RATE) : 0;
+        track[n] = (int16_t)lround(thump + (rand() % 401 - 200));
+    }
+    wav_t wav = through_wav(track, count);
+    free(track);
+
+    // Blocks a click starts in, after the first second of history
+    uint32_t clicks = 0, found = 0, spurious = 0;
+    audio_features_t features;
+    int32_t last_click_block = -100;
+    for (uint32_t block = 0; block < count / AUDIO_BLOCK_SIZE; block++) {
+        uint32_t first = block * AUDIO_BLOCK_SIZE;
+        bool click_starts = first % period > period - AUDIO_BLOCK_SIZE || first % period == 0;
+        if (click_starts) last_click_block = block;
+        process(&analysis, &wav, block, &features);
+        if (block < AUDIO_BEAT_HISTORY) continue;
+        clicks += click_starts;
+        if (features.beat) {
+            // A beat belongs to the click that started in this block or the one before
+            if ((int32_t)block - last_click_block <= 1) {
+                found++;
+            } else {
+                spurious++;
+            }
+        }
+    }
+    free(wav.samples);
+    printf("click track: %u clicks, %u beats on them, %u elsewhere\n", clicks, found, spurious);
+    CHECK(clicks >= 20);
+    CHECK(found >= clicks * 9 / 10);
+    CHECK(found <= clicks);
+    CHECK_EQ(spurious, 0);
+}
+
+// Features of every block of a recording, for checking by eye
+static int print_recording(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    size_t size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* data = malloc(size);
+    size_t read = fread(data, 1, size, file);
+    fclose(file);
+    wav_t wav = {0};
+    if (read != size || !wav_decode(data, size, &wav)) {
+        fprintf(stderr, "%s: not a 16-bit mono PCM WAV file\n", path);
+        return 1;
+    }
+    free(data);
+    if (wav.sample_rate != SAMPLE_RATE) {
+        fprintf(stderr, "%s: %u Hz, the firmware records at %d Hz so bands and beats shift\n", path, wav.sample_rate, SAMPLE_RATE);
+    }
+
+    static audio_analysis_t analysis;
+    audio_analysis_init(&analysis);
+    audio_features_t features;
+    for (uint32_t block = 0; block < wav.count / AUDIO_BLOCK_SIZE; block++) {
+        process(&analysis, &wav, block, &features);
+        printf("%8.3f s  level %3u  bands", (double)block * AUDIO_BLOCK_SIZE / wav.sample_rate, features.level);
+        for (int band = 0; band < AUDIO_BANDS; band++) {
+            printf(" %3u", features.bands[band]);
+        }
+        printf("%s\n", features.beat ? "  beat" : "");
+    }
+    free(wav.samples);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1) return print_recording(argv[1]);
+    test_fft_sizes();
+    test_tone_bins();
+    test_against_dft();
+    test_tone_band();
+    test_click_track();
+    return test_result("audio_analysis");
+}
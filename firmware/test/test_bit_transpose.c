@@ -0,0 +1,111 @@
+/*
+ * bit_transpose.c against a naive per-bit transpose on random lanes, and the time of each for a frame
+ * of 16 lanes of 300 RGB pixels, what parallel_strip.c encodes per refresh.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bit_transpose.h"
+#include "test.h"
+
+#define LANES 16
+#define FRAME_BYTES (300 * 3)
+#define WORDS (FRAME_BYTES * 8 * BIT_TRANSPOSE_WORDS_PER_BIT)
+#define BENCH_FRAMES 200
+
+static uint8_t lanes[LANES * FRAME_BYTES];
+static uint16_t fast[WORDS];
+static uint16_t naive[WORDS];
+
+// One bit at a time: word 3 * (8 * i + bit) + 1 holds bit (7 - bit) of byte i of every lane
+static size_t naive_encode(const uint8_t* in, size_t lane_stride, size_t bytes, int lane_count, uint16_t* out)
+{
+    size_t words = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            uint16_t data = 0;
+            for (int lane = 0; lane < lane_count; lane++) {
+                data |= ((in[lane * lane_stride + i] >> bit) & 1) << lane;
+            }
+            out[words++] = lane_count == 8 ? 0xFF : 0xFFFF;
+            out[words++] = data;
+            out[words++] = 0;
+        }
+    }
+    return words;
+}
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void test_8x8()
+{
+    // Every single set bit lands in exactly one place
+    for (int lane = 0; lane < 8; lane++) {
+        for (int bit = 0; bit < 8; bit++) {
+            uint8_t in[8] = {0};
+            uint8_t out[8];
+            in[lane] = 1 << bit;
+            bit_transpose_8x8(in, out);
+            for (int plane = 0; plane < 8; plane++) {
+                CHECK_EQ(out[plane], plane == 7 - bit ? 1 << lane : 0);
+            }
+        }
+    }
+}
+
+static void test_encode()
+{
+    for (size_t i = 0; i < sizeof(lanes); i++) {
+        lanes[i] = rand();
+    }
+
+    uint8_t fast8[WORDS];
+    CHECK_EQ(bit_transpose_encode_8(lanes, FRAME_BYTES, FRAME_BYTES, fast8), WORDS);
+    CHECK_EQ(naive_encode(lanes, FRAME_BYTES, FRAME_BYTES, 8, naive), WORDS);
+    size_t mismatches = 0;
+    for (size_t i = 0; i < WORDS; i++) {
+        mismatches += fast8[i] != naive[i];
+    }
+    CHECK_EQ(mismatches, 0);
+
+    CHECK_EQ(bit_transpose_encode_16(lanes, FRAME_BYTES, FRAME_BYTES, fast), WORDS);
+    CHECK_EQ(naive_encode(lanes, FRAME_BYTES, FRAME_BYTES, 16, naive), WORDS);
+    CHECK(memcmp(fast, naive, sizeof(fast)) == 0);
+
+    // A stride wider than the bytes encoded, as when lanes are shorter than the longest one
+    CHECK_EQ(bit_transpose_encode_16(lanes, FRAME_BYTES, 5, fast), 5 * 8 * BIT_TRANSPOSE_WORDS_PER_BIT);
+    naive_encode(lanes, FRAME_BYTES, 5, 16, naive);
+    CHECK(memcmp(fast, naive, 5 * 8 * BIT_TRANSPOSE_WORDS_PER_BIT * sizeof(uint16_t)) == 0);
+}
+
+static void bench()
+{
+    double start = now_ns();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        bit_transpose_encode_16(lanes, FRAME_BYTES, FRAME_BYTES, fast);
+        __asm__ volatile("" : : "r"(fast) : "memory");
+    }
+    double fast_us = (now_ns() - start) / BENCH_FRAMES / 1e3;
+    start = now_ns();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        naive_encode(lanes, FRAME_BYTES, FRAME_BYTES, 16, naive);
+        __asm__ volatile("" : : "r"(naive) : "memory");
+    }
+    double naive_us = (now_ns() - start) / BENCH_FRAMES / 1e3;
+    printf("16 lanes of %d bytes: transpose %.1f us, per bit %.1f us (%.1fx)\n", FRAME_BYTES, fast_us, naive_us, naive_us / fast_us);
+}
+
+int main()
+{
+    srand(1);
+    test_8x8();
+    test_encode();
+    bench();
+    return test_result("bit_transpose");
+}
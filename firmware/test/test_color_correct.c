@@ -0,0 +1,156 @@
+/*
+ * color_correct.c: white extraction checked against the light it stands for. Over a grid of colors the
+ * RGB left plus the white LED at its white point reproduces the input, and the white taken out is as
+ * much as the input allows. Also explicit white, the RGB mix-in and per channel balance.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include "color_correct.h"
+#include "test.h"
+
+#define GRID_STEP 5
+#define TOLERANCE 2                 // Rounding in the tables, in channel steps
+
+static const uint8_t unity[COLOR_CHANNELS] = {255, 255, 255, 255};
+
+static void test_white_point()
+{
+    color_correct_t correct;
+    // Warm white: red at full, blue well below green
+    color_correct_init(&correct, 2700, unity);
+    CHECK_EQ(correct.white_point[COLOR_RED], 255);
+    CHECK(correct.white_point[COLOR_GREEN] < 255);
+    CHECK(correct.white_point[COLOR_BLUE] < correct.white_point[COLOR_GREEN]);
+    // Cool white: blue at full, red below it
+    color_correct_init(&correct, 10000, unity);
+    CHECK_EQ(correct.white_point[COLOR_BLUE], 255);
+    CHECK(correct.white_point[COLOR_RED] < 255);
+    // Around daylight all three are close to full
+    color_correct_init(&correct, 6600, unity);
+    for (int channel = 0; channel < COLOR_WHITE; channel++) {
+        CHECK(correct.white_point[channel] >= 240);
+    }
+}
+
+// What the strip emits for each of red, green and blue, counting the white LED at its white point
+static void emitted(const color_correct_t* correct, const uint8_t out[COLOR_CHANNELS], int light[COLOR_WHITE])
+{
+    for (int channel = 0; channel < COLOR_WHITE; channel++) {
+        light[channel] = out[channel] + (out[COLOR_WHITE] * correct->white_point[channel] + 127) / 255;
+    }
+}
+
+static void test_extraction(uint32_t kelvin)
+{
+    color_correct_t correct;
+    color_correct_init(&correct, kelvin, unity);
+    uint32_t off = 0;
+    uint32_t not_maximal = 0;
+    for (int red = 0; red < 256; red += GRID_STEP) {
+        for (int green = 0; green < 256; green += GRID_STEP) {
+            for (int blue = 0; blue < 256; blue += GRID_STEP) {
+                uint8_t in[COLOR_CHANNELS] = {red, green, blue, 0};
+                uint8_t out[COLOR_CHANNELS];
+                color_correct_rgbw(&correct, in, out);
+                int light[COLOR_WHITE];
+                emitted(&correct, out, light);
+                for (int channel = 0; channel < COLOR_WHITE; channel++) {
+                    off += abs(light[channel] - in[channel]) > TOLERANCE;
+                }
+                // Any more white would overshoot some channel, so one the white LED emits is nearly used up
+                int least = 255;
+                for (int channel = 0; channel < COLOR_WHITE; channel++) {
+                    if (correct.white_point[channel] && out[channel] < least) least = out[channel];
+                }
+                not_maximal += out[COLOR_WHITE] < 255 && least > TOLERANCE;
+            }
+        }
+    }
+    if (off || not_maximal) {
+        fprintf(stderr, "%u K: %u channels off the input, %u colors with white left in RGB\n", kelvin, off, not_maximal);
+        test_failures++;
+    }
+
+    // The white point itself is all white, a saturated color has none
+    uint8_t white[COLOR_CHANNELS] = {correct.white_point[0], correct.white_point[1], correct.white_point[2], 0};
+    uint8_t out[COLOR_CHANNELS];
+    color_correct_rgbw(&correct, white, out);
+    CHECK_EQ(out[COLOR_WHITE], 255);
+    for (int channel = 0; channel < COLOR_WHITE; channel++) {
+        CHECK(out[channel] <= TOLERANCE);
+    }
+    const uint8_t primaries[3][COLOR_CHANNELS] = {{255, 0, 0, 0}, {0, 255, 0, 0}, {0, 0, 255, 0}};
+    for (int i = 0; i < 3; i++) {
+        color_correct_rgbw(&correct, primaries[i], out);
+        CHECK_EQ(out[COLOR_WHITE], 0);
+        for (int channel = 0; channel < COLOR_WHITE; channel++) {
+            CHECK_EQ(out[channel], primaries[i][channel]);
+        }
+    }
+}
+
+static void test_explicit_white()
+{
+    color_correct_t correct;
+    color_correct_init(&correct, 4000, unity);
+    uint8_t out[COLOR_CHANNELS];
+
+    // On RGBW explicit white goes straight to the white LED, on top of what was extracted, up to full
+    const uint8_t only_white[COLOR_CHANNELS] = {0, 0, 0, 200};
+    color_correct_rgbw(&correct, only_white, out);
+    CHECK_EQ(out[COLOR_RED], 0);
+    CHECK_EQ(out[COLOR_GREEN], 0);
+    CHECK_EQ(out[COLOR_BLUE], 0);
+    CHECK_EQ(out[COLOR_WHITE], 200);
+    const uint8_t everything[COLOR_CHANNELS] = {255, 255, 255, 255};
+    color_correct_rgbw(&correct, everything, out);
+    CHECK_EQ(out[COLOR_WHITE], 255);
+
+    // On RGB it is mixed in at the white point, and RGB clamps rather than wraps
+    color_correct_rgb(&correct, only_white, out);
+    for (int channel = 0; channel < COLOR_WHITE; channel++) {
+        CHECK(abs(out[channel] - (200 * correct.white_point[channel] + 127) / 255) <= 1);
+    }
+    CHECK_EQ(out[COLOR_WHITE], 0);
+    const uint8_t red_and_white[COLOR_CHANNELS] = {250, 0, 0, 255};
+    color_correct_rgb(&correct, red_and_white, out);
+    CHECK_EQ(out[COLOR_RED], 255);
+    CHECK_EQ(out[COLOR_GREEN], correct.white_point[COLOR_GREEN]);
+}
+
+static void test_balance()
+{
+    color_correct_t correct;
+    const uint8_t balance[COLOR_CHANNELS] = {128, 255, 0, 64};
+    color_correct_init(&correct, 6600, balance);
+    uint8_t out[COLOR_CHANNELS];
+
+    // Applied after extraction, to what is sent
+    const uint8_t color[COLOR_CHANNELS] = {255, 255, 0, 255};
+    color_correct_rgbw(&correct, color, out);
+    CHECK_EQ(out[COLOR_RED], 128);
+    CHECK_EQ(out[COLOR_GREEN], 255);
+    CHECK_EQ(out[COLOR_BLUE], 0);
+    CHECK_EQ(out[COLOR_WHITE], 64);
+    color_correct_rgb(&correct, color, out);
+    CHECK_EQ(out[COLOR_RED], 128);
+    CHECK_EQ(out[COLOR_BLUE], 0);
+
+    // 255 leaves every value as it is
+    color_correct_init(&correct, 6600, unity);
+    for (int v = 0; v < 256; v++) {
+        CHECK_EQ(correct.balance[COLOR_RED][v], v);
+    }
+}
+
+int main()
+{
+    test_white_point();
+    test_extraction(2700);
+    test_extraction(4000);
+    test_extraction(6600);
+    test_extraction(10000);
+    test_explicit_white();
+    test_balance();
+    return test_result("color_correct");
+}
@@ -0,0 +1,133 @@
+/*
+ * frame_diff.c: the encoding of a known frame byte for byte (the same bytes live_preview_test.dart expects
+ * from the app's encoder), every pattern of changes on a short frame staying within FRAME_DIFF_MAX_SIZE,
+ * random frames going through frame_diff_apply back to what was encoded, and malformed ranges rejected.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame_diff.h"
+#include "test.h"
+
+#define PIXELS 256
+#define SHORT_PIXELS 12             // Every subset of changed pixels is tried
+#define RANDOM_FRAMES 20000
+
+static uint8_t sent[PIXELS][3];
+static uint8_t frame[PIXELS][3];
+static uint8_t received[PIXELS][3];
+static uint8_t out[FRAME_DIFF_MAX_SIZE(PIXELS)];
+
+static size_t encode(uint16_t count)
+{
+    return frame_diff_encode(sent, (const uint8_t (*)[3])frame, count, out);
+}
+
+static void test_golden()
+{
+    memset(sent, 0, sizeof(sent));
+    memset(frame, 0, sizeof(frame));
+    frame[2][0] = 9;
+    frame[4][1] = 8;
+    frame[8][2] = 7;
+    // Pixels 2 and 4 share a range across the unchanged 3, pixel 8 is two away and gets its own
+    const uint8_t golden[] = {2, 0, 3, 0, 9, 0, 0, 0, 0, 0, 0, 8, 0, 8, 0, 1, 0, 0, 0, 7};
+    size_t len = encode(10);
+    CHECK_EQ(len, sizeof(golden));
+    CHECK(memcmp(out, golden, sizeof(golden)) == 0);
+    CHECK(memcmp(sent, frame, sizeof(frame)) == 0);
+    CHECK_EQ(encode(10), 0);
+
+    // Two unchanged pixels cost more than a header, so 0 and 3 are sent apart
+    frame[0][0] = 5;
+    frame[3][2] = 6;
+    const uint8_t apart[] = {0, 0, 1, 0, 5, 0, 0, 3, 0, 1, 0, 0, 0, 6};
+    CHECK_EQ(encode(10), sizeof(apart));
+    CHECK(memcmp(out, apart, sizeof(apart)) == 0);
+}
+
+static void test_bound()
+{
+    // Alternating changes are one range of every pixel, the largest an encoding gets
+    uint32_t over = 0;
+    uint32_t wrong = 0;
+    size_t largest = 0;
+    for (uint32_t mask = 0; mask < 1u << SHORT_PIXELS; mask++) {
+        memset(sent, 0, sizeof(sent));
+        memset(received, 0, sizeof(received));
+        memset(frame, 0, sizeof(frame));
+        for (int i = 0; i < SHORT_PIXELS; i++) {
+            if (mask >> i & 1) frame[i][i % 3] = 1 + i;
+        }
+        // Guard bytes after the bound catch a write past it
+        memset(out, 0xEE, sizeof(out));
+        size_t len = encode(SHORT_PIXELS);
+        over += len > FRAME_DIFF_MAX_SIZE(SHORT_PIXELS) || out[FRAME_DIFF_MAX_SIZE(SHORT_PIXELS)] != 0xEE;
+        wrong += (len == 0) != (mask == 0);
+        wrong += !frame_diff_apply(received, SHORT_PIXELS, out, len);
+        wrong += memcmp(received, frame, SHORT_PIXELS * 3) != 0;
+        if (len > largest) largest = len;
+    }
+    CHECK_EQ(over, 0);
+    CHECK_EQ(wrong, 0);
+    CHECK_EQ(largest, FRAME_DIFF_MAX_SIZE(SHORT_PIXELS));
+
+    // Every other pixel of a full frame, both ends included
+    memset(sent, 0, sizeof(sent));
+    for (int i = 0; i < PIXELS; i++) {
+        memset(frame[i], i % 2 && i != PIXELS - 1 ? 0 : 0xFF, 3);
+    }
+    CHECK_EQ(encode(PIXELS), FRAME_DIFF_MAX_SIZE(PIXELS));
+}
+
+static void test_round_trip()
+{
+    memset(sent, 0, sizeof(sent));
+    memset(received, 0, sizeof(received));
+    memset(frame, 0, sizeof(frame));
+    uint32_t wrong = 0;
+    for (int i = 0; i < RANDOM_FRAMES; i++) {
+        // From every pixel changing to a few scattered ones
+        int sparseness = i % 4;
+        for (int pixel = 0; pixel < PIXELS; pixel++) {
+            if (sparseness == 0 || rand() % (8 * sparseness) == 0) {
+                frame[pixel][rand() % 3] = rand();
+            }
+        }
+        size_t len = encode(PIXELS);
+        wrong += len > FRAME_DIFF_MAX_SIZE(PIXELS);
+        wrong += !frame_diff_apply(received, PIXELS, out, len);
+        wrong += memcmp(received, frame, sizeof(frame)) != 0;
+        wrong += memcmp(sent, frame, sizeof(frame)) != 0;
+    }
+    CHECK_EQ(wrong, 0);
+}
+
+static void test_malformed()
+{
+    const struct {
+        uint8_t bytes[10];
+        size_t len;
+    } invalid[] = {
+        { {0, 0}, 2 },                              // Half a header
+        { {0, 0, 0, 0}, 4 },                        // Empty range
+        { {0, 0, 2, 0, 1, 2, 3}, 7 },               // Fewer pixels than counted
+        { {9, 0, 2, 0, 1, 2, 3, 4, 5, 6}, 10 },     // Past the end of the frame
+        { {10, 0, 1, 0, 1, 2, 3}, 7 },              // Starts at the end
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        CHECK(!frame_diff_apply(received, 10, invalid[i].bytes, invalid[i].len));
+    }
+    // No ranges at all is a frame with nothing changed
+    CHECK(frame_diff_apply(received, 10, out, 0));
+}
+
+int main()
+{
+    srand(1);
+    test_golden();
+    test_bound();
+    test_round_trip();
+    test_malformed();
+    return test_result("frame_diff");
+}
@@ -0,0 +1,211 @@
+/*
+ * json_stream.c against documents split at every possible point, escapes, values that don't fit their
+ * field and malformed input.
+ */
+#include <stdint.h>
+#include <string.h>
+#include "json_stream.h"
+#include "test.h"
+
+typedef struct {
+    bool state;
+    uint8_t red;
+    uint16_t count;
+    uint32_t duration;
+    char morse[16];
+    json_field_t fields[5];
+} request_t;
+
+static void request_init(request_t* request, json_stream_t* stream)
+{
+    memset(request, 0, sizeof(*request));
+    json_field_t fields[] = {
+        { .key = "state", .type = JSON_FIELD_BOOL, .dest = &request->state },
+        { .key = "red", .type = JSON_FIELD_UINT8, .dest = &request->red },
+        { .key = "count", .type = JSON_FIELD_UINT16, .dest = &request->count },
+        { .key = "duration", .type = JSON_FIELD_UINT32, .dest = &request->duration },
+        { .key = "morse", .type = JSON_FIELD_STRING, .dest = request->morse, .dest_size = sizeof(request->morse) }
+    };
+    memcpy(request->fields, fields, sizeof(fields));
+    json_stream_init(stream, request->fields, 5);
+}
+
+// Feeds doc in chunks of the given sizes, cycling through them, and returns the first error
+static esp_err_t parse_chunked(request_t* request, const char* doc, const size_t* chunks, size_t chunk_count)
+{
+    json_stream_t stream;
+    request_init(request, &stream);
+    size_t len = strlen(doc);
+    size_t pos = 0;
+    for (size_t i = 0; pos < len; i++) {
+        size_t chunk = chunks[i % chunk_count];
+        if (chunk > len - pos) chunk = len - pos;
+        esp_err_t err = json_stream_feed(&stream, doc + pos, chunk);
+        if (err != ESP_OK) return err;
+        pos += chunk;
+    }
+    return json_stream_finish(&stream);
+}
+
+static esp_err_t parse(request_t* request, const char* doc)
+{
+    size_t whole = strlen(doc) ? strlen(doc) : 1;
+    return parse_chunked(request, doc, &whole, 1);
+}
+
+static void test_every_split()
+{
+    const char* doc = "{ \"state\" : true, \"skip\": [1, {\"red\": 9}, \"x\\\"y\", null, -2.5e3],"
+                      "\"red\":255,\"count\":65535,\"duration\":4294967295,\"morse\":\"... \\u002F\\t---\"}";
+    size_t len = strlen(doc);
+    // One split at every byte, then byte by byte and uneven chunks
+    for (size_t split = 0; split <= len; split++) {
+        size_t chunks[] = { split ? split : len, len };
+        request_t request;
+        CHECK_EQ(parse_chunked(&request, doc, chunks, 2), ESP_OK);
+        CHECK(request.state);
+        CHECK_EQ(request.red, 255);
+        CHECK_EQ(request.count, 65535);
+        CHECK_EQ(request.duration, UINT32_MAX);
+        CHECK(strcmp(request.morse, "... /\t---") == 0);
+        for (int i = 0; i < 5; i++) {
+            CHECK(request.fields[i].found);
+        }
+    }
+    size_t odd[] = { 1, 2, 3, 5, 7 };
+    request_t request;
+    CHECK_EQ(parse_chunked(&request, doc, odd, 5), ESP_OK);
+    CHECK(strcmp(request.morse, "... /\t---") == 0);
+}
+
+static void test_escapes()
+{
+    request_t request;
+    CHECK_EQ(parse(&request, "{\"morse\":\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u0041\\u00e9\"}"), ESP_OK);
+    // Anything outside ASCII becomes '?'
+    CHECK(strcmp(request.morse, "\"\\/\b\f\n\r\tA?") == 0);
+
+    CHECK_EQ(parse(&request, "{\"morse\":\"\\x\"}"), ESP_FAIL);
+    CHECK_EQ(parse(&request, "{\"morse\":\"\\u12G4\"}"), ESP_FAIL);
+    CHECK_EQ(parse(&request, "{\"morse\":\"a\nb\"}"), ESP_FAIL);
+    // Escaped key characters still spell the key
+    CHECK_EQ(parse(&request, "{\"r\\u0065d\":7}"), ESP_OK);
+    CHECK_EQ(request.red, 7);
+}
+
+static void test_overflow()
+{
+    request_t request;
+    // 15 characters fit a 16 byte field, 16 don't
+    CHECK_EQ(parse(&request, "{\"morse\":\"...............\"}"), ESP_OK);
+    CHECK_EQ(strlen(request.morse), 15);
+    CHECK_EQ(parse(&request, "{\"morse\":\"................\"}"), ESP_ERR_INVALID_SIZE);
+
+    CHECK_EQ(parse(&request, "{\"red\":256}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(parse(&request, "{\"count\":65536}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(parse(&request, "{\"duration\":4294967296}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(parse(&request, "{\"red\":-1}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(parse(&request, "{\"red\":1.5}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(parse(&request, "{\"red\":1e2}"), ESP_ERR_INVALID_ARG);
+    // Values nobody asked for may be anything
+    CHECK_EQ(parse(&request, "{\"other\":99999999999999999999,\"text\":\"longer than any field we have\"}"), ESP_OK);
+    // A key over JSON_STREAM_KEY_MAX never binds, even when it starts with a field's key
+    CHECK_EQ(parse(&request, "{\"redredredredredred\":1}"), ESP_OK);
+    CHECK(!request.fields[1].found);
+}
+
+static void test_wrong_types()
+{
+    request_t request;
+    CHECK_EQ(parse(&request, "{\"state\":1}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(parse(&request, "{\"red\":\"1\"}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(parse(&request, "{\"red\":true}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(parse(&request, "{\"morse\":5}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(parse(&request, "{\"red\":[1]}"), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(parse(&request, "{\"red\":{}}"), ESP_ERR_INVALID_ARG);
+    // Only the top-level object binds
+    CHECK_EQ(parse(&request, "{\"nested\":{\"red\":5},\"red\":6}"), ESP_OK);
+    CHECK_EQ(request.red, 6);
+    CHECK_EQ(parse(&request, "[{\"red\":5}]"), ESP_OK);
+    CHECK(!request.fields[1].found);
+}
+
+static void test_malformed()
+{
+    const char* docs[] = {
+        "", " ", "{", "}", "{\"red\"}", "{\"red\":}", "{\"red\" 1}", "{\"red\":1,}", "{,}", "[1,]", "[1 2]",
+        "{\"red\":1}}", "{\"red\":1} x", "tru", "nulL", "-", "{\"red\":-}", "\"open", "{'red':1}", "[}", "{]"
+    };
+    for (size_t i = 0; i < sizeof(docs) / sizeof(docs[0]); i++) {
+        request_t request;
+        esp_err_t err = parse(&request, docs[i]);
+        if (err != ESP_FAIL) {
+            fprintf(stderr, "accepted malformed document '%s' (%d)\n", docs[i], err);
+            test_failures++;
+        }
+    }
+
+    // The depth limit is a nesting error, not a crash
+    char deep[JSON_STREAM_MAX_DEPTH + 2] = {0};
+    memset(deep, '[', JSON_STREAM_MAX_DEPTH + 1);
+    request_t request;
+    CHECK_EQ(parse(&request, deep), ESP_FAIL);
+    deep[JSON_STREAM_MAX_DEPTH] = '\0';
+    json_stream_t stream;
+    request_init(&request, &stream);
+    CHECK_EQ(json_stream_feed(&stream, deep, JSON_STREAM_MAX_DEPTH), ESP_OK);
+
+    // Bare top-level values are complete documents
+    CHECK_EQ(parse(&request, "42"), ESP_OK);
+    CHECK_EQ(parse(&request, " null "), ESP_OK);
+}
+
+typedef struct {
+    int records;
+    uint8_t reds[4];
+    int fail_at;
+} records_t;
+
+static esp_err_t on_record(json_field_t* fields, size_t field_count, void* ctx)
+{
+    records_t* records = ctx;
+    if (records->records == records->fail_at) return ESP_ERR_NOT_FOUND;
+    records->reds[records->records++] = fields[1].found ? *(uint8_t*)fields[1].dest : 0;
+    return ESP_OK;
+}
+
+static void test_records()
+{
+    const char* doc = "[{\"red\":1,\"state\":true},{\"state\":false},{\"red\":3,\"x\":{\"red\":9}}]";
+    request_t request;
+    json_stream_t stream;
+    records_t records = { .fail_at = -1 };
+    request_init(&request, &stream);
+    json_stream_set_record_handler(&stream, 2, on_record, &records);
+    for (size_t i = 0; i < strlen(doc); i++) {
+        CHECK_EQ(json_stream_feed(&stream, doc + i, 1), ESP_OK);
+    }
+    CHECK_EQ(json_stream_finish(&stream), ESP_OK);
+    // Found flags are cleared between records, so the second has no red
+    CHECK_EQ(records.records, 3);
+    CHECK_EQ(records.reds[0], 1);
+    CHECK_EQ(records.reds[1], 0);
+    CHECK_EQ(records.reds[2], 3);
+
+    records = (records_t) { .fail_at = 1 };
+    request_init(&request, &stream);
+    json_stream_set_record_handler(&stream, 2, on_record, &records);
+    CHECK_EQ(json_stream_feed(&stream, doc, strlen(doc)), ESP_ERR_NOT_FOUND);
+    CHECK_EQ(records.records, 1);
+}
+
+int main()
+{
+    test_every_split();
+    test_escapes();
+    test_overflow();
+    test_wrong_types();
+    test_malformed();
+    test_records();
+    return test_result("json_stream");
+}
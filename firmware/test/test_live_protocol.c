@@ -0,0 +1,190 @@
+/*
+ * live_protocol.c on the untrusted side of the live channel: a message with every operation decoded field
+ * by field, every truncation of it rejected unless it ends between operations, unknown operation bytes and
+ * bad values rejected wherever they appear, the operation limit, and random bytes that are either rejected
+ * or decode to operations that encode back to exactly the same bytes.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "live_protocol.h"
+#include "test.h"
+
+#define RANDOM_MESSAGES 200000
+
+static live_op_t ops[LIVE_MAX_OPS];
+
+// The client side of the protocol, as the app writes it
+static size_t encode_op(const live_op_t* op, uint8_t* out)
+{
+    out[0] = op->type;
+    switch (op->type) {
+        case LIVE_OP_STATE:
+            out[1] = op->state;
+            return 2;
+        case LIVE_OP_MODE:
+            out[1] = op->mode;
+            return 2;
+        case LIVE_OP_PREVIEW:
+            out[1] = op->fps;
+            return 2;
+        case LIVE_OP_DURATION:
+            for (int i = 0; i < 4; i++) out[1 + i] = op->duration >> 8 * i;
+            return 5;
+        case LIVE_OP_COLOR:
+            memcpy(out + 1, op->pixels.rgbw, 4);
+            return 5;
+        case LIVE_OP_PIXELS:
+            out[1] = op->pixels.start & 0xFF;
+            out[2] = op->pixels.start >> 8;
+            out[3] = op->pixels.count & 0xFF;
+            out[4] = op->pixels.count >> 8;
+            memcpy(out + 5, op->pixels.rgbw, 4);
+            return 9;
+    }
+    return 0;
+}
+
+static const uint8_t message[] = {
+    LIVE_OP_STATE, 1,
+    LIVE_OP_MODE, 2,
+    LIVE_OP_DURATION, 0x78, 0x56, 0x34, 0x12,
+    LIVE_OP_COLOR, 10, 20, 30, 40,
+    LIVE_OP_PIXELS, 0x2C, 0x01, 0x05, 0x00, 1, 2, 3, 4,
+    LIVE_OP_PREVIEW, 30,
+    LIVE_OP_STATE, 0
+};
+// Offsets where an operation starts, and the message length
+static const size_t boundaries[] = {0, 2, 4, 9, 14, 23, 25, sizeof(message)};
+
+static void test_fields()
+{
+    size_t count = 0;
+    CHECK(live_decode(message, sizeof(message), ops, LIVE_MAX_OPS, &count));
+    CHECK_EQ(count, 7);
+    CHECK_EQ(ops[0].type, LIVE_OP_STATE);
+    CHECK_EQ(ops[0].state, true);
+    CHECK_EQ(ops[1].type, LIVE_OP_MODE);
+    CHECK_EQ(ops[1].mode, 2);
+    CHECK_EQ(ops[2].type, LIVE_OP_DURATION);
+    CHECK_EQ(ops[2].duration, 0x12345678);
+    CHECK_EQ(ops[3].type, LIVE_OP_COLOR);
+    CHECK(memcmp(ops[3].pixels.rgbw, (uint8_t[]){10, 20, 30, 40}, 4) == 0);
+    CHECK_EQ(ops[4].type, LIVE_OP_PIXELS);
+    CHECK_EQ(ops[4].pixels.start, 300);
+    CHECK_EQ(ops[4].pixels.count, 5);
+    CHECK(memcmp(ops[4].pixels.rgbw, (uint8_t[]){1, 2, 3, 4}, 4) == 0);
+    CHECK_EQ(ops[5].type, LIVE_OP_PREVIEW);
+    CHECK_EQ(ops[5].fps, 30);
+    CHECK_EQ(ops[6].type, LIVE_OP_STATE);
+    CHECK_EQ(ops[6].state, false);
+
+    // An empty message is no operations
+    count = 99;
+    CHECK(live_decode(message, 0, ops, LIVE_MAX_OPS, &count));
+    CHECK_EQ(count, 0);
+
+    uint8_t header[LIVE_FRAME_HEADER];
+    CHECK_EQ(live_encode_frame_header(header, 300), LIVE_FRAME_HEADER);
+    CHECK(memcmp(header, (uint8_t[]){LIVE_FRAME_MESSAGE, 0x2C, 0x01}, LIVE_FRAME_HEADER) == 0);
+}
+
+static void test_truncated()
+{
+    size_t boundary = 0;
+    for (size_t len = 1; len < sizeof(message); len++) {
+        size_t count;
+        bool between_ops = false;
+        for (size_t i = 0; i < sizeof(boundaries) / sizeof(boundaries[0]); i++) {
+            if (boundaries[i] == len) {
+                between_ops = true;
+                boundary = i;
+            }
+        }
+        bool decoded = live_decode(message, len, ops, LIVE_MAX_OPS, &count);
+        if (decoded != between_ops) {
+            fprintf(stderr, "message cut to %zu bytes was %s\n", len, decoded ? "accepted" : "rejected");
+            test_failures++;
+        } else if (decoded) {
+            CHECK_EQ(count, boundary);
+        }
+    }
+}
+
+static void test_invalid()
+{
+    uint8_t buf[LIVE_MAX_MESSAGE_SIZE];
+    size_t count;
+
+    // Every byte that is not an operation, on its own with a payload and after a valid operation
+    for (int type = 0; type < 256; type++) {
+        if (type >= LIVE_OP_STATE && type <= LIVE_OP_PREVIEW) continue;
+        uint8_t alone[] = {type, 0, 0, 0, 0, 0, 0, 0, 0};
+        uint8_t after[] = {LIVE_OP_STATE, 1, type, 0, 0, 0, 0};
+        if (live_decode(alone, sizeof(alone), ops, LIVE_MAX_OPS, &count) ||
+            live_decode(after, sizeof(after), ops, LIVE_MAX_OPS, &count)) {
+            fprintf(stderr, "operation byte 0x%02x was accepted\n", type);
+            test_failures++;
+        }
+    }
+    CHECK(!live_decode((uint8_t[]){LIVE_FRAME_MESSAGE, 1, 0}, LIVE_FRAME_HEADER, ops, LIVE_MAX_OPS, &count));
+
+    // State is a boolean
+    for (int state = 2; state < 256; state++) {
+        CHECK(!live_decode((uint8_t[]){LIVE_OP_COLOR, 1, 2, 3, 4, LIVE_OP_STATE, state}, 7, ops, LIVE_MAX_OPS, &count));
+    }
+
+    // Modes are not the protocol's to check: every byte reaches the caller as sent, for live_channel.c to
+    // reject the ones that are no led_mode_t
+    uint32_t wrong = 0;
+    for (int mode = 0; mode < 256; mode++) {
+        wrong += !live_decode((uint8_t[]){LIVE_OP_MODE, mode}, 2, ops, LIVE_MAX_OPS, &count) || count != 1 || ops[0].mode != mode;
+    }
+    CHECK_EQ(wrong, 0);
+
+    // As many operations as fit, and not one more
+    for (int i = 0; i < LIVE_MAX_OPS + 1; i++) {
+        buf[2 * i] = LIVE_OP_STATE;
+        buf[2 * i + 1] = i & 1;
+    }
+    CHECK(live_decode(buf, 2 * LIVE_MAX_OPS, ops, LIVE_MAX_OPS, &count));
+    CHECK_EQ(count, LIVE_MAX_OPS);
+    CHECK(!live_decode(buf, 2 * (LIVE_MAX_OPS + 1), ops, LIVE_MAX_OPS, &count));
+    CHECK(!live_decode(message, sizeof(message), ops, 6, &count));
+}
+
+static void test_random()
+{
+    uint8_t buf[32];
+    uint8_t encoded[32 + 9];
+    uint32_t accepted = 0;
+    uint32_t wrong = 0;
+    for (int i = 0; i < RANDOM_MESSAGES; i++) {
+        size_t len = rand() % sizeof(buf);
+        for (size_t j = 0; j < len; j++) {
+            // Mostly operation bytes and small values, so a good share decodes
+            buf[j] = rand() % 4 ? rand() % 8 : rand();
+        }
+        size_t count;
+        if (!live_decode(buf, len, ops, LIVE_MAX_OPS, &count)) continue;
+        accepted++;
+        size_t encoded_len = 0;
+        for (size_t op = 0; op < count; op++) {
+            encoded_len += encode_op(&ops[op], encoded + encoded_len);
+        }
+        wrong += encoded_len != len || memcmp(encoded, buf, len) != 0;
+    }
+    CHECK_EQ(wrong, 0);
+    // The run means something only if plenty of messages got through
+    CHECK(accepted > RANDOM_MESSAGES / 100);
+}
+
+int main()
+{
+    srand(1);
+    test_fields();
+    test_truncated();
+    test_invalid();
+    test_random();
+    return test_result("live_protocol");
+}
@@ -0,0 +1,205 @@
+/*
+ * matrix.c against per-pixel reference versions of each primitive on random matrices, and the path from
+ * a matrix zone to the strip: a bitmap blitted row-major into a serpentine zone comes out of the
+ * zone_map.c remap in wiring order, row by row in alternating directions.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "matrix.h"
+#include "zone_map.h"
+#include "test.h"
+
+#define MAX_SIDE 24
+#define RANDOM_RUNS 2000
+
+typedef uint8_t pixel_t[MATRIX_BYTES_PER_PIXEL];
+
+static pixel_t actual[MAX_SIDE * MAX_SIDE];
+static pixel_t expected[MAX_SIDE * MAX_SIDE];
+
+static void random_pixels(pixel_t* pixels, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        for (int byte = 0; byte < MATRIX_BYTES_PER_PIXEL; byte++) {
+            pixels[i][byte] = rand();
+        }
+    }
+}
+
+static void reference_scroll(uint16_t width, uint16_t height, int dx, int dy, const pixel_t fill)
+{
+    static pixel_t source[MAX_SIDE * MAX_SIDE];
+    memcpy(source, expected, sizeof(source));
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int from_x = x - dx;
+            int from_y = y - dy;
+            bool inside = from_x >= 0 && from_x < width && from_y >= 0 && from_y < height;
+            memcpy(expected[y * width + x], inside ? source[from_y * width + from_x] : fill, sizeof(pixel_t));
+        }
+    }
+}
+
+static void test_primitives()
+{
+    uint32_t mismatches = 0;
+    for (int run = 0; run < RANDOM_RUNS; run++) {
+        uint16_t width = 1 + rand() % MAX_SIDE;
+        uint16_t height = 1 + rand() % MAX_SIDE;
+        matrix_t matrix = { .pixels = actual, .width = width, .height = height };
+        random_pixels(actual, width * height);
+        memcpy(expected, actual, sizeof(actual));
+        pixel_t color;
+        random_pixels(&color, 1);
+
+        // A rectangle that fits, possibly empty
+        uint16_t x = rand() % width;
+        uint16_t y = rand() % height;
+        uint16_t w = rand() % (width - x + 1);
+        uint16_t h = rand() % (height - y + 1);
+        switch (run % 4) {
+            case 0: {
+                pixel_t bitmap[MAX_SIDE * MAX_SIDE];
+                random_pixels(bitmap, w * h);
+                matrix_blit(&matrix, x, y, w, h, (const pixel_t*)bitmap);
+                for (uint16_t row = 0; row < h; row++) {
+                    memcpy(expected[(y + row) * width + x], bitmap[row * w], w * sizeof(pixel_t));
+                }
+                break;
+            }
+            case 1:
+                matrix_fill_rect(&matrix, x, y, w, h, color);
+                for (uint16_t row = 0; row < h; row++) {
+                    for (uint16_t column = 0; column < w; column++) {
+                        memcpy(expected[(y + row) * width + x + column], color, sizeof(pixel_t));
+                    }
+                }
+                break;
+            case 2: {
+                // Shifts past the edges as well as within them
+                int dx = rand() % (2 * width + 1) - width;
+                int dy = rand() % (2 * height + 1) - height;
+                matrix_scroll(&matrix, dx, dy, color);
+                reference_scroll(width, height, dx, dy, color);
+                break;
+            }
+            case 3: {
+                pixel_t column[MAX_SIDE];
+                random_pixels(column, height);
+                matrix_shift_in_column(&matrix, (const pixel_t*)column);
+                reference_scroll(width, height, -1, 0, color);
+                for (uint16_t row = 0; row < height; row++) {
+                    memcpy(expected[row * width + width - 1], column[row], sizeof(pixel_t));
+                }
+                break;
+            }
+        }
+        mismatches += memcmp(actual, expected, width * height * sizeof(pixel_t)) != 0;
+    }
+    CHECK_EQ(mismatches, 0);
+
+    uint8_t rgb[] = {1, 2, 3, 4, 5, 6};
+    pixel_t rgbw[2];
+    memset(rgbw, 0xAA, sizeof(rgbw));
+    matrix_unpack_rgb(rgb, rgbw, 2);
+    CHECK(memcmp(rgbw, (pixel_t[]){{1, 2, 3, 0}, {4, 5, 6, 0}}, sizeof(rgbw)) == 0);
+}
+
+static void test_zone_parse()
+{
+    zone_table_t table;
+    CHECK_EQ(zone_table_parse("", 10, &table), ESP_OK);
+    CHECK_EQ(table.count, 0);
+    CHECK_EQ(zone_table_parse("desk:0:60, shelf:60:30:r ,panel:90:16x16:s", 346, &table), ESP_OK);
+    CHECK_EQ(table.count, 3);
+    const zone_t* panel = zone_table_find(&table, "panel");
+    CHECK(panel != NULL);
+    CHECK_EQ(panel->length, 256);
+    CHECK_EQ(panel->width, 16);
+    CHECK_EQ(panel->layout, ZONE_LAYOUT_SERPENTINE);
+    CHECK_EQ(zone_table_find(&table, "shelf")->layout, ZONE_LAYOUT_REVERSED);
+    CHECK(zone_table_find(&table, "wall") == NULL);
+
+    const char* invalid[] = {
+        "desk:0:61",                // Past the end
+        "desk:60:1",                // Starts at the end
+        "a:0:10,b:9:5",             // Overlap
+        "a:0:5,a:5:5",              // Name reused
+        "a:0:0",                    // Empty
+        "a:0:3x0",
+        "a:0:5,",                   // Trailing comma
+        ":0:5",                     // No name
+        "sixteen_letters_:0:5",     // Name too long
+        "a:0:5:q",                  // Unknown flag
+        "a:0:5 b:5:5",              // Missing comma
+        "a:0:300x300"               // More than 16 bits of pixels
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        if (zone_table_parse(invalid[i], 60, &table) != ESP_ERR_INVALID_ARG) {
+            fprintf(stderr, "zone list \"%s\" was accepted\n", invalid[i]);
+            test_failures++;
+        }
+    }
+
+    char many[256] = "";
+    for (int i = 0; i <= ZONE_MAX_COUNT; i++) {
+        snprintf(many + strlen(many), sizeof(many) - strlen(many), "%sz%d:%d:1", i ? "," : "", i, i);
+    }
+    CHECK_EQ(zone_table_parse(many, 60, &table), ESP_ERR_NO_MEM);
+}
+
+static void test_remap()
+{
+    // 3 plain pixels, a 4x3 serpentine panel, a 3x2 matrix wired like it is stored, 4 reversed, 2 spare
+    const uint16_t pixel_count = 27;
+    zone_table_t table;
+    CHECK_EQ(zone_table_parse("lead:0:3,panel:3:4x3:s,grid:15:3x2,back:21:4:r", pixel_count, &table), ESP_OK);
+    uint16_t remap[27];
+    zone_table_compile(&table, pixel_count, remap);
+
+    // Every stored pixel shows at exactly one strip position
+    uint8_t seen[27] = {0};
+    for (uint16_t i = 0; i < pixel_count; i++) {
+        CHECK(remap[i] < pixel_count);
+        if (remap[i] < pixel_count) seen[remap[i]]++;
+    }
+    for (uint16_t i = 0; i < pixel_count; i++) {
+        CHECK_EQ(seen[i], 1);
+    }
+
+    // A numbered bitmap blitted into the stored panel, then flushed through the remap like led_manager does
+    pixel_t stored[27] = {{0}};
+    matrix_t panel = { .pixels = &stored[3], .width = 4, .height = 3 };
+    pixel_t bitmap[12];
+    for (int i = 0; i < 12; i++) {
+        memcpy(bitmap[i], (pixel_t){i + 1, 0, 0, 0}, sizeof(pixel_t));
+    }
+    matrix_blit(&panel, 0, 0, 4, 3, (const pixel_t*)bitmap);
+    pixel_t strip[27];
+    for (uint16_t i = 0; i < pixel_count; i++) {
+        memcpy(strip[i], stored[remap[i]], sizeof(pixel_t));
+    }
+    // Rows 0 and 2 wired left to right, row 1 right to left
+    const uint8_t wired[12] = {1, 2, 3, 4, 8, 7, 6, 5, 9, 10, 11, 12};
+    for (int i = 0; i < 12; i++) {
+        CHECK_EQ(strip[3 + i][0], wired[i]);
+    }
+
+    // Plain matrix and spare pixels stay where they are, the reversed segment runs backwards
+    for (uint16_t i = 0; i < 3; i++) CHECK_EQ(remap[i], i);
+    for (uint16_t i = 15; i < 21; i++) CHECK_EQ(remap[i], i);
+    for (uint16_t i = 0; i < 4; i++) CHECK_EQ(remap[21 + i], 24 - i);
+    CHECK_EQ(remap[25], 25);
+    CHECK_EQ(remap[26], 26);
+}
+
+int main()
+{
+    srand(1);
+    test_primitives();
+    test_zone_parse();
+    test_remap();
+    return test_result("matrix");
+}
@@ -0,0 +1,132 @@
+/*
+ * mpsc_queue.c under several producer threads and one consumer, like the HTTP handlers and timers
+ * feeding the render task: nothing is lost, duplicated or torn, and each producer's items stay in order.
+ * A small ring keeps it full, so producers race for slots and retry on a full queue like post_command.
+ */
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <time.h>
+#include "mpsc_queue.h"
+#include "test.h"
+
+#define PRODUCERS 8
+#define ITEMS_PER_PRODUCER 250000
+#define CAPACITY 32
+
+typedef struct {
+    uint32_t producer;
+    uint32_t sequence;
+    uint32_t payload[6];
+} item_t;
+
+static mpsc_queue_t queue;
+static item_t buffer[CAPACITY];
+static uint32_t sequences[CAPACITY];
+static uint32_t full_retries[PRODUCERS];
+
+static void fill(item_t* item, uint32_t producer, uint32_t sequence)
+{
+    item->producer = producer;
+    item->sequence = sequence;
+    for (int i = 0; i < 6; i++) {
+        item->payload[i] = (producer << 24 | sequence) * 2654435761u + i;
+    }
+}
+
+static void test_single_thread()
+{
+    uint32_t storage[4];
+    uint32_t seq[4];
+    mpsc_queue_t q;
+    CHECK_EQ(mpsc_queue_init(&q, storage, seq, sizeof(uint32_t), 6), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(mpsc_queue_init(&q, storage, seq, 0, 4), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(mpsc_queue_init(&q, storage, seq, sizeof(uint32_t), 4), ESP_OK);
+
+    uint32_t value;
+    CHECK(!mpsc_queue_pop(&q, &value));
+    for (uint32_t lap = 0; lap < 3; lap++) {
+        for (uint32_t i = 0; i < 4; i++) {
+            value = lap * 10 + i;
+            CHECK(mpsc_queue_push(&q, &value));
+        }
+        CHECK(!mpsc_queue_push(&q, &value));
+        for (uint32_t i = 0; i < 4; i++) {
+            CHECK(mpsc_queue_pop(&q, &value));
+            CHECK_EQ(value, lap * 10 + i);
+        }
+        CHECK(!mpsc_queue_pop(&q, &value));
+    }
+}
+
+static void* producer(void* arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+    item_t item;
+    for (uint32_t sequence = 0; sequence < ITEMS_PER_PRODUCER; sequence++) {
+        fill(&item, id, sequence);
+        while (!mpsc_queue_push(&queue, &item)) {
+            full_retries[id]++;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_producers()
+{
+    CHECK_EQ(mpsc_queue_init(&queue, buffer, sequences, sizeof(item_t), CAPACITY), ESP_OK);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t threads[PRODUCERS];
+    for (uintptr_t i = 0; i < PRODUCERS; i++) {
+        pthread_create(&threads[i], NULL, producer, (void*)i);
+    }
+
+    // Next sequence expected from each producer, anything else is a loss, duplicate or reorder
+    uint32_t next[PRODUCERS] = {0};
+    uint32_t out_of_order = 0;
+    uint32_t torn = 0;
+    item_t item, good;
+    for (uint32_t received = 0; received < PRODUCERS * ITEMS_PER_PRODUCER; received++) {
+        while (!mpsc_queue_pop(&queue, &item)) {
+            sched_yield();
+        }
+        if (item.producer >= PRODUCERS) {
+            torn++;
+            continue;
+        }
+        fill(&good, item.producer, item.sequence);
+        torn += memcmp(&item, &good, sizeof(item)) != 0;
+        out_of_order += item.sequence != next[item.producer];
+        next[item.producer] = item.sequence + 1;
+    }
+    for (int i = 0; i < PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(out_of_order, 0);
+    for (int i = 0; i < PRODUCERS; i++) {
+        CHECK_EQ(next[i], ITEMS_PER_PRODUCER);
+    }
+    CHECK(!mpsc_queue_pop(&queue, &item));
+
+    uint64_t retries = 0;
+    for (int i = 0; i < PRODUCERS; i++) {
+        retries += full_retries[i];
+    }
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%d producers, %d items through %d slots: %.1f M items/s, %llu pushes found the queue full\n",
+           PRODUCERS, PRODUCERS * ITEMS_PER_PRODUCER, CAPACITY, PRODUCERS * ITEMS_PER_PRODUCER / seconds / 1e6,
+           (unsigned long long)retries);
+}
+
+int main()
+{
+    test_single_thread();
+    test_producers();
+    return test_result("mpsc_queue");
+}
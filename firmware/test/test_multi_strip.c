@@ -0,0 +1,351 @@
+/*
+ * multi_strip.c on a fake RMT (fake_rmt.c): pixels split across the outputs in order with the remainder
+ * short on the last, every output started together through the sync manager, the WS2812 and SK6812
+ * symbols each output puts on the wire, only the dirty prefix of each output sent after the first
+ * refresh, and channels released when creation fails. test_multi_strip_unsynced builds it again as for
+ * chips without RMT TX sync.
+ */
+#include <stdint.h>
+#include <string.h>
+#include "multi_strip.h"
+#include "fake_rmt.h"
+#include "test.h"
+
+#define RESOLUTION_HZ (10 * 1000 * 1000)
+#define BIT_THRESHOLD 4             // Ticks, between the 0.3 us high of a 0 and the 0.6 or 0.9 us high of a 1
+#define RESET_HALF_TICKS 1400       // 280 us in two halves
+
+static const int gpios[MULTI_STRIP_MAX_OUTPUTS] = {38, 39, 40, 41, 42, 1, 2, 3};
+
+static multi_strip_config_t config_for(uint8_t outputs, uint32_t leds)
+{
+    multi_strip_config_t config = {
+        .output_count = outputs,
+        .max_leds = leds,
+        .resolution_hz = RESOLUTION_HZ,
+        .mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL
+    };
+    memcpy(config.gpios, gpios, sizeof(gpios));
+    return config;
+}
+
+static int channels_in_use()
+{
+    int count = 0;
+    for (int i = 0; i < FAKE_RMT_TX_CHANNELS; i++) {
+        count += fake_rmt_channels[i].in_use;
+    }
+    return count;
+}
+
+// A distinct color per pixel, so any pixel sent from the wrong place shows
+static void pixel_color(uint32_t index, uint8_t* red, uint8_t* green, uint8_t* blue)
+{
+    *red = index + 1;
+    *green = index + 101;
+    *blue = index + 201;
+}
+
+static void check_output(int gpio, uint32_t first, uint32_t count)
+{
+    const struct rmt_channel_t* channel = fake_rmt_channel(gpio);
+    CHECK(channel != NULL);
+    if (!channel) return;
+    CHECK_EQ(channel->last_bytes, count * 3);
+    CHECK_EQ(channel->symbol_count, count * 24 + 1);
+    uint8_t sent[64];
+    CHECK_EQ(fake_rmt_decode(channel, BIT_THRESHOLD, sent), count * 3);
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t red, green, blue;
+        pixel_color(first + i, &red, &green, &blue);
+        CHECK_EQ(sent[3 * i], green);
+        CHECK_EQ(sent[3 * i + 1], red);
+        CHECK_EQ(sent[3 * i + 2], blue);
+    }
+}
+
+static void test_config()
+{
+    fake_rmt_reset();
+    led_strip_handle_t strip;
+    multi_strip_config_t config = config_for(0, 10);
+    CHECK_EQ(multi_strip_new_rmt_device(&config, &strip), ESP_ERR_INVALID_ARG);
+    config = config_for(MULTI_STRIP_MAX_OUTPUTS + 1, 10);
+    CHECK_EQ(multi_strip_new_rmt_device(&config, &strip), ESP_ERR_INVALID_ARG);
+    config = config_for(4, 3);
+    CHECK_EQ(multi_strip_new_rmt_device(&config, &strip), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(channels_in_use(), 0);
+
+    // More outputs than TX channels: the driver's error, with the channels already made given back
+    config = config_for(FAKE_RMT_TX_CHANNELS + 1, 100);
+    CHECK_EQ(multi_strip_new_rmt_device(&config, &strip), ESP_ERR_NOT_FOUND);
+    CHECK_EQ(channels_in_use(), 0);
+    CHECK_EQ(fake_rmt_live_encoders, 0);
+
+    int parsed[MULTI_STRIP_MAX_OUTPUTS];
+    uint8_t count;
+    CHECK_EQ(multi_strip_parse_gpios("38,39,40,41", parsed, MULTI_STRIP_MAX_OUTPUTS, &count), ESP_OK);
+    CHECK_EQ(count, 4);
+    CHECK_EQ(parsed[0], 38);
+    CHECK_EQ(parsed[3], 41);
+    CHECK_EQ(multi_strip_parse_gpios(" 5 , 6 ", parsed, MULTI_STRIP_MAX_OUTPUTS, &count), ESP_OK);
+    CHECK_EQ(count, 2);
+    CHECK_EQ(parsed[1], 6);
+    CHECK_EQ(multi_strip_parse_gpios("", parsed, MULTI_STRIP_MAX_OUTPUTS, &count), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(multi_strip_parse_gpios("1,,2", parsed, MULTI_STRIP_MAX_OUTPUTS, &count), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(multi_strip_parse_gpios("1 2", parsed, MULTI_STRIP_MAX_OUTPUTS, &count), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(multi_strip_parse_gpios("-1", parsed, MULTI_STRIP_MAX_OUTPUTS, &count), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(multi_strip_parse_gpios("GPIO4", parsed, MULTI_STRIP_MAX_OUTPUTS, &count), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(multi_strip_parse_gpios("1,2,3", parsed, 2, &count), ESP_ERR_INVALID_ARG);
+}
+
+static void test_split()
+{
+    fake_rmt_reset();
+    // 10 pixels on 4 outputs: 3, 3, 3 and the 1 left over
+    multi_strip_config_t config = config_for(4, 10);
+    led_strip_handle_t strip;
+    CHECK_EQ(multi_strip_new_rmt_device(&config, &strip), ESP_OK);
+    CHECK_EQ(channels_in_use(), 4);
+    for (int i = 0; i < 4; i++) {
+        CHECK(fake_rmt_channel(gpios[i])->enabled);
+        CHECK_EQ(fake_rmt_channel(gpios[i])->synced, SOC_RMT_SUPPORT_TX_SYNCHRO);
+    }
+
+    for (uint32_t i = 0; i < 10; i++) {
+        uint8_t red, green, blue;
+        pixel_color(i, &red, &green, &blue);
+        CHECK_EQ(led_strip_set_pixel(strip, i, red, green, blue), ESP_OK);
+    }
+    CHECK_EQ(led_strip_set_pixel(strip, 10, 1, 1, 1), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(led_strip_set_pixel_rgbw(strip, 0, 1, 1, 1, 1), ESP_ERR_NOT_SUPPORTED);
+    CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+
+    check_output(38, 0, 3);
+    check_output(39, 3, 3);
+    check_output(40, 6, 3);
+    check_output(41, 9, 1);
+    // All four queued after one sync reset, so they start on the same clock edge, and all waited for
+    CHECK_EQ(fake_rmt_sync_resets, SOC_RMT_SUPPORT_TX_SYNCHRO ? 1 : 0);
+    for (int i = 0; i < 4; i++) {
+        const struct rmt_channel_t* channel = fake_rmt_channel(gpios[i]);
+        CHECK_EQ(channel->transmissions, 1);
+        CHECK_EQ(channel->sync_reset_seen, fake_rmt_sync_resets);
+        CHECK(!channel->pending);
+    }
+
+    // WS2812 timings at 10 MHz: a 0 is 0.3 us high then 0.9 us low, a 1 the reverse, then 280 us low.
+    // Pixel 0 is green 101 = 0b01100101 first, spread over two refills of the 48 symbol channel memory
+    const struct rmt_channel_t* first = fake_rmt_channel(38);
+    const uint8_t green_bits[8] = {0, 1, 1, 0, 0, 1, 0, 1};
+    for (int bit = 0; bit < 8; bit++) {
+        rmt_symbol_word_t symbol = first->symbols[bit];
+        CHECK_EQ(symbol.level0, 1);
+        CHECK_EQ(symbol.duration0, green_bits[bit] ? 9 : 3);
+        CHECK_EQ(symbol.level1, 0);
+        CHECK_EQ(symbol.duration1, green_bits[bit] ? 3 : 9);
+    }
+    rmt_symbol_word_t reset = first->symbols[first->symbol_count - 1];
+    CHECK_EQ(reset.level0, 0);
+    CHECK_EQ(reset.duration0, RESET_HALF_TICKS);
+    CHECK_EQ(reset.level1, 0);
+    CHECK_EQ(reset.duration1, RESET_HALF_TICKS);
+
+    // The encoder state is per channel, a transmission cut short doesn't leak into the next one
+    CHECK_EQ(led_strip_set_pixel(strip, 0, 0, 0, 0), ESP_OK);
+    CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+    CHECK_EQ(fake_rmt_channel(38)->symbols[0].duration0, 3);
+    CHECK_EQ(fake_rmt_channel(38)->symbols[fake_rmt_channel(38)->symbol_count - 1].duration0, RESET_HALF_TICKS);
+
+    CHECK_EQ(led_strip_del(strip), ESP_OK);
+    CHECK_EQ(channels_in_use(), 0);
+    CHECK_EQ(fake_rmt_live_encoders, 0);
+}
+
+static uint32_t transmissions(int gpio)
+{
+    return fake_rmt_channel(gpio)->transmissions;
+}
+
+static void set_color(led_strip_handle_t strip, uint32_t index)
+{
+    uint8_t red, green, blue;
+    pixel_color(index, &red, &green, &blue);
+    CHECK_EQ(led_strip_set_pixel(strip, index, red, green, blue), ESP_OK);
+}
+
+// Checks a refresh sent count pixels on the output at gpio, or, for 0, only what a synced start needs
+static void check_sent(int gpio, uint32_t before, uint32_t count)
+{
+    if (count == 0 && !SOC_RMT_SUPPORT_TX_SYNCHRO) {
+        CHECK_EQ(transmissions(gpio), before);
+        return;
+    }
+    CHECK_EQ(transmissions(gpio), before + 1);
+    // Synced channels all have to transmit, a clean one resends its first pixel
+    CHECK_EQ(fake_rmt_channel(gpio)->last_bytes, (count ? count : 1) * 3);
+}
+
+static void test_dirty_prefix()
+{
+    fake_rmt_reset();
+    // 40 pixels on 4 outputs of 10
+    multi_strip_config_t config = config_for(4, 40);
+    led_strip_handle_t strip;
+    CHECK_EQ(multi_strip_new_rmt_device(&config, &strip), ESP_OK);
+
+    // What the strips show at power up is unknown, so the first refresh sends every pixel, even dark ones
+    CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+    for (int i = 0; i < 4; i++) {
+        CHECK_EQ(transmissions(gpios[i]), 1);
+        CHECK_EQ(fake_rmt_channel(gpios[i])->last_bytes, 10 * 3);
+    }
+
+    // Nothing changed, nothing sent and no sync reset, including a pixel set to what it already is
+    uint32_t resets = fake_rmt_sync_resets;
+    CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+    CHECK_EQ(led_strip_set_pixel(strip, 5, 0, 0, 0), ESP_OK);
+    CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+    for (int i = 0; i < 4; i++) {
+        CHECK_EQ(transmissions(gpios[i]), 1);
+    }
+    CHECK_EQ(fake_rmt_sync_resets, resets);
+
+    // Pixel 12 is the third of the second output, which sends 3 pixels, the others send nothing
+    for (uint32_t i = 0; i < 40; i++) {
+        set_color(strip, i);
+    }
+    CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+    CHECK_EQ(led_strip_set_pixel(strip, 12, 0, 0, 0), ESP_OK);
+    uint32_t before[4];
+    for (int i = 0; i < 4; i++) {
+        before[i] = transmissions(gpios[i]);
+    }
+    CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+    check_sent(38, before[0], 0);
+    check_sent(39, before[1], 3);
+    check_sent(40, before[2], 0);
+    check_sent(41, before[3], 0);
+    uint8_t sent[64];
+    CHECK_EQ(fake_rmt_decode(fake_rmt_channel(39), BIT_THRESHOLD, sent), 9);
+    CHECK_EQ(sent[6], 0);
+    CHECK_EQ(sent[7], 0);
+    CHECK_EQ(sent[8], 0);
+    set_color(strip, 12);
+
+    // The furthest change on an output sets its prefix, each output on its own
+    CHECK_EQ(led_strip_set_pixel(strip, 7, 1, 1, 1), ESP_OK);
+    CHECK_EQ(led_strip_set_pixel(strip, 2, 1, 1, 1), ESP_OK);
+    CHECK_EQ(led_strip_set_pixel(strip, 30, 1, 1, 1), ESP_OK);
+    for (int i = 0; i < 4; i++) {
+        before[i] = transmissions(gpios[i]);
+    }
+    CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+    check_sent(38, before[0], 8);
+    check_sent(39, before[1], 3);
+    check_sent(40, before[2], 0);
+    check_sent(41, before[3], 1);
+
+    // Clearing sends each output up to its last lit pixel: all of them while every pixel is lit
+    for (int i = 0; i < 4; i++) {
+        before[i] = transmissions(gpios[i]);
+    }
+    CHECK_EQ(led_strip_clear(strip), ESP_OK);
+    for (int i = 0; i < 4; i++) {
+        check_sent(gpios[i], before[i], 10);
+        CHECK_EQ(fake_rmt_decode(fake_rmt_channel(gpios[i]), BIT_THRESHOLD, sent), 30);
+        uint32_t lit = 0;
+        for (int byte = 0; byte < 30; byte++) {
+            lit += sent[byte] != 0;
+        }
+        CHECK_EQ(lit, 0);
+    }
+    // Then only as far as the last lit pixel, and nothing once dark
+    CHECK_EQ(led_strip_set_pixel(strip, 4, 9, 9, 9), ESP_OK);
+    CHECK_EQ(led_strip_set_pixel(strip, 21, 9, 9, 9), ESP_OK);
+    CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+    for (int i = 0; i < 4; i++) {
+        before[i] = transmissions(gpios[i]);
+    }
+    CHECK_EQ(led_strip_clear(strip), ESP_OK);
+    check_sent(38, before[0], 5);
+    check_sent(39, before[1], 0);
+    check_sent(40, before[2], 2);
+    check_sent(41, before[3], 0);
+    for (int i = 0; i < 4; i++) {
+        before[i] = transmissions(gpios[i]);
+    }
+    CHECK_EQ(led_strip_clear(strip), ESP_OK);
+    for (int i = 0; i < 4; i++) {
+        CHECK_EQ(transmissions(gpios[i]), before[i]);
+    }
+    CHECK_EQ(led_strip_del(strip), ESP_OK);
+}
+
+static void test_rgbw()
+{
+    fake_rmt_reset();
+    // SK6812 outputs: four bytes per pixel in G, R, B, W order
+    multi_strip_config_t config = config_for(2, 6);
+    config.rgbw = true;
+    led_strip_handle_t strip;
+    CHECK_EQ(multi_strip_new_rmt_device(&config, &strip), ESP_OK);
+    CHECK_EQ(led_strip_set_pixel_rgbw(strip, 4, 10, 20, 30, 40), ESP_OK);
+    CHECK_EQ(led_strip_set_pixel_rgbw(strip, 6, 1, 1, 1, 1), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+    const struct rmt_channel_t* second = fake_rmt_channel(39);
+    CHECK_EQ(second->last_bytes, 3 * 4);
+    CHECK_EQ(second->symbol_count, 3 * 32 + 1);
+    uint8_t sent[12];
+    CHECK_EQ(fake_rmt_decode(second, BIT_THRESHOLD, sent), 12);
+    CHECK_EQ(sent[4], 20);
+    CHECK_EQ(sent[5], 10);
+    CHECK_EQ(sent[6], 30);
+    CHECK_EQ(sent[7], 40);
+
+    // SK6812 timings: a 1 is 0.6 us high and 0.6 us low, a 0 is as on WS2812. Green 20 = 0b00010100
+    const uint8_t green_bits[8] = {0, 0, 0, 1, 0, 1, 0, 0};
+    for (int bit = 0; bit < 8; bit++) {
+        rmt_symbol_word_t symbol = second->symbols[32 + bit];
+        CHECK_EQ(symbol.duration0, green_bits[bit] ? 6 : 3);
+        CHECK_EQ(symbol.duration1, green_bits[bit] ? 6 : 9);
+    }
+
+    // Setting RGB alone leaves the white as it was
+    CHECK_EQ(led_strip_set_pixel(strip, 4, 11, 20, 30), ESP_OK);
+    CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+    CHECK_EQ(fake_rmt_decode(second, BIT_THRESHOLD, sent), 8);
+    CHECK_EQ(sent[5], 11);
+    CHECK_EQ(sent[7], 40);
+    CHECK_EQ(led_strip_del(strip), ESP_OK);
+}
+
+static void test_single_output()
+{
+    fake_rmt_reset();
+    // One output needs no sync manager, and holds every pixel
+    multi_strip_config_t config = config_for(1, 5);
+    led_strip_handle_t strip;
+    CHECK_EQ(multi_strip_new_rmt_device(&config, &strip), ESP_OK);
+    CHECK(!fake_rmt_channel(38)->synced);
+    for (uint32_t i = 0; i < 5; i++) {
+        uint8_t red, green, blue;
+        pixel_color(i, &red, &green, &blue);
+        CHECK_EQ(led_strip_set_pixel(strip, i, red, green, blue), ESP_OK);
+    }
+    CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+    check_output(38, 0, 5);
+    CHECK_EQ(fake_rmt_sync_resets, 0);
+    CHECK_EQ(led_strip_del(strip), ESP_OK);
+    CHECK_EQ(channels_in_use(), 0);
+}
+
+int main()
+{
+    test_config();
+    test_split();
+    test_dirty_prefix();
+    test_rgbw();
+    test_single_output();
+    return test_result(SOC_RMT_SUPPORT_TX_SYNCHRO ? "multi_strip" : "multi_strip_unsynced");
+}
@@ -0,0 +1,2 @@
+// test_multi_strip.c as for the ESP32 and ESP32-S2, which have no RMT TX sync, see CMakeLists.txt
+#include "test_multi_strip.c"
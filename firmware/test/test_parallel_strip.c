@@ -0,0 +1,159 @@
+/*
+ * parallel_strip.c on a fake i80 bus (fake_lcd.c): every lane decoded back from the parallel words of a
+ * transfer, the WS2812 reset that follows them, and after the first refresh only the prefix up to the
+ * last changed pixel in any lane sent, on 8 and 16 lanes.
+ */
+#include <stdint.h>
+#include <string.h>
+#include "parallel_strip.h"
+#include "fake_lcd.h"
+#include "test.h"
+
+#define PIXELS_PER_LANE 10
+#define RESET_US 280
+
+static uint8_t model[PARALLEL_STRIP_MAX_LANES][PIXELS_PER_LANE][3];     // GRB, what each strip should show
+
+static uint32_t word_at(size_t word_size, size_t index)
+{
+    const uint8_t* data = fake_lcd.last_data;
+    return word_size == 1 ? data[index] : (uint32_t)(data[2 * index] | data[2 * index + 1] << 8);
+}
+
+// Checks the last transfer holds the first prefix pixels of every lane, then only zeros for the reset
+static void check_transfer(uint8_t lanes, uint32_t prefix)
+{
+    size_t word_size = lanes / 8;
+    uint32_t all_lanes = lanes == 8 ? 0xFF : 0xFFFF;
+    size_t data_words = prefix * 3 * 8 * BIT_TRANSPOSE_WORDS_PER_BIT;
+    CHECK_EQ(fake_lcd.last_cmd, -1);
+    CHECK(fake_lcd.last_size >= data_words * word_size);
+    if (fake_lcd.last_size < data_words * word_size) return;
+
+    uint32_t wrong = 0;
+    for (size_t byte = 0; byte < prefix * 3; byte++) {
+        for (int bit = 0; bit < 8; bit++) {
+            size_t word = (byte * 8 + bit) * BIT_TRANSPOSE_WORDS_PER_BIT;
+            // Every lane rises, the data lanes stay high for a 1, every lane falls
+            wrong += word_at(word_size, word) != all_lanes;
+            wrong += word_at(word_size, word + 2) != 0;
+            uint32_t data = word_at(word_size, word + 1);
+            for (uint8_t lane = 0; lane < lanes; lane++) {
+                wrong += (data >> lane & 1) != (model[lane][byte / 3][byte % 3] >> (7 - bit) & 1);
+            }
+        }
+    }
+    CHECK_EQ(wrong, 0);
+
+    size_t reset_words = fake_lcd.last_size / word_size - data_words;
+    uint32_t nonzero = 0;
+    for (size_t i = data_words; i < data_words + reset_words; i++) {
+        nonzero += word_at(word_size, i) != 0;
+    }
+    CHECK_EQ(nonzero, 0);
+    // Low long enough for the strips to latch
+    CHECK((uint64_t)reset_words * 1000000 >= (uint64_t)RESET_US * fake_lcd.io_config.pclk_hz);
+}
+
+static void set(led_strip_handle_t strip, uint8_t lane, uint32_t local, uint8_t red, uint8_t green, uint8_t blue)
+{
+    CHECK_EQ(led_strip_set_pixel(strip, lane * PIXELS_PER_LANE + local, red, green, blue), ESP_OK);
+    model[lane][local][0] = green;
+    model[lane][local][1] = red;
+    model[lane][local][2] = blue;
+}
+
+static void refresh(led_strip_handle_t strip, uint8_t lanes, uint32_t expected_prefix)
+{
+    uint32_t transfers = fake_lcd.transfers;
+    CHECK_EQ(led_strip_refresh(strip), ESP_OK);
+    CHECK_EQ(fake_lcd.transfers, transfers + (expected_prefix ? 1 : 0));
+    if (expected_prefix) check_transfer(lanes, expected_prefix);
+}
+
+static void test_lanes(uint8_t lanes)
+{
+    fake_lcd_reset();
+    memset(model, 0, sizeof(model));
+    parallel_strip_config_t config = {
+        .lane_count = lanes,
+        .wr_gpio = 47,
+        .dc_gpio = 48,
+        .max_leds = lanes * PIXELS_PER_LANE
+    };
+    for (uint8_t lane = 0; lane < lanes; lane++) {
+        config.data_gpios[lane] = lane + 1;
+    }
+    led_strip_handle_t strip;
+    CHECK_EQ(parallel_strip_new_lcd_device(&config, &strip), ESP_OK);
+    CHECK_EQ(fake_lcd.bus_config.bus_width, lanes);
+    CHECK_EQ(fake_lcd.bus_config.data_gpio_nums[lanes - 1], lanes);
+    CHECK_EQ(led_strip_set_pixel(strip, config.max_leds, 1, 1, 1), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(led_strip_set_pixel_rgbw(strip, 0, 1, 1, 1, 1), ESP_ERR_NOT_SUPPORTED);
+
+    // What the strips show at power up is unknown, so the first refresh sends every pixel
+    for (uint8_t lane = 0; lane < lanes; lane++) {
+        for (uint32_t local = 0; local < PIXELS_PER_LANE; local++) {
+            set(strip, lane, local, lane * 37 + local * 11 + 1, lane * 13 + local * 7 + 2, lane * 5 + local * 29 + 3);
+        }
+    }
+    refresh(strip, lanes, PIXELS_PER_LANE);
+
+    // Nothing changed, nothing sent, including a pixel set to what it already is
+    refresh(strip, lanes, 0);
+    set(strip, 2, 8, model[2][8][1], model[2][8][0], model[2][8][2]);
+    refresh(strip, lanes, 0);
+
+    // The lanes share a clock, so a change in one sends the same prefix on all of them
+    set(strip, 3, 4, 200, 100, 50);
+    refresh(strip, lanes, 5);
+    set(strip, 0, 2, 4, 5, 6);
+    set(strip, lanes - 1, 0, 1, 2, 3);
+    refresh(strip, lanes, 3);
+
+    // Clearing a lit strip sends everything up to the last lit pixel
+    memset(model, 0, sizeof(model));
+    CHECK_EQ(fake_lcd.transfers, 3);
+    CHECK_EQ(led_strip_clear(strip), ESP_OK);
+    CHECK_EQ(fake_lcd.transfers, 4);
+    check_transfer(lanes, PIXELS_PER_LANE);
+    CHECK_EQ(led_strip_clear(strip), ESP_OK);
+    CHECK_EQ(fake_lcd.transfers, 4);
+
+    // Only as far as the furthest lit pixel in any lane
+    set(strip, 1, 6, 9, 9, 9);
+    set(strip, lanes - 1, 3, 9, 9, 9);
+    refresh(strip, lanes, 7);
+    memset(model, 0, sizeof(model));
+    CHECK_EQ(led_strip_clear(strip), ESP_OK);
+    check_transfer(lanes, 7);
+
+    // Every transfer waited for its completion, and fitted the DMA buffer the bus was sized for
+    CHECK_EQ(fake_lcd.notifications, 0);
+    CHECK_EQ(fake_lcd.takes_without_notification, 0);
+    CHECK(!fake_lcd.over_max_transfer);
+    CHECK_EQ(led_strip_del(strip), ESP_OK);
+    CHECK_EQ(fake_lcd.live_buses, 0);
+    CHECK_EQ(fake_lcd.live_ios, 0);
+}
+
+static void test_config()
+{
+    fake_lcd_reset();
+    parallel_strip_config_t config = { .lane_count = 12, .max_leds = 120 };
+    led_strip_handle_t strip;
+    CHECK_EQ(parallel_strip_new_lcd_device(&config, &strip), ESP_ERR_INVALID_ARG);
+    config.lane_count = 16;
+    config.max_leds = 15;
+    CHECK_EQ(parallel_strip_new_lcd_device(&config, &strip), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(fake_lcd.live_buses, 0);
+}
+
+int main()
+{
+    test_config();
+    test_lanes(8);
+    test_lanes(16);
+    fake_lcd_reset();
+    return test_result("parallel_strip");
+}
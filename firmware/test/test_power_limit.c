@@ -0,0 +1,132 @@
+/*
+ * power_limit.c on a simulated 300 pixel strip: the running sums kept per changed pixel match a full
+ * scan after many random changes, and a frame scaled with power_limit_apply never draws more than the
+ * budget while using nearly all of it.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include "power_limit.h"
+#include "test.h"
+
+#define PIXELS 300
+#define IDLE_MA 300                 // About 1 mA per dark WS2812
+#define UPDATES 100000
+
+static const uint16_t channel_ma[COLOR_CHANNELS] = {12, 12, 12, 18};
+static uint8_t frame[PIXELS][COLOR_CHANNELS];
+
+// Current of a frame counted from scratch, in mA as a real number
+static double scan_ma(uint32_t scale)
+{
+    double total = IDLE_MA;
+    for (int i = 0; i < PIXELS; i++) {
+        for (int channel = 0; channel < COLOR_CHANNELS; channel++) {
+            total += power_limit_apply(frame[i][channel], scale) * channel_ma[channel] / 255.0;
+        }
+    }
+    return total;
+}
+
+static void set_pixel(power_limit_t* limit, int index, const uint8_t color[COLOR_CHANNELS])
+{
+    power_limit_update(limit, frame[index], color);
+    for (int channel = 0; channel < COLOR_CHANNELS; channel++) {
+        frame[index][channel] = color[channel];
+    }
+}
+
+static void test_running_sums()
+{
+    power_limit_t limit;
+    power_limit_init(&limit, channel_ma, IDLE_MA, 0);
+    CHECK_EQ(power_limit_estimate_ma(&limit), IDLE_MA);
+    // Random pixels to random colors, values going down as well as up
+    for (int update = 0; update < UPDATES; update++) {
+        uint8_t color[COLOR_CHANNELS] = {rand(), rand(), rand(), rand() % 4 ? 0 : rand()};
+        set_pixel(&limit, rand() % PIXELS, color);
+    }
+    // The estimate rounds up, so it is never under the real draw and over by less than 1 mA
+    double scanned = scan_ma(POWER_LIMIT_FULL_SCALE);
+    uint32_t estimate = power_limit_estimate_ma(&limit);
+    CHECK(estimate >= scanned);
+    CHECK(estimate < scanned + 1);
+
+    // Without a budget nothing is scaled
+    uint32_t limited_ma;
+    CHECK_EQ(power_limit_scale(&limit, &limited_ma), POWER_LIMIT_FULL_SCALE);
+    CHECK_EQ(limited_ma, estimate);
+    for (int v = 0; v < 256; v++) {
+        CHECK_EQ(power_limit_apply(v, POWER_LIMIT_FULL_SCALE), v);
+    }
+}
+
+static void test_budget(uint32_t budget_ma)
+{
+    power_limit_t limit;
+    power_limit_init(&limit, channel_ma, IDLE_MA, budget_ma);
+    for (int i = 0; i < PIXELS; i++) {
+        uint8_t color[COLOR_CHANNELS] = {frame[i][0], frame[i][1], frame[i][2], frame[i][3]};
+        uint8_t dark[COLOR_CHANNELS] = {0};
+        power_limit_update(&limit, dark, color);
+    }
+    uint32_t limited_ma;
+    uint32_t scale = power_limit_scale(&limit, &limited_ma);
+    double scaled = scan_ma(scale);
+    uint32_t estimate = power_limit_estimate_ma(&limit);
+
+    if (estimate <= budget_ma) {
+        CHECK_EQ(scale, POWER_LIMIT_FULL_SCALE);
+        return;
+    }
+    CHECK(scale < POWER_LIMIT_FULL_SCALE);
+    // Never over, and rounding each value down costs at most one step of every channel of every pixel
+    double slack_ma = PIXELS * (12 + 12 + 12 + 18) / 255.0;
+    CHECK(scaled <= budget_ma);
+    CHECK(scaled > budget_ma - slack_ma - 1);
+    CHECK(limited_ma <= budget_ma);
+    CHECK(limited_ma + 1 >= scaled);
+}
+
+static void test_extremes()
+{
+    power_limit_t limit;
+    uint8_t dark[COLOR_CHANNELS] = {0};
+    uint8_t full[COLOR_CHANNELS] = {255, 255, 255, 255};
+
+    // Every channel of every pixel at full: 300 * 54 mA plus idle
+    power_limit_init(&limit, channel_ma, IDLE_MA, 5000);
+    for (int i = 0; i < PIXELS; i++) {
+        power_limit_update(&limit, dark, full);
+    }
+    CHECK_EQ(power_limit_estimate_ma(&limit), IDLE_MA + PIXELS * 54);
+    uint32_t scale = power_limit_scale(&limit, NULL);
+    // 4700 mA left for 16200 mA of channels
+    CHECK_EQ(power_limit_apply(255, scale), 255 * 4700 / 16200);
+
+    // A budget the idle draw alone uses up leaves the frame dark rather than wrapping
+    power_limit_init(&limit, channel_ma, IDLE_MA, IDLE_MA / 2);
+    power_limit_update(&limit, dark, full);
+    uint32_t limited_ma;
+    scale = power_limit_scale(&limit, &limited_ma);
+    CHECK_EQ(scale, 0);
+    CHECK_EQ(power_limit_apply(255, scale), 0);
+    CHECK_EQ(limited_ma, IDLE_MA);
+
+    // Back to dark, the sums return to zero
+    power_limit_update(&limit, full, dark);
+    CHECK_EQ(power_limit_estimate_ma(&limit), IDLE_MA);
+    CHECK_EQ(power_limit_scale(&limit, NULL), POWER_LIMIT_FULL_SCALE);
+}
+
+int main()
+{
+    srand(1);
+    test_running_sums();
+    // Budgets from generous to nearly nothing left after idle, on the random frame
+    const uint32_t budgets[] = {20000, 4000, 2000, 1000, 500, 310};
+    for (size_t i = 0; i < sizeof(budgets) / sizeof(budgets[0]); i++) {
+        test_budget(budgets[i]);
+    }
+    test_extremes();
+    return test_result("power_limit");
+}
@@ -0,0 +1,304 @@
+/*
+ * schedule.c against a mocked clock: times are passed in rather than read, and a simulated scheduler
+ * task ticks once a second through whole weeks like scheduler.c does. Covers weekday and year rollover,
+ * the daylight saving gap and repeat in POSIX TZ zones, reindexing after schedule_remove, and a rule
+ * that fell behind catching up with a single fire.
+ */
+#define _DEFAULT_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "schedule.h"
+#include "test.h"
+
+#define MINUTE 60
+#define HOUR (60 * MINUTE)
+#define DAY (24 * HOUR)
+#define WEEK (7 * DAY)
+#define SUNDAY (1 << 0)
+#define FRIDAY (1 << 5)
+#define SATURDAY (1 << 6)
+
+static void set_zone(const char* tz)
+{
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+static time_t utc(int year, int month, int day, int hour, int minute)
+{
+    struct tm tm = {
+        .tm_year = year - 1900,
+        .tm_mon = month - 1,
+        .tm_mday = day,
+        .tm_hour = hour,
+        .tm_min = minute
+    };
+    return timegm(&tm);
+}
+
+static schedule_rule_t rule_at(uint8_t weekdays, uint8_t hour, uint8_t minute)
+{
+    return (schedule_rule_t){
+        .weekdays = weekdays,
+        .hour = hour,
+        .minute = minute,
+        .has_state = true,
+        .state = true
+    };
+}
+
+// The scheduler task's loop on a clock that advances a second per tick, counting fires per rule
+static void run_ticks(schedule_t* schedule, time_t from, time_t to, uint32_t* fires, time_t* last_fire)
+{
+    for (time_t now = from; now < to; now++) {
+        uint8_t index;
+        while (schedule_pop_due(schedule, now, &index)) {
+            fires[index]++;
+            if (last_fire) last_fire[index] = now;
+        }
+    }
+}
+
+static void test_valid()
+{
+    schedule_rule_t rule = rule_at(SCHEDULE_EVERY_DAY, 23, 59);
+    CHECK(schedule_rule_valid(&rule));
+    rule.weekdays = 0;
+    CHECK(!schedule_rule_valid(&rule));
+    rule.weekdays = 0x80;
+    CHECK(!schedule_rule_valid(&rule));
+    rule = rule_at(SCHEDULE_EVERY_DAY, 24, 0);
+    CHECK(!schedule_rule_valid(&rule));
+    rule = rule_at(SCHEDULE_EVERY_DAY, 0, 60);
+    CHECK(!schedule_rule_valid(&rule));
+    rule.minute = 0;
+    rule.has_state = false;
+    CHECK(!schedule_rule_valid(&rule));
+
+    schedule_t schedule;
+    schedule_init(&schedule);
+    CHECK_EQ(schedule_add(&schedule, &rule, 0), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(schedule_peek(&schedule), SCHEDULE_NEVER);
+}
+
+static void test_weekday_rollover()
+{
+    set_zone("UTC0");
+    // Saturday 23:59, a Sunday rule fires the next morning
+    schedule_rule_t sunday = rule_at(SUNDAY, 7, 0);
+    CHECK_EQ(schedule_next_fire(&sunday, utc(2026, 10, 24, 23, 59)), utc(2026, 10, 25, 7, 0));
+    // Exactly at the fire time it is a week out, the result is always later than after
+    CHECK_EQ(schedule_next_fire(&sunday, utc(2026, 10, 25, 7, 0)), utc(2026, 11, 1, 7, 0));
+    CHECK_EQ(schedule_next_fire(&sunday, utc(2026, 10, 25, 6, 59)), utc(2026, 10, 25, 7, 0));
+
+    // Today's weekday but already past, the longest wait there is
+    schedule_rule_t saturday = rule_at(SATURDAY, 23, 30);
+    CHECK_EQ(schedule_next_fire(&saturday, utc(2026, 10, 24, 23, 45)), utc(2026, 10, 31, 23, 30));
+
+    // Across the end of a month and a year, Thursday 2026-12-31 to Friday 2027-01-01
+    schedule_rule_t friday = rule_at(FRIDAY, 0, 30);
+    CHECK_EQ(schedule_next_fire(&friday, utc(2026, 12, 31, 23, 0)), utc(2027, 1, 1, 0, 30));
+
+    // Saturday and Sunday only, from a Monday
+    schedule_rule_t weekend = rule_at(SATURDAY | SUNDAY, 9, 0);
+    CHECK_EQ(schedule_next_fire(&weekend, utc(2026, 10, 19, 12, 0)), utc(2026, 10, 24, 9, 0));
+    CHECK_EQ(schedule_next_fire(&weekend, utc(2026, 10, 24, 9, 0)), utc(2026, 10, 25, 9, 0));
+    CHECK_EQ(schedule_next_fire(&weekend, utc(2026, 10, 25, 9, 0)), utc(2026, 10, 31, 9, 0));
+
+    // Each rule fires on each of its days over four weeks of ticks, and nowhere else
+    schedule_t schedule;
+    schedule_init(&schedule);
+    time_t start = utc(2026, 10, 19, 0, 0);
+    CHECK_EQ(schedule_add(&schedule, &sunday, start), ESP_OK);
+    CHECK_EQ(schedule_add(&schedule, &weekend, start), ESP_OK);
+    schedule_rule_t every_day = rule_at(SCHEDULE_EVERY_DAY, 0, 0);
+    CHECK_EQ(schedule_add(&schedule, &every_day, start), ESP_OK);
+    uint32_t fires[3] = {0};
+    run_ticks(&schedule, start, start + 4 * WEEK, fires, NULL);
+    CHECK_EQ(fires[0], 4);
+    CHECK_EQ(fires[1], 8);
+    // Midnight at start is not after start
+    CHECK_EQ(fires[2], 27);
+}
+
+static void test_dst_gap()
+{
+    // Central Europe springs forward on 2026-03-29, 02:00 CET is 03:00 CEST (01:00 UTC)
+    set_zone("CET-1CEST,M3.5.0,M10.5.0/3");
+    schedule_rule_t skipped = rule_at(SCHEDULE_EVERY_DAY, 2, 30);
+    // 02:30 never happens that night, it fires that much later at 03:30 CEST
+    CHECK_EQ(schedule_next_fire(&skipped, utc(2026, 3, 28, 12, 0)), utc(2026, 3, 29, 1, 30));
+    CHECK_EQ(schedule_next_fire(&skipped, utc(2026, 3, 29, 1, 30)), utc(2026, 3, 30, 0, 30));
+    // The day before is still CET
+    CHECK_EQ(schedule_next_fire(&skipped, utc(2026, 3, 27, 12, 0)), utc(2026, 3, 28, 1, 30));
+
+    // Once a day through the week of the change, for a rule in the gap and ones either side of it
+    schedule_t schedule;
+    schedule_init(&schedule);
+    time_t start = utc(2026, 3, 25, 12, 0);
+    CHECK_EQ(schedule_add(&schedule, &skipped, start), ESP_OK);
+    schedule_rule_t before = rule_at(SCHEDULE_EVERY_DAY, 1, 59);
+    CHECK_EQ(schedule_add(&schedule, &before, start), ESP_OK);
+    schedule_rule_t after = rule_at(SCHEDULE_EVERY_DAY, 3, 0);
+    CHECK_EQ(schedule_add(&schedule, &after, start), ESP_OK);
+    uint32_t fires[3] = {0};
+    time_t last_fire[3] = {0};
+    run_ticks(&schedule, start, start + WEEK, fires, last_fire);
+    CHECK_EQ(fires[0], 7);
+    CHECK_EQ(fires[1], 7);
+    CHECK_EQ(fires[2], 7);
+    // The last of each is on 2026-04-01, in summer time
+    CHECK_EQ(last_fire[0], utc(2026, 4, 1, 0, 30));
+    CHECK_EQ(last_fire[1], utc(2026, 3, 31, 23, 59));
+    CHECK_EQ(last_fire[2], utc(2026, 4, 1, 1, 0));
+}
+
+static void test_dst_repeat()
+{
+    // Central Europe falls back on 2026-10-25, 03:00 CEST is 02:00 CET, so 02:30 happens at 00:30 and 01:30 UTC
+    set_zone("CET-1CEST,M3.5.0,M10.5.0/3");
+    schedule_rule_t repeated = rule_at(SCHEDULE_EVERY_DAY, 2, 30);
+    time_t first = schedule_next_fire(&repeated, utc(2026, 10, 24, 12, 0));
+    CHECK_EQ(first, utc(2026, 10, 25, 0, 30));
+    // Fires once at the first, the next is the following night in CET
+    CHECK_EQ(schedule_next_fire(&repeated, first), utc(2026, 10, 26, 1, 30));
+
+    // US Eastern falls back on 2026-11-01 at 02:00 EDT, so 01:00 to 01:59 happen twice
+    set_zone("EST5EDT,M3.2.0,M11.1.0");
+    schedule_t schedule;
+    schedule_init(&schedule);
+    time_t start = utc(2026, 10, 29, 12, 0);
+    schedule_rule_t eastern = rule_at(SCHEDULE_EVERY_DAY, 1, 15);
+    CHECK_EQ(schedule_add(&schedule, &eastern, start), ESP_OK);
+    schedule_rule_t sunday = rule_at(SUNDAY, 1, 45);
+    CHECK_EQ(schedule_add(&schedule, &sunday, start), ESP_OK);
+    uint32_t fires[2] = {0};
+    time_t last_fire[2] = {0};
+    run_ticks(&schedule, start, start + WEEK, fires, last_fire);
+    CHECK_EQ(fires[0], 7);
+    CHECK_EQ(fires[1], 1);
+    // In daylight saving time, the first of the two
+    CHECK_EQ(last_fire[1], utc(2026, 11, 1, 5, 45));
+}
+
+static void test_remove()
+{
+    set_zone("UTC0");
+    schedule_t schedule;
+    schedule_init(&schedule);
+    time_t start = utc(2026, 10, 19, 0, 0);
+    // Rule i fires at 10 + i o'clock every day
+    for (uint8_t i = 0; i < 5; i++) {
+        schedule_rule_t rule = rule_at(SCHEDULE_EVERY_DAY, 10 + i, 0);
+        CHECK_EQ(schedule_add(&schedule, &rule, start), ESP_OK);
+    }
+    CHECK_EQ(schedule_remove(&schedule, 5, start), ESP_ERR_NOT_FOUND);
+    CHECK_EQ(schedule_remove(&schedule, 1, start), ESP_OK);
+    CHECK_EQ(schedule.count, 4);
+
+    // Later rules moved down one index, and the heap points at the rules as they are now
+    const uint8_t hours[] = {10, 12, 13, 14};
+    for (uint8_t i = 0; i < 4; i++) {
+        CHECK_EQ(schedule.rules[i].hour, hours[i]);
+    }
+    uint8_t index;
+    time_t now = start;
+    for (uint8_t i = 0; i < 4; i++) {
+        now = schedule_peek(&schedule);
+        CHECK_EQ(now, start + hours[i] * HOUR);
+        CHECK(schedule_pop_due(&schedule, now, &index));
+        CHECK_EQ(index, i);
+        CHECK_EQ(schedule.rules[index].hour, hours[i]);
+    }
+
+    // Removing the last rule, and the only rule, after some fired
+    CHECK_EQ(schedule_remove(&schedule, 3, now), ESP_OK);
+    CHECK_EQ(schedule_peek(&schedule), utc(2026, 10, 20, 10, 0));
+    while (schedule.count) {
+        CHECK_EQ(schedule_remove(&schedule, 0, now), ESP_OK);
+    }
+    CHECK_EQ(schedule_peek(&schedule), SCHEDULE_NEVER);
+    CHECK(!schedule_pop_due(&schedule, now + WEEK, &index));
+    CHECK_EQ(schedule_remove(&schedule, 0, now), ESP_ERR_NOT_FOUND);
+}
+
+static void test_catch_up()
+{
+    set_zone("UTC0");
+    schedule_t schedule;
+    schedule_init(&schedule);
+    time_t start = utc(2026, 10, 19, 0, 0);
+    schedule_rule_t daily = rule_at(SCHEDULE_EVERY_DAY, 8, 0);
+    schedule_rule_t evening = rule_at(SCHEDULE_EVERY_DAY, 20, 0);
+    CHECK_EQ(schedule_add(&schedule, &evening, start), ESP_OK);
+    CHECK_EQ(schedule_add(&schedule, &daily, start), ESP_OK);
+
+    // Nothing is due before the first fire
+    uint8_t index;
+    CHECK(!schedule_pop_due(&schedule, utc(2026, 10, 19, 7, 59), &index));
+
+    // Three days late: each rule fires once, earliest due first, then waits for its next time after now
+    time_t late = utc(2026, 10, 22, 9, 0);
+    CHECK(schedule_pop_due(&schedule, late, &index));
+    CHECK_EQ(index, 1);
+    CHECK(schedule_pop_due(&schedule, late, &index));
+    CHECK_EQ(index, 0);
+    CHECK(!schedule_pop_due(&schedule, late, &index));
+    CHECK_EQ(schedule_peek(&schedule), utc(2026, 10, 22, 20, 0));
+
+    // Both due on the same tick fire on it
+    schedule_rule_t also_evening = rule_at(SCHEDULE_EVERY_DAY, 20, 0);
+    CHECK_EQ(schedule_add(&schedule, &also_evening, late), ESP_OK);
+    time_t evening_at = utc(2026, 10, 22, 20, 0);
+    CHECK(!schedule_pop_due(&schedule, evening_at - 1, &index));
+    uint32_t seen = 0;
+    while (schedule_pop_due(&schedule, evening_at, &index)) {
+        seen |= 1u << index;
+    }
+    CHECK_EQ(seen, 0x5);
+    CHECK_EQ(schedule_peek(&schedule), utc(2026, 10, 23, 8, 0));
+
+    // A clock set back a day is requeued from the new time rather than waiting out the old queue
+    schedule_rebuild(&schedule, utc(2026, 10, 21, 12, 0));
+    CHECK_EQ(schedule_peek(&schedule), utc(2026, 10, 21, 20, 0));
+}
+
+static void test_full()
+{
+    set_zone("UTC0");
+    schedule_t schedule;
+    schedule_init(&schedule);
+    time_t start = utc(2026, 10, 19, 0, 0);
+    // Minutes in a scrambled order, the heap gives them back sorted
+    for (uint8_t i = 0; i < SCHEDULE_MAX_RULES; i++) {
+        schedule_rule_t rule = rule_at(SCHEDULE_EVERY_DAY, 6, (i * 37) % 59);
+        CHECK_EQ(schedule_add(&schedule, &rule, start), ESP_OK);
+    }
+    schedule_rule_t rule = rule_at(SCHEDULE_EVERY_DAY, 6, 0);
+    CHECK_EQ(schedule_add(&schedule, &rule, start), ESP_ERR_NO_MEM);
+
+    time_t previous = 0;
+    for (uint8_t i = 0; i < SCHEDULE_MAX_RULES; i++) {
+        time_t at = schedule_peek(&schedule);
+        CHECK(at >= previous);
+        uint8_t index;
+        CHECK(schedule_pop_due(&schedule, at, &index));
+        CHECK_EQ(at, start + 6 * HOUR + schedule.rules[index].minute * MINUTE);
+        previous = at;
+    }
+    CHECK_EQ(schedule_peek(&schedule), utc(2026, 10, 20, 6, 0));
+}
+
+int main()
+{
+    test_valid();
+    test_weekday_rollover();
+    test_dst_gap();
+    test_dst_repeat();
+    test_remove();
+    test_catch_up();
+    test_full();
+    return test_result("schedule");
+}
@@ -0,0 +1,106 @@
+/*
+ * spsc_queue.c with a producer and a consumer thread, like the network core feeding the render core:
+ * every item arrives once, in order and whole, through a small ring that wraps many times.
+ * Prints the throughput, which on a host with one core is mostly thread switches.
+ */
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <time.h>
+#include "spsc_queue.h"
+#include "test.h"
+
+#define ITEMS 2000000
+#define CAPACITY 16
+
+// Big enough that a torn copy shows up as a payload that doesn't match its sequence
+typedef struct {
+    uint32_t sequence;
+    uint32_t payload[7];
+} item_t;
+
+static spsc_queue_t queue;
+static item_t buffer[CAPACITY];
+
+static void fill(item_t* item, uint32_t sequence)
+{
+    item->sequence = sequence;
+    for (int i = 0; i < 7; i++) {
+        item->payload[i] = sequence * 2654435761u + i;
+    }
+}
+
+static void test_single_thread()
+{
+    uint8_t small[4 * sizeof(uint32_t)];
+    spsc_queue_t q;
+    CHECK_EQ(spsc_queue_init(&q, small, sizeof(uint32_t), 3), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(spsc_queue_init(&q, small, 0, 4), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(spsc_queue_init(&q, small, sizeof(uint32_t), 4), ESP_OK);
+
+    uint32_t value;
+    CHECK(!spsc_queue_pop(&q, &value));
+    // Counters about to wrap, so the full and empty checks are exercised across the wrap
+    q.head = q.tail = UINT32_MAX - 5;
+    for (uint32_t lap = 0; lap < 4; lap++) {
+        for (uint32_t i = 0; i < 4; i++) {
+            value = lap * 10 + i;
+            CHECK(spsc_queue_push(&q, &value));
+        }
+        CHECK(!spsc_queue_push(&q, &value));
+        for (uint32_t i = 0; i < 4; i++) {
+            CHECK(spsc_queue_pop(&q, &value));
+            CHECK_EQ(value, lap * 10 + i);
+        }
+        CHECK(!spsc_queue_pop(&q, &value));
+    }
+}
+
+static void* producer(void* arg)
+{
+    item_t item;
+    for (uint32_t sequence = 0; sequence < ITEMS; sequence++) {
+        fill(&item, sequence);
+        while (!spsc_queue_push(&queue, &item)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_two_threads()
+{
+    CHECK_EQ(spsc_queue_init(&queue, buffer, sizeof(item_t), CAPACITY), ESP_OK);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t thread;
+    pthread_create(&thread, NULL, producer, NULL);
+
+    uint32_t expected = 0;
+    uint32_t wrong = 0;
+    item_t item, good;
+    while (expected < ITEMS) {
+        if (!spsc_queue_pop(&queue, &item)) {
+            sched_yield();
+            continue;
+        }
+        fill(&good, expected);
+        wrong += memcmp(&item, &good, sizeof(item)) != 0;
+        expected++;
+    }
+    pthread_join(thread, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    CHECK_EQ(wrong, 0);
+    CHECK(!spsc_queue_pop(&queue, &item));
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%d items of %zu bytes through %d slots: %.1f M items/s\n", ITEMS, sizeof(item_t), CAPACITY, ITEMS / seconds / 1e6);
+}
+
+int main()
+{
+    test_single_thread();
+    test_two_threads();
+    return test_result("spsc_queue");
+}
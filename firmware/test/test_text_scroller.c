@@ -0,0 +1,155 @@
+/*
+ * font.c and text_scroller.c: glyphs drawn out against their pictures, the exact column stream of a
+ * looping string with its spacing and gap, and text scrolled into a matrix with matrix_shift_in_column
+ * the way led_manager.c does, read back off the matrix.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "font.h"
+#include "text_scroller.h"
+#include "matrix.h"
+#include "test.h"
+
+#define MATRIX_WIDTH 12
+#define MATRIX_HEIGHT 9
+#define TEXT_TOP 1                  // Font row 0 on matrix row 1, centered like led_manager.c
+
+// One string per font row, '#' for a lit pixel
+static void draw_glyph(char c, char rows[FONT_HEIGHT][FONT_WIDTH + 1])
+{
+    const uint8_t* glyph = font_glyph(c);
+    for (int row = 0; row < FONT_HEIGHT; row++) {
+        for (int column = 0; column < FONT_WIDTH; column++) {
+            rows[row][column] = glyph[column] >> row & 1 ? '#' : ' ';
+        }
+        rows[row][FONT_WIDTH] = '\0';
+    }
+}
+
+static void check_glyph(char c, const char* const picture[FONT_HEIGHT])
+{
+    char rows[FONT_HEIGHT][FONT_WIDTH + 1];
+    draw_glyph(c, rows);
+    for (int row = 0; row < FONT_HEIGHT; row++) {
+        if (strcmp(rows[row], picture[row]) != 0) {
+            fprintf(stderr, "'%c' row %d is \"%s\", expected \"%s\"\n", c, row, rows[row], picture[row]);
+            test_failures++;
+        }
+    }
+}
+
+static void test_font()
+{
+    const char* const a[FONT_HEIGHT] = {" ### ", "#   #", "#   #", "#   #", "#####", "#   #", "#   #"};
+    const char* const g[FONT_HEIGHT] = {"     ", " ####", "#   #", "#   #", " ####", "    #", " ### "};
+    const char* const seven[FONT_HEIGHT] = {"#####", "    #", "   # ", "  #  ", " #   ", " #   ", " #   "};
+    check_glyph('A', a);
+    check_glyph('7', seven);
+    // Descenders reach the bottom row
+    check_glyph('g', g);
+
+    // Every glyph fits in 7 rows, and everything but the space lights something
+    for (int c = FONT_FIRST; c <= FONT_LAST; c++) {
+        const uint8_t* glyph = font_glyph(c);
+        uint8_t lit = 0;
+        for (int column = 0; column < FONT_WIDTH; column++) {
+            CHECK_EQ(glyph[column] >> FONT_HEIGHT, 0);
+            lit |= glyph[column];
+        }
+        CHECK(c == ' ' ? lit == 0 : lit != 0);
+    }
+    // Anything unprintable shows as '?'
+    const uint8_t* question = font_glyph('?');
+    CHECK(font_glyph('\n') == question);
+    CHECK(font_glyph(0x7F) == question);
+    CHECK(font_glyph((char)0xC3) == question);
+    CHECK(font_glyph('\0') == question);
+    CHECK(font_glyph(FONT_FIRST) != question);
+    CHECK(font_glyph(FONT_LAST) != question);
+}
+
+static void test_stream()
+{
+    text_scroller_t scroller;
+    // Each glyph, one blank spacing column, then the gap, then around again
+    const uint16_t gap = 8;
+    text_scroller_start(&scroller, "Hi", gap);
+    const uint16_t period = 2 * (FONT_WIDTH + TEXT_SCROLLER_SPACING) + gap;
+    uint32_t wrong = 0;
+    for (int lap = 0; lap < 3; lap++) {
+        for (uint16_t step = 0; step < period; step++) {
+            uint8_t expected = 0;
+            uint16_t glyph = step / (FONT_WIDTH + TEXT_SCROLLER_SPACING);
+            uint16_t column = step % (FONT_WIDTH + TEXT_SCROLLER_SPACING);
+            if (glyph < 2 && column < FONT_WIDTH) {
+                expected = font_glyph("Hi"[glyph])[column];
+            }
+            wrong += text_scroller_next_column(&scroller) != expected;
+        }
+    }
+    CHECK_EQ(wrong, 0);
+
+    // An empty string is only gap, and a gap of 0 still moves
+    text_scroller_start(&scroller, "", 0);
+    for (int step = 0; step < 10; step++) {
+        CHECK_EQ(text_scroller_next_column(&scroller), 0);
+    }
+    text_scroller_start(&scroller, "!", 0);
+    uint8_t stream[14];
+    for (int step = 0; step < 14; step++) {
+        stream[step] = text_scroller_next_column(&scroller);
+    }
+    // '!' is lit in its middle column, then 3 blanks (2 in the glyph, 1 spacing) and 1 of gap
+    const uint8_t bang[14] = {0, 0, 0x5F, 0, 0, 0, 0, 0, 0, 0x5F, 0, 0, 0, 0};
+    CHECK(memcmp(stream, bang, sizeof(stream)) == 0);
+}
+
+static void test_scroll_into_matrix()
+{
+    static uint8_t pixels[MATRIX_WIDTH * MATRIX_HEIGHT][MATRIX_BYTES_PER_PIXEL];
+    const matrix_t matrix = { .pixels = pixels, .width = MATRIX_WIDTH, .height = MATRIX_HEIGHT };
+    const uint8_t background[MATRIX_BYTES_PER_PIXEL] = {0, 0, 10, 0};
+    const uint8_t foreground[MATRIX_BYTES_PER_PIXEL] = {255, 128, 0, 0};
+    matrix_fill_rect(&matrix, 0, 0, MATRIX_WIDTH, MATRIX_HEIGHT, background);
+
+    text_scroller_t scroller;
+    text_scroller_start(&scroller, "OK", MATRIX_WIDTH);
+    // Enough steps that "OK" is fully inside: its 12 columns end at the right edge
+    uint8_t column[MATRIX_HEIGHT][MATRIX_BYTES_PER_PIXEL];
+    for (int step = 0; step < 2 * (FONT_WIDTH + TEXT_SCROLLER_SPACING); step++) {
+        uint8_t bits = text_scroller_next_column(&scroller);
+        for (uint16_t row = 0; row < MATRIX_HEIGHT; row++) {
+            uint16_t font_row = row - TEXT_TOP;
+            memcpy(column[row], font_row < FONT_HEIGHT && (bits >> font_row & 1) ? foreground : background, MATRIX_BYTES_PER_PIXEL);
+        }
+        matrix_shift_in_column(&matrix, (const uint8_t (*)[MATRIX_BYTES_PER_PIXEL])column);
+    }
+
+    // Read the text back off the matrix
+    uint32_t wrong = 0;
+    for (uint16_t x = 0; x < MATRIX_WIDTH; x++) {
+        uint16_t glyph = x / (FONT_WIDTH + TEXT_SCROLLER_SPACING);
+        uint16_t glyph_column = x % (FONT_WIDTH + TEXT_SCROLLER_SPACING);
+        uint8_t bits = glyph_column < FONT_WIDTH ? font_glyph("OK"[glyph])[glyph_column] : 0;
+        for (uint16_t y = 0; y < MATRIX_HEIGHT; y++) {
+            uint16_t font_row = y - TEXT_TOP;
+            bool lit = font_row < FONT_HEIGHT && (bits >> font_row & 1);
+            wrong += memcmp(pixels[y * MATRIX_WIDTH + x], lit ? foreground : background, MATRIX_BYTES_PER_PIXEL) != 0;
+        }
+    }
+    CHECK_EQ(wrong, 0);
+    // The rows outside the font stay background
+    for (uint16_t x = 0; x < MATRIX_WIDTH; x++) {
+        CHECK(memcmp(pixels[x], background, MATRIX_BYTES_PER_PIXEL) == 0);
+        CHECK(memcmp(pixels[(MATRIX_HEIGHT - 1) * MATRIX_WIDTH + x], background, MATRIX_BYTES_PER_PIXEL) == 0);
+    }
+}
+
+int main()
+{
+    test_font();
+    test_stream();
+    test_scroll_into_matrix();
+    return test_result("text_scroller");
+}
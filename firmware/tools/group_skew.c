@@ -0,0 +1,398 @@
+/*
+ * Measures how closely the members of a group apply a command and step a timed effect, running the
+ * firmware's group protocol (firmware/main/group_protocol.c) in several processes over loopback multicast.
+ *
+ * Build and run on the host (Linux):
+ *     cc -O2 -Ifirmware/main -o group_skew firmware/tools/group_skew.c firmware/main/group_protocol.c
+ *     ./group_skew [members] [commands] [jitter_us]
+ *
+ * Process 0 is the clock leader and sends the commands, like a controller handling POST /group.
+ * Every process runs on its own simulated clock, started up to 1000 s apart like esp_timer after boot, drifting by up to
+ * 50 ppm, syncs to the leader like the firmware does and applies each command when its clock says
+ * so. Two skews are reported per command, as the spread across members in true (CLOCK_MONOTONIC)
+ * time: clock skew, when each member's clock reached the execution time, which is the error of the
+ * sync alone, and apply skew, when each process actually ran it, which adds wakeup latency and
+ * grows with the member count when the host has fewer cores than members.
+ * Every process also steps an effect every 20 ms of the group clock from the end of the warmup on, the
+ * way led_manager.c times Blinky, Morse Code and text, and the same two skews are reported for each
+ * step, in steady state since the warmup is over.
+ * jitter_us holds every sync packet for a random time before sending, after its timestamp is
+ * taken, to stand in for a busy network.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "group_protocol.h"
+
+#define GROUP_ADDRESS "239.255.76.67"
+#define GROUP_PORT 7667
+#define GROUP_ID 1
+#define SYNC_INTERVAL_US 500000         // Same as the firmware
+#define WARMUP_US 3000000               // Sync exchanges before the first command
+#define COMMAND_INTERVAL_US 250000
+#define COMMAND_DELAY_US 100000
+#define COMMAND_REPEATS 3
+#define MAX_OFFSET_US 1000000000LL
+#define MAX_DRIFT_PPM 50
+#define MAX_MEMBERS 64
+#define MAX_COMMANDS 1000
+#define STEP_US 20000                   // Effect period, one frame at 50 fps
+
+typedef struct {
+    int64_t start;              // True time the simulation started
+    int64_t offset;
+    double rate;
+} sim_clock_t;
+
+static int64_t true_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t local_now(const sim_clock_t* clock)
+{
+    return clock->offset + (int64_t)((true_now() - clock->start) * clock->rate);
+}
+
+// True time at which a simulated clock reads local
+static int64_t true_at(const sim_clock_t* clock, int64_t local)
+{
+    return clock->start + (int64_t)((local - clock->offset) / clock->rate);
+}
+
+static int open_socket(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY) };
+    struct ip_mreq membership = { .imr_multiaddr.s_addr = inet_addr(GROUP_ADDRESS), .imr_interface.s_addr = inet_addr("127.0.0.1") };
+    struct in_addr interface = { .s_addr = inet_addr("127.0.0.1") };
+    unsigned char loop = 1;     // Every member is on this host
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        (port && setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) ||
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) < 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+        perror("socket");
+        exit(1);
+    }
+    return fd;
+}
+
+static void hold(int jitter_us)
+{
+    if (jitter_us) usleep(rand() % jitter_us);
+}
+
+static void send_packet(int fd, const group_packet_t* packet, const struct sockaddr_in* to)
+{
+    uint8_t buf[GROUP_PACKET_MAX_SIZE];
+    size_t len = group_packet_encode(packet, buf);
+    sendto(fd, buf, len, 0, (const struct sockaddr*)to, sizeof(*to));
+}
+
+// Same as led_manager.c: the step a timer that fired slightly early belongs to
+static int64_t nearest_step(int64_t time, int64_t period)
+{
+    return (time + period / 2) / period * period;
+}
+
+static void report_line(int report_fd, char kind, int index, long long id, int64_t done_at, int64_t due_at)
+{
+    char line[96];
+    int len = snprintf(line, sizeof(line), "%c %d %lld %lld %lld\n", kind, index, id, (long long)done_at, (long long)due_at);
+    write(report_fd, line, len);
+}
+
+// Group clock of a member, its own clock on the leader
+static int64_t to_group(bool leader, const group_clock_t* group_clock, int64_t local)
+{
+    return leader ? local : group_clock_to_group(group_clock, local);
+}
+
+static int64_t to_local(bool leader, const group_clock_t* group_clock, int64_t group)
+{
+    return leader ? group : group_clock_to_local(group_clock, group);
+}
+
+// Runs one member until every command was applied or the time is up, reporting a
+// "C member command applied_at due_at" line per command and a "S member step stepped_at due_at"
+// line per effect step, all in true time
+static void run_member(int index, int commands, int jitter_us, int report_fd, int64_t start)
+{
+    srand(getpid());
+    prctl(PR_SET_TIMERSLACK, 1UL);      // Wake up on time rather than within the default 50 us
+    sim_clock_t clock = {
+        .start = start,
+        .offset = ((int64_t)rand() << 16 ^ rand()) % MAX_OFFSET_US,
+        .rate = 1.0 + (rand() % (2 * MAX_DRIFT_PPM * 1000) - MAX_DRIFT_PPM * 1000) * 1e-9
+    };
+    bool leader = index == 0;
+    uint32_t sender_id = (uint32_t)rand() << 1 ^ index;
+    uint32_t sequence = rand();
+    struct sockaddr_in group_addr = { .sin_family = AF_INET, .sin_port = htons(GROUP_PORT), .sin_addr.s_addr = inet_addr(GROUP_ADDRESS) };
+    // The firmware has one socket per device; here every process shares the group port, so sync
+    // replies come back on a socket of the member's own
+    int group_fd = open_socket(GROUP_PORT);
+    int sync_fd = open_socket(0);
+
+    group_clock_t group_clock;
+    group_pending_t pending;
+    group_dedup_t dedup;
+    group_clock_init(&group_clock);
+    group_pending_init(&pending);
+    group_dedup_init(&dedup);
+    int64_t last_request_t1 = 0;
+    int64_t next_sync = local_now(&clock);
+    int64_t next_command = WARMUP_US;   // Leader only, true time since start
+    int64_t next_step = 0;              // Group clock, 0 until the warmup is over
+    int sent = 0;
+    int applied = 0;
+    int64_t deadline = start + WARMUP_US + (int64_t)commands * COMMAND_INTERVAL_US + 2000000;
+
+    while (applied < commands && true_now() < deadline) {
+        int64_t now = local_now(&clock);
+        if (!leader && now >= next_sync) {
+            group_packet_t request = { .type = GROUP_PACKET_SYNC_REQUEST, .group = GROUP_ID, .sender = sender_id, .sequence = ++sequence };
+            request.sync_request.t1 = last_request_t1 = local_now(&clock);
+            hold(jitter_us);
+            send_packet(sync_fd, &request, &group_addr);
+            next_sync = now + SYNC_INTERVAL_US;
+        }
+        if (leader && sent < commands && true_now() - start >= next_command) {
+            // Command number rides in the duration so the report can match members up
+            group_packet_t command = {
+                .type = GROUP_PACKET_COMMAND, .group = GROUP_ID, .sender = sender_id, .sequence = ++sequence,
+                .command = { .execute_at = local_now(&clock) + COMMAND_DELAY_US, .action = { .has_duration = true, .blink_duration = sent } }
+            };
+            group_pending_add(&pending, command.command.execute_at, &command.command.action);
+            for (int i = 0; i < COMMAND_REPEATS; i++) {
+                send_packet(group_fd, &command, &group_addr);
+            }
+            sent++;
+            next_command += COMMAND_INTERVAL_US;
+        }
+
+        group_action_t action;
+        int64_t due;
+        while (group_pending_next(&pending, &due) && group_pending_pop_due(&pending, local_now(&clock), &action)) {
+            report_line(report_fd, 'C', index, action.blink_duration, true_now(), true_at(&clock, due));
+            applied++;
+        }
+
+        if (!next_step && true_now() - start >= WARMUP_US && (leader || group_clock_synced(&group_clock))) {
+            next_step = nearest_step(to_group(leader, &group_clock, local_now(&clock)), STEP_US) + STEP_US;
+        }
+        if (next_step) {
+            int64_t step_at = to_local(leader, &group_clock, next_step);
+            if (local_now(&clock) >= step_at) {
+                report_line(report_fd, 'S', index, next_step / STEP_US, true_now(), true_at(&clock, step_at));
+                next_step = nearest_step(to_group(leader, &group_clock, local_now(&clock)), STEP_US) + STEP_US;
+            }
+        }
+
+        // Sleep until a packet, the next due command or effect step, or the next sync request, in true time
+        int64_t wait = 10000;
+        if (group_pending_next(&pending, &due)) {
+            int64_t until_due = (int64_t)((due - local_now(&clock)) / clock.rate);
+            if (until_due < wait) wait = until_due;
+        }
+        if (next_step) {
+            int64_t until_step = (int64_t)((to_local(leader, &group_clock, next_step) - local_now(&clock)) / clock.rate);
+            if (until_step < wait) wait = until_step;
+        }
+        if (!leader && next_sync - local_now(&clock) < wait) wait = next_sync - local_now(&clock);
+        if (wait < 0) wait = 0;
+        struct pollfd fds[2] = { { .fd = group_fd, .events = POLLIN }, { .fd = sync_fd, .events = POLLIN } };
+        struct timespec timeout = { .tv_sec = wait / 1000000, .tv_nsec = wait % 1000000 * 1000 };
+        if (ppoll(fds, 2, &timeout, NULL) <= 0) continue;
+
+        for (int i = 0; i < 2; i++) {
+            if (!(fds[i].revents & POLLIN)) continue;
+            uint8_t buf[GROUP_PACKET_MAX_SIZE];
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            ssize_t len = recvfrom(fds[i].fd, buf, sizeof(buf), 0, (struct sockaddr*)&from, &from_len);
+            int64_t received = local_now(&clock);
+            group_packet_t packet;
+            if (len <= 0 || !group_packet_decode(buf, len, &packet) || packet.group != GROUP_ID || packet.sender == sender_id) continue;
+
+            switch (packet.type) {
+                case GROUP_PACKET_SYNC_REQUEST: {
+                    if (!leader) break;
+                    group_packet_t reply = {
+                        .type = GROUP_PACKET_SYNC_REPLY, .group = GROUP_ID, .sender = sender_id, .sequence = packet.sequence,
+                        .sync_reply = { .requester = packet.sender, .t1 = packet.sync_request.t1, .t2 = received }
+                    };
+                    reply.sync_reply.t3 = local_now(&clock);
+                    hold(jitter_us);
+                    send_packet(group_fd, &reply, &from);
+                    break;
+                }
+                case GROUP_PACKET_SYNC_REPLY:
+                    if (packet.sync_reply.requester == sender_id && packet.sync_reply.t1 == last_request_t1) {
+                        group_clock_add_sample(&group_clock, packet.sync_reply.t1, packet.sync_reply.t2, packet.sync_reply.t3, received);
+                    }
+                    break;
+                case GROUP_PACKET_COMMAND:
+                    if (group_dedup_seen(&dedup, packet.sender, packet.sequence)) break;
+                    if (!group_clock_synced(&group_clock)) {
+                        fprintf(stderr, "member %d: command before the first sync\n", index);
+                        break;
+                    }
+                    group_pending_add(&pending, group_clock_to_local(&group_clock, packet.command.execute_at), &packet.command.action);
+                    break;
+            }
+        }
+    }
+    // Leader minus member drift is what the member should have estimated
+    if (leader) {
+        fprintf(stderr, "leader   : drift %+6.1f ppm\n", (clock.rate - 1.0) * 1e6);
+    } else {
+        fprintf(stderr, "member %2d: drift %+6.1f ppm, leader's estimated %+6.1f ppm, offset error bound %5lld us\n", index,
+                (clock.rate - 1.0) * 1e6, group_clock_drift_ppb(&group_clock) / 1000.0, (long long)group_clock_delay(&group_clock) / 2);
+    }
+}
+
+static int compare_i64(const void* a, const void* b)
+{
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int64_t spread(const int64_t* times, int count)
+{
+    int64_t min = times[0];
+    int64_t max = times[0];
+    for (int i = 1; i < count; i++) {
+        if (times[i] < min) min = times[i];
+        if (times[i] > max) max = times[i];
+    }
+    return max - min;
+}
+
+typedef struct {
+    int count;
+    int64_t min_done;
+    int64_t max_done;
+    int64_t min_due;
+    int64_t max_due;
+} step_t;
+
+static void print_spreads(const char* name, int64_t* spreads, int count)
+{
+    qsort(spreads, count, sizeof(spreads[0]), compare_i64);
+    int64_t total = 0;
+    for (int i = 0; i < count; i++) total += spreads[i];
+    printf("  %s (max - min across members): mean %lld us, median %lld us, 99th percentile %lld us, max %lld us\n",
+           name, (long long)(total / count), (long long)spreads[count / 2], (long long)spreads[count * 99 / 100],
+           (long long)spreads[count - 1]);
+}
+
+int main(int argc, char** argv)
+{
+    int members = argc > 1 ? atoi(argv[1]) : 8;
+    int commands = argc > 2 ? atoi(argv[2]) : 20;
+    int jitter_us = argc > 3 ? atoi(argv[3]) : 0;
+    if (members < 2 || members > MAX_MEMBERS || commands < 1 || commands > MAX_COMMANDS || jitter_us < 0) {
+        fprintf(stderr, "usage: %s [members 2-%d] [commands 1-%d] [jitter_us]\n", argv[0], MAX_MEMBERS, MAX_COMMANDS);
+        return 1;
+    }
+
+    int report[2];
+    if (pipe(report) < 0) {
+        perror("pipe");
+        return 1;
+    }
+    int64_t start = true_now();
+    for (int i = 0; i < members; i++) {
+        if (fork() == 0) {
+            close(report[0]);
+            run_member(i, commands, jitter_us, report[1], start);
+            _exit(0);
+        }
+    }
+    close(report[1]);
+
+    // Due times show the clock sync alone, apply times add how late each process woke up
+    static int64_t applied_at[MAX_COMMANDS][MAX_MEMBERS];
+    static int64_t due_at[MAX_COMMANDS][MAX_MEMBERS];
+    static int applied_count[MAX_COMMANDS];
+    // Steps are numbered on the leader's clock, so they are kept relative to the first one seen
+    int step_capacity = (WARMUP_US + commands * COMMAND_INTERVAL_US + 4000000) / STEP_US;
+    step_t* steps = calloc(step_capacity, sizeof(step_t));
+    long long first_step = -1;
+    FILE* in = fdopen(report[0], "r");
+    char kind;
+    int member;
+    long long id, done, due;
+    while (fscanf(in, " %c %d %lld %lld %lld", &kind, &member, &id, &done, &due) == 5) {
+        if (kind == 'C' && id >= 0 && id < commands) {
+            applied_at[id][applied_count[id]] = done;
+            due_at[id][applied_count[id]++] = due;
+        } else if (kind == 'S') {
+            if (first_step < 0) first_step = id;
+            long long slot = id - first_step;
+            if (slot < 0 || slot >= step_capacity) continue;
+            step_t* step = &steps[slot];
+            if (step->count++ == 0) {
+                step->min_done = step->max_done = done;
+                step->min_due = step->max_due = due;
+            }
+            if (done < step->min_done) step->min_done = done;
+            if (done > step->max_done) step->max_done = done;
+            if (due < step->min_due) step->min_due = due;
+            if (due > step->max_due) step->max_due = due;
+        }
+    }
+    while (wait(NULL) > 0) {
+    }
+
+    static int64_t clock_spreads[MAX_COMMANDS];
+    static int64_t apply_spreads[MAX_COMMANDS];
+    int complete = 0;
+    int missing = 0;
+    for (int c = 0; c < commands; c++) {
+        missing += members - applied_count[c];
+        if (applied_count[c] < members) continue;
+        clock_spreads[complete] = spread(due_at[c], members);
+        apply_spreads[complete++] = spread(applied_at[c], members);
+    }
+    if (complete == 0) {
+        fprintf(stderr, "No command reached every member\n");
+        return 1;
+    }
+    printf("%d members, %d commands, %d us jitter, %d applies missing\n", members, commands, jitter_us, missing);
+    print_spreads("clock skew", clock_spreads, complete);
+    print_spreads("apply skew", apply_spreads, complete);
+
+    // Only steps every member took, the first and last ones overlap the members starting and stopping
+    int64_t* step_clock_spreads = malloc(step_capacity * sizeof(int64_t));
+    int64_t* step_spreads = malloc(step_capacity * sizeof(int64_t));
+    int step_count = 0;
+    for (int i = 0; i < step_capacity; i++) {
+        if (steps[i].count != members) continue;
+        step_clock_spreads[step_count] = steps[i].max_due - steps[i].min_due;
+        step_spreads[step_count++] = steps[i].max_done - steps[i].min_done;
+    }
+    if (step_count) {
+        printf("%d effect steps every %d ms\n", step_count, STEP_US / 1000);
+        print_spreads("clock skew", step_clock_spreads, step_count);
+        print_spreads("step skew", step_spreads, step_count);
+    }
+    return 0;
+}
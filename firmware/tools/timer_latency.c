@@ -0,0 +1,169 @@
+/*
+ * Simulates the esp_timer task on a host to compare how late other timers fire when the Blinky
+ * callback refreshes the strip itself (before the render task) and when it only notifies the render
+ * task (now).
+ *
+ * Build and run on the host (Linux):
+ *     cc -O2 -o timer_latency firmware/tools/timer_latency.c -lpthread
+ *     ./timer_latency [pixels] [seconds]
+ *
+ * One thread stands in for the esp_timer task and runs callbacks one after another in deadline order,
+ * like esp_timer's dispatch. A 1 ms periodic timer stands in for the Wi-Fi and other system timers and
+ * records how late each of its callbacks starts. A blink timer toggles every 50 ms. Before, its
+ * callback spins for the refresh's wire time (30 us per WS2812 pixel plus the 280 us latch) and formats
+ * the log line, as activate_light did. Now it wakes a render thread that does the same work off the
+ * timer thread, like blinky_timer_callback with the render task. Each run reports percentiles of the
+ * 1 ms timer's lateness. On a host with a single core the render thread still competes with the timer
+ * thread, so the worst case stays high; on the device the render task has core 1 to itself.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define SYSTEM_PERIOD_US 1000
+#define BLINK_PERIOD_US 50000
+#define PIXEL_WIRE_NS 30000     // 24 bits at 1.25 us
+#define LATCH_NS 280000
+#define MAX_SAMPLES 200000
+
+typedef struct {
+    int64_t due_ns;
+    int64_t period_ns;
+    void (*callback)(void);
+} sim_timer_t;
+
+static int pixels;
+static bool deferred;
+static int64_t lateness[MAX_SAMPLES];
+static int samples;
+static int64_t current_lateness;
+
+static pthread_mutex_t render_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t render_wake = PTHREAD_COND_INITIALIZER;
+static int render_pending;
+static bool render_stop;
+static volatile bool lit;
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_until(int64_t ns)
+{
+    struct timespec ts = { .tv_sec = ns / 1000000000LL, .tv_nsec = ns % 1000000000LL };
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+// The RMT refresh blocks the caller for the whole transmission, plus the ESP_LOGI formatting
+static void refresh_strip()
+{
+    int64_t end = now_ns() + (int64_t)pixels * PIXEL_WIRE_NS + LATCH_NS;
+    char line[96];
+    snprintf(line, sizeof(line), "I (%lld) led_manager: LED %s, %d pixels", (long long)(end / 1000000), lit ? "On" : "Off", pixels);
+    while (now_ns() < end) {
+    }
+    __asm__ volatile("" : : "r"(line) : "memory");
+}
+
+static void system_callback()
+{
+    if (samples < MAX_SAMPLES) {
+        lateness[samples++] = current_lateness;
+    }
+}
+
+static void blink_callback()
+{
+    lit = !lit;
+    if (!deferred) {
+        refresh_strip();
+        return;
+    }
+    pthread_mutex_lock(&render_lock);
+    render_pending++;
+    pthread_cond_signal(&render_wake);
+    pthread_mutex_unlock(&render_lock);
+}
+
+static void* render_task(void* arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&render_lock);
+    while (!render_stop) {
+        if (!render_pending) {
+            pthread_cond_wait(&render_wake, &render_lock);
+            continue;
+        }
+        render_pending = 0;
+        pthread_mutex_unlock(&render_lock);
+        refresh_strip();
+        pthread_mutex_lock(&render_lock);
+    }
+    pthread_mutex_unlock(&render_lock);
+    return NULL;
+}
+
+// esp_timer dispatch: the earliest due timer runs next, callbacks never overlap
+static void run_timers(int seconds)
+{
+    int64_t start = now_ns();
+    sim_timer_t timers[] = {
+        { start + SYSTEM_PERIOD_US * 1000LL, SYSTEM_PERIOD_US * 1000LL, system_callback },
+        { start + BLINK_PERIOD_US * 1000LL, BLINK_PERIOD_US * 1000LL, blink_callback }
+    };
+    int64_t end = start + seconds * 1000000000LL;
+    while (now_ns() < end) {
+        sim_timer_t* next = timers[0].due_ns <= timers[1].due_ns ? &timers[0] : &timers[1];
+        sleep_until(next->due_ns);
+        current_lateness = now_ns() - next->due_ns;
+        next->callback();
+        next->due_ns += next->period_ns;
+    }
+}
+
+static int compare(const void* a, const void* b)
+{
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char* name)
+{
+    qsort(lateness, samples, sizeof(lateness[0]), compare);
+    printf("%-18s %6d samples  p50 %7.1f us  p99 %7.1f us  max %7.1f us\n", name, samples,
+           lateness[samples / 2] / 1e3, lateness[samples * 99 / 100] / 1e3, lateness[samples - 1] / 1e3);
+}
+
+int main(int argc, char** argv)
+{
+    pixels = argc > 1 ? atoi(argv[1]) : 300;
+    int seconds = argc > 2 ? atoi(argv[2]) : 5;
+    printf("%d pixels, refresh %.2f ms, lateness of a 1 ms timer next to a 50 ms blink:\n", pixels,
+           ((int64_t)pixels * PIXEL_WIRE_NS + LATCH_NS) / 1e6);
+
+    deferred = false;
+    samples = 0;
+    run_timers(seconds);
+    report("refresh in timer");
+
+    pthread_t render;
+    pthread_create(&render, NULL, render_task, NULL);
+    deferred = true;
+    samples = 0;
+    run_timers(seconds);
+    pthread_mutex_lock(&render_lock);
+    render_stop = true;
+    pthread_cond_signal(&render_wake);
+    pthread_mutex_unlock(&render_lock);
+    pthread_join(render, NULL);
+    report("render task");
+    return 0;
+}
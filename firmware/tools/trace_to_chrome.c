@@ -0,0 +1,116 @@
+/*
+ * Converts a GET /trace dump into Chrome trace JSON (chrome://tracing, Perfetto).
+ *
+ * Build and run on the host:
+ *     cc -O2 -o trace_to_chrome firmware/tools/trace_to_chrome.c
+ *     curl -s http://<esp-ip>/trace -o trace.bin
+ *     ./trace_to_chrome trace.bin > trace.json
+ *
+ * The layout below mirrors trace_header_t and trace_entry_t in firmware/main/trace.h.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TRACE_FORMAT_VERSION 1
+
+enum {
+    TRACE_RENDER_START,
+    TRACE_RENDER_END,
+    TRACE_REFRESH_START,
+    TRACE_REFRESH_END,
+    TRACE_REQUEST,
+    TRACE_TIMER_FIRE
+};
+
+static uint32_t read_u32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_u16(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+int main(int argc, char** argv)
+{
+    FILE* in = argc > 1 ? fopen(argv[1], "rb") : stdin;
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    uint8_t header[16];
+    if (fread(header, 1, sizeof(header), in) != sizeof(header) || memcmp(header, "LEDT", 4) != 0) {
+        fprintf(stderr, "Not a trace dump\n");
+        return 1;
+    }
+    uint16_t version = read_u16(header + 4);
+    uint16_t entry_size = read_u16(header + 6);
+    uint32_t count = read_u32(header + 8);
+    uint32_t dropped = read_u32(header + 12);
+    if (version != TRACE_FORMAT_VERSION || entry_size < 8) {
+        fprintf(stderr, "Unsupported trace format %u (entry size %u)\n", version, entry_size);
+        return 1;
+    }
+    fprintf(stderr, "%u entries, %u dropped before the dump\n", count, dropped);
+
+    printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    printf("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"esp32 led controller\"}}");
+    for (int core = 0; core < 2; core++) {
+        printf(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"core %d\"}}", core, core);
+    }
+
+    // Timestamps are 32-bit microseconds, unwrap them into a 64-bit timeline. Deltas are signed
+    // because concurrent producers can claim slots slightly out of timestamp order
+    int64_t now = 0;
+    uint32_t previous = 0;
+    uint8_t entry[256];
+    for (uint32_t i = 0; i < count; i++) {
+        if (fread(entry, 1, entry_size, in) != entry_size) {
+            fprintf(stderr, "Truncated after %u entries\n", i);
+            break;
+        }
+        uint32_t timestamp = read_u32(entry);
+        now = i == 0 ? timestamp : now + (int32_t)(timestamp - previous);
+        previous = timestamp;
+
+        uint8_t event = entry[4];
+        uint8_t core = entry[5];
+        uint16_t arg = read_u16(entry + 6);
+        const char* fmt;
+        const char* name;
+        switch (event) {
+            case TRACE_RENDER_START:
+            case TRACE_RENDER_END:
+                name = "render";
+                fmt = event == TRACE_RENDER_START ? "B" : "E";
+                break;
+            case TRACE_REFRESH_START:
+            case TRACE_REFRESH_END:
+                name = "refresh";
+                fmt = event == TRACE_REFRESH_START ? "B" : "E";
+                break;
+            case TRACE_REQUEST:
+                name = "request";
+                fmt = "i";
+                break;
+            case TRACE_TIMER_FIRE:
+                name = "timer";
+                fmt = "i";
+                break;
+            default:
+                name = "unknown";
+                fmt = "i";
+        }
+        printf(
+            ",\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%lld,\"pid\":0,\"tid\":%u,%s\"args\":{\"arg\":%u}}",
+            name, fmt, (long long)now, core, fmt[0] == 'i' ? "\"s\":\"t\"," : "", arg
+        );
+    }
+    printf("\n]}\n");
+
+    if (in != stdin) fclose(in);
+    return 0;
+}